@@ -0,0 +1,24 @@
+// Heap use of the benchmark executable, counted by its replacement of the global operator new and delete
+
+#pragma once
+
+#include <cstddef>
+
+namespace AllocationCounter
+{
+	// Allocations made since the scope started and the most heap bytes live on top of what was live then. Scopes
+	// share one peak, so they must not overlap.
+	class Scope
+	{
+	public:
+		Scope();
+		size_t allocations() const;
+		size_t allocatedBytes() const; // Sum of every allocation, freed or not
+		size_t peakBytes() const;
+
+	private:
+		size_t baselineLive;
+		size_t baselineCount;
+		size_t baselineBytes;
+	};
+}
\ No newline at end of file
@@ -11,6 +11,11 @@ public:
 	void orbit(float dx, float dy); // Adjust camera angles based on mouse movement
 	void zoom(float delta); // Adjust camera distance based on scroll input
 	DirectX::XMFLOAT4X4 getMVPMatrix(float aspectRatio) const; // Get the combined Model-View-Projection matrix
+	DirectX::XMMATRIX getViewMatrix() const;
+	DirectX::XMMATRIX getProjectionMatrix(float aspectRatio) const;
+	float getVerticalFov() const; // Radians
+	const DirectX::XMFLOAT3& getPosition() const;
+	void setTarget(const DirectX::XMFLOAT3& newTarget); // Orbit around a new point, keeping distance and angles
 
 private:
 	DirectX::XMFLOAT3 position;
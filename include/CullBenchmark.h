@@ -0,0 +1,8 @@
+// Times frustum culling of a model's index chunks over a scripted set of camera poses
+
+#pragma once
+
+#include <QString>
+
+// Logs visible chunk and triangle fractions and cull time per instruction set, and checks the SIMD paths against scalar
+bool runCullBenchmark(const QString& filePath);
\ No newline at end of file
@@ -0,0 +1,24 @@
+// FrameFence over an ID3D12Fence, the only D3D12 part of the frame pacing
+
+#pragma once
+
+#include <d3d12.h>
+#include <wrl.h>
+#include "FrameRing.h"
+
+class D3D12FrameFence : public FrameFence
+{
+public:
+	~D3D12FrameFence() override;
+
+	void create(ID3D12Device* device); // Throws std::runtime_error like the rest of the D3D12 setup
+	uint64_t signal(ID3D12CommandQueue* queue); // Signals the next value after the queue's submitted work and returns it
+
+	uint64_t completedValue() const override;
+	void wait(uint64_t value) override;
+
+private:
+	Microsoft::WRL::ComPtr<ID3D12Fence> fence;
+	HANDLE event = nullptr;
+	uint64_t lastSignaled = 0;
+};
\ No newline at end of file
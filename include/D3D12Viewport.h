@@ -7,21 +7,24 @@
 #include <dxgi1_6.h>
 #include <wrl.h>
 #include <QVector3D>
+#include <memory>
 #include <vector>
 #include "Model.h"
 #include <QMatrix4x4>
 #include <DirectXMath.h>
 #include "Camera.h"
 #include <QMouseEvent>
+#include "VertexQuantizer.h"
+#include "TriangleBvh.h"
+#include "FrustumCuller.h"
+#include "MeshSimplifier.h"
+#include "MeshPacker.h"
+#include "D3D12FrameFence.h"
+#include "FrameRing.h"
+#include "Scene.h"
 
 using Microsoft::WRL::ComPtr;
 
-struct Vertex
-{
-	QVector3D position;
-	QVector3D normal;
-};
-
 class D3D12Viewport : public QWidget
 {
 	Q_OBJECT
@@ -32,8 +35,26 @@ public:
 
 	// Override paintEngine to return nullptr for Direct3D rendering
 	QPaintEngine* paintEngine() const override { return nullptr; }
-	void loadModel(const Model* model);
+	// A scene of model alone, one root node at identity referencing it as mesh 0
+	void loadModel(std::shared_ptr<const Model> model); // Packs on the calling thread straight into the upload heaps
+	void loadPackedModel(std::shared_ptr<const Model> model, PackedMesh&& mesh); // mesh was packed from model, e.g. by ModelLoader
+	void loadPackedScene(Scene&& newScene, std::vector<PackedMesh>&& meshes); // meshes[i] was packed from mesh i of newScene
+	// Write what MeshPacker::packAppend() packed for model's buffers over them, then draw model as appended. False,
+	// leaving everything as it was, when model is not loaded or its buffers are not the ones append was packed for.
+	bool appendPackedModel(const Model* model, PackedAppend&& append);
+	AppendCapacity getAppendCapacity(const Model* model) const; // Empty unless model is loaded with room to grow
+	// For MeshPacker::pack() on any thread: upload heaps mapped for good, which the load functions above then bind
+	// as they are instead of copying the packed bytes
+	MeshBufferAllocator getMeshBufferAllocator() const;
+	// Every node with a mesh draws it with its world matrix, more nodes can be added as instances of the loaded
+	// meshes. Call update() after changing it.
+	Scene& getScene();
 	void toggleWireframe();
+	void setCompactVertices(bool enabled); // 12-byte quantized vertices and 16-bit indices when they fit, re-packs every mesh
+	bool getCompactVertices() const;
+
+signals:
+	void trianglePicked(unsigned int node, unsigned int triangle, unsigned int vertex, const QVector3D& point); // Click without dragging hit a mesh
 
 protected:
 	void initializeD3D12();
@@ -42,42 +63,108 @@ protected:
 
 	void mousePressEvent(QMouseEvent* event) override;
 	void mouseMoveEvent(QMouseEvent* event) override;
+	void mouseReleaseEvent(QMouseEvent* event) override;
+	void mouseDoubleClickEvent(QMouseEvent* event) override; // Picks and makes the hit point the orbit target
 	void wheelEvent(QWheelEvent* event) override;
 	void keyPressEvent(QKeyEvent* event) override;
 
 private:
+	// Full-resolution chunk of an out-of-core mesh, drawn in place of its preview triangles
+	struct RefinedChunk
+	{
+		size_t chunk = 0; // In the model's OutOfCoreMesh
+		ComPtr<ID3D12Resource> vertexBuffer;
+		ComPtr<ID3D12Resource> indexBuffer;
+		D3D12_VERTEX_BUFFER_VIEW vertexBufferView = {};
+		D3D12_INDEX_BUFFER_VIEW indexBufferView = {};
+		UINT indexCount = 0;
+		uint64_t lastFrame = 0; // frameNumber of the last frame that drew it
+	};
+
+	// Buffers, culling and picking state of one scene mesh
+	struct GpuMesh
+	{
+		ComPtr<ID3D12Resource> vertexBuffer;
+		ComPtr<ID3D12Resource> indexBuffer;
+		D3D12_VERTEX_BUFFER_VIEW vertexBufferView = {};
+		D3D12_INDEX_BUFFER_VIEW indexBufferView = {};
+		unsigned int indexCount = 0; // Of the full mesh, 0 when there is nothing to draw
+		size_t vertexCapacity = 0; // Bytes of the buffers, room for appends beyond the views
+		size_t indexCapacity = 0;
+		bool compactVertices = false; // Format of the buffers, selects the pipeline
+		PositionQuantization quantization;
+		// Frustum culling, one set of chunk bounds per LOD level, index 0 is the full mesh
+		std::vector<ChunkBounds> cullChunks;
+		// LOD levels, their indices follow the full mesh's in the index buffer
+		std::vector<LodLevel> lodLevels;
+		TriangleBvh pickBvh; // Built on the first pick after a load
+		std::vector<RefinedChunk> refinedChunks; // Out-of-core meshes only, paged in as the camera comes close
+	};
+
+	// Cast the camera ray through a widget position at every node, hit is in the space of the nearest node's mesh
+	bool pick(const QPoint& pos, uint32_t& node, PickHit& hit, QVector3D& point);
+	// Replace the scene and the buffers of all its meshes, sources[i] set packs mesh i from that model's streams
+	void uploadScene(Scene&& newScene, std::vector<PackedMesh>&& meshes, const std::vector<const Model*>& sources);
+	// Create the buffers of mesh and fill them, from source's streams in one pass when set, from mesh's bytes otherwise
+	void uploadMesh(GpuMesh& gpu, PackedMesh&& mesh, const Model* source);
+	uint32_t findMesh(const Model* model) const; // Scene mesh id of model, Scene::none if it is not loaded
+	// For a node drawing the full level of model, which is loaded out of core: page in the chunks that cover enough of
+	// the screen, list the ones to draw in refinedDraws and cut their preview triangles out of visibleRanges
+	void refineChunks(GpuMesh& gpu, const Model& model, const Frustum& frustum, const DirectX::XMMATRIX& modelMatrix, float scale);
+	bool uploadChunk(const OutOfCoreMesh& outOfCore, size_t chunk, RefinedChunk& out);
+
 	// D3D12 core components that need to be managed to render within the widget
 	ComPtr<ID3D12Device> device; // Graphics brain, represents the GPU
 	ComPtr<IDXGISwapChain3> swapChain; // Manages the buffers for rendering and presenting to the screen
 	ComPtr<ID3D12CommandQueue> commandQueue; // Sends commands to the GPU
-	ComPtr<ID3D12CommandAllocator> commandAllocator; // Allocates memory for command lists
+	static constexpr unsigned int framesInFlight = 2; // Frames the CPU may record while the GPU still renders older ones
+	ComPtr<ID3D12CommandAllocator> commandAllocators[framesInFlight]; // One per pacer slot, reset once its frame completed
 	ComPtr<ID3D12GraphicsCommandList> commandList; // Issues drawing commands
 	ComPtr<ID3D12DescriptorHeap> rtvHeap; // Manages render target views (interprets the bynary data from renderTargets)
 	ComPtr<ID3D12Resource> renderTargets[2]; // The actual buffers we render to (hold the bynary data)
 
-	// Synchronization objects
-	HANDLE fenceEvent; // Event handle for GPU synchronization
-	ComPtr<ID3D12Fence> fence; // Synchronization primitive
-	UINT64 fenceValue; // Current fence value for synchronization
+	// Synchronization objects, frames are only waited for when their slot or upload space is needed again
+	D3D12FrameFence frameFence; // Signaled after every frame's commands
+	FramePacer framePacer;
+	UploadRing uploadRing; // Per-frame constants, sub-allocated from uploadBuffer
 	UINT frameIndex; // Current frame index in the swap chain
 
 	ComPtr<ID3D12RootSignature> rootSignature; // Defines how shaders access resources
 	ComPtr<ID3D12PipelineState> pipelineState; // Encapsulates the GPU state for rendering
-	ComPtr<ID3D12Resource> vertexBuffer; // Buffer holding vertex data
-	ComPtr<ID3D12Resource> indexBuffer; // Buffer holding index data
-	ComPtr<ID3D12Resource> constantBuffer; // Buffer for passing constants to shaders
-	D3D12_VERTEX_BUFFER_VIEW vertexBufferView; // View describing the vertex buffer
-	D3D12_INDEX_BUFFER_VIEW indexBufferView; // View describing the index buffer
-	unsigned int indexCount; // Number of indices to draw
+	ComPtr<ID3D12Resource> uploadBuffer; // Persistently mapped upload heap behind uploadRing
+	unsigned char* uploadData = nullptr;
 	DirectX::XMFLOAT4X4 mvpMatrix;
 
 	Camera camera; // Camera for view and projection matrices
 	QPoint lastMousePos; // Last mouse position for camera control
 	bool leftButtonPressed; // Is the left mouse button pressed
+	QPoint pressMousePos; // Where the left button went down, a release close by is a click
+
+	Scene scene; // World matrices are brought up to date at the start of every frame
+	std::vector<GpuMesh> gpuMeshes; // Parallel to the scene's meshes
+
+	// Chunks of a node's mesh that survive culling against its MVP, scratch of every frame
+	std::vector<IndexRange> visibleRanges;
+	// Out-of-core refinement, scratch of every frame as well
+	std::vector<std::pair<float, size_t>> wantedChunks; // Screen radius in pixels and chunk, largest first
+	std::vector<size_t> refinedDraws; // Into the node's refinedChunks
+	std::vector<IndexRange> previewHoles;
+	std::vector<IndexRange> keptRanges;
+	uint64_t frameNumber = 0; // Counts frames, a refined chunk is released framesInFlight frames after its last draw
+	bool refinementPending = false; // A wanted chunk waits for a later frame, which is requested once this one is done
+	size_t currentLod = 0; // Finest level any node drew in the last frame
+	float maxLodPixelError = 1.0f; // Coarsest level whose error stays under this many pixels is drawn
 
 	ComPtr<ID3D12PipelineState> pipelineStateSolid; // Pipeline state for solid rendering
+	ComPtr<ID3D12PipelineState> pipelineStateSolidMirrored; // Culls the other winding, for nodes whose world matrix mirrors
 	bool isWireframe;
 
+	// Compact vertex path, pipelines for the quantized input layout
+	ComPtr<ID3D12PipelineState> pipelineStateCompact;
+	ComPtr<ID3D12PipelineState> pipelineStateSolidCompact;
+	ComPtr<ID3D12PipelineState> pipelineStateSolidCompactMirrored;
+	bool useCompactVertices = true;
+
 	ComPtr<ID3D12Resource> depthBuffer; // Depth buffer resource
 	ComPtr<ID3D12DescriptorHeap> dsvHeap; // Depth stencil view descriptor heap
 
@@ -0,0 +1,54 @@
+// Hands out a file in blocks of a read-only mapping, a background thread pages in the next block while the current one is used
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <span>
+#include <thread>
+#include <QFile>
+#include <QString>
+#include <QtGlobal>
+
+class FileBlockReader
+{
+public:
+	static constexpr size_t defaultBlockBytes = 16 << 20;
+
+	// Maps the file and starts paging it in right away, at most queueDepth blocks ahead of the consumer. lineAligned
+	// blocks end right after a '\n' (or at the end of the file); a line longer than a block makes its block longer.
+	explicit FileBlockReader(const QString& filePath, size_t blockBytes = defaultBlockBytes, bool lineAligned = false, size_t queueDepth = 2);
+	~FileBlockReader(); // Stops the reader thread and unmaps, every block handed out becomes invalid
+	FileBlockReader(const FileBlockReader&) = delete;
+	FileBlockReader& operator=(const FileBlockReader&) = delete;
+
+	// Wait for the next block, a view into the mapping that stays valid while this reader lives. Returns false once the
+	// file is exhausted or could not be mapped.
+	bool next(std::span<const char>& block);
+
+	bool failed() const; // The file could not be opened or mapped
+	qint64 fileSize() const; // -1 until the reader thread has opened the file
+	qint64 bytesRead() const; // Paged in so far, ahead of what next() has handed out
+
+private:
+	void run();
+
+	const size_t blockBytes;
+	const size_t queueDepth;
+	const bool lineAligned;
+
+	QFile file;
+	const char* mapped = nullptr; // Set by the reader thread before the first block is queued
+	std::mutex mutex;
+	std::condition_variable changed;
+	std::deque<std::span<const char>> queue; // Paged-in blocks in file order
+	bool finished = false;
+	bool stopping = false;
+	std::atomic<bool> error{ false };
+	std::atomic<qint64> size{ -1 };
+	std::atomic<qint64> readBytes{ 0 };
+	std::thread thread;
+};
\ No newline at end of file
@@ -0,0 +1,77 @@
+// Frames-in-flight pacing and a ring of per-frame upload memory retired by fence value, free of any graphics API
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+// The part of a GPU fence the pacer and the ring use. Values only grow, the GPU reaches them in submission order.
+class FrameFence
+{
+public:
+	virtual ~FrameFence() = default;
+	virtual uint64_t completedValue() const = 0;
+	virtual void wait(uint64_t value) = 0; // Returns once completedValue() >= value
+};
+
+// Hands out framesInFlight slots round-robin for per-frame resources such as command allocators. A slot is only
+// returned again after the GPU finished the frame that last used it, so the CPU runs at most that many frames ahead.
+class FramePacer
+{
+public:
+	FramePacer(FrameFence& fence, unsigned int framesInFlight);
+	unsigned int beginFrame(); // Waits for the slot's previous frame and returns the slot index
+	void endFrame(uint64_t fenceValue); // The value signaled after this frame's commands
+	void waitIdle(); // Wait for every frame ended so far, e.g. before resources in use are replaced
+	unsigned int getFramesInFlight() const;
+
+private:
+	FrameFence& fence;
+	std::vector<uint64_t> slotFences; // Fence value of the last frame that used each slot, 0 = never used
+	uint64_t frameNumber = 0;
+	uint64_t lastFenceValue = 0;
+};
+
+// Linear allocator over a ring of capacity bytes, for data written by the CPU once per frame and read by the GPU.
+// Allocations stay valid until the fence value of their frame completes, only then is the space handed out again.
+class UploadRing
+{
+public:
+	struct Allocation
+	{
+		size_t offset = 0; // From the start of the ring, add to the mapped pointer and the GPU address
+		size_t size = 0;
+	};
+
+	UploadRing(FrameFence& fence, size_t capacity);
+
+	// Aligned space for the current frame, alignment is a power of two. Waits for older frames while the ring is full.
+	// Returns false only when the request cannot fit even after every older frame retired.
+	bool allocate(size_t size, size_t alignment, Allocation& out);
+	void endFrame(uint64_t fenceValue); // Everything allocated since the previous call retires with fenceValue
+	void retire(); // Release the frames whose fence value completed, allocate() does this too
+
+	size_t getCapacity() const;
+	size_t usedBytes() const; // Including alignment padding and the skipped end of the ring on wrap-around
+	size_t framesPending() const; // Ended but not yet retired
+
+private:
+	bool tryAllocate(size_t size, size_t alignment, Allocation& out);
+
+	struct PendingFrame
+	{
+		uint64_t fenceValue;
+		size_t end; // Ring position after the frame's last allocation
+		uint64_t allocatedTotal; // allocatedBytes when the frame ended
+	};
+
+	FrameFence& fence;
+	const size_t capacity;
+	size_t head = 0; // Next free byte
+	size_t tail = 0; // First byte still in use
+	uint64_t allocatedBytes = 0; // Running totals, their difference is the space in use
+	uint64_t releasedBytes = 0;
+	std::deque<PendingFrame> frames;
+};
\ No newline at end of file
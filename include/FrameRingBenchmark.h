@@ -0,0 +1,9 @@
+// Stress test of the frame pacer and upload ring against a fake GPU thread, no graphics API needed
+
+#pragma once
+
+#include <cstddef>
+
+// Submits frameCount frames of random allocations to a simulated GPU that completes fences after random delays
+// and checks that no allocation was handed out again before its frame completed. Logs throughput and stalls.
+bool runFrameRingStress(size_t frameCount);
\ No newline at end of file
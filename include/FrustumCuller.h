@@ -0,0 +1,56 @@
+// CPU view-frustum culling of index buffer chunks, tests four or eight boxes per SIMD step
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+#include "MeshStreams.h"
+
+// Six planes (a, b, c, d) with a*x + b*y + c*z + d >= 0 inside, order left, right, bottom, top, near, far
+struct Frustum
+{
+	float planes[6][4];
+
+	// From a row-major matrix used as clip = position * matrix (DirectX::XMFLOAT4X4 layout, Camera::getMVPMatrix)
+	// with D3D clip depth 0..w
+	static Frustum fromMatrix(const float* rowMajorMatrix);
+};
+
+// Contiguous run of the index buffer
+struct IndexRange
+{
+	uint32_t firstIndex;
+	uint32_t indexCount;
+};
+
+// Axis-aligned bounds of consecutive index ranges, one float stream per box component
+struct ChunkBounds
+{
+	FloatStream minX, minY, minZ;
+	FloatStream maxX, maxY, maxZ;
+	std::vector<IndexRange> ranges;
+
+	size_t size() const { return ranges.size(); }
+	bool empty() const { return ranges.empty(); }
+	void clear();
+};
+
+namespace FrustumCuller
+{
+	constexpr size_t defaultChunkTriangles = 8192;
+
+	// Cut the index buffer into chunks of trianglesPerChunk consecutive triangles. Chunks are only tight when the
+	// triangle order is spatially coherent, as after Model::optimizeVertexOrder(). baseIndex is added to every
+	// range, for index arrays that sit further into a larger GPU buffer. Chunks without a valid vertex index are left
+	// out, so ranges may have gaps between them.
+	void buildChunks(Vec3Streams positions, std::span<const unsigned int> indices, size_t trianglesPerChunk, ChunkBounds& out, uint32_t baseIndex = 0);
+	// Drop the chunks of chunks that start at firstIndex or later and append tail, built by buildChunks() with
+	// baseIndex = firstIndex, for an index buffer that only changed from there on
+	void replaceTail(ChunkBounds& chunks, const ChunkBounds& tail, uint32_t firstIndex);
+
+	// Append the ranges of every chunk that intersects the frustum to visible, merging neighbours into one range.
+	// Returns the number of visible chunks.
+	size_t cull(const Frustum& frustum, const ChunkBounds& chunks, std::vector<IndexRange>& visible);
+}
\ No newline at end of file
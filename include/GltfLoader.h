@@ -0,0 +1,115 @@
+// glTF 2.0 (.glb and .gltf) reading: buffers are memory-mapped and accessors are read where they lie
+
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <span>
+#include <vector>
+#include <QByteArray>
+#include <QFile>
+#include <QMatrix4x4>
+#include <QString>
+#include "MeshStreams.h"
+
+// One accessor resolved to its bytes inside a mapped buffer, nothing is copied until decode is called
+struct GltfAccessor
+{
+	const unsigned char* data = nullptr; // First element, nullptr when the accessor has no buffer view (all zeros)
+	size_t count = 0;
+	size_t stride = 0; // Bytes from one element to the next
+	unsigned int components = 1; // 1 for SCALAR up to 4 for VEC4
+	unsigned int componentType = 0; // GL enum, 5120 BYTE ... 5126 FLOAT
+	bool normalized = false;
+
+	// Sparse substitution: sparseCount (index, value) pairs overriding elements of data
+	size_t sparseCount = 0;
+	const unsigned char* sparseIndices = nullptr;
+	unsigned int sparseIndexType = 0;
+	const unsigned char* sparseValues = nullptr;
+
+	// The elements as they are in the file when they are tightly packed, aligned 32-bit unsigned scalars without
+	// sparse substitution, empty otherwise
+	std::span<const unsigned int> asUint32() const;
+	// One component of every element into out[0, count), normalized integers mapped to [0, 1] or [-1, 1]
+	void decodeComponent(unsigned int component, float* out) const;
+	// Scalar integer elements into out[0, count), each plus base
+	void decodeIndices(unsigned int base, unsigned int* out) const;
+};
+
+// A parsed .glb or .gltf with its buffers mapped. Accessors point into the mappings, which live as long as this object.
+class GltfAsset
+{
+public:
+	static constexpr unsigned int triangles = 4;
+	static constexpr unsigned int triangleStrip = 5;
+	static constexpr unsigned int triangleFan = 6;
+
+	struct Primitive
+	{
+		int positions = -1; // Accessor indices, -1 when absent
+		int normals = -1;
+		int texcoords = -1; // TEXCOORD_0
+		int indices = -1;
+		unsigned int mode = triangles;
+	};
+	struct MeshInstance
+	{
+		unsigned int mesh;
+		QMatrix4x4 transform; // World transform of the node that references the mesh
+	};
+
+	~GltfAsset();
+	GltfAsset(const GltfAsset&) = delete;
+	GltfAsset& operator=(const GltfAsset&) = delete;
+
+	static std::shared_ptr<GltfAsset> open(const QString& filePath); // nullptr after logging what is wrong
+
+	const std::vector<std::vector<Primitive>>& getMeshes() const;
+	// Meshes placed by the nodes of the default scene, or every mesh once when the file has no scene
+	const std::vector<MeshInstance>& getInstances() const;
+	bool getAccessor(int index, GltfAccessor& out) const; // False when index is out of range or the accessor is malformed
+
+private:
+	GltfAsset() = default;
+	bool parse(const QByteArray& json, const QString& directory, std::span<const unsigned char> binaryChunk);
+	bool mapFile(const QString& path, std::span<const unsigned char>& out);
+
+	struct Mapping
+	{
+		std::unique_ptr<QFile> file;
+		uchar* data = nullptr;
+	};
+	std::vector<Mapping> mappings; // The .glb itself or the external .bin files
+	std::vector<QByteArray> decodedBuffers; // Base64 data: URIs
+	std::vector<std::span<const unsigned char>> buffers;
+	std::vector<GltfAccessor> accessors;
+	std::vector<char> accessorValid; // Parallel to accessors, 0 where bounds or types did not check out
+	std::vector<std::vector<Primitive>> meshes;
+	std::vector<MeshInstance> instances;
+};
+
+// Every triangle primitive of every mesh instance flattened into one indexed mesh in world space
+struct GltfMeshData
+{
+	Vec3Array vertices;
+	Vec3Array normals; // Empty unless every primitive has normals
+	Vec2Array texcoords; // Empty unless every primitive has TEXCOORD_0
+	std::vector<unsigned int> indices;
+	std::span<const unsigned int> indexView; // indices, or the file's own index buffer when it could be used in place
+	std::shared_ptr<const GltfAsset> asset; // Set when indexView points into the mapped file
+	size_t primitiveCount = 0;
+	size_t skippedPrimitives = 0; // Points and lines
+};
+
+namespace GltfLoader
+{
+	bool isGltfFile(const QString& filePath); // By extension, .glb or .gltf
+
+	// Map filePath and decode its primitives on up to threadCount threads (0 = one per hardware thread), one primitive
+	// instance per task. The only copies made are the ones the SoA layout and index merging require.
+	bool load(const QString& filePath, GltfMeshData& out, unsigned int threadCount);
+	// load() for mesh alone, in its own space. asset is filePath opened once for the loads of all the meshes a Scene
+	// node per instance then places.
+	bool loadMesh(const QString& filePath, std::shared_ptr<const GltfAsset> asset, unsigned int mesh, GltfMeshData& out, unsigned int threadCount);
+}
\ No newline at end of file
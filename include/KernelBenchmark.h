@@ -0,0 +1,8 @@
+// Compares the SoA mesh kernels against the original QVector3D loops on a generated mesh
+
+#pragma once
+
+#include <cstddef>
+
+// Logs per-kernel timings for the QVector3D baseline and every supported instruction set
+bool runKernelBenchmark(size_t triangleCount);
\ No newline at end of file
@@ -0,0 +1,26 @@
+// Times the whole load path on generated meshes from 1K to 100M triangles and records the results as JSON
+
+#pragma once
+
+#include <cstddef>
+#include <iterator>
+#include <vector>
+#include <QString>
+#include "MeshGenerator.h"
+
+struct LoadBenchmarkSettings
+{
+	std::vector<MeshGenerator::Shape> shapes = { std::begin(MeshGenerator::allShapes), std::end(MeshGenerator::allShapes) };
+	std::vector<size_t> triangleCounts = { 1000, 10000, 100000, 1000000, 10000000, 100000000 };
+	QString directory; // Where the generated files go, a temporary directory when empty
+	QString jsonPath; // Results file, nothing is written when empty
+	unsigned int threadCount = 0; // Parse threads, 0 = one per hardware thread
+	int repeats = 1; // Loads per file, the fastest of each timing is kept
+	bool optimize = false; // Include the vertex order optimization in the load
+	bool keepFiles = false; // Leave the generated files in directory
+};
+
+// For every shape and size: generate the file, time its raw read, Model::loadFromFile with the time spent in each
+// load stage, normal generation on its own and packing for the GPU. Logs the time per triangle relative to the
+// smallest size, so superlinear stages stand out, and times Camera matrix updates once.
+bool runLoadBenchmark(const LoadBenchmarkSettings& settings);
\ No newline at end of file
@@ -0,0 +1,8 @@
+// Times the LOD chain build of a model and reports the levels it produces
+
+#pragma once
+
+#include <QString>
+
+// Load filePath, build the default LOD chain at 1, 2, 4 ... maxThreads threads (0 = hardware threads) and log times and levels
+bool runLodBenchmark(const QString& filePath, unsigned int maxThreads = 0);
\ No newline at end of file
@@ -1,11 +1,17 @@
 // Basic QMainWindow setup.
 
 #pragma once
+#include <memory>
 #include <QMainWindow>
+#include <QProgressBar>
 #include <QPushButton>
 
 class D3D12Viewport;
+class QFileSystemWatcher;
+class QTimer;
 class Model;
+class MeshCache;
+class ModelLoader;
 
 class MainWindow : public QMainWindow
 {
@@ -15,13 +21,29 @@ class MainWindow : public QMainWindow
 public slots:
 	void openFile();
 	void toggleWireframe();
+	void clearMeshCache();
+	void setCompactVertices(bool enabled);
+	void modelLoaded(const QString& filePath); // Swap the finished background load in for the current model
+	void setWatchFile(bool enabled);
+	void reloadModel(); // After the watched file changed, appended text extends the current model in place
 
 public:
 	MainWindow(QWidget* parent = nullptr);
 	~MainWindow();
 
 private:
+	void showLoadProgress(bool visible);
+	void watchModelFile();
+
 	D3D12Viewport* viewport;
-	Model* model;
+	std::shared_ptr<Model> model; // The one on screen
+	std::unique_ptr<Model> loadSettings; // Never loaded, the File menu sets it up and every load copies its settings
+	MeshCache* meshCache;
+	ModelLoader* loader;
+	QString modelPath; // File of the model on screen
+	QFileSystemWatcher* watcher;
+	QTimer* reloadTimer; // Collects the bursts of change notifications a single save produces
+	QProgressBar* loadProgress;
+	QPushButton* cancelLoadButton;
 	QPushButton* wireframeButton;
 };
\ No newline at end of file
@@ -0,0 +1,69 @@
+// On-disk cache of finished Model data, laid out so a hit is a plain memory map
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <QByteArray>
+#include <QFile>
+#include <QString>
+#include "MeshKernels.h"
+#include "MeshSimplifier.h"
+#include "MeshStreams.h"
+
+// A cache file mapped read-only. The spans point straight into the mapping and stay valid while this lives.
+class CachedMesh
+{
+public:
+	~CachedMesh();
+
+	Vec3Streams vertices;
+	Vec3Streams normals;
+	Vec2Streams texcoords;
+	std::span<const unsigned int> indices;
+	LodChainView lods; // Empty when the entry was stored without a chain
+	MeshBounds bounds;
+
+private:
+	friend class MeshCache;
+	QFile file;
+	uchar* mapped = nullptr;
+};
+
+class MeshCache
+{
+public:
+	// Identifies one version of a source file: path, size, mtime and a hash of sampled content
+	struct Key
+	{
+		QString sourcePath;
+		qint64 sourceSize = 0;
+		qint64 sourceModified = 0; // ms since epoch
+		QByteArray contentHash;
+		QByteArray digest; // Hash of all of the above, names the cache file
+	};
+
+	explicit MeshCache(const QString& directory = QString()); // Empty = the per-user cache location
+	void setSizeLimit(qint64 bytes); // Least recently used entries are evicted above this
+	qint64 getSizeLimit() const;
+	const QString& getDirectory() const;
+
+	// variant separates entries of one source built with different processing options
+	static bool makeKey(const QString& sourcePath, Key& key, const QByteArray& variant = QByteArray());
+
+	// Map the entry for key, nullptr on a miss or a stale/corrupt entry
+	std::shared_ptr<const CachedMesh> load(const Key& key) const;
+	bool store(const Key& key, Vec3Streams vertices, Vec3Streams normals, Vec2Streams texcoords, std::span<const unsigned int> indices, const MeshBounds& bounds, LodChainView lods = {});
+
+	void invalidate(const QString& sourcePath); // Drop every entry built from sourcePath
+	void clear();
+	qint64 totalSize() const;
+
+private:
+	QString entryPath(const Key& key) const;
+	void evictToLimit();
+
+	QString directory;
+	qint64 sizeLimit;
+};
\ No newline at end of file
@@ -0,0 +1,36 @@
+// Writes procedural .obj files of a requested size and shape, the inputs of the load benchmarks
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <QString>
+#include <QtGlobal>
+
+namespace MeshGenerator
+{
+	// Each shape exercises a different path through the loader
+	enum class Shape
+	{
+		Grid, // Wavy height field, positions only, normals are generated on load
+		Sphere, // UV sphere with v/vt/vn corners, goes through vertex welding
+		Scan, // Jittered height field in full float precision with rows written out of order, like a raw scan
+		Cad // Grid of n-gon prisms written with negative indices and fixed-point coordinates, like a CAD export
+	};
+	constexpr Shape allShapes[] = { Shape::Grid, Shape::Sphere, Shape::Scan, Shape::Cad };
+
+	const char* shapeName(Shape shape);
+	bool shapeFromName(const QString& name, Shape& shape); // Case-insensitive, false for an unknown name
+
+	struct Stats
+	{
+		size_t vertices = 0; // "v" records
+		size_t triangles = 0; // After fan triangulation, close to but not exactly the requested count
+		size_t faces = 0; // "f" records
+		qint64 bytes = 0;
+	};
+
+	// Write a mesh of about triangleCount triangles to filePath in fixed-size blocks, so the mesh itself is never
+	// held in memory. The same shape, count and seed always produce the same file.
+	bool writeObj(const QString& filePath, Shape shape, size_t triangleCount, uint32_t seed = 1, Stats* stats = nullptr);
+}
\ No newline at end of file
@@ -0,0 +1,53 @@
+// Bulk geometry kernels over SoA streams, vectorized with SSE2/AVX2 and chosen at runtime
+
+#pragma once
+
+#include <cstddef>
+#include <span>
+#include <vector>
+#include <QVector3D>
+#include "MeshStreams.h"
+
+// Axis-aligned box plus a bounding sphere centred on the box
+struct MeshBounds
+{
+	QVector3D min;
+	QVector3D max;
+	QVector3D center;
+	float radius = 0.0f;
+};
+
+namespace MeshKernels
+{
+	enum class Isa
+	{
+		Scalar,
+		SSE2,
+		AVX2
+	};
+
+	Isa bestSupportedIsa(); // Widest instruction set this CPU and build can run
+	Isa activeIsa();
+	void setActiveIsa(Isa isa); // Clamped to bestSupportedIsa(), mainly for benchmarks
+	const char* isaName(Isa isa);
+
+	// Add every triangle's unit face normal to the normals of its three corners. The caller zeroes n first.
+	void accumulateFaceNormals(Vec3Streams positions, const unsigned int* indices, size_t indexCount, float* nx, float* ny, float* nz);
+
+	// Scale every vector to unit length in place, zero vectors are left as they are
+	void normalize(float* x, float* y, float* z, size_t count);
+
+	MeshBounds computeBounds(Vec3Streams positions);
+
+	// Multiply by an affine column-major 4x4 matrix (QMatrix4x4::constData() layout).
+	// Points receive the translation, directions only the upper 3x3.
+	void transformPoints(float* x, float* y, float* z, size_t count, const float* matrix);
+	void transformDirections(float* x, float* y, float* z, size_t count, const float* matrix);
+
+	// out[i] = parent[i] * local[i] for count affine matrices held as twelve streams each: the column-major
+	// QMatrix4x4 layout without the constant last row, so stream c * 3 + r is row r of column c. out may be local.
+	void composeAffine(const float* const parent[12], const float* const local[12], float* const out[12], size_t count);
+
+	// Triangle ids sorted along a Morton curve through their centroids, ties in triangle order
+	std::vector<unsigned int> mortonTriangleOrder(Vec3Streams positions, std::span<const unsigned int> indices, const MeshBounds& bounds);
+}
\ No newline at end of file
@@ -0,0 +1,46 @@
+// Load-time reordering of triangles for vertex-cache reuse and of vertices for fetch locality
+
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+struct VertexCacheStats
+{
+	double acmr = 0.0; // Average cache miss ratio: vertex shader runs per triangle (0.5 ideal, 3 worst)
+	double atvr = 0.0; // Average transformed vertex ratio: vertex shader runs per unique vertex (1 ideal)
+};
+
+struct MeshOptimizeReport
+{
+	VertexCacheStats before;
+	VertexCacheStats after;
+	double seconds = 0.0;
+};
+
+namespace MeshOptimizer
+{
+	// Simulate a FIFO post-transform cache of cacheSize entries over the index buffer
+	VertexCacheStats analyzeVertexCache(const unsigned int* indices, size_t indexCount, size_t vertexCount, unsigned int cacheSize = 16);
+
+	// Reorder triangles in place with Forsyth's linear-speed algorithm. Large meshes are grouped into blocks by
+	// vertex range that are optimized independently on up to threadCount threads (0 = hardware threads);
+	// the block layout does not depend on the thread count, so neither does the result.
+	void optimizeVertexCache(unsigned int* indices, size_t indexCount, size_t vertexCount, unsigned int threadCount = 0);
+
+	// Renumber vertices in first-use order and rewrite indices to match. remap[old] = new, vertices never
+	// referenced are moved after the referenced ones. Returns the number of referenced vertices.
+	size_t optimizeVertexFetch(unsigned int* indices, size_t indexCount, size_t vertexCount, std::vector<unsigned int>& remap);
+
+	// Move every element of a per-vertex stream to its remapped position
+	template <typename Stream>
+	void applyRemap(Stream& stream, const std::vector<unsigned int>& remap)
+	{
+		Stream reordered(stream.size());
+		for (size_t i = 0; i < remap.size() && i < stream.size(); ++i)
+		{
+			reordered[remap[i]] = stream[i];
+		}
+		stream.swap(reordered);
+	}
+}
\ No newline at end of file
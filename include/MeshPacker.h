@@ -0,0 +1,102 @@
+// GPU-ready vertex and index bytes of a Model, built off the GUI thread into upload heaps or copied into them as is
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+#include <QVector3D>
+#include "FrustumCuller.h"
+#include "MeshSimplifier.h"
+#include "VertexQuantizer.h"
+
+class Model;
+struct ObjAppend;
+
+struct Vertex
+{
+	QVector3D position;
+	QVector3D normal;
+};
+
+// Memory that packed bytes go to and stay in, such as persistently mapped upload heaps the renderer takes over as
+// they are. Owns whatever backs the two pointers, both stay valid as long as the object lives.
+class MeshBuffers
+{
+public:
+	virtual ~MeshBuffers() = default;
+	virtual void* vertexData() = 0;
+	virtual void* indexData() = 0;
+};
+
+// Creates MeshBuffers of the given sizes, on any thread. nullptr makes pack() use PackedMesh's own vectors instead.
+using MeshBufferAllocator = std::function<std::unique_ptr<MeshBuffers>(size_t vertexBytes, size_t indexBytes)>;
+
+struct PackedMesh
+{
+	std::vector<uint8_t> vertexData; // Vertex or CompactVertex records, empty when written straight to a buffer
+	std::vector<uint8_t> indexData; // Full mesh indices followed by the LOD chain's, 16 or 32 bits each
+	std::unique_ptr<MeshBuffers> buffers; // Holds the bytes instead of vertexData and indexData when set
+	size_t vertexBytes = 0; // What vertexData holds or a buffer for writeVertices() needs
+	size_t indexBytes = 0;
+	size_t vertexCapacity = 0; // Bytes of the buffers to create, more than the above for a model that may be appended to
+	size_t indexCapacity = 0;
+	size_t vertexStride = 0;
+	size_t indexCount = 0; // Indices of the full mesh, the first draw range
+	bool compactVertices = false;
+	bool shortIndices = false;
+	PositionQuantization quantization; // Identity for full vertices
+	std::vector<ChunkBounds> cullChunks; // One set per LOD level, index 0 is the full mesh
+	std::vector<LodLevel> lodLevels; // firstIndex is relative to the chain, add indexCount for the buffer position
+
+	bool empty() const { return indexCount == 0; }
+	void clear();
+};
+
+// Buffer bytes a mesh was uploaded with, the most a later packAppend() may fill
+struct AppendCapacity
+{
+	size_t vertexBytes = 0;
+	size_t indexBytes = 0;
+};
+
+// The bytes an append changes in a mesh packed with room to grow, to be written over its buffers. Always full Vertex
+// records and 32-bit indices, the only format such a mesh is packed in.
+struct PackedAppend
+{
+	size_t firstVertex = 0;
+	std::vector<Vertex> vertices; // Records from firstVertex on
+	std::vector<uint32_t> patchedVertices; // Vertices before firstVertex whose normal changed
+	std::vector<Vertex> patches; // Their records
+	size_t firstIndex = 0;
+	std::vector<unsigned int> indices; // From firstIndex on
+	size_t vertexBytes = 0; // Of the whole mesh after the append
+	size_t indexBytes = 0;
+	size_t indexCount = 0;
+	ChunkBounds tailChunks; // Replace the full mesh's culling chunks from firstChunkIndex on
+	uint32_t firstChunkIndex = 0;
+};
+
+namespace MeshPacker
+{
+	// Lay out model for drawing: 12-byte quantized vertices or full Vertex records, 16-bit indices whenever
+	// every vertex is addressable with them, and the frustum culling chunks of every LOD level. A model that may be
+	// appended to (Model::canAppend()) always gets full records, 32-bit indices and capacity to grow by half.
+	// Returns false and leaves out empty when the model has no triangles or does not fit 32-bit buffers.
+	// With allocator set the bytes are written once, into the buffers it returns, instead of into out's vectors.
+	bool pack(const Model& model, bool compactVertices, PackedMesh& out, const MeshBufferAllocator& allocator = {});
+
+	// pack() without vertexData and indexData: sizes, formats, quantization and culling chunks. The bytes are then
+	// written in one pass from the model's streams into memory the caller provides, such as a mapped upload heap,
+	// so no second copy of the mesh is ever held. Destinations are written front to back and never read.
+	bool layout(const Model& model, bool compactVertices, PackedMesh& out);
+	void writeVertices(const Model& model, const PackedMesh& layout, void* destination); // layout.vertexBytes
+	void writeIndices(const Model& model, const PackedMesh& layout, void* destination); // layout.indexBytes
+
+	// What an Appended result of model.readAppendedText() changes in model's packed buffers, on the thread that read
+	// it, before model.appendText() applies it. Reads the model only around the append: kept vertices the new faces
+	// touch and the last culling chunk. False when the grown mesh does not fit capacity.
+	bool packAppend(const Model& model, const ObjAppend& append, const AppendCapacity& capacity, PackedAppend& out);
+}
\ No newline at end of file
@@ -0,0 +1,60 @@
+// Quadric-error edge-collapse simplification and the distance-selected LOD chain built from it
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+#include "MeshKernels.h"
+#include "MeshStreams.h"
+
+// One simplified level, a range of LodChain::indices over the full mesh's vertices. 16 bytes.
+struct LodLevel
+{
+	uint32_t firstIndex;
+	uint32_t indexCount;
+	float error; // Upper bound of the distance to the full mesh surface, in model units
+	float ratio; // Requested fraction of the full triangle count
+};
+static_assert(sizeof(LodLevel) == 16, "LodLevel is stored as is in the mesh cache");
+
+// Read-only view over a chain, either a LodChain or a mapped cache file
+struct LodChainView
+{
+	std::span<const unsigned int> indices;
+	std::span<const LodLevel> levels; // Finest first
+
+	bool empty() const { return levels.empty(); }
+
+	// Coarsest level whose error covers at most maxPixelError pixels: 0 is the full mesh, i is levels[i - 1]
+	size_t selectLevel(float pixelsPerUnit, float maxPixelError = 1.0f) const;
+};
+
+// Owning chain, all levels share one index array
+struct LodChain
+{
+	std::vector<unsigned int> indices;
+	std::vector<LodLevel> levels;
+
+	LodChainView view() const { return { indices, levels }; }
+	void clear();
+};
+
+namespace MeshSimplifier
+{
+	constexpr float defaultLodRatios[] = { 0.5f, 0.25f, 0.1f, 0.02f };
+
+	// Collapse edges in order of quadric error until about targetIndexCount indices remain, writing the kept
+	// triangles to out. Vertices only ever move onto other existing vertices, so out indexes the same vertex
+	// streams. The mesh is cut into fixed Morton-order blocks simplified on up to threadCount threads
+	// (0 = hardware threads) with the vertices between blocks held in place; the result does not depend on
+	// the thread count. Returns the largest collapse error in model units.
+	float simplify(Vec3Streams positions, std::span<const unsigned int> indices, size_t targetIndexCount, std::vector<unsigned int>& out, unsigned int threadCount = 0);
+
+	// One level per ratio, each simplified from the one before. Level errors add up along the chain.
+	void buildLodChain(Vec3Streams positions, std::span<const unsigned int> indices, std::span<const float> ratios, LodChain& out, unsigned int threadCount = 0);
+
+	// Screen pixels covered by one model unit at distance from a perspective camera
+	float pixelsPerUnit(float distance, float viewportHeight, float verticalFov);
+}
\ No newline at end of file
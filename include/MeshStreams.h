@@ -0,0 +1,131 @@
+// Structure-of-arrays storage for per-vertex vectors: one aligned float stream per component
+
+#pragma once
+
+#include <cstddef>
+#include <new>
+#include <vector>
+#include <QVector3D>
+
+// Allocator that hands out storage aligned for the widest SIMD loads the kernels use
+template <typename T, size_t Alignment = 64>
+struct AlignedAllocator
+{
+	using value_type = T;
+
+	template <typename U>
+	struct rebind
+	{
+		using other = AlignedAllocator<U, Alignment>;
+	};
+
+	AlignedAllocator() = default;
+	template <typename U>
+	AlignedAllocator(const AlignedAllocator<U, Alignment>&) {}
+
+	T* allocate(size_t count)
+	{
+		return static_cast<T*>(::operator new(count * sizeof(T), std::align_val_t(Alignment)));
+	}
+	void deallocate(T* pointer, size_t)
+	{
+		::operator delete(pointer, std::align_val_t(Alignment));
+	}
+
+	template <typename U>
+	bool operator==(const AlignedAllocator<U, Alignment>&) const { return true; }
+	template <typename U>
+	bool operator!=(const AlignedAllocator<U, Alignment>&) const { return false; }
+};
+
+using FloatStream = std::vector<float, AlignedAllocator<float>>;
+
+// Read-only view over three parallel component streams. Indexing rebuilds a QVector3D on the fly.
+struct Vec3Streams
+{
+	const float* x = nullptr;
+	const float* y = nullptr;
+	const float* z = nullptr;
+	size_t count = 0;
+
+	size_t size() const { return count; }
+	bool empty() const { return count == 0; }
+	QVector3D operator[](size_t i) const { return QVector3D(x[i], y[i], z[i]); }
+};
+
+// Owning x/y/z streams
+struct Vec3Array
+{
+	FloatStream x;
+	FloatStream y;
+	FloatStream z;
+
+	size_t size() const { return x.size(); }
+	bool empty() const { return x.empty(); }
+
+	void clear()
+	{
+		x.clear();
+		y.clear();
+		z.clear();
+	}
+	void reserve(size_t count)
+	{
+		x.reserve(count);
+		y.reserve(count);
+		z.reserve(count);
+	}
+	void resize(size_t count, float value = 0.0f)
+	{
+		x.resize(count, value);
+		y.resize(count, value);
+		z.resize(count, value);
+	}
+	void push_back(float vx, float vy, float vz)
+	{
+		x.push_back(vx);
+		y.push_back(vy);
+		z.push_back(vz);
+	}
+
+	Vec3Streams view() const { return { x.data(), y.data(), z.data(), x.size() }; }
+};
+
+// Read-only view over two parallel component streams (texture coordinates)
+struct Vec2Streams
+{
+	const float* x = nullptr;
+	const float* y = nullptr;
+	size_t count = 0;
+
+	size_t size() const { return count; }
+	bool empty() const { return count == 0; }
+};
+
+// Owning x/y streams
+struct Vec2Array
+{
+	FloatStream x;
+	FloatStream y;
+
+	size_t size() const { return x.size(); }
+	bool empty() const { return x.empty(); }
+
+	void clear()
+	{
+		x.clear();
+		y.clear();
+	}
+	void resize(size_t count, float value = 0.0f)
+	{
+		x.resize(count, value);
+		y.resize(count, value);
+	}
+	void push_back(float vx, float vy)
+	{
+		x.push_back(vx);
+		y.push_back(vy);
+	}
+
+	Vec2Streams view() const { return { x.data(), y.data(), x.size() }; }
+};
\ No newline at end of file
@@ -0,0 +1,66 @@
+// Splits a triangle mesh into small spatially coherent clusters that can be culled as a unit
+
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+#include "MeshKernels.h"
+#include "MeshStreams.h"
+
+// One cluster. Offsets point into MeshletData::vertices and MeshletData::triangles.
+struct Meshlet
+{
+	uint32_t vertexOffset;
+	uint32_t triangleOffset; // In triangles, three local bytes each
+	uint32_t vertexCount;
+	uint32_t triangleCount;
+
+	float center[3]; // Bounding sphere
+	float radius;
+	float boundsMin[3];
+	float boundsMax[3];
+
+	// Backface cone: every triangle faces away from a camera at position c when
+	// dot(center - c, coneAxis) >= coneCutoff * |center - c| + radius. coneCutoff = 1 never culls.
+	float coneAxis[3];
+	float coneCutoff;
+};
+static_assert(sizeof(Meshlet) == 72, "Meshlet layout changed");
+
+struct MeshletData
+{
+	static constexpr unsigned int maxVertices = 64;
+	static constexpr unsigned int maxTriangles = 124;
+
+	std::vector<Meshlet> meshlets;
+	std::vector<unsigned int> vertices; // Mesh vertex index of every meshlet-local vertex
+	std::vector<uint8_t> triangles; // Meshlet-local vertex indices, three per triangle
+
+	size_t triangleCount() const { return triangles.size() / 3; }
+	bool empty() const { return meshlets.empty(); }
+	void clear()
+	{
+		meshlets.clear();
+		vertices.clear();
+		triangles.clear();
+	}
+};
+
+namespace MeshletBuilder
+{
+	// Triangles are sorted along a Morton curve, cut into fixed-size blocks and clustered greedily per block on up
+	// to threadCount threads (0 = hardware threads). The result does not depend on the thread count.
+	void build(Vec3Streams positions, std::span<const unsigned int> indices, const MeshBounds& bounds, MeshletData& out, unsigned int threadCount = 0);
+
+	// True when the camera can only see the back of every triangle in the meshlet
+	inline bool isBackfacing(const Meshlet& meshlet, float cameraX, float cameraY, float cameraZ)
+	{
+		const float dx = meshlet.center[0] - cameraX, dy = meshlet.center[1] - cameraY, dz = meshlet.center[2] - cameraZ;
+		const float distance = dx * dx + dy * dy + dz * dz;
+		const float along = dx * meshlet.coneAxis[0] + dy * meshlet.coneAxis[1] + dz * meshlet.coneAxis[2];
+		return along >= meshlet.coneCutoff * std::sqrt(distance) + meshlet.radius;
+	}
+}
\ No newline at end of file
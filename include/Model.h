@@ -1,22 +1,204 @@
-// To load and access .obj gemotry data
+// To load and access .obj, glTF, .ply and .stl geometry data
 
 #pragma once
 
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <span>
 #include <vector>
+#include <QByteArray>
+#include <QDateTime>
+#include <QMatrix4x4>
 #include <QString>
-#include <QVector3D>
+#include "FrustumCuller.h"
+#include "MeshKernels.h"
+#include "MeshOptimizer.h"
+#include "MeshletBuilder.h"
+#include "MeshSimplifier.h"
+#include "MeshStreams.h"
+#include "ObjParser.h"
+#include "VertexWelder.h"
+
+class MeshCache;
+class CachedMesh;
+class GltfAsset;
+class OutOfCoreMesh;
+struct ObjAppendState;
+
+// Steps of a load in the order they run. Read and Parse overlap, each later step needs the whole mesh.
+enum class LoadStage
+{
+	Read,
+	Parse,
+	Normals,
+	Optimize,
+	Pack
+};
+const char* loadStageName(LoadStage stage);
+
+// Hooks for a load running off the GUI thread, both optional and called on the loading thread
+struct LoadProgress
+{
+	std::function<void(LoadStage stage, double fraction)> report;
+	const std::atomic<bool>* cancel = nullptr;
+
+	bool canceled() const { return cancel && cancel->load(std::memory_order_relaxed); }
+};
+
+// What an .obj file gained since a model parsed it, from Model::readAppendedText() for Model::appendText()
+struct ObjAppend
+{
+	enum class Change
+	{
+		None, // Same size and modification time as when parsed
+		Appended, // The text parsed before is unchanged, lines and partialLine hold what follows it
+		Rewritten // Earlier text changed, or the append cannot be applied in place, needs a full load
+	};
+
+	Change change = Change::Rewritten;
+	ObjData lines; // Complete lines, indices count from the start of the file
+	ObjData partialLine; // A last line still missing its '\n', drawn now and parsed again with the next append
+	qint64 parsedBytes = 0; // File offset right after lines
+	qint64 fileSize = 0;
+	QDateTime modified;
+	std::vector<QByteArray> prefixHashes; // Of the text before parsedBytes, checked by the next append
+
+	// Where the new text takes over from the model, everything after these counts is replaced
+	size_t keptVertices = 0;
+	size_t keptNormals = 0;
+	size_t keptIndices = 0;
+	// Generated normals (no vn records), worked out with the text so that appendText() only copies. Both streams hold
+	// the new vertices (lines, then partialLine) followed by touched.
+	std::vector<unsigned int> touched; // Kept vertices whose normal changes, ascending
+	Vec3Array normalSums; // Face normal sums over the complete lines
+	Vec3Array normals; // Normalized, partialLine's faces included
+};
 
 class Model
 {
 public:
 	Model();
-	bool loadFromFile(const QString& filePath);
-	const std::vector<QVector3D>& getVertices() const;
-	const std::vector<unsigned int>& getIndices() const;
-	const std::vector<QVector3D>& getNormals() const;
+	~Model();
+	Model(const Model&) = delete; // The views below may point into this object's own arrays
+	Model& operator=(const Model&) = delete;
+
+	// Maps .obj and .ply files and parses them in blocks while a background thread pages in the next, .glb, .gltf
+	// and .stl files are mapped and decoded in parallel. Returns false and leaves the model empty when the file
+	// cannot be read or progress asks to cancel.
+	bool loadFromFile(const QString& filePath, const LoadProgress* progress = nullptr);
+	// loadFromFile() for one mesh of a glTF file, in its own space instead of flattened with every instance in world
+	// space, for a Scene node per instance (GltfAsset::getInstances()). asset is filePath opened once for all of them.
+	bool loadGltfMesh(const QString& filePath, std::shared_ptr<const GltfAsset> asset, unsigned int mesh, const LoadProgress* progress = nullptr);
+	// Views over the loaded data, either the parsed arrays or a mapped cache file
+	Vec3Streams getVertices() const;
+	std::span<const unsigned int> getIndices() const;
+	Vec3Streams getNormals() const;
+	Vec2Streams getTexCoords() const; // Empty unless the file has "vt" records referenced by faces
+	const MeshBounds& getBounds() const;
+	const WeldStats& getWeldStats() const; // Zero counts unless OBJ attribute indices or STL corners were welded
+
+	void applyTransform(const QMatrix4x4& matrix); // Transforms positions and normals of the whole mesh
+
+	void setMeshCache(MeshCache* cache); // Optional, not owned. nullptr disables caching.
+	MeshCache* getMeshCache() const;
+
+	void setParseThreadCount(unsigned int count); // Threads used to parse, 0 = one per hardware thread
+	unsigned int getParseThreadCount() const;
+
+	// Reorder triangles for post-transform cache reuse and vertices for fetch locality
+	MeshOptimizeReport optimizeVertexOrder();
+	// Cluster the triangles for per-meshlet culling. Dropped again whenever the geometry changes.
+	const MeshletData& buildMeshlets();
+	const MeshletData& getMeshlets() const; // Empty until buildMeshlets()
+	// Simplified index buffers over the same vertices, one per ratio of the full triangle count, and a log of
+	// each level's triangles and error. Dropped when the geometry changes.
+	LodChainView buildLodChain(std::span<const float> ratios = MeshSimplifier::defaultLodRatios);
+	LodChainView getLodChain() const; // Empty until buildLodChain()
+
+	void setOptimizeOnLoad(bool enabled); // Off by default, runs optimizeVertexOrder() before the mesh is cached
+	bool getOptimizeOnLoad() const;
+	void setLodChainOnLoad(bool enabled); // Off by default, runs buildLodChain() before the mesh is cached
+	bool getLodChainOnLoad() const;
+	// On by default: STL corners at the same position are welded and smooth normals generated. Off keeps every
+	// triangle's own corners with the file's facet normals, which skips welding and normal generation.
+	void setStlSmoothing(bool enabled);
+	bool getStlSmoothing() const;
+	void setStlWeldEpsilon(float epsilon); // 0 (the default) welds bit-identical positions only
+	float getStlWeldEpsilon() const;
+	// 0 (the default) loads everything into memory. Otherwise .stl, .ply and .obj files are split into independently
+	// indexed 32-bit chunks while parsing and spilled to a scratch file, and the model itself becomes a preview
+	// simplified to fit about half of bytes and 32-bit indices. Files of any triangle count then load within about
+	// bytes of memory.
+	void setOutOfCoreBudget(size_t bytes);
+	size_t getOutOfCoreBudget() const;
+	const OutOfCoreMesh* getOutOfCoreMesh() const; // Full-resolution chunks of an out-of-core load, nullptr otherwise
+	// Per chunk of getOutOfCoreMesh(), the part of getIndices() its preview triangles fill, for drawing the chunk in
+	// full resolution in their place. Empty unless getOutOfCoreMesh() is set.
+	std::span<const IndexRange> getPreviewRanges() const;
+	// Off by default. An .obj load without v/vt/vn faces, vertex optimization or LOD chain then keeps what
+	// appendText() needs: where its complete lines end, a hash of each 64 KB of them and the unnormalized normal
+	// sums of a mesh without vn records (12 bytes per vertex).
+	void setIncrementalReload(bool enabled);
+	bool getIncrementalReload() const;
+
+	// Compare filePath with the .obj text this model parsed and parse just what was appended to it. The file must have
+	// grown, and the first and last 64 KB piece of the parsed text plus up to 16 evenly spaced pieces between must match
+	// the hashes taken when it was parsed, so the check reads about 1 MB whatever the file size and the parse, normals
+	// and upload follow the size of the change. An edit outside the sampled pieces that also makes the file longer
+	// is taken for an append, as the mesh cache would take it for the same file. Only reads the model, so it may run
+	// on another thread while nothing modifies it. Rewritten whenever the model keeps no state for filePath. The
+	// normals of the vertices the new faces add or touch are generated here too.
+	ObjAppend readAppendedText(const QString& filePath) const;
+	// Extend positions, indices and normals in place with an Appended result of readAppendedText(), copying only what
+	// it computed. Bounds grow to hold the new vertices, meshlets and LODs are dropped. False if append is not
+	// Appended or the model changed since it was read.
+	bool appendText(ObjAppend&& append);
+	bool canAppend() const; // Keeps the state readAppendedText() needs, an append may extend the model
 
 private:
-	std::vector<QVector3D> vertices;
+	using ReportFunction = std::function<void(LoadStage stage, double fraction)>;
+
+	void clear();
+	void updateViews();
+	// With gltfScene set, filePath is a glTF file and only its mesh gltfMesh is loaded
+	bool load(const QString& filePath, const LoadProgress* progress, std::shared_ptr<const GltfAsset> gltfScene, unsigned int gltfMesh);
+	// With chunked set, each block's vertices and faces are streamed into it and the model's arrays stay empty
+	bool loadObj(const QString& filePath, const ReportFunction& report, const std::function<bool()>& canceled, OutOfCoreMesh* chunked = nullptr);
+	void generateAppendedNormals(ObjAppend& append) const; // Fills touched, normalSums and normals of an Appended result
+	bool loadGltf(const QString& filePath, const ReportFunction& report, std::shared_ptr<const GltfAsset> scene, unsigned int mesh);
+	// With chunked set, faces are streamed into it and the model's arrays stay empty
+	bool loadPly(const QString& filePath, const ReportFunction& report, const std::function<bool()>& canceled, OutOfCoreMesh* chunked = nullptr);
+	bool loadStl(const QString& filePath, const ReportFunction& report);
+	bool loadOutOfCore(const QString& filePath, const ReportFunction& report, const std::function<bool()>& canceled);
+	void weldVertices(ObjData& data);
+	static void generateNormals(Vec3Streams positions, std::span<const unsigned int> faceIndices, Vec3Array& out);
+	void detachFromMapping(); // Copy whatever the views share with a mapped file into the owned arrays
+
+	Vec3Array vertices; // SoA position streams
 	std::vector<unsigned int> indices;
-	std::vector<QVector3D> normals;
+	Vec3Array normals;
+	Vec2Array texcoords;
+	std::shared_ptr<const CachedMesh> cachedMesh; // Keeps the mapping alive when loaded from the cache
+	std::shared_ptr<const GltfAsset> gltfAsset; // Keeps a mapped glTF file alive while indexView points into it
+	std::unique_ptr<OutOfCoreMesh> outOfCore;
+	std::vector<IndexRange> previewRanges;
+	std::unique_ptr<ObjAppendState> appendState; // Of the last .obj load with incremental reloads
+	Vec3Streams vertexView;
+	std::span<const unsigned int> indexView;
+	Vec3Streams normalView;
+	Vec2Streams texcoordView;
+	MeshBounds bounds;
+	MeshletData meshlets;
+	LodChain lods;
+	LodChainView lodView;
+	WeldStats weldStats;
+	unsigned int parseThreadCount;
+	bool optimizeOnLoad;
+	bool lodChainOnLoad;
+	bool stlSmoothing;
+	float stlWeldEpsilon;
+	size_t outOfCoreBudget;
+	bool incrementalReload;
+	MeshCache* meshCache;
 };
\ No newline at end of file
@@ -0,0 +1,89 @@
+// Runs Model loading and GPU packing on a background thread and reports back through queued signals
+
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <QObject>
+#include <QString>
+#include "MeshPacker.h"
+#include "Model.h"
+#include "Scene.h"
+
+class ModelLoader : public QObject
+{
+	Q_OBJECT
+
+public:
+	explicit ModelLoader(QObject* parent = nullptr);
+	~ModelLoader(); // Cancels and waits for every job still running
+
+	// Load filePath into a new Model with the settings of templateModel (cache, threads, on-load steps) and pack it.
+	// A glTF file becomes a model per mesh its nodes use and a node per instance, any other file one node at identity.
+	// A load already in flight is canceled, its results are never delivered.
+	void load(const QString& filePath, const Model& templateModel, bool compactVertices);
+	// Bring current up to date with filePath after it changed on disk. Text appended to an .obj is parsed for
+	// Model::appendText(), packed for buffers of capacity and delivered through appended(), nothing is delivered when
+	// the file is unchanged, and any other change or an append that does not fit capacity becomes a full load with the
+	// settings of templateModel. current must not be modified until the job ends. False without starting anything
+	// while an earlier job, canceled ones too, is still running.
+	bool reload(const QString& filePath, std::shared_ptr<const Model> current, const Model& templateModel, bool compactVertices, const AppendCapacity& capacity);
+	bool isLoading() const;
+	// Where jobs started from now on pack to, called on their threads. Unset, they pack into PackedMesh's vectors.
+	void setMeshBufferAllocator(MeshBufferAllocator allocator);
+
+	// Results of the last finished() signal, each can be taken once
+	std::shared_ptr<Model> takeModel(); // Mesh 0 of the scene
+	Scene takeScene(); // The loaded meshes and the nodes placing them
+	std::vector<PackedMesh> takePackedMeshes(); // Parallel to the scene's meshes
+	ObjAppend takeAppendedText(); // Results of the last appended() signal
+	PackedAppend takePackedAppend();
+
+public slots:
+	void cancel();
+
+signals:
+	void progress(const QString& stage, int percent);
+	void finished(const QString& filePath);
+	void appended(const QString& filePath);
+	void failed(const QString& filePath);
+	void canceled(const QString& filePath);
+
+private:
+	struct Job
+	{
+		unsigned int id;
+		QString filePath;
+		std::shared_ptr<Model> model; // Mesh 0 of scene
+		Scene scene;
+		std::vector<PackedMesh> meshes;
+		MeshBufferAllocator allocator;
+		std::shared_ptr<const Model> current; // Set for a reload
+		ObjAppend append;
+		AppendCapacity capacity;
+		PackedAppend packedAppend;
+		bool compactVertices = true;
+		bool succeeded = false;
+		std::atomic<bool> cancel{ false };
+		std::atomic<bool> done{ false };
+	};
+
+	Job& start(const QString& filePath, const Model& templateModel, bool compactVertices);
+	void run(Job& job);
+	bool loadGltfScene(Job& job, const LoadProgress& hooks); // One model per mesh into job.scene, false if any fails
+	void complete(unsigned int id); // On the GUI thread, delivers the job if it is still the current one
+	void reapThreads(); // Join the threads of jobs that have completed
+
+	std::vector<std::unique_ptr<Job>> jobs; // Running, or completed and not yet reaped
+	std::vector<std::thread> threads; // Parallel to jobs
+	unsigned int currentJobId = 0; // 0 when idle, canceled jobs finish in the background
+	unsigned int nextJobId = 1;
+	MeshBufferAllocator bufferAllocator;
+	std::shared_ptr<Model> resultModel;
+	Scene resultScene;
+	std::vector<PackedMesh> resultMeshes;
+	ObjAppend resultAppend;
+	PackedAppend resultPackedAppend;
+};
\ No newline at end of file
@@ -0,0 +1,12 @@
+// Checks NumberParser against strtof and strtod, then times it against std::from_chars and QString parsing
+
+#pragma once
+
+#include <cstddef>
+
+// Parses valueCount random floats printed with 9 significant digits, which must come back bit for bit, plus a list of
+// edge cases (halfway points, subnormals, more than 19 digits, missing digits around the '.' or the exponent), and
+// compares every result with strtof and strtod in the C locale. Then logs values per second for .obj-like coordinates
+// at 6 and 9 digits, floats of any magnitude and face indices with NumberParser, std::from_chars and QString::toFloat /
+// toUInt.
+bool runNumberBenchmark(size_t valueCount);
\ No newline at end of file
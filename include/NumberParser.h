@@ -0,0 +1,14 @@
+// Locale-independent decimal number parsing shared by the text mesh formats (.obj, ASCII .ply and .stl)
+
+#pragma once
+
+namespace NumberParser
+{
+	// Each reads one number at the start of [first, last) with the grammar of std::from_chars plus an optional leading
+	// '+', and returns the end of it. On failure, including out-of-range values, it returns nullptr and leaves value
+	// alone. Results are correctly rounded, the same as strtof and strtod in the C locale.
+	const char* parseFloat(const char* first, const char* last, float& value);
+	const char* parseDouble(const char* first, const char* last, double& value);
+	const char* parseUInt(const char* first, const char* last, unsigned int& value);
+	const char* parseInt(const char* first, const char* last, long long& value);
+}
\ No newline at end of file
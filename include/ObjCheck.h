@@ -0,0 +1,13 @@
+// Compares ObjParser with the QTextStream/QString line pipeline it replaced, record for record
+
+#pragma once
+
+#include <QString>
+#include <QStringList>
+
+// Parses every file in filePaths plus a built-in corpus (edge cases such as CRLF endings, a last line without '\n',
+// negative indices, corners without vt or vn, and one generated mesh of each shape) with the reference pipeline and
+// with ObjParser: in one piece, in chunks on threadCount threads (0 = one per hardware thread) and in small blocks.
+// Logs the first difference in positions, texcoords, normals, indices or per-corner vt/vn indices of each and
+// returns false if there is any.
+bool runObjCheck(const QStringList& filePaths, unsigned int threadCount);
\ No newline at end of file
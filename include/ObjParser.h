@@ -0,0 +1,72 @@
+// Pointer-based .obj tokenizer that reads straight out of a memory-mapped file
+
+#pragma once
+
+#include <memory>
+#include <vector>
+#include "MeshStreams.h"
+
+struct ObjData
+{
+	static constexpr unsigned int missingIndex = 0xFFFFFFFF;
+
+	Vec3Array vertices;
+	Vec2Array texcoords;
+	Vec3Array normals;
+	std::vector<unsigned int> indices; // Fan-triangulated, 0-based position indices
+
+	// Per-corner vt/vn indices parallel to indices (missingIndex where a corner has none).
+	// Only filled once a face uses the v/vt/vn form, position-only files skip them entirely.
+	bool attributeIndices = false;
+	std::vector<unsigned int> texcoordIndices;
+	std::vector<unsigned int> normalIndices;
+};
+
+// Per-chunk arrays of a chunked parse. One scratch passed to every block of a load lets each chunk reuse the arrays
+// it grew on the block before instead of allocating and growing them again, and frees all of them in one step when
+// the load ends. Holds about one block's worth of parsed records. Not for parses that run at the same time.
+class ObjParseScratch
+{
+public:
+	ObjParseScratch();
+	~ObjParseScratch();
+	ObjParseScratch(const ObjParseScratch&) = delete;
+	ObjParseScratch& operator=(const ObjParseScratch&) = delete;
+
+	struct Chunks; // Defined by the parser
+	std::unique_ptr<Chunks> chunks;
+};
+
+namespace ObjParser
+{
+	// Records of each kind in text parsed earlier, what negative indices in the text after it count back from
+	struct RecordCounts
+	{
+		size_t vertices = 0;
+		size_t texcoords = 0;
+		size_t normals = 0;
+	};
+
+	// Throughput of one parseParallel run, used for the thread scaling report
+	struct ScalingSample
+	{
+		unsigned int threadCount;
+		double seconds;
+		double megabytesPerSecond;
+	};
+
+	// Parse the text in [begin, end) and append its records to out. No per-line heap allocation.
+	void parse(const char* begin, const char* end, ObjData& out);
+
+	// Same result as parse(), bit for bit, but splits the text at line boundaries and parses the
+	// chunks on up to threadCount threads (0 = one per hardware thread) before merging them in order
+	void parseParallel(const char* begin, const char* end, ObjData& out, unsigned int threadCount, ObjParseScratch* scratch = nullptr);
+
+	// Parse [begin, end), text that follows records parsed elsewhere, and append it to out as if before's records
+	// came ahead of out's. Appending out to the earlier arrays then gives what one parse of all the text would.
+	void parseContinuation(const char* begin, const char* end, const RecordCounts& before, ObjData& out, unsigned int threadCount,
+		ObjParseScratch* scratch = nullptr);
+
+	// Parse [begin, end) at 1, 2, 4 ... maxThreads threads (0 = hardware threads) and time each run
+	std::vector<ScalingSample> measureScaling(const char* begin, const char* end, unsigned int maxThreads);
+}
\ No newline at end of file
@@ -0,0 +1,115 @@
+// Meshes beyond memory or 32-bit indices: independently indexed chunks spilled to a scratch file and paged back in
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <span>
+#include <utility>
+#include <vector>
+#include <QFile>
+#include <QString>
+#include "MeshKernels.h"
+#include "MeshStreams.h"
+
+class QTemporaryFile;
+
+// One chunk paged in. The views point into a read-only mapping of the scratch file and stay valid while this lives.
+class PagedChunk
+{
+public:
+	~PagedChunk();
+
+	Vec3Streams vertices;
+	Vec3Streams normals; // Smooth, across chunk borders as well unless the budget ran out (see finish())
+	std::span<const unsigned int> indices;
+
+private:
+	friend class OutOfCoreMesh;
+	QFile file;
+	uchar* mapped = nullptr;
+};
+
+// Triangles are added in file order into a chunk of bounded size. A full chunk is welded, given normals and written
+// to the scratch file, so memory holds one chunk being built plus the chunks paged in, whatever the total size.
+// Vertices on a chunk's open edges keep their normal sums until finish(), which shares them between the chunks that
+// meet there. Not thread-safe.
+class OutOfCoreMesh
+{
+public:
+	struct Chunk
+	{
+		uint64_t offset; // Into the scratch file, aligned for mapping
+		uint64_t bytes;
+		uint32_t vertexCount;
+		uint32_t indexCount;
+		MeshBounds bounds;
+	};
+
+	// memoryBudget is split about evenly between the chunk being built and the chunks kept paged in. The scratch file
+	// goes into scratchDirectory, the system temporary directory when empty, and is removed with this object.
+	explicit OutOfCoreMesh(size_t memoryBudget, const QString& scratchDirectory = QString(), unsigned int threadCount = 0);
+	~OutOfCoreMesh();
+	OutOfCoreMesh(const OutOfCoreMesh&) = delete;
+	OutOfCoreMesh& operator=(const OutOfCoreMesh&) = delete;
+
+	// False from the first scratch file error on
+	bool addTriangles(Vec3Streams corners); // Three corners per triangle
+	// Indexed meshes: every vertex position goes to a second scratch file first, in windows of any size. The triangles
+	// that follow gather their corners from a mapping of it, so only the parts of it they touch take memory. Vertices
+	// and triangles may alternate, as in .obj files, triangles can index every vertex added before them.
+	bool addVertices(Vec3Streams positions);
+	bool addIndexedTriangles(std::span<const uint64_t> indices); // Into the vertices added so far
+	// Spill the last chunk and give border vertices at the same position in several chunks one normal, so shading
+	// has no seams along chunk borders. Call before paging. Files whose triangles come in no spatial order can have
+	// more border vertices than an eighth of the budget holds; their chunk borders keep the normals of each side.
+	bool finish();
+
+	const std::vector<Chunk>& getChunks() const;
+	uint64_t getTriangleCount() const; // Kept triangles, the ones that collapsed when welding are dropped
+	uint64_t getVertexCount() const; // Sum over chunks, vertices on chunk borders are counted once per chunk
+	uint64_t getScratchBytes() const;
+	size_t getChunkTriangleLimit() const;
+	MeshBounds getBounds() const;
+
+	// Map chunk, or hand out the mapping still cached from an earlier call. The least recently used chunks leave the
+	// cache once it holds more than its half of the budget; a caller holding one keeps it mapped. nullptr on failure.
+	std::shared_ptr<const PagedChunk> page(size_t chunk) const;
+	size_t getPagedBytes() const; // Cached chunk bytes
+
+private:
+	// A vertex on an edge only one triangle of its chunk uses, the edge may continue in another chunk
+	struct BorderVertex
+	{
+		float position[3];
+		float normalSum[3]; // Of the chunk's triangles around it, then the shared normal
+		uint32_t chunk;
+		uint32_t vertex;
+	};
+
+	bool spill();
+	bool mapVertices();
+	bool shareBorderNormals();
+
+	const unsigned int threadCount;
+	const QString directory;
+	size_t chunkTriangles; // Limit of the chunk being built
+	size_t pagingBudget;
+	std::unique_ptr<QTemporaryFile> scratch;
+	bool failed = false;
+	Vec3Array corners; // Of the chunk being built
+	std::vector<BorderVertex> borderVertices; // Of every chunk spilled, until finish()
+	size_t maxBorderVertices;
+	bool borderOverflow = false; // borderVertices would have passed its limit, borders keep their seams
+	std::unique_ptr<QTemporaryFile> vertexScratch; // Interleaved x, y, z of addVertices(), removed by finish()
+	uint64_t vertexScratchCount = 0;
+	const float* mappedVertices = nullptr;
+	std::vector<Chunk> chunks;
+	uint64_t triangleCount = 0;
+	uint64_t vertexCount = 0;
+	uint64_t scratchBytes = 0;
+	mutable std::list<std::pair<size_t, std::shared_ptr<const PagedChunk>>> pagedChunks; // Most recently used first
+	mutable size_t pagedBytes = 0;
+};
\ No newline at end of file
@@ -0,0 +1,36 @@
+// Minimal helpers for spreading CPU work over std::threads
+
+#pragma once
+
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+namespace Parallel
+{
+	// 0 means one thread per hardware thread
+	inline unsigned int resolveThreadCount(unsigned int requested)
+	{
+		return requested > 0 ? requested : std::max(1u, std::thread::hardware_concurrency());
+	}
+
+	// Run job(i) for every i in [0, count) with one thread per item, the calling thread takes item 0
+	template <typename Job>
+	void run(size_t count, const Job& job)
+	{
+		std::vector<std::thread> workers;
+		workers.reserve(count > 0 ? count - 1 : 0);
+		for (size_t i = 1; i < count; ++i)
+		{
+			workers.emplace_back([&job, i]() { job(i); });
+		}
+		if (count > 0)
+		{
+			job(0);
+		}
+		for (auto& worker : workers)
+		{
+			worker.join();
+		}
+	}
+}
\ No newline at end of file
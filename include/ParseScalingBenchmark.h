@@ -0,0 +1,8 @@
+// Measures how OBJ parse throughput grows with the thread count
+
+#pragma once
+
+#include <QString>
+
+// Parse filePath at 1, 2, 4 ... maxThreads threads (0 = hardware threads) and log the MB/s of each run
+bool runParseScalingBenchmark(const QString& filePath, unsigned int maxThreads = 0);
\ No newline at end of file
@@ -0,0 +1,10 @@
+// Compares .obj parses that allocate their chunk arrays per block with ones that keep them in an ObjParseScratch
+
+#pragma once
+
+#include <QString>
+
+// Parses filePath block by block like a load, on threadCount threads (0 = one per hardware thread), with fresh chunk
+// arrays for every block and with one scratch for the whole file. Logs allocations, allocated and peak heap bytes and
+// the fastest of three runs for each, and checks that both produce the same records.
+bool runParseScratchBenchmark(const QString& filePath, unsigned int threadCount);
\ No newline at end of file
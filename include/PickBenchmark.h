@@ -0,0 +1,9 @@
+// Times BVH construction and ray picking on a model file against a brute-force triangle loop
+
+#pragma once
+
+#include <cstddef>
+#include <QString>
+
+// Logs build time per thread count and per-ray query times, and checks hits against the brute-force loop
+bool runPickBenchmark(const QString& filePath, size_t rayCount);
\ No newline at end of file
@@ -0,0 +1,133 @@
+// Streaming .ply reader for binary (little- and big-endian) and ASCII files, fed block by block into the final arrays
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+#include <QString>
+#include "MeshStreams.h"
+
+struct PlyMesh
+{
+	Vec3Array vertices;
+	Vec3Array normals; // Empty unless the vertex element has nx, ny and nz
+	Vec2Array texcoords; // Empty unless the vertex element has u and v (or s and t)
+	std::vector<unsigned int> indices; // Fan-triangulated faces
+	std::vector<uint64_t> wideIndices; // Instead of indices while streaming vertices, which may be past 32 bits
+};
+
+// Takes the file in order in blocks of any size. The arrays are sized from the header, records are decoded straight
+// into them and only a record split by a block boundary is copied, so memory stays at the mesh plus one record.
+// Element counts are 64-bit; past 32-bit indices the vertices can only be streamed.
+class PlyReader
+{
+public:
+	// Gets each full window of vertex positions in file order, false stops the read
+	using VertexWindowFunction = std::function<bool(Vec3Streams window)>;
+
+	// threadCount is for long runs of binary vertices, 0 = one per hardware thread
+	explicit PlyReader(unsigned int threadCount = 0);
+
+	// Before the first block, for out-of-core loads: vertices are decoded into a window of windowVertices positions that
+	// goes to flush whenever it fills and after the last vertex, with no limit on their count. Normals and texture
+	// coordinates are skipped, faces collect in getMesh().wideIndices and the index array is not sized from the header
+	// as the caller takes the faces out between blocks.
+	void streamVertices(size_t windowVertices, VertexWindowFunction flush);
+
+	static bool isPlyFile(const QString& filePath); // By extension
+
+	bool consume(const char* begin, const char* end); // False once the header or the data turned out invalid
+	bool finish(); // After the last block, false when the file ended early
+	PlyMesh& getMesh();
+	bool verticesDone() const; // Every vertex record is in getMesh()
+
+private:
+	enum class Format
+	{
+		Ascii,
+		BinaryLittleEndian,
+		BinaryBigEndian
+	};
+	enum class Type : unsigned char
+	{
+		Int8,
+		UInt8,
+		Int16,
+		UInt16,
+		Int32,
+		UInt32,
+		Float32,
+		Float64
+	};
+	// What a property is read into, None is skipped
+	enum class Role : unsigned char
+	{
+		None,
+		X,
+		Y,
+		Z,
+		NormalX,
+		NormalY,
+		NormalZ,
+		U,
+		V,
+		FaceIndices
+	};
+	enum class Kind
+	{
+		Vertex,
+		Face,
+		Other
+	};
+	struct Property
+	{
+		std::string name;
+		Type type = Type::Float32; // Item type for lists
+		Type countType = Type::UInt8;
+		bool list = false;
+		Role role = Role::None;
+		size_t offset = 0; // In the record, valid while recordBytes > 0
+	};
+	struct Element
+	{
+		std::string name;
+		uint64_t count = 0;
+		Kind kind = Kind::Other;
+		std::vector<Property> properties;
+		size_t recordBytes = 0; // Binary record size, 0 when a list makes it vary
+	};
+
+	bool parseHeader(const char* begin, const char* end);
+	bool fail(const char* message);
+	size_t parseRecords(const char* begin, const char* end); // Complete records of the current element, returns the bytes used
+	size_t missingBytes(const char* begin, const char* end) const; // To complete the binary record starting at begin
+	size_t parseVertexRun(const char* begin, size_t records);
+	void advanceVertices(uint64_t records); // Past records decoded into the window, flushing it once full
+	size_t parseFacesFast(const char* begin, const char* end);
+	const char* parseBinaryRecord(const Element& current, const char* pos, size_t vertex); // Past the record, nullptr on failure
+	bool parseAsciiRecord(const Element& current, const char* line, const char* end, size_t vertex);
+	void addFace(); // Fan-triangulates polygon
+	void addTriangle(uint64_t a, uint64_t b, uint64_t c);
+
+	const unsigned int threadCount;
+	size_t windowVertices = 0; // Streaming when above 0
+	VertexWindowFunction flushWindow;
+	bool headerDone = false;
+	bool failed = false;
+	Format format = Format::Ascii;
+	bool swapBytes = false; // Binary data in the other byte order than this machine's
+	std::vector<Element> elements;
+	size_t element = 0; // Being read
+	uint64_t record = 0; // Finished records of the current element
+	uint64_t vertexCount = 0;
+	uint64_t vertexRecord = 0; // Next vertex written, vertex elements may be split across calls
+	uint64_t windowStart = 0; // File index of mesh.vertices[0]
+	bool fastVertices = false; // Binary, native byte order, every property read is a float
+	bool fastFaces = false; // Binary, native byte order, only a uchar-counted int/uint index list
+	std::vector<char> carry; // The header while incomplete, then a record split by a block boundary
+	std::vector<uint64_t> polygon; // Corners of the face being read
+	PlyMesh mesh;
+};
\ No newline at end of file
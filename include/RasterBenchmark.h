@@ -0,0 +1,9 @@
+// Renders a model with the software rasterizer over scripted camera poses and reports its throughput
+
+#pragma once
+
+#include <QString>
+
+// Logs frame time and triangles per second per instruction set in solid and wireframe mode, checks the SIMD images
+// against scalar and, when imagePath is set, saves the first pose in both modes
+bool runRasterBenchmark(const QString& filePath, int width, int height, const QString& imagePath = QString());
\ No newline at end of file
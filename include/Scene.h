@@ -0,0 +1,60 @@
+// Assemblies of shared meshes: a flat transform hierarchy whose world matrices are recomputed for changed subtrees only
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include <QMatrix4x4>
+#include "MeshStreams.h"
+
+class Model;
+
+// Nodes live in one array in which every node comes after its parent, with each matrix element in its own stream
+// (see MeshKernels::composeAffine) so world matrices are computed many nodes at a time. Transforms are affine, the
+// last row of a local matrix is ignored. Meshes are held once and referenced by id from any number of nodes.
+// Not thread-safe, updateWorldTransforms() runs its own threads.
+class Scene
+{
+public:
+	static constexpr uint32_t none = UINT32_MAX; // No parent or no mesh
+
+	uint32_t addMesh(std::shared_ptr<const Model> mesh);
+	const Model* getMesh(uint32_t mesh) const;
+	size_t getMeshCount() const;
+
+	// parent is none or an earlier node, which keeps parents ahead of their children. The node's world matrix is
+	// computed by the next update.
+	uint32_t addNode(uint32_t parent, const QMatrix4x4& local, uint32_t mesh = none);
+	void clear();
+	size_t getNodeCount() const;
+	uint32_t getParent(uint32_t node) const;
+	uint32_t getNodeMesh(uint32_t node) const;
+	uint32_t getDepth(uint32_t node) const; // 0 for nodes without a parent
+
+	void setLocalTransform(uint32_t node, const QMatrix4x4& local); // Marks node and everything below it
+	QMatrix4x4 getLocalTransform(uint32_t node) const;
+	QMatrix4x4 getWorldTransform(uint32_t node) const; // As of the last update
+	void getWorldTransform(uint32_t node, float matrix[16]) const; // Column-major like QMatrix4x4::constData()
+
+	// Recompute the world matrices below every node changed since the last call, a depth level at a time with the
+	// nodes of a level split over up to threadCount threads (0 = one per hardware thread). Returns the nodes updated.
+	size_t updateWorldTransforms(unsigned int threadCount = 0);
+	bool needsUpdate() const;
+
+private:
+	void updateLevel(const uint32_t* nodes, size_t count, bool roots);
+
+	std::vector<std::shared_ptr<const Model>> meshes;
+	std::vector<uint32_t> parents;
+	std::vector<uint32_t> depths;
+	std::vector<uint32_t> nodeMeshes;
+	std::vector<uint8_t> dirty; // Set on changed nodes only, spread to their subtrees when updating
+	FloatStream local[12];
+	FloatStream world[12];
+	uint32_t firstDirty = none;
+	uint32_t maxDepth = 0;
+	std::vector<uint32_t> updateOrder; // Dirty nodes grouped by depth, scratch of updateWorldTransforms()
+	std::vector<size_t> levelStarts;
+};
\ No newline at end of file
@@ -0,0 +1,9 @@
+// Times world-matrix updates of a generated assembly, the per-frame work of a scene with many moving parts
+
+#pragma once
+
+#include <cstddef>
+
+// Builds an assembly of nodeCount nodes over a few shared meshes and logs the cost of whole-scene, every-leaf and
+// sparse updates per instruction set and thread count. Checks every world matrix against a serial QMatrix4x4 walk.
+bool runSceneBenchmark(size_t nodeCount);
\ No newline at end of file
@@ -0,0 +1,16 @@
+// Compile-time switches shared by the translation units that carry SSE2/AVX2 code paths
+
+#pragma once
+
+// SSE2 is the x64 baseline. AVX2 functions are compiled per function so the binary still runs on older
+// CPUs, callers pick them through MeshKernels::activeIsa().
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define MESH_KERNELS_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#define MESH_KERNELS_AVX2_TARGET
+#else
+#define MESH_KERNELS_AVX2_TARGET __attribute__((target("avx2")))
+#endif
+#endif
\ No newline at end of file
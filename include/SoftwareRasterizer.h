@@ -0,0 +1,75 @@
+// Tiled multi-threaded CPU rasterizer with the viewer's shading, renders where D3D12 and a GPU are not available
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+#include "MeshStreams.h"
+
+struct RasterStats
+{
+	size_t triangles = 0; // Submitted
+	size_t primitives = 0; // Triangles (or edges in wireframe) left after culling and clipping, binned to tiles
+	size_t pixels = 0; // Covered and shaded
+	double transformMs = 0.0;
+	double binMs = 0.0;
+	double rasterMs = 0.0;
+	double shadeMs = 0.0;
+	double frameMs = 0.0;
+
+	double trianglesPerSecond() const { return frameMs > 0.0 ? triangles / (frameMs / 1000.0) : 0.0; }
+};
+
+class SoftwareRasterizer
+{
+public:
+	static constexpr int tileSize = 64; // Pixels per tile side, each tile is rasterized and shaded by one thread
+	static constexpr size_t batchTriangles = 1 << 18; // Binned together, bounds the memory of the setup data
+
+	explicit SoftwareRasterizer(unsigned int threadCount = 0); // 0 = one thread per hardware thread
+	~SoftwareRasterizer();
+	void resize(int width, int height);
+	int getWidth() const;
+	int getHeight() const;
+
+	// Solid with back-face culling, or triangle edges without culling, like the viewer's two pipelines
+	void toggleWireframe();
+	void setWireframe(bool enabled);
+	bool isWireframe() const;
+
+	// Clear and draw one frame the way vertex.hlsl and pixel.hlsl do. positions and normals are in world space
+	// (the viewer's model matrix is identity), mvp is row-major with clip = position * mvp (Camera::getMVPMatrix
+	// layout) and lightDirection points towards the main light. Coverage uses MeshKernels::activeIsa().
+	RasterStats render(Vec3Streams positions, Vec3Streams normals, std::span<const unsigned int> indices, const float* mvp, const float* lightDirection);
+
+	// Last frame, width * height pixels as 0xffRRGGBB row by row (QImage::Format_RGB32)
+	const std::vector<uint32_t>& getPixels() const;
+	float getDepth(int x, int y) const; // 1 where nothing was drawn
+
+private:
+	struct Block; // Setup data and per-tile bins of one fixed run of triangles
+
+	void transform(Vec3Streams positions, const float* mvp);
+	void bin(std::span<const unsigned int> indices, size_t firstTriangle, size_t triangleCount, size_t blockCount);
+	void rasterize(size_t blockCount, bool clear);
+	size_t shade(Vec3Streams positions, Vec3Streams normals, std::span<const unsigned int> indices, const float* lightDirection);
+	size_t tileOffset(int x, int y) const; // Of a pixel in the tile-major depth and id buffers
+
+	unsigned int threadCount;
+	int width = 0;
+	int height = 0;
+	int tilesX = 0;
+	int tilesY = 0;
+	bool wireframe = false;
+
+	Vec3Array clipXYZ; // Clip-space position of every vertex of the current frame
+	FloatStream clipW;
+	Vec3Array screen; // Snapped pixel position and depth, valid unless the vertex needs clipping
+	std::vector<uint8_t> vertexFlags; // Frustum planes the vertex is outside of, and whether it needs clipping
+	FloatStream depth; // Tile-major, tileSize * tileSize floats per tile
+	std::vector<uint32_t, AlignedAllocator<uint32_t>> triangleIds; // Visibility buffer beside depth, the triangle drawn at each pixel
+	std::vector<uint32_t> pixels;
+	std::vector<Block> blocks;
+};
\ No newline at end of file
@@ -0,0 +1,35 @@
+// STL (binary and ASCII) reading: a triangle soup welded into shared vertices, or kept flat with the facet normals
+
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <vector>
+#include <QString>
+#include "MeshStreams.h"
+#include "VertexWelder.h"
+
+class OutOfCoreMesh;
+
+struct StlMeshData
+{
+	Vec3Array vertices;
+	Vec3Array normals; // Facet normals per corner when not welded, empty otherwise
+	std::vector<unsigned int> indices;
+	WeldStats weldStats; // Zero counts when not welded
+	size_t triangleCount = 0; // In the file, welding drops the ones that collapse
+	bool binary = false;
+};
+
+namespace StlLoader
+{
+	bool isStlFile(const QString& filePath); // By extension
+
+	// Map filePath and read its triangles, binary ones on up to threadCount threads (0 = one per hardware thread).
+	// With weld, corners at the same position share a vertex (see VertexWelder::weldPositions for weldEpsilon) and
+	// triangles that collapse are dropped. Without it every corner keeps its own vertex and its facet's normal.
+	bool load(const QString& filePath, StlMeshData& out, bool weld, float weldEpsilon, unsigned int threadCount);
+	// Stream the triangles into out a batch at a time, so the whole soup is never in memory. progress gets the fraction
+	// of the file read after every batch, returning false from it cancels.
+	bool loadChunked(const QString& filePath, OutOfCoreMesh& out, unsigned int threadCount, const std::function<bool(double fraction)>& progress);
+}
\ No newline at end of file
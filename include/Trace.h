@@ -0,0 +1,43 @@
+// Scoped-zone tracing into per-thread buffers, exported as Chrome trace / Perfetto JSON
+
+#pragma once
+
+// Built only with the SIMPLE3DVIEWER_TRACING CMake option, otherwise the macros expand to nothing
+#if SIMPLE3DVIEWER_TRACING
+#include <cstdint>
+#include <QString>
+
+namespace Trace
+{
+	int64_t now(); // Nanoseconds since the first traced event of the process
+
+	// Append one complete zone to the calling thread's buffer. name must outlive the trace, a string literal.
+	// No locks, the buffer is only shared with writeJson() through atomics.
+	void record(const char* name, int64_t startNs, int64_t endNs);
+	void setThreadName(const char* name); // Shown as the track name, a string literal too
+
+	// Every zone recorded so far by any thread, including threads that have ended. Safe to call while others trace.
+	bool writeJson(const QString& filePath);
+
+	class Zone
+	{
+	public:
+		explicit Zone(const char* name) : name(name), start(now()) {}
+		~Zone() { record(name, start, now()); }
+		Zone(const Zone&) = delete;
+		Zone& operator=(const Zone&) = delete;
+
+	private:
+		const char* name;
+		int64_t start;
+	};
+}
+
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+#define TRACE_ZONE(name) Trace::Zone TRACE_CONCAT(traceZone, __LINE__)(name) // Until the end of the enclosing scope
+#define TRACE_THREAD_NAME(name) Trace::setThreadName(name)
+#else
+#define TRACE_ZONE(name) ((void)0)
+#define TRACE_THREAD_NAME(name) ((void)0)
+#endif
\ No newline at end of file
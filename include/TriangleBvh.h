@@ -0,0 +1,59 @@
+// Bounding volume hierarchy over mesh triangles for ray picking
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+#include "MeshStreams.h"
+
+// 32 bytes. Interior nodes have count == 0 and their children at leftOrFirst and leftOrFirst + 1,
+// leaves cover count triangles starting at leftOrFirst in TriangleBvh's reordered triangle list.
+struct BvhNode
+{
+	float boundsMin[3];
+	uint32_t leftOrFirst;
+	float boundsMax[3];
+	uint32_t count;
+};
+static_assert(sizeof(BvhNode) == 32, "BvhNode must stay 32 bytes");
+
+struct PickRay
+{
+	float origin[3];
+	float direction[3]; // Need not be normalized, distances are in units of its length
+};
+
+struct PickHit
+{
+	bool hit = false;
+	uint32_t triangle = 0; // Index into the mesh's index buffer / 3
+	float distance = 0.0f;
+	float u = 0.0f; // Barycentric weights of the second and third corner
+	float v = 0.0f;
+};
+
+class TriangleBvh
+{
+public:
+	// Binned SAH build, subtrees are split across up to threadCount threads (0 = hardware threads).
+	// The node layout is the same for every thread count.
+	void build(Vec3Streams positions, std::span<const unsigned int> indices, unsigned int threadCount = 0);
+	void clear();
+	bool empty() const { return nodes.empty(); }
+
+	// Nearest hit along the ray. positions must be the streams the tree was built from.
+	PickHit intersect(const PickRay& ray, Vec3Streams positions) const;
+
+	// Reference answer that tests every triangle, for checking and timing the tree
+	static PickHit intersectAll(const PickRay& ray, Vec3Streams positions, std::span<const unsigned int> indices);
+
+	const std::vector<BvhNode>& getNodes() const { return nodes; }
+	size_t memoryBytes() const;
+
+private:
+	std::vector<BvhNode> nodes;
+	std::vector<uint32_t> triangleIds; // Original triangle number of each leaf slot
+	std::vector<unsigned int> triangles; // Corner indices in leaf order, three per triangle
+};
\ No newline at end of file
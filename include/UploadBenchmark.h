@@ -0,0 +1,11 @@
+// Measures the heap memory and time of getting a loaded model into GPU upload buffers, staged and written in place
+
+#pragma once
+
+#include <QString>
+
+// Loads filePath, then uploads it in both vertex formats through MeshPacker::pack() plus a copy, through
+// MeshPacker::layout() plus writes straight into the destination and through pack() with a MeshBufferAllocator that
+// returns the destination. Logs the peak heap bytes each path allocates on top of the model and checks that all three
+// produce the same bytes.
+bool runUploadBenchmark(const QString& filePath);
\ No newline at end of file
@@ -0,0 +1,43 @@
+// Compact GPU vertex format: 16-bit positions inside the mesh bounds and octahedral 32-bit normals
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include "MeshKernels.h"
+#include "MeshStreams.h"
+
+// 12 bytes instead of 24. position is read as R16G16B16A16_UNORM (w unused), normal as R16G16_SNORM.
+struct CompactVertex
+{
+	uint16_t position[4];
+	int16_t normal[2];
+};
+static_assert(sizeof(CompactVertex) == 12, "CompactVertex must stay tightly packed");
+
+// Dequantization: position = offset + unorm * scale, per axis
+struct PositionQuantization
+{
+	float offset[3] = { 0.0f, 0.0f, 0.0f };
+	float scale[3] = { 1.0f, 1.0f, 1.0f };
+};
+
+struct QuantizationError
+{
+	float maxPositionError = 0.0f; // Largest object-space distance between a source and a decoded position
+	float maxNormalErrorDegrees = 0.0f; // Largest angle between a source and a decoded normal
+};
+
+namespace VertexQuantizer
+{
+	PositionQuantization positionQuantization(const MeshBounds& bounds);
+
+	// Vertices past the end of normals get (0, 1, 0)
+	void encode(Vec3Streams positions, Vec3Streams normals, const PositionQuantization& quantization, CompactVertex* out);
+
+	// Expand back to float streams the way the vertex shader does, for error checks and CPU consumers
+	void decodePositions(const CompactVertex* vertices, size_t count, const PositionQuantization& quantization, float* x, float* y, float* z);
+	void decodeNormals(const CompactVertex* vertices, size_t count, float* x, float* y, float* z);
+
+	QuantizationError measureError(Vec3Streams positions, Vec3Streams normals, const CompactVertex* vertices, const PositionQuantization& quantization);
+}
\ No newline at end of file
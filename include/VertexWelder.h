@@ -0,0 +1,48 @@
+// Welds OBJ face corners with identical (v, vt, vn) index tuples, or triangle soup corners at the same position, into
+// one shared vertex each
+
+#pragma once
+
+#include <cstddef>
+#include <vector>
+#include "MeshStreams.h"
+
+// Source indices of one welded vertex, 0xFFFFFFFF where the corner had no vt or vn
+struct VertexTuple
+{
+	unsigned int position;
+	unsigned int texcoord;
+	unsigned int normal;
+};
+
+struct WeldStats
+{
+	size_t cornerCount = 0;
+	size_t vertexCount = 0;
+	double seconds = 0.0;
+
+	double dedupRatio() const { return vertexCount > 0 ? static_cast<double>(cornerCount) / vertexCount : 0.0; }
+	double cornersPerSecond() const { return seconds > 0.0 ? cornerCount / seconds : 0.0; }
+};
+
+namespace VertexWelder
+{
+	// Starting guess for the number of unique tuples from the record counts of the first (parse) pass
+	size_t estimateVertexCount(size_t positionCount, size_t texcoordCount, size_t normalCount, size_t cornerCount);
+
+	// Map every corner to a welded vertex. indices receives one welded index per corner, tuples one entry
+	// per welded vertex in first-use order. texcoordIndices/normalIndices run parallel to positionIndices.
+	WeldStats weld(const unsigned int* positionIndices, const unsigned int* texcoordIndices, const unsigned int* normalIndices,
+		size_t cornerCount, size_t expectedVertexCount, std::vector<unsigned int>& indices, std::vector<VertexTuple>& tuples);
+
+	// Map every corner position to a welded vertex. With epsilon 0 only bit-identical positions weld (-0 equals 0), the
+	// corners spread over hash partitions that weld on up to threadCount threads (0 = one per hardware thread).
+	// Otherwise the result is that of taking each corner in turn, which joins the lowest earlier vertex within epsilon
+	// (Euclidean distance) or starts a new one. The bit-identical weld runs first and only the distinct positions go
+	// through parallel rounds over a grid of epsilon-sized cells, with the same result on any thread count. A corner
+	// within epsilon of a vertex always welds, but a chain of corners each within epsilon of the next can still end up
+	// in several vertices. indices receives one welded index per corner, firstCorners the
+	// corner each welded vertex takes its position from, in first-use order.
+	WeldStats weldPositions(Vec3Streams corners, float epsilon, unsigned int threadCount, std::vector<unsigned int>& indices,
+		std::vector<unsigned int>& firstCorners);
+}
\ No newline at end of file
@@ -5,14 +5,50 @@ cbuffer Constants : register(b0)
     float4x4 mvpMatrix;
     float4x4 modelMatrix;
     float4x4 normalMatrix;
+    float3 lightDirection;
+    float padding;
+    float4 positionOffset; // Dequantization of compact positions: offset + unorm * scale
+    float4 positionScale;
 };
 
+#ifdef COMPACT_VERTICES
+// 16-bit UNORM positions inside the mesh bounds, octahedral SNORM normals
+struct VSInput
+{
+    float4 position : POSITION;
+    float2 normal : NORMAL;
+};
+
+float3 decodeNormal(float2 encoded)
+{
+    float3 n = float3(encoded, 1.0 - abs(encoded.x) - abs(encoded.y));
+    float t = saturate(-n.z);
+    n.xy += n.xy >= 0.0 ? -t : t;
+    return normalize(n);
+}
+
+float3 decodePosition(float4 encoded)
+{
+    return positionOffset.xyz + encoded.xyz * positionScale.xyz;
+}
+#else
 struct VSInput
 {
     float3 position : POSITION;
     float3 normal : NORMAL;
 };
 
+float3 decodeNormal(float3 normal)
+{
+    return normal;
+}
+
+float3 decodePosition(float3 position)
+{
+    return position;
+}
+#endif
+
 struct VSOutput
 {
     float4 position : SV_POSITION;
@@ -23,16 +59,17 @@ struct VSOutput
 VSOutput main(VSInput input)
 {
     VSOutput output;
+    float3 position = decodePosition(input.position);
     
     // Transform position to world space
-    float4 worldPos = mul(modelMatrix, float4(input.position, 1.0));
+    float4 worldPos = mul(modelMatrix, float4(position, 1.0));
     output.worldPos = worldPos.xyz;
 
     // Transform position to clip space
-    output.position = mul(mvpMatrix, float4(input.position, 1.0));
+    output.position = mul(mvpMatrix, float4(position, 1.0));
     
     // Transform normal to world space using normal matrix
-    output.worldNormal = normalize(mul((float3x3) normalMatrix, input.normal));
+    output.worldNormal = normalize(mul((float3x3) normalMatrix, decodeNormal(input.normal)));
     
     return output;
 }
\ No newline at end of file
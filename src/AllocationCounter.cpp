@@ -0,0 +1,87 @@
+// Replaces the global operator new and delete of the benchmark executable to count every C++ heap allocation
+
+#include "AllocationCounter.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+
+namespace
+{
+	std::atomic<size_t> liveBytes{ 0 };
+	std::atomic<size_t> peakLiveBytes{ 0 };
+	std::atomic<size_t> allocationCount{ 0 };
+	std::atomic<size_t> totalBytes{ 0 };
+
+	// The block start and the requested size sit right in front of the returned pointer, so any alignment works
+	// on top of malloc and a delete without a size still knows what it frees
+	void* countedAllocate(size_t size, size_t alignment)
+	{
+		alignment = std::max(alignment, alignof(std::max_align_t));
+		const size_t header = 2 * sizeof(size_t);
+		char* block = static_cast<char*>(std::malloc(size + header + alignment));
+		if (!block)
+		{
+			throw std::bad_alloc();
+		}
+		const uintptr_t address = (reinterpret_cast<uintptr_t>(block) + header + alignment - 1) & ~(uintptr_t(alignment) - 1);
+		size_t* fields = reinterpret_cast<size_t*>(address) - 2;
+		fields[0] = address - reinterpret_cast<uintptr_t>(block);
+		fields[1] = size;
+		allocationCount.fetch_add(1, std::memory_order_relaxed);
+		totalBytes.fetch_add(size, std::memory_order_relaxed);
+		const size_t live = liveBytes.fetch_add(size, std::memory_order_relaxed) + size;
+		size_t peak = peakLiveBytes.load(std::memory_order_relaxed);
+		while (live > peak && !peakLiveBytes.compare_exchange_weak(peak, live, std::memory_order_relaxed))
+		{
+		}
+		return reinterpret_cast<void*>(address);
+	}
+
+	void countedFree(void* pointer)
+	{
+		if (!pointer)
+		{
+			return;
+		}
+		const size_t* fields = static_cast<const size_t*>(pointer) - 2;
+		liveBytes.fetch_sub(fields[1], std::memory_order_relaxed);
+		std::free(static_cast<char*>(pointer) - fields[0]);
+	}
+}
+
+void* operator new(size_t size) { return countedAllocate(size, 0); }
+void* operator new[](size_t size) { return countedAllocate(size, 0); }
+void* operator new(size_t size, std::align_val_t alignment) { return countedAllocate(size, size_t(alignment)); }
+void* operator new[](size_t size, std::align_val_t alignment) { return countedAllocate(size, size_t(alignment)); }
+void operator delete(void* pointer) noexcept { countedFree(pointer); }
+void operator delete[](void* pointer) noexcept { countedFree(pointer); }
+void operator delete(void* pointer, size_t) noexcept { countedFree(pointer); }
+void operator delete[](void* pointer, size_t) noexcept { countedFree(pointer); }
+void operator delete(void* pointer, std::align_val_t) noexcept { countedFree(pointer); }
+void operator delete[](void* pointer, std::align_val_t) noexcept { countedFree(pointer); }
+void operator delete(void* pointer, size_t, std::align_val_t) noexcept { countedFree(pointer); }
+void operator delete[](void* pointer, size_t, std::align_val_t) noexcept { countedFree(pointer); }
+
+AllocationCounter::Scope::Scope()
+	: baselineLive(liveBytes.load(std::memory_order_relaxed)), baselineCount(allocationCount.load(std::memory_order_relaxed)),
+	baselineBytes(totalBytes.load(std::memory_order_relaxed))
+{
+	peakLiveBytes.store(baselineLive, std::memory_order_relaxed);
+}
+
+size_t AllocationCounter::Scope::allocations() const
+{
+	return allocationCount.load(std::memory_order_relaxed) - baselineCount;
+}
+
+size_t AllocationCounter::Scope::allocatedBytes() const
+{
+	return totalBytes.load(std::memory_order_relaxed) - baselineBytes;
+}
+
+size_t AllocationCounter::Scope::peakBytes() const
+{
+	return peakLiveBytes.load(std::memory_order_relaxed) - baselineLive;
+}
\ No newline at end of file
@@ -0,0 +1,229 @@
+// Entry point of the benchmark executable - runs the requested benchmark without a window or GPU
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDebug>
+#include "CullBenchmark.h"
+#include "FrameRingBenchmark.h"
+#include "KernelBenchmark.h"
+#include "LoadBenchmark.h"
+#include "LodBenchmark.h"
+#include "MeshGenerator.h"
+#include "Model.h"
+#include "NumberBenchmark.h"
+#include "ObjCheck.h"
+#include "ParseScalingBenchmark.h"
+#include "ParseScratchBenchmark.h"
+#include "PickBenchmark.h"
+#include "RasterBenchmark.h"
+#include "SceneBenchmark.h"
+#include "Trace.h"
+#include "UploadBenchmark.h"
+
+namespace
+{
+	// Plain counts or with a K or M suffix: 1000, 10K, 2.5M
+	bool parseCount(const QString& text, size_t& count)
+	{
+		QString digits = text.trimmed().toUpper();
+		double scale = 1.0;
+		if (digits.endsWith('K') || digits.endsWith('M'))
+		{
+			scale = digits.endsWith('K') ? 1.0e3 : 1.0e6;
+			digits.chop(1);
+		}
+		bool ok = false;
+		const double value = digits.toDouble(&ok) * scale;
+		if (!ok || value < 1.0)
+		{
+			qCritical() << "Invalid count" << text;
+			return false;
+		}
+		count = static_cast<size_t>(value + 0.5);
+		return true;
+	}
+
+	bool parseShapes(const QString& text, std::vector<MeshGenerator::Shape>& shapes)
+	{
+		shapes.clear();
+		for (const QString& name : text.split(',', Qt::SkipEmptyParts))
+		{
+			MeshGenerator::Shape shape;
+			if (!MeshGenerator::shapeFromName(name.trimmed(), shape))
+			{
+				qCritical() << "Unknown shape" << name << "- expected grid, sphere, scan or cad";
+				return false;
+			}
+			shapes.push_back(shape);
+		}
+		return !shapes.empty();
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	QCoreApplication app(argc, argv);
+	TRACE_THREAD_NAME("Main");
+#if SIMPLE3DVIEWER_TRACING
+	struct TraceWriter // Writes the trace on every return path below
+	{
+		~TraceWriter() { Trace::writeJson(qEnvironmentVariable("SIMPLE3DVIEWER_TRACE", "simple3dviewer-benchmarks-trace.json")); }
+	} traceWriter;
+#endif
+
+	QCommandLineParser parser;
+	parser.setApplicationDescription("Runs the load benchmark over generated meshes when no other benchmark is selected.");
+	parser.addHelpOption();
+	QCommandLineOption sizesOption("sizes", "Comma-separated triangle counts for the load benchmark, K and M suffixes allowed.", "counts", "1K,10K,100K,1M,10M,100M");
+	QCommandLineOption shapesOption("shapes", "Comma-separated shapes for the load benchmark and --generate: grid, sphere, scan, cad.", "shapes", "grid,sphere,scan,cad");
+	QCommandLineOption directoryOption("mesh-dir", "Directory for the generated meshes (default: a temporary directory).", "dir");
+	QCommandLineOption jsonOption("json", "Write the load benchmark results to <file>.", "file");
+	QCommandLineOption repeatOption("repeat", "Loads per generated mesh, the fastest is reported.", "count", "1");
+	QCommandLineOption optimizeOption("optimize", "Include the vertex order optimization in the timed loads.");
+	QCommandLineOption keepOption("keep-meshes", "Keep the generated meshes instead of deleting each after its run.");
+	QCommandLineOption generateOption("generate", "Only write a mesh of the first --shapes entry with --triangles triangles to <file> and exit.", "file");
+	QCommandLineOption trianglesOption("triangles", "Triangle count for --generate, K and M suffixes allowed.", "count", "1M");
+	parser.addOption(sizesOption);
+	parser.addOption(shapesOption);
+	parser.addOption(directoryOption);
+	parser.addOption(jsonOption);
+	parser.addOption(repeatOption);
+	parser.addOption(optimizeOption);
+	parser.addOption(keepOption);
+	parser.addOption(generateOption);
+	parser.addOption(trianglesOption);
+	QCommandLineOption scalingOption("parse-scaling", "Log OBJ parse throughput at 1, 2, 4 ... N threads for <file> and exit.", "file");
+	QCommandLineOption threadsOption("parse-threads", "Parse threads of the load benchmark, upper thread count for --parse-scaling and --lod-report (default: hardware threads).", "count", "0");
+	QCommandLineOption kernelOption("kernel-benchmark", "Time the SoA mesh kernels against the QVector3D loops on a <triangles> grid and exit.", "triangles");
+	parser.addOption(scalingOption);
+	parser.addOption(threadsOption);
+	QCommandLineOption pickOption("pick-benchmark", "Time BVH build and ray picks on <file> and exit.", "file");
+	QCommandLineOption raysOption("pick-rays", "Number of rays for --pick-benchmark.", "count", "10000");
+	parser.addOption(kernelOption);
+	parser.addOption(pickOption);
+	parser.addOption(raysOption);
+	QCommandLineOption cullOption("cull-benchmark", "Time frustum culling of <file> over scripted camera poses and exit.", "file");
+	parser.addOption(cullOption);
+	QCommandLineOption lodOption("lod-report", "Build the LOD chain of <file> at 1, 2, 4 ... N threads, log triangle counts and errors and exit.", "file");
+	parser.addOption(lodOption);
+	QCommandLineOption rasterOption("raster-benchmark", "Render <file> with the software rasterizer over scripted camera poses, log frame times and exit.", "file");
+	QCommandLineOption rasterSizeOption("raster-size", "Frame size for --raster-benchmark.", "WxH", "1280x720");
+	QCommandLineOption rasterImageOption("raster-image", "Save the first --raster-benchmark frame to <png>, plus a -wireframe copy.", "png");
+	parser.addOption(rasterOption);
+	parser.addOption(rasterSizeOption);
+	parser.addOption(rasterImageOption);
+	QCommandLineOption ringOption("ring-stress", "Run <frames> frames of random upload ring allocations against a simulated GPU, check that none is reused early and exit.", "frames");
+	parser.addOption(ringOption);
+	QCommandLineOption outOfCoreOption("out-of-core", "Load the .stl, .ply or .obj <file> out of core, log its chunks and preview and exit.", "file");
+	QCommandLineOption budgetOption("memory-budget", "Memory budget of --out-of-core in MB.", "MB", "1024");
+	parser.addOption(outOfCoreOption);
+	parser.addOption(budgetOption);
+	QCommandLineOption sceneOption("scene-benchmark", "Update the world matrices of a generated assembly of <nodes> nodes every frame, log the times and exit. K and M suffixes allowed.", "nodes");
+	parser.addOption(sceneOption);
+	QCommandLineOption uploadOption("upload-benchmark", "Pack <file> for upload staged and in place in both vertex formats, log peak heap bytes and times and exit.", "file");
+	parser.addOption(uploadOption);
+	QCommandLineOption parseScratchOption("parse-scratch", "Parse <file> with chunk arrays allocated per block and kept for the whole load, log allocations and times at --parse-threads and exit.", "file");
+	parser.addOption(parseScratchOption);
+	QCommandLineOption numberOption("number-benchmark", "Check the number parser against strtof and strtod on <values> random floats and edge cases, log values per second against std::from_chars and QString and exit. K and M suffixes allowed.", "values");
+	parser.addOption(numberOption);
+	QCommandLineOption objCheckOption("obj-check", "Parse built-in edge cases, generated meshes and the .obj files given as arguments with the old QString line parser and with the .obj parser whole, chunked on --parse-threads and in small blocks, log any difference and exit.");
+	parser.addOption(objCheckOption);
+	parser.addPositionalArgument("files", "Extra .obj files for --obj-check.", "[files...]");
+	parser.process(app);
+	if (parser.isSet(scalingOption))
+	{
+		return runParseScalingBenchmark(parser.value(scalingOption), parser.value(threadsOption).toUInt()) ? 0 : 1;
+	}
+	if (parser.isSet(kernelOption))
+	{
+		return runKernelBenchmark(parser.value(kernelOption).toULongLong()) ? 0 : 1;
+	}
+	if (parser.isSet(pickOption))
+	{
+		return runPickBenchmark(parser.value(pickOption), parser.value(raysOption).toULongLong()) ? 0 : 1;
+	}
+	if (parser.isSet(cullOption))
+	{
+		return runCullBenchmark(parser.value(cullOption)) ? 0 : 1;
+	}
+	if (parser.isSet(lodOption))
+	{
+		return runLodBenchmark(parser.value(lodOption), parser.value(threadsOption).toUInt()) ? 0 : 1;
+	}
+	if (parser.isSet(rasterOption))
+	{
+		const QStringList size = parser.value(rasterSizeOption).split('x');
+		const int width = size.value(0).toInt();
+		const int height = size.value(1).toInt();
+		return runRasterBenchmark(parser.value(rasterOption), width, height, parser.value(rasterImageOption)) ? 0 : 1;
+	}
+	if (parser.isSet(ringOption))
+	{
+		return runFrameRingStress(parser.value(ringOption).toULongLong()) ? 0 : 1;
+	}
+	if (parser.isSet(sceneOption))
+	{
+		size_t nodes = 0;
+		return parseCount(parser.value(sceneOption), nodes) && runSceneBenchmark(nodes) ? 0 : 1;
+	}
+	if (parser.isSet(uploadOption))
+	{
+		return runUploadBenchmark(parser.value(uploadOption)) ? 0 : 1;
+	}
+	if (parser.isSet(parseScratchOption))
+	{
+		return runParseScratchBenchmark(parser.value(parseScratchOption), parser.value(threadsOption).toUInt()) ? 0 : 1;
+	}
+	if (parser.isSet(numberOption))
+	{
+		size_t values = 0;
+		return parseCount(parser.value(numberOption), values) && runNumberBenchmark(values) ? 0 : 1;
+	}
+	if (parser.isSet(objCheckOption))
+	{
+		return runObjCheck(parser.positionalArguments(), parser.value(threadsOption).toUInt()) ? 0 : 1;
+	}
+	if (parser.isSet(outOfCoreOption))
+	{
+		Model model;
+		model.setParseThreadCount(parser.value(threadsOption).toUInt());
+		model.setOutOfCoreBudget(parser.value(budgetOption).toULongLong() * 1024 * 1024);
+		return model.loadFromFile(parser.value(outOfCoreOption)) ? 0 : 1;
+	}
+
+	LoadBenchmarkSettings settings;
+	if (!parseShapes(parser.value(shapesOption), settings.shapes))
+	{
+		return 1;
+	}
+	if (parser.isSet(generateOption))
+	{
+		size_t triangles = 0;
+		MeshGenerator::Stats stats;
+		if (!parseCount(parser.value(trianglesOption), triangles)
+			|| !MeshGenerator::writeObj(parser.value(generateOption), settings.shapes.front(), triangles, 1, &stats))
+		{
+			return 1;
+		}
+		qInfo().nospace() << "Wrote " << stats.triangles << " triangles, " << stats.vertices << " vertices, " << stats.bytes / (1024.0 * 1024.0) << " MB";
+		return 0;
+	}
+
+	settings.triangleCounts.clear();
+	for (const QString& count : parser.value(sizesOption).split(',', Qt::SkipEmptyParts))
+	{
+		size_t triangles = 0;
+		if (!parseCount(count, triangles))
+		{
+			return 1;
+		}
+		settings.triangleCounts.push_back(triangles);
+	}
+	settings.directory = parser.value(directoryOption);
+	settings.jsonPath = parser.value(jsonOption);
+	settings.threadCount = parser.value(threadsOption).toUInt();
+	settings.repeats = parser.value(repeatOption).toInt();
+	settings.optimize = parser.isSet(optimizeOption);
+	settings.keepFiles = parser.isSet(keepOption);
+	return runLoadBenchmark(settings) ? 0 : 1;
+}
\ No newline at end of file
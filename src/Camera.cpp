@@ -34,10 +34,36 @@ void Camera::zoom(float delta)
 	updatePosition();
 }
 
+void Camera::setTarget(const DirectX::XMFLOAT3& newTarget)
+{
+	target = newTarget;
+	updatePosition();
+}
+
+const DirectX::XMFLOAT3& Camera::getPosition() const
+{
+	return position;
+}
+
+DirectX::XMMATRIX Camera::getViewMatrix() const
+{
+	return XMMatrixLookAtLH(XMLoadFloat3(&position), XMLoadFloat3(&target), XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+}
+
+DirectX::XMMATRIX Camera::getProjectionMatrix(float aspectRatio) const
+{
+	return XMMatrixPerspectiveFovLH(getVerticalFov(), aspectRatio, 0.1f, 100.0f);
+}
+
+float Camera::getVerticalFov() const
+{
+	return XMConvertToRadians(45.0f);
+}
+
 DirectX::XMFLOAT4X4 Camera::getMVPMatrix(float aspectRatio) const
 {
-	XMMATRIX view = XMMatrixLookAtLH(XMLoadFloat3(&position), XMLoadFloat3(&target), XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
-	XMMATRIX proj = XMMatrixPerspectiveFovLH(XMConvertToRadians(45.0f), aspectRatio, 0.1f, 100.0f);
+	XMMATRIX view = getViewMatrix();
+	XMMATRIX proj = getProjectionMatrix(aspectRatio);
 	XMMATRIX mvp = XMMatrixIdentity() * view * proj; // Model is identity for now
 	XMFLOAT4X4 result;
 	XMStoreFloat4x4(&result, mvp);
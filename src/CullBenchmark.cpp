@@ -0,0 +1,123 @@
+// Orbits and zooms the viewer camera around a loaded model and culls its chunks at every pose, no GPU needed
+
+#include "CullBenchmark.h"
+#include "Camera.h"
+#include "FrustumCuller.h"
+#include "MeshKernels.h"
+#include "Model.h"
+#include <QDebug>
+#include <chrono>
+#include <vector>
+
+namespace
+{
+	constexpr float aspectRatio = 16.0f / 9.0f;
+	constexpr int repeats = 50; // Per pose, one cull is too short to time on its own
+
+	// Full circles at three pitches and three zoom levels, the camera distances the viewer reaches with the wheel
+	std::vector<DirectX::XMFLOAT4X4> makePoses(const MeshBounds& bounds)
+	{
+		std::vector<DirectX::XMFLOAT4X4> poses;
+		const float zoomSteps[] = { 0.0f, 20.0f, 35.0f };
+		const float pitchSteps[] = { 0.0f, -60.0f, 60.0f };
+		for (float zoom : zoomSteps)
+		{
+			for (float pitch : pitchSteps)
+			{
+				Camera camera;
+				camera.setTarget({ bounds.center.x(), bounds.center.y(), bounds.center.z() });
+				camera.zoom(zoom);
+				camera.orbit(0.0f, pitch);
+				for (int step = 0; step < 24; ++step)
+				{
+					camera.orbit(30.0f, 0.0f); // 15 degrees of yaw
+					poses.push_back(camera.getMVPMatrix(aspectRatio));
+				}
+			}
+		}
+		return poses;
+	}
+
+	size_t triangleCount(const std::vector<IndexRange>& ranges)
+	{
+		size_t indices = 0;
+		for (const IndexRange& range : ranges)
+		{
+			indices += range.indexCount;
+		}
+		return indices / 3;
+	}
+}
+
+bool runCullBenchmark(const QString& filePath)
+{
+	// Chunks are only tight on a spatially coherent triangle order
+	Model model;
+	model.setOptimizeOnLoad(true);
+	if (!model.loadFromFile(filePath) || model.getIndices().empty())
+	{
+		qCritical() << "Cannot load" << filePath << "for the cull benchmark";
+		return false;
+	}
+	const auto indices = model.getIndices();
+	const size_t totalTriangles = indices.size() / 3;
+
+	ChunkBounds chunks;
+	auto start = std::chrono::steady_clock::now();
+	FrustumCuller::buildChunks(model.getVertices(), indices, FrustumCuller::defaultChunkTriangles, chunks);
+	const double buildMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	qInfo().nospace() << "Cull benchmark: " << totalTriangles << " triangles in " << chunks.size() << " chunks of "
+		<< FrustumCuller::defaultChunkTriangles << ", built in " << buildMs << " ms";
+
+	const std::vector<DirectX::XMFLOAT4X4> poses = makePoses(model.getBounds());
+	std::vector<Frustum> frustums;
+	frustums.reserve(poses.size());
+	for (const DirectX::XMFLOAT4X4& pose : poses)
+	{
+		frustums.push_back(Frustum::fromMatrix(&pose.m[0][0]));
+	}
+
+	// Scalar results are the reference for the SIMD paths
+	std::vector<std::vector<IndexRange>> reference(frustums.size());
+	size_t visibleChunks = 0;
+	size_t visibleTriangles = 0;
+	for (size_t i = 0; i < frustums.size(); ++i)
+	{
+		visibleChunks += FrustumCuller::cull(frustums[i], chunks, reference[i]);
+		visibleTriangles += triangleCount(reference[i]);
+	}
+	qInfo().nospace() << frustums.size() << " poses: " << 100.0 * visibleChunks / (double(chunks.size()) * frustums.size())
+		<< "% of chunks and " << 100.0 * visibleTriangles / (double(totalTriangles) * frustums.size()) << "% of triangles drawn on average";
+
+	bool matches = true;
+	std::vector<IndexRange> visible;
+	const MeshKernels::Isa previous = MeshKernels::activeIsa();
+	for (int isa = 0; isa <= static_cast<int>(MeshKernels::bestSupportedIsa()); ++isa)
+	{
+		MeshKernels::setActiveIsa(static_cast<MeshKernels::Isa>(isa));
+		size_t mismatches = 0;
+		double totalUs = 0.0;
+		for (size_t i = 0; i < frustums.size(); ++i)
+		{
+			start = std::chrono::steady_clock::now();
+			for (int r = 0; r < repeats; ++r)
+			{
+				visible.clear();
+				FrustumCuller::cull(frustums[i], chunks, visible);
+			}
+			totalUs += std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / repeats;
+
+			bool same = visible.size() == reference[i].size();
+			for (size_t r = 0; same && r < visible.size(); ++r)
+			{
+				same = visible[r].firstIndex == reference[i][r].firstIndex && visible[r].indexCount == reference[i][r].indexCount;
+			}
+			mismatches += same ? 0 : 1;
+		}
+		qInfo().nospace() << MeshKernels::isaName(MeshKernels::activeIsa()) << ": " << totalUs / frustums.size() << " us per pose, "
+			<< mismatches << " poses differ from scalar";
+		matches = matches && mismatches == 0;
+	}
+	MeshKernels::setActiveIsa(previous);
+	return matches;
+}
\ No newline at end of file
@@ -0,0 +1,48 @@
+// Fence values signaled on the command queue and waited on through a Win32 event
+
+#include "D3D12FrameFence.h"
+#include <stdexcept>
+#include "Trace.h"
+
+D3D12FrameFence::~D3D12FrameFence()
+{
+	if (event)
+	{
+		CloseHandle(event);
+	}
+}
+
+void D3D12FrameFence::create(ID3D12Device* device)
+{
+	if (FAILED(device->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&fence))))
+	{
+		throw std::runtime_error("Failed to create fence");
+	}
+	event = CreateEvent(nullptr, FALSE, FALSE, nullptr);
+	if (!event)
+	{
+		throw std::runtime_error("Failed to create fence event");
+	}
+}
+
+uint64_t D3D12FrameFence::signal(ID3D12CommandQueue* queue)
+{
+	queue->Signal(fence.Get(), ++lastSignaled);
+	return lastSignaled;
+}
+
+uint64_t D3D12FrameFence::completedValue() const
+{
+	return fence ? fence->GetCompletedValue() : lastSignaled;
+}
+
+void D3D12FrameFence::wait(uint64_t value)
+{
+	if (!fence || fence->GetCompletedValue() >= value)
+	{
+		return;
+	}
+	TRACE_ZONE("Wait for GPU");
+	fence->SetEventOnCompletion(value, event);
+	WaitForSingleObject(event, INFINITE);
+}
\ No newline at end of file
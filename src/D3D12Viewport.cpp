@@ -2,6 +2,8 @@
 
 #include "D3D12Viewport.h"
 #include <QWindow>
+#include <algorithm>
+#include <climits>
 #include <stdexcept>
 #include <d3dcompiler.h>
 #include <DirectXMath.h>
@@ -11,6 +13,11 @@
 #include <QCoreApplication>
 #include <QWheelEvent>
 #include <QDebug>
+#include <QElapsedTimer>
+#include <QTimer>
+#include "OutOfCoreMesh.h"
+#include "Trace.h"
+#include "VertexQuantizer.h"
 
 using namespace DirectX;
 
@@ -20,11 +27,79 @@ struct ConstantBufferData
 	XMFLOAT4X4 modelMatrix;
 	XMFLOAT4X4 normalMatrix;
 	XMFLOAT3 lightDirection;
-	float padding[13];
+	float padding;
+	XMFLOAT4 positionOffset; // Dequantization of compact positions, identity for full vertices
+	XMFLOAT4 positionScale;
+	float reserved[4];
 };
 static_assert((sizeof(ConstantBufferData) % 256) == 0, "ConstantBufferData size must be 256-byte aligned");
 
-D3D12Viewport::D3D12Viewport(QWidget* parent) : QWidget(parent), frameIndex(0), fenceValue(0)
+static constexpr size_t uploadRingBytes = 4 * 1024 * 1024; // Per-node constants of about 8K scene nodes for each frame in flight
+
+namespace
+{
+	// Chunks of an out-of-core mesh whose bounding sphere covers at least this radius on screen are drawn in full
+	constexpr float refineChunkPixels = 256.0f;
+	constexpr size_t maxRefinedChunks = 4; // Resident per mesh, each up to the chunk size OutOfCoreMesh builds
+
+	// False when the box is entirely outside one of the planes, tested at its corner furthest along the plane normal
+	bool intersects(const Frustum& frustum, const MeshBounds& bounds)
+	{
+		for (const auto& plane : frustum.planes)
+		{
+			const float x = plane[0] >= 0.0f ? bounds.max.x() : bounds.min.x();
+			const float y = plane[1] >= 0.0f ? bounds.max.y() : bounds.min.y();
+			const float z = plane[2] >= 0.0f ? bounds.max.z() : bounds.min.z();
+			if (plane[0] * x + plane[1] * y + plane[2] * z + plane[3] < 0.0f)
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	// A committed buffer in the upload heap, the GPU reads it where the CPU wrote it
+	bool createUploadBuffer(ID3D12Device* device, size_t bytes, ComPtr<ID3D12Resource>& buffer)
+	{
+		D3D12_HEAP_PROPERTIES heapProps = {};
+		heapProps.Type = D3D12_HEAP_TYPE_UPLOAD;
+		heapProps.CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_UNKNOWN;
+		heapProps.MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN;
+		heapProps.CreationNodeMask = 1;
+		heapProps.VisibleNodeMask = 1;
+
+		D3D12_RESOURCE_DESC desc = {};
+		desc.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
+		desc.Alignment = 0;
+		desc.Width = bytes;
+		desc.Height = 1;
+		desc.DepthOrArraySize = 1;
+		desc.MipLevels = 1;
+		desc.Format = DXGI_FORMAT_UNKNOWN;
+		desc.SampleDesc.Count = 1;
+		desc.SampleDesc.Quality = 0;
+		desc.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
+		desc.Flags = D3D12_RESOURCE_FLAG_NONE;
+
+		return SUCCEEDED(device->CreateCommittedResource(&heapProps, D3D12_HEAP_FLAG_NONE, &desc, D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, IID_PPV_ARGS(&buffer)));
+	}
+
+	// Vertex and index buffers mapped for their whole lifetime. The loader thread packs into them (the device is
+	// free-threaded) and the viewport binds the very same resources.
+	class UploadHeapMeshBuffers : public MeshBuffers
+	{
+	public:
+		void* vertexData() override { return vertices; }
+		void* indexData() override { return indices; }
+
+		ComPtr<ID3D12Resource> vertexBuffer;
+		ComPtr<ID3D12Resource> indexBuffer;
+		void* vertices = nullptr;
+		void* indices = nullptr;
+	};
+}
+
+D3D12Viewport::D3D12Viewport(QWidget* parent) : QWidget(parent), framePacer(frameFence, framesInFlight), uploadRing(frameFence, uploadRingBytes), frameIndex(0)
 {
 	setAttribute(Qt::WA_PaintOnScreen, true);
 	setAttribute(Qt::WA_NativeWindow, true);
@@ -37,7 +112,6 @@ D3D12Viewport::D3D12Viewport(QWidget* parent) : QWidget(parent), frameIndex(0),
 
 	winId();
 
-	indexCount = 0;
 	XMStoreFloat4x4(&mvpMatrix, XMMatrixIdentity());
 
 	try
@@ -53,16 +127,9 @@ D3D12Viewport::D3D12Viewport(QWidget* parent) : QWidget(parent), frameIndex(0),
 D3D12Viewport::~D3D12Viewport()
 {
 	// Wait for GPU to finish
-	if (commandQueue && fence)
-	{
-		commandQueue->Signal(fence.Get(), fenceValue);
-		fence->SetEventOnCompletion(fenceValue, fenceEvent);
-		WaitForSingleObject(fenceEvent, INFINITE);
-		CloseHandle(fenceEvent);
-	}
-	if (vertexBuffer) vertexBuffer.Reset();
-	if (indexBuffer) indexBuffer.Reset();
-	if (constantBuffer) constantBuffer.Reset();
+	framePacer.waitIdle();
+	gpuMeshes.clear();
+	if (uploadBuffer) uploadBuffer.Reset();
 	if (rootSignature) rootSignature.Reset();
 	if (pipelineState) pipelineState.Reset();
 }
@@ -224,25 +291,24 @@ void D3D12Viewport::initializeD3D12()
 	device->CreateDepthStencilView(depthBuffer.Get(), &dsvDesc, dsvHeap->GetCPUDescriptorHandleForHeapStart());
 
 
-	// Create command allocator and command list
-	if (FAILED(device->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_DIRECT, IID_PPV_ARGS(&commandAllocator))))
+	// Create a command allocator per frame in flight and the command list
+	for (ComPtr<ID3D12CommandAllocator>& allocator : commandAllocators)
 	{
-		throw std::runtime_error("Failed to create command allocator");
+		if (FAILED(device->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_DIRECT, IID_PPV_ARGS(&allocator))))
+		{
+			throw std::runtime_error("Failed to create command allocator");
+		}
 	}
-	if (FAILED(device->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_DIRECT, commandAllocator.Get(), nullptr, IID_PPV_ARGS(&commandList))))
+	if (FAILED(device->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_DIRECT, commandAllocators[0].Get(), nullptr, IID_PPV_ARGS(&commandList))))
 	{
 		throw std::runtime_error("Failed to create command list");
 	}
 	commandList->Close();
 
 	// Create synchronization objects
-	fenceEvent = CreateEvent(nullptr, FALSE, FALSE, nullptr);
-	if (FAILED(device->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&fence))))
-	{
-		throw std::runtime_error("Failed to create fence");
-	}
+	frameFence.create(device.Get());
 
-	// Create constant buffer for MVP matrix - properly initialize the resource desc
+	// Create the upload buffer the per-frame constants are sub-allocated from
 	D3D12_HEAP_PROPERTIES heapProps = {};
 	heapProps.Type = D3D12_HEAP_TYPE_UPLOAD;
 	heapProps.CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_UNKNOWN;
@@ -253,7 +319,7 @@ void D3D12Viewport::initializeD3D12()
 	D3D12_RESOURCE_DESC cbDesc = {};
 	cbDesc.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
 	cbDesc.Alignment = 0;
-	cbDesc.Width = sizeof(ConstantBufferData);
+	cbDesc.Width = uploadRing.getCapacity();
 	cbDesc.Height = 1;
 	cbDesc.DepthOrArraySize = 1;
 	cbDesc.MipLevels = 1;
@@ -263,21 +329,19 @@ void D3D12Viewport::initializeD3D12()
 	cbDesc.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
 	cbDesc.Flags = D3D12_RESOURCE_FLAG_NONE;
 
-	if (FAILED(device->CreateCommittedResource(&heapProps, D3D12_HEAP_FLAG_NONE, &cbDesc, D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, IID_PPV_ARGS(&constantBuffer))))
+	if (FAILED(device->CreateCommittedResource(&heapProps, D3D12_HEAP_FLAG_NONE, &cbDesc, D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, IID_PPV_ARGS(&uploadBuffer))))
 	{
-		throw std::runtime_error("Failed to create constant buffer");
+		throw std::runtime_error("Failed to create upload buffer");
 	}
 
-	// Map and initialize constant buffer
-	void* cbData;
+	// Upload heaps may stay mapped for their whole lifetime, the CPU never reads them back
+	void* mapped;
 	D3D12_RANGE range = { 0, 0 };
-	if (FAILED(constantBuffer->Map(0, &range, &cbData)))
+	if (FAILED(uploadBuffer->Map(0, &range, &mapped)))
 	{
-		throw std::runtime_error("Failed to map constant buffer");
+		throw std::runtime_error("Failed to map upload buffer");
 	}
-	XMStoreFloat4x4(&mvpMatrix, XMMatrixIdentity());
-	memcpy(cbData, &mvpMatrix, sizeof(XMFLOAT4X4));
-	constantBuffer->Unmap(0, nullptr);
+	uploadData = static_cast<unsigned char*>(mapped);
 
 	// Manual root parameter initialization (could be loaded from a file instead)
 	D3D12_ROOT_PARAMETER rootParameters[1];
@@ -318,6 +382,23 @@ void D3D12Viewport::initializeD3D12()
 		throw std::runtime_error(errorMsg);
 	}
 
+	// Same shader with the compact vertex decode compiled in
+	ComPtr<ID3DBlob> vsCompactBlob;
+	const D3D_SHADER_MACRO compactDefines[] = { { "COMPACT_VERTICES", "1" }, { nullptr, nullptr } };
+	vsResult = D3DCompileFromFile(vertexShaderPath.c_str(), compactDefines, D3D_COMPILE_STANDARD_FILE_INCLUDE, "main", "vs_5_0",
+		D3DCOMPILE_DEBUG | D3DCOMPILE_SKIP_OPTIMIZATION, 0, &vsCompactBlob, &errorBlob);
+	if (FAILED(vsResult))
+	{
+		std::string errorMsg = "Failed to compile compact vertex shader";
+		if (errorBlob)
+		{
+			errorMsg += ":\n";
+			errorMsg += static_cast<char*>(errorBlob->GetBufferPointer());
+		}
+		errorMsg += "\nHRESULT: 0x" + std::to_string(vsResult);
+		throw std::runtime_error(errorMsg);
+	}
+
 	HRESULT psResult = D3DCompileFromFile(pixelShaderPath.c_str(), nullptr, D3D_COMPILE_STANDARD_FILE_INCLUDE, "main", "ps_5_0",
 		D3DCOMPILE_DEBUG | D3DCOMPILE_SKIP_OPTIMIZATION, 0, &psBlob, &errorBlob);
 	if (FAILED(psResult))
@@ -388,142 +469,381 @@ void D3D12Viewport::initializeD3D12()
 	{
 		throw std::runtime_error("Failed to create solid graphics pipeline state");
 	}
+	// A node whose world matrix mirrors turns its meshes' front faces clockwise on screen
+	D3D12_GRAPHICS_PIPELINE_STATE_DESC psoDescSolidMirrored = psoDescSolid;
+	psoDescSolidMirrored.RasterizerState.FrontCounterClockwise = TRUE;
+	if (FAILED(device->CreateGraphicsPipelineState(&psoDescSolidMirrored, IID_PPV_ARGS(&pipelineStateSolidMirrored))))
+	{
+		throw std::runtime_error("Failed to create mirrored solid graphics pipeline state");
+	}
+
+	// Compact vertices: 16-bit positions in the mesh bounds plus an octahedral normal, 12 bytes per vertex
+	D3D12_INPUT_ELEMENT_DESC compactInputLayout[] = {
+		{ "POSITION", 0, DXGI_FORMAT_R16G16B16A16_UNORM, 0, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+		{ "NORMAL", 0, DXGI_FORMAT_R16G16_SNORM, 0, 8, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 }
+	};
+	D3D12_GRAPHICS_PIPELINE_STATE_DESC psoDescCompact = psoDesc;
+	psoDescCompact.InputLayout = { compactInputLayout, 2 };
+	psoDescCompact.VS = { vsCompactBlob->GetBufferPointer(), vsCompactBlob->GetBufferSize() };
+	if (FAILED(device->CreateGraphicsPipelineState(&psoDescCompact, IID_PPV_ARGS(&pipelineStateCompact))))
+	{
+		throw std::runtime_error("Failed to create compact graphics pipeline state");
+	}
+	D3D12_GRAPHICS_PIPELINE_STATE_DESC psoDescSolidCompact = psoDescSolid;
+	psoDescSolidCompact.InputLayout = psoDescCompact.InputLayout;
+	psoDescSolidCompact.VS = psoDescCompact.VS;
+	if (FAILED(device->CreateGraphicsPipelineState(&psoDescSolidCompact, IID_PPV_ARGS(&pipelineStateSolidCompact))))
+	{
+		throw std::runtime_error("Failed to create compact solid graphics pipeline state");
+	}
+	D3D12_GRAPHICS_PIPELINE_STATE_DESC psoDescSolidCompactMirrored = psoDescSolidCompact;
+	psoDescSolidCompactMirrored.RasterizerState.FrontCounterClockwise = TRUE;
+	if (FAILED(device->CreateGraphicsPipelineState(&psoDescSolidCompactMirrored, IID_PPV_ARGS(&pipelineStateSolidCompactMirrored))))
+	{
+		throw std::runtime_error("Failed to create mirrored compact solid graphics pipeline state");
+	}
 }
 // Load model data into GPU buffers
-void D3D12Viewport::loadModel(const Model* model)
+void D3D12Viewport::loadModel(std::shared_ptr<const Model> model)
 {
+	TRACE_ZONE("D3D12Viewport::loadModel");
 	if (!model)
 	{
 		qCritical() << "Null model passed to loadModel";
 		return;
 	}
-
+	// Only the layout is computed up front, the vertex and index bytes are written once, into the mapped buffers
+	std::vector<PackedMesh> meshes(1);
+	MeshPacker::layout(*model, useCompactVertices, meshes[0]);
+	const std::vector<const Model*> sources = { model.get() };
+	Scene newScene;
+	newScene.addNode(Scene::none, QMatrix4x4(), newScene.addMesh(std::move(model)));
+	uploadScene(std::move(newScene), std::move(meshes), sources);
+}
+// Copy an already packed mesh into upload heaps, the only part of a load that has to run on this thread
+void D3D12Viewport::loadPackedModel(std::shared_ptr<const Model> model, PackedMesh&& mesh)
+{
+	TRACE_ZONE("D3D12Viewport::loadPackedModel");
+	std::vector<PackedMesh> meshes(1);
+	meshes[0] = std::move(mesh);
+	Scene newScene;
+	newScene.addNode(Scene::none, QMatrix4x4(), newScene.addMesh(std::move(model)));
+	uploadScene(std::move(newScene), std::move(meshes), {});
+}
+void D3D12Viewport::loadPackedScene(Scene&& newScene, std::vector<PackedMesh>&& meshes)
+{
+	TRACE_ZONE("D3D12Viewport::loadPackedScene");
+	uploadScene(std::move(newScene), std::move(meshes), {});
+}
+void D3D12Viewport::uploadScene(Scene&& newScene, std::vector<PackedMesh>&& meshes, const std::vector<const Model*>& sources)
+{
 	try
 	{
-		qDebug() << "Starting model load...";
+		qDebug() << "Starting scene load..." << newScene.getMeshCount() << "meshes," << newScene.getNodeCount() << "nodes";
+		framePacer.waitIdle(); // Frames in flight still read the buffers replaced below
+		scene = std::move(newScene);
+		gpuMeshes.clear();
+		gpuMeshes.resize(scene.getMeshCount());
+		meshes.resize(scene.getMeshCount()); // A mesh without packed data draws nothing
+		currentLod = 0;
+		for (size_t mesh = 0; mesh < gpuMeshes.size(); ++mesh)
+		{
+			uploadMesh(gpuMeshes[mesh], std::move(meshes[mesh]), mesh < sources.size() ? sources[mesh] : nullptr);
+		}
+		update();
+	}
+	catch (const std::exception& ex)
+	{
+		qCritical() << "Exception in loadModel:" << ex.what();
+		throw;
+	}
+	catch (...)
+	{
+		qCritical() << "Unknown exception in loadModel";
+		throw;
+	}
+}
+void D3D12Viewport::uploadMesh(GpuMesh& gpu, PackedMesh&& mesh, const Model* source)
+{
+	gpu = GpuMesh();
+	if (mesh.empty())
+	{
+		return;
+	}
 
-		const auto& positions = model->getVertices();
-		const auto& indices = model->getIndices();
-		const auto& normals = model->getNormals();
+	qDebug() << "Mesh stats - Vertices:" << mesh.vertexBytes / mesh.vertexStride << "Indices:" << mesh.indexCount;
+	gpu.indexCount = static_cast<UINT>(mesh.indexCount);
+	gpu.vertexCapacity = mesh.vertexCapacity;
+	gpu.indexCapacity = mesh.indexCapacity;
 
-		if (positions.empty() || indices.empty())
+	if (UploadHeapMeshBuffers* packed = dynamic_cast<UploadHeapMeshBuffers*>(mesh.buffers.get()))
+	{
+		// Packed in place by the loader, the buffers are taken over without touching the bytes
+		gpu.vertexBuffer = std::move(packed->vertexBuffer);
+		gpu.indexBuffer = std::move(packed->indexBuffer);
+	}
+	else
+	{
+		if (!createUploadBuffer(device.Get(), mesh.vertexCapacity, gpu.vertexBuffer))
 		{
-			qCritical() << "Model has no vertices or indices";
-			indexCount = 0;
-			return;
+			throw std::runtime_error("Failed to create vertex buffer");
 		}
-
-		if (positions.size() > UINT_MAX || indices.size() > UINT_MAX)
+		if (!createUploadBuffer(device.Get(), mesh.indexCapacity, gpu.indexBuffer))
 		{
-			qCritical() << "Model too large for 32-bit buffers";
-			return;
+			throw std::runtime_error("Failed to create index buffer");
 		}
-
-		// Combined vertex data (position + normal)
-		std::vector<Vertex> vertices;
-		vertices.reserve(positions.size());
-
-		for (size_t i = 0; i < positions.size(); ++i)
+		// Written in one pass from source's streams, or copied from wherever the packed bytes are
 		{
-			Vertex vertex;
-			vertex.position = positions[i];
-			vertex.normal = (i < normals.size()) ? normals[i] : QVector3D(0.0f, 1.0f, 0.0f);
-			vertices.push_back(vertex);
+			TRACE_ZONE("Upload vertices");
+			void* vbData;
+			gpu.vertexBuffer->Map(0, nullptr, &vbData);
+			if (source)
+			{
+				MeshPacker::writeVertices(*source, mesh, vbData);
+			}
+			else
+			{
+				memcpy(vbData, mesh.buffers ? mesh.buffers->vertexData() : mesh.vertexData.data(), mesh.vertexBytes);
+			}
+			gpu.vertexBuffer->Unmap(0, nullptr);
 		}
-
-
-		qDebug() << "Model stats - Vertices:" << vertices.size() << "Indices:" << indices.size();
-		indexCount = static_cast<UINT>(indices.size());
-
-		// Create vertex buffer
-		D3D12_HEAP_PROPERTIES heapProps = {};
-		heapProps.Type = D3D12_HEAP_TYPE_UPLOAD;
-		heapProps.CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_UNKNOWN;
-		heapProps.MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN;
-		heapProps.CreationNodeMask = 1;
-		heapProps.VisibleNodeMask = 1;
-
-		D3D12_RESOURCE_DESC vbDesc = {};
-		vbDesc.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
-		vbDesc.Alignment = 0;
-		vbDesc.Width = vertices.size() * sizeof(Vertex);
-		vbDesc.Height = 1;
-		vbDesc.DepthOrArraySize = 1;
-		vbDesc.MipLevels = 1;
-		vbDesc.Format = DXGI_FORMAT_UNKNOWN;
-		vbDesc.SampleDesc.Count = 1;
-		vbDesc.SampleDesc.Quality = 0;
-		vbDesc.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
-		vbDesc.Flags = D3D12_RESOURCE_FLAG_NONE;
-
-		if (FAILED(device->CreateCommittedResource(&heapProps, D3D12_HEAP_FLAG_NONE, &vbDesc, D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, IID_PPV_ARGS(&vertexBuffer))))
 		{
-			throw std::runtime_error("Failed to create vertex buffer");
+			TRACE_ZONE("Upload indices");
+			void* ibData;
+			gpu.indexBuffer->Map(0, nullptr, &ibData);
+			if (source)
+			{
+				MeshPacker::writeIndices(*source, mesh, ibData);
+			}
+			else
+			{
+				memcpy(ibData, mesh.buffers ? mesh.buffers->indexData() : mesh.indexData.data(), mesh.indexBytes);
+			}
+			gpu.indexBuffer->Unmap(0, nullptr);
 		}
+	}
+	gpu.vertexBufferView.BufferLocation = gpu.vertexBuffer->GetGPUVirtualAddress();
+	gpu.vertexBufferView.SizeInBytes = static_cast<UINT>(mesh.vertexBytes);
+	gpu.vertexBufferView.StrideInBytes = static_cast<UINT>(mesh.vertexStride);
+	gpu.compactVertices = mesh.compactVertices;
+	gpu.quantization = mesh.quantization;
+	gpu.indexBufferView.BufferLocation = gpu.indexBuffer->GetGPUVirtualAddress();
+	gpu.indexBufferView.SizeInBytes = static_cast<UINT>(mesh.indexBytes);
+	gpu.indexBufferView.Format = mesh.shortIndices ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT;
+
+	gpu.lodLevels = std::move(mesh.lodLevels);
+	gpu.cullChunks = std::move(mesh.cullChunks);
+}
+// Only the records and indices an append changed are written, into the room left in the buffers at upload
+bool D3D12Viewport::appendPackedModel(const Model* model, PackedAppend&& append)
+{
+	TRACE_ZONE("D3D12Viewport::appendPackedModel");
+	const uint32_t meshId = findMesh(model);
+	if (meshId == Scene::none)
+	{
+		return false;
+	}
+	GpuMesh& gpu = gpuMeshes[meshId];
+	if (gpu.indexCount == 0 || gpu.compactVertices || gpu.indexBufferView.Format != DXGI_FORMAT_R32_UINT || gpu.cullChunks.size() != 1
+		|| append.vertexBytes > gpu.vertexCapacity || append.indexBytes > gpu.indexCapacity)
+	{
+		return false;
+	}
+	framePacer.waitIdle(); // Frames in flight still read the bytes overwritten below
+
+	D3D12_RANGE range = { 0, 0 }; // Nothing is read back
+	{
+		TRACE_ZONE("Upload appended vertices");
 		void* vbData;
-		vertexBuffer->Map(0, nullptr, &vbData);
-		memcpy(vbData, vertices.data(), vertices.size() * sizeof(Vertex));
-		vertexBuffer->Unmap(0, nullptr);
-		vertexBufferView.BufferLocation = vertexBuffer->GetGPUVirtualAddress();
-		vertexBufferView.SizeInBytes = static_cast<UINT>(vertices.size() * sizeof(Vertex));
-		vertexBufferView.StrideInBytes = sizeof(Vertex);
-
-		// Create index buffer
-		D3D12_RESOURCE_DESC ibDesc = {};
-		ibDesc.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
-		ibDesc.Alignment = 0;
-		ibDesc.Width = indices.size() * sizeof(unsigned int);
-		ibDesc.Height = 1;
-		ibDesc.DepthOrArraySize = 1;
-		ibDesc.MipLevels = 1;
-		ibDesc.Format = DXGI_FORMAT_UNKNOWN;
-		ibDesc.SampleDesc.Count = 1;
-		ibDesc.SampleDesc.Quality = 0;
-		ibDesc.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
-		ibDesc.Flags = D3D12_RESOURCE_FLAG_NONE;
-
-		if (FAILED(device->CreateCommittedResource(&heapProps, D3D12_HEAP_FLAG_NONE, &ibDesc, D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, IID_PPV_ARGS(&indexBuffer))))
+		gpu.vertexBuffer->Map(0, &range, &vbData);
+		uint8_t* records = static_cast<uint8_t*>(vbData);
+		memcpy(records + append.firstVertex * sizeof(Vertex), append.vertices.data(), append.vertices.size() * sizeof(Vertex));
+		for (size_t i = 0; i < append.patches.size(); ++i)
 		{
-			throw std::runtime_error("Failed to create index buffer");
+			memcpy(records + size_t(append.patchedVertices[i]) * sizeof(Vertex), &append.patches[i], sizeof(Vertex));
 		}
+		gpu.vertexBuffer->Unmap(0, nullptr);
+	}
+	{
+		TRACE_ZONE("Upload appended indices");
 		void* ibData;
-		indexBuffer->Map(0, nullptr, &ibData);
-		memcpy(ibData, indices.data(), indices.size() * sizeof(unsigned int));
-		indexBuffer->Unmap(0, nullptr);
-		indexBufferView.BufferLocation = indexBuffer->GetGPUVirtualAddress();
-		indexBufferView.SizeInBytes = static_cast<UINT>(indices.size() * sizeof(unsigned int));
-		indexBufferView.Format = DXGI_FORMAT_R32_UINT;
+		gpu.indexBuffer->Map(0, &range, &ibData);
+		memcpy(static_cast<uint8_t*>(ibData) + append.firstIndex * sizeof(unsigned int), append.indices.data(), append.indices.size() * sizeof(unsigned int));
+		gpu.indexBuffer->Unmap(0, nullptr);
+	}
+	gpu.vertexBufferView.SizeInBytes = static_cast<UINT>(append.vertexBytes);
+	gpu.indexBufferView.SizeInBytes = static_cast<UINT>(append.indexBytes);
+	gpu.indexCount = static_cast<UINT>(append.indexCount);
+	FrustumCuller::replaceTail(gpu.cullChunks[0], append.tailChunks, append.firstChunkIndex);
+	gpu.pickBvh.clear(); // Rebuilt on the next pick
+	update();
+	return true;
+}
+AppendCapacity D3D12Viewport::getAppendCapacity(const Model* model) const
+{
+	const uint32_t meshId = findMesh(model);
+	if (meshId == Scene::none || gpuMeshes[meshId].compactVertices || gpuMeshes[meshId].indexBufferView.Format != DXGI_FORMAT_R32_UINT)
+	{
+		return AppendCapacity();
+	}
+	return { gpuMeshes[meshId].vertexCapacity, gpuMeshes[meshId].indexCapacity };
+}
+uint32_t D3D12Viewport::findMesh(const Model* model) const
+{
+	for (uint32_t mesh = 0; mesh < gpuMeshes.size(); ++mesh)
+	{
+		if (scene.getMesh(mesh) == model)
+		{
+			return mesh;
+		}
+	}
+	return Scene::none;
+}
+// Chunks are wanted by the radius their bounding sphere covers on screen, the largest first. One not resident yet is
+// paged in and copied to upload heaps, at most one per frame so a frame waits on the reads of one chunk at most, and
+// the next frame is requested for the rest. Chunks no longer wanted are released once no frame in flight draws them.
+void D3D12Viewport::refineChunks(GpuMesh& gpu, const Model& model, const Frustum& frustum, const XMMATRIX& modelMatrix, float scale)
+{
+	TRACE_ZONE("Refine out-of-core chunks");
+	const OutOfCoreMesh& outOfCore = *model.getOutOfCoreMesh();
+	const std::span<const IndexRange> previewRanges = model.getPreviewRanges();
+	const auto& chunks = outOfCore.getChunks();
+	const XMFLOAT3& eye = camera.getPosition();
+	wantedChunks.clear();
+	for (size_t i = 0; i < chunks.size() && i < previewRanges.size(); ++i)
+	{
+		const MeshBounds& bounds = chunks[i].bounds;
+		if (!intersects(frustum, bounds))
+		{
+			continue;
+		}
+		XMFLOAT3 center;
+		XMStoreFloat3(&center, XMVector3TransformCoord(XMVectorSet(bounds.center.x(), bounds.center.y(), bounds.center.z(), 1.0f), modelMatrix));
+		const float distance = std::max(QVector3D(center.x - eye.x, center.y - eye.y, center.z - eye.z).length() - bounds.radius * scale, 0.1f);
+		const float pixels = MeshSimplifier::pixelsPerUnit(distance, static_cast<float>(height()), camera.getVerticalFov()) * scale * bounds.radius;
+		if (pixels >= refineChunkPixels)
+		{
+			wantedChunks.emplace_back(pixels, i);
+		}
+	}
+	std::sort(wantedChunks.begin(), wantedChunks.end(), [](const auto& a, const auto& b) { return a.first > b.first; });
+	wantedChunks.resize(std::min(wantedChunks.size(), maxRefinedChunks));
 
-		update();
+	std::erase_if(gpu.refinedChunks, [this](const RefinedChunk& refined)
+	{
+		const bool wanted = std::any_of(wantedChunks.begin(), wantedChunks.end(), [&refined](const auto& w) { return w.second == refined.chunk; });
+		return !wanted && refined.lastFrame + framesInFlight <= frameNumber;
+	});
+	bool uploaded = false;
+	for (const auto& want : wantedChunks)
+	{
+		const size_t chunk = want.second;
+		auto found = std::find_if(gpu.refinedChunks.begin(), gpu.refinedChunks.end(), [chunk](const RefinedChunk& refined) { return refined.chunk == chunk; });
+		if (found == gpu.refinedChunks.end())
+		{
+			if (uploaded || gpu.refinedChunks.size() >= maxRefinedChunks)
+			{
+				refinementPending = true;
+				continue;
+			}
+			RefinedChunk added;
+			if (!uploadChunk(outOfCore, chunk, added))
+			{
+				continue;
+			}
+			uploaded = true;
+			gpu.refinedChunks.push_back(std::move(added));
+			found = gpu.refinedChunks.end() - 1;
+		}
+		found->lastFrame = frameNumber;
+		refinedDraws.push_back(found - gpu.refinedChunks.begin());
 	}
-	catch (const std::exception& ex)
+	if (refinedDraws.empty())
 	{
-		qCritical() << "Exception in loadModel:" << ex.what();
-		throw;
+		return;
 	}
-	catch (...)
+
+	// Both lists are in index order, each visible range loses the parts the drawn chunks' preview triangles fill
+	previewHoles.clear();
+	for (size_t refined : refinedDraws)
 	{
-		qCritical() << "Unknown exception in loadModel";
-		throw;
+		previewHoles.push_back(previewRanges[gpu.refinedChunks[refined].chunk]);
+	}
+	std::sort(previewHoles.begin(), previewHoles.end(), [](const IndexRange& a, const IndexRange& b) { return a.firstIndex < b.firstIndex; });
+	keptRanges.clear();
+	size_t hole = 0;
+	for (const IndexRange& range : visibleRanges)
+	{
+		uint32_t first = range.firstIndex;
+		const uint32_t end = range.firstIndex + range.indexCount;
+		while (hole < previewHoles.size() && previewHoles[hole].firstIndex + previewHoles[hole].indexCount <= first)
+		{
+			++hole;
+		}
+		for (size_t h = hole; h < previewHoles.size() && previewHoles[h].firstIndex < end; ++h)
+		{
+			if (previewHoles[h].firstIndex > first)
+			{
+				keptRanges.push_back({ first, previewHoles[h].firstIndex - first });
+			}
+			first = std::max(first, previewHoles[h].firstIndex + previewHoles[h].indexCount);
+		}
+		if (first < end)
+		{
+			keptRanges.push_back({ first, end - first });
+		}
 	}
+	visibleRanges.swap(keptRanges);
+}
+// Full Vertex records and 32-bit indices in upload heaps, like every mesh, built from the chunk's mapping
+bool D3D12Viewport::uploadChunk(const OutOfCoreMesh& outOfCore, size_t chunk, RefinedChunk& out)
+{
+	TRACE_ZONE("Upload out-of-core chunk");
+	const std::shared_ptr<const PagedChunk> paged = outOfCore.page(chunk);
+	if (!paged)
+	{
+		return false;
+	}
+	const size_t vertexBytes = paged->vertices.size() * sizeof(Vertex);
+	const size_t indexBytes = paged->indices.size() * sizeof(unsigned int);
+	if (vertexBytes > UINT_MAX || indexBytes > UINT_MAX)
+	{
+		qWarning() << "Out-of-core chunk" << chunk << "is too large for one buffer view, its preview is drawn instead";
+		return false;
+	}
+	if (!createUploadBuffer(device.Get(), vertexBytes, out.vertexBuffer) || !createUploadBuffer(device.Get(), indexBytes, out.indexBuffer))
+	{
+		qCritical() << "Failed to create the buffers of out-of-core chunk" << chunk;
+		return false;
+	}
+	D3D12_RANGE range = { 0, 0 }; // Nothing is read back
+	void* vbData;
+	out.vertexBuffer->Map(0, &range, &vbData);
+	Vertex* records = static_cast<Vertex*>(vbData);
+	for (size_t v = 0; v < paged->vertices.size(); ++v)
+	{
+		records[v] = { paged->vertices[v], paged->normals[v] };
+	}
+	out.vertexBuffer->Unmap(0, nullptr);
+	void* ibData;
+	out.indexBuffer->Map(0, &range, &ibData);
+	memcpy(ibData, paged->indices.data(), indexBytes);
+	out.indexBuffer->Unmap(0, nullptr);
+
+	out.chunk = chunk;
+	out.indexCount = static_cast<UINT>(paged->indices.size());
+	out.vertexBufferView = { out.vertexBuffer->GetGPUVirtualAddress(), static_cast<UINT>(vertexBytes), static_cast<UINT>(sizeof(Vertex)) };
+	out.indexBufferView = { out.indexBuffer->GetGPUVirtualAddress(), static_cast<UINT>(indexBytes), DXGI_FORMAT_R32_UINT };
+	return true;
 }
 // Renders frame to the current back buffer and presents it
 void D3D12Viewport::paintEvent(QPaintEvent*)
 {
+	TRACE_ZONE("D3D12Viewport::paintEvent");
 	try
 	{
-		qDebug() << "Rendering frame, indexCount:" << indexCount;
-
-		// Get matrices separately
-		auto mvpMatrix = camera.getMVPMatrix((float)width() / (float)height());
-		auto modelMatrix = XMMatrixIdentity(); 
-		auto normalMatrix = XMMatrixInverse(nullptr, XMMatrixTranspose(modelMatrix));
-
-		ConstantBufferData cbData;
-
-		XMStoreFloat4x4(&cbData.mvpMatrix, XMLoadFloat4x4(&mvpMatrix));
-		XMStoreFloat4x4(&cbData.modelMatrix, modelMatrix);
-		XMStoreFloat4x4(&cbData.normalMatrix, normalMatrix);
+		// The camera part is shared, every node adds its own world matrix in front of it
+		const XMMATRIX viewProjection = camera.getViewMatrix() * camera.getProjectionMatrix((float)width() / (float)height());
 
 		// Calculate light direction from yaw and pitch
 		float lightYawRad = XMConvertToRadians(lightYaw);
@@ -540,18 +860,13 @@ void D3D12Viewport::paintEvent(QPaintEvent*)
 		lightDirVec = XMVector3Normalize(lightDirVec);
 		XMStoreFloat3(&lightDirection, lightDirVec);
 
-		cbData.lightDirection = lightDirection;
-
+		scene.updateWorldTransforms();
 
-		void* mappedData;
-		D3D12_RANGE range = { 0, 0 };
-		constantBuffer->Map(0, &range, &mappedData);
-		// FIX: Copy cbData instead of mvpMatrix
-		memcpy(mappedData, &cbData, sizeof(ConstantBufferData));
-		constantBuffer->Unmap(0, nullptr);
-
-		commandAllocator->Reset();
-		commandList->Reset(commandAllocator.Get(), isWireframe ? pipelineState.Get() : pipelineStateSolid.Get());
+		// Waits only while the GPU is framesInFlight frames behind, older constants stay intact until their frame completed
+		const unsigned int slot = framePacer.beginFrame();
+		++frameNumber;
+		commandAllocators[slot]->Reset();
+		commandList->Reset(commandAllocators[slot].Get(), isWireframe ? pipelineState.Get() : pipelineStateSolid.Get());
 
 		D3D12_RESOURCE_BARRIER barrier = {};
 		barrier.Type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
@@ -585,14 +900,118 @@ void D3D12Viewport::paintEvent(QPaintEvent*)
 		D3D12_RECT scissorRect = { 0, 0, width(), height() };
 		commandList->RSSetScissorRects(1, &scissorRect);
 
-		if (indexCount > 0)
+		if (!gpuMeshes.empty())
 		{
+			TRACE_ZONE("Cull and record draws");
 			commandList->SetGraphicsRootSignature(rootSignature.Get());
 			commandList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-			commandList->IASetVertexBuffers(0, 1, &vertexBufferView);
-			commandList->IASetIndexBuffer(&indexBufferView);
-			commandList->SetGraphicsRootConstantBufferView(0, constantBuffer->GetGPUVirtualAddress());
-			commandList->DrawIndexedInstanced(indexCount, 1, 0, 0, 0);
+
+			// Per node: its world matrix in front of the camera's, culling in the space of its mesh and a LOD from the
+			// nearest point of the mesh's bounding sphere and the pixels a mesh unit covers there. Buffers and pipeline
+			// are only rebound when a node draws another mesh, or mirrors where the one before it did not.
+			const XMFLOAT3& eye = camera.getPosition();
+			uint32_t boundMesh = Scene::none;
+			bool boundMirrored = false;
+			size_t finestLod = SIZE_MAX;
+			for (uint32_t node = 0; node < scene.getNodeCount(); ++node)
+			{
+				const uint32_t meshId = scene.getNodeMesh(node);
+				if (meshId >= gpuMeshes.size() || gpuMeshes[meshId].indexCount == 0 || gpuMeshes[meshId].cullChunks.empty())
+				{
+					continue;
+				}
+				GpuMesh& mesh = gpuMeshes[meshId];
+				const Model& model = *scene.getMesh(meshId);
+				const MeshBounds& bounds = model.getBounds();
+
+				// Column-major with column vectors is the same memory as DirectXMath's row-major with row vectors
+				XMFLOAT4X4 world;
+				scene.getWorldTransform(node, &world.m[0][0]);
+				const XMMATRIX modelMatrix = XMLoadFloat4x4(&world);
+				XMFLOAT4X4 nodeMvp;
+				XMStoreFloat4x4(&nodeMvp, modelMatrix * viewProjection);
+
+				XMFLOAT3 center;
+				XMStoreFloat3(&center, XMVector3TransformCoord(XMVectorSet(bounds.center.x(), bounds.center.y(), bounds.center.z(), 1.0f), modelMatrix));
+				const float scale = std::sqrt(std::max({ XMVectorGetX(XMVector3LengthSq(modelMatrix.r[0])), XMVectorGetX(XMVector3LengthSq(modelMatrix.r[1])), XMVectorGetX(XMVector3LengthSq(modelMatrix.r[2])) }));
+				const QVector3D toNode = QVector3D(center.x - eye.x, center.y - eye.y, center.z - eye.z);
+				const float distance = std::max(toNode.length() - bounds.radius * scale, 0.1f);
+				// Pixels per world unit times world units per mesh unit, the error is measured in mesh units
+				const LodChainView lodChain{ {}, mesh.lodLevels };
+				const size_t lod = lodChain.selectLevel(MeshSimplifier::pixelsPerUnit(distance, static_cast<float>(height()), camera.getVerticalFov()) * scale, maxLodPixelError);
+
+				visibleRanges.clear();
+				const Frustum frustum = Frustum::fromMatrix(&nodeMvp.m[0][0]);
+				FrustumCuller::cull(frustum, mesh.cullChunks[lod], visibleRanges);
+				if (visibleRanges.empty())
+				{
+					continue;
+				}
+				refinedDraws.clear();
+				if (lod == 0 && model.getOutOfCoreMesh())
+				{
+					refineChunks(mesh, model, frustum, modelMatrix, scale);
+				}
+				UploadRing::Allocation constants;
+				if (!uploadRing.allocate(sizeof(ConstantBufferData), D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT, constants))
+				{
+					static bool reported = false;
+					if (!reported)
+					{
+						qWarning() << "Upload ring full, nodes from" << node << "on are skipped in frames with this many visible nodes";
+						reported = true;
+					}
+					break;
+				}
+				const bool mirrored = XMVectorGetX(XMMatrixDeterminant(modelMatrix)) < 0.0f;
+				if (meshId != boundMesh || mirrored != boundMirrored)
+				{
+					ID3D12PipelineState* solid = mesh.compactVertices
+						? (mirrored ? pipelineStateSolidCompactMirrored.Get() : pipelineStateSolidCompact.Get())
+						: (mirrored ? pipelineStateSolidMirrored.Get() : pipelineStateSolid.Get());
+					commandList->SetPipelineState(isWireframe ? (mesh.compactVertices ? pipelineStateCompact.Get() : pipelineState.Get()) : solid);
+				}
+				if (meshId != boundMesh)
+				{
+					commandList->IASetVertexBuffers(0, 1, &mesh.vertexBufferView);
+					commandList->IASetIndexBuffer(&mesh.indexBufferView);
+				}
+				boundMesh = meshId;
+				boundMirrored = mirrored;
+				ConstantBufferData cbData;
+				cbData.mvpMatrix = nodeMvp;
+				XMStoreFloat4x4(&cbData.modelMatrix, modelMatrix);
+				XMStoreFloat4x4(&cbData.normalMatrix, XMMatrixInverse(nullptr, XMMatrixTranspose(modelMatrix)));
+				cbData.lightDirection = lightDirection;
+				cbData.positionOffset = XMFLOAT4(mesh.quantization.offset[0], mesh.quantization.offset[1], mesh.quantization.offset[2], 0.0f);
+				cbData.positionScale = XMFLOAT4(mesh.quantization.scale[0], mesh.quantization.scale[1], mesh.quantization.scale[2], 0.0f);
+				memcpy(uploadData + constants.offset, &cbData, sizeof(ConstantBufferData));
+
+				commandList->SetGraphicsRootConstantBufferView(0, uploadBuffer->GetGPUVirtualAddress() + constants.offset);
+				for (const IndexRange& range : visibleRanges)
+				{
+					commandList->DrawIndexedInstanced(range.indexCount, 1, range.firstIndex, 0, 0);
+				}
+				if (!refinedDraws.empty())
+				{
+					// Full records and 32-bit indices in any vertex format, the constants above apply as they are
+					commandList->SetPipelineState(isWireframe ? pipelineState.Get() : (mirrored ? pipelineStateSolidMirrored.Get() : pipelineStateSolid.Get()));
+					for (size_t refined : refinedDraws)
+					{
+						const RefinedChunk& chunk = mesh.refinedChunks[refined];
+						commandList->IASetVertexBuffers(0, 1, &chunk.vertexBufferView);
+						commandList->IASetIndexBuffer(&chunk.indexBufferView);
+						commandList->DrawIndexedInstanced(chunk.indexCount, 1, 0, 0, 0);
+					}
+					boundMesh = Scene::none; // The next node binds its mesh and pipeline again
+				}
+				finestLod = std::min(finestLod, lod);
+			}
+			if (finestLod != SIZE_MAX && finestLod != currentLod)
+			{
+				currentLod = finestLod;
+				qInfo() << "Finest LOD drawn:" << finestLod;
+			}
 		}
 
 		barrier.Transition.StateBefore = D3D12_RESOURCE_STATE_RENDER_TARGET;
@@ -603,14 +1022,21 @@ void D3D12Viewport::paintEvent(QPaintEvent*)
 		ID3D12CommandList* cmdLists[] = { commandList.Get() };
 		commandQueue->ExecuteCommandLists(1, cmdLists);
 
-		swapChain->Present(1, 0);
+		{
+			TRACE_ZONE("Present");
+			swapChain->Present(1, 0);
+		}
 		frameIndex = swapChain->GetCurrentBackBufferIndex();
 
-		commandQueue->Signal(fence.Get(), ++fenceValue);
-		fence->SetEventOnCompletion(fenceValue, fenceEvent);
-		WaitForSingleObject(fenceEvent, INFINITE);
-
-		qDebug() << "Frame rendered successfully.";
+		// No wait here, the next beginFrame blocks only if this slot is still busy by then
+		const uint64_t fenceValue = frameFence.signal(commandQueue.Get());
+		uploadRing.endFrame(fenceValue);
+		framePacer.endFrame(fenceValue);
+		if (refinementPending)
+		{
+			refinementPending = false;
+			QTimer::singleShot(0, this, [this]() { update(); });
+		}
 	}
 	catch (const std::exception& ex)
 	{
@@ -624,12 +1050,11 @@ void D3D12Viewport::paintEvent(QPaintEvent*)
 // Rebuild rendering pipeline when window changes size, since buffers depend on the window size
 void D3D12Viewport::resizeEvent(QResizeEvent *event)
 {
+	TRACE_ZONE("D3D12Viewport::resizeEvent");
 	if (swapChain)
 	{
-		// Wait for GPU to finish
-		commandQueue->Signal(fence.Get(), ++fenceValue);
-		fence->SetEventOnCompletion(fenceValue, fenceEvent);
-		WaitForSingleObject(fenceEvent, INFINITE);
+		// Wait for GPU to finish, every frame in flight may reference the back buffers
+		framePacer.waitIdle();
 
 		// Release old resources before resizing
 		for (UINT i = 0; i < 2; ++i)
@@ -710,14 +1135,122 @@ void D3D12Viewport::resizeEvent(QResizeEvent *event)
 // Mouse event handlers
 void D3D12Viewport::mousePressEvent(QMouseEvent *event)
 {
+	TRACE_ZONE("D3D12Viewport::mousePressEvent");
 	if (event->button() == Qt::LeftButton)
 	{
 		leftButtonPressed = true;
 		lastMousePos = event->pos();
+		pressMousePos = event->pos();
+	}
+}
+void D3D12Viewport::mouseReleaseEvent(QMouseEvent* event)
+{
+	TRACE_ZONE("D3D12Viewport::mouseReleaseEvent");
+	if (event->button() != Qt::LeftButton)
+	{
+		return;
+	}
+	leftButtonPressed = false;
+
+	// Only a click picks, a drag was an orbit
+	if ((event->pos() - pressMousePos).manhattanLength() > 3)
+	{
+		return;
+	}
+	uint32_t node = Scene::none;
+	PickHit hit;
+	QVector3D point;
+	if (pick(event->pos(), node, hit, point))
+	{
+		// Report the corner nearest to the hit as the picked vertex
+		const auto indices = scene.getMesh(scene.getNodeMesh(node))->getIndices();
+		const float w = 1.0f - hit.u - hit.v;
+		const int corner = (w >= hit.u && w >= hit.v) ? 0 : (hit.u >= hit.v ? 1 : 2);
+		emit trianglePicked(node, hit.triangle, indices[size_t(hit.triangle) * 3 + corner], point);
+	}
+}
+void D3D12Viewport::mouseDoubleClickEvent(QMouseEvent* event)
+{
+	TRACE_ZONE("D3D12Viewport::mouseDoubleClickEvent");
+	uint32_t node = Scene::none;
+	PickHit hit;
+	QVector3D point;
+	if (event->button() == Qt::LeftButton && pick(event->pos(), node, hit, point))
+	{
+		camera.setTarget(XMFLOAT3(point.x(), point.y(), point.z()));
+		update();
 	}
 }
+
+bool D3D12Viewport::pick(const QPoint& pos, uint32_t& node, PickHit& hit, QVector3D& point)
+{
+	TRACE_ZONE("D3D12Viewport::pick");
+	if (width() == 0 || height() == 0)
+	{
+		return false;
+	}
+	const XMMATRIX view = camera.getViewMatrix();
+	const XMMATRIX projection = camera.getProjectionMatrix((float)width() / (float)height());
+
+	// The cursor is unprojected onto the near and far planes in the space of each node's mesh. The ray runs from
+	// the near to the far point in every space, so hit distances of different nodes compare directly.
+	QElapsedTimer queryTimer;
+	queryTimer.start();
+	hit = PickHit();
+	XMFLOAT3 hitPoint = {};
+	for (uint32_t candidate = 0; candidate < scene.getNodeCount(); ++candidate)
+	{
+		const uint32_t meshId = scene.getNodeMesh(candidate);
+		if (meshId >= gpuMeshes.size() || gpuMeshes[meshId].indexCount == 0)
+		{
+			continue;
+		}
+		const Model* model = scene.getMesh(meshId);
+		const Vec3Streams positions = model->getVertices();
+		TriangleBvh& bvh = gpuMeshes[meshId].pickBvh;
+		if (bvh.empty())
+		{
+			TRACE_ZONE("Build picking BVH");
+			QElapsedTimer buildTimer;
+			buildTimer.start();
+			bvh.build(positions, model->getIndices());
+			qInfo() << "Built picking BVH of mesh" << meshId << ":" << bvh.getNodes().size() << "nodes," << bvh.memoryBytes() / (1024.0 * 1024.0) << "MB in" << buildTimer.elapsed() << "ms";
+		}
+
+		XMFLOAT4X4 world;
+		scene.getWorldTransform(candidate, &world.m[0][0]);
+		const XMMATRIX modelMatrix = XMLoadFloat4x4(&world);
+		const XMVECTOR nearPoint = XMVector3Unproject(XMVectorSet((float)pos.x(), (float)pos.y(), 0.0f, 0.0f),
+			0.0f, 0.0f, (float)width(), (float)height(), 0.0f, 1.0f, projection, view, modelMatrix);
+		const XMVECTOR farPoint = XMVector3Unproject(XMVectorSet((float)pos.x(), (float)pos.y(), 1.0f, 0.0f),
+			0.0f, 0.0f, (float)width(), (float)height(), 0.0f, 1.0f, projection, view, modelMatrix);
+		PickRay ray;
+		XMFLOAT3 origin, direction;
+		XMStoreFloat3(&origin, nearPoint);
+		XMStoreFloat3(&direction, XMVectorSubtract(farPoint, nearPoint));
+		ray.origin[0] = origin.x; ray.origin[1] = origin.y; ray.origin[2] = origin.z;
+		ray.direction[0] = direction.x; ray.direction[1] = direction.y; ray.direction[2] = direction.z;
+
+		const PickHit candidateHit = bvh.intersect(ray, positions);
+		if (candidateHit.hit && (!hit.hit || candidateHit.distance < hit.distance))
+		{
+			hit = candidateHit;
+			node = candidate;
+			XMStoreFloat3(&hitPoint, XMVector3TransformCoord(XMVectorSet(origin.x + direction.x * hit.distance, origin.y + direction.y * hit.distance, origin.z + direction.z * hit.distance, 1.0f), modelMatrix));
+		}
+	}
+	const qint64 queryNs = queryTimer.nsecsElapsed();
+	if (!hit.hit)
+	{
+		return false;
+	}
+	point = QVector3D(hitPoint.x, hitPoint.y, hitPoint.z);
+	qDebug() << "Picked triangle" << hit.triangle << "of node" << node << "at" << point << "in" << queryNs / 1000.0 << "us";
+	return true;
+}
 void D3D12Viewport::mouseMoveEvent(QMouseEvent* event)
 {
+	TRACE_ZONE("D3D12Viewport::mouseMoveEvent");
 	if (leftButtonPressed)
 	{
 		float dx = event->pos().x() - lastMousePos.x();
@@ -729,11 +1262,13 @@ void D3D12Viewport::mouseMoveEvent(QMouseEvent* event)
 }
 void D3D12Viewport::wheelEvent(QWheelEvent* event)
 {
+	TRACE_ZONE("D3D12Viewport::wheelEvent");
 	camera.zoom(event->angleDelta().y() / 120.0f); // Scroll sensitivity
 	update();
 }
 void D3D12Viewport::keyPressEvent(QKeyEvent* event)
 {
+	TRACE_ZONE("D3D12Viewport::keyPressEvent");
 	switch (event->key())
 	{
 	case Qt::Key_Q:
@@ -761,3 +1296,48 @@ void D3D12Viewport::toggleWireframe()
 	isWireframe = !isWireframe;
 	update();
 }
+
+void D3D12Viewport::setCompactVertices(bool enabled)
+{
+	TRACE_ZONE("D3D12Viewport::setCompactVertices");
+	if (enabled == useCompactVertices)
+	{
+		return;
+	}
+	useCompactVertices = enabled;
+	// The nodes stay, every mesh is packed again in the new format straight from its model
+	framePacer.waitIdle();
+	for (uint32_t mesh = 0; mesh < gpuMeshes.size(); ++mesh)
+	{
+		const Model* model = scene.getMesh(mesh);
+		PackedMesh packed;
+		MeshPacker::layout(*model, useCompactVertices, packed);
+		uploadMesh(gpuMeshes[mesh], std::move(packed), model);
+	}
+	update();
+}
+bool D3D12Viewport::getCompactVertices() const
+{
+	return useCompactVertices;
+}
+MeshBufferAllocator D3D12Viewport::getMeshBufferAllocator() const
+{
+	ComPtr<ID3D12Device> owner = device; // Jobs may still pack after the viewport is gone
+	return [owner](size_t vertexBytes, size_t indexBytes) -> std::unique_ptr<MeshBuffers>
+	{
+		TRACE_ZONE("Create upload heaps");
+		auto buffers = std::make_unique<UploadHeapMeshBuffers>();
+		D3D12_RANGE range = { 0, 0 }; // The CPU never reads them back
+		if (!createUploadBuffer(owner.Get(), vertexBytes, buffers->vertexBuffer) || !createUploadBuffer(owner.Get(), indexBytes, buffers->indexBuffer)
+			|| FAILED(buffers->vertexBuffer->Map(0, &range, &buffers->vertices)) || FAILED(buffers->indexBuffer->Map(0, &range, &buffers->indices)))
+		{
+			qWarning() << "Cannot create upload heaps of" << vertexBytes << "and" << indexBytes << "bytes, packing into memory instead";
+			return nullptr;
+		}
+		return buffers;
+	};
+}
+Scene& D3D12Viewport::getScene()
+{
+	return scene;
+}
\ No newline at end of file
@@ -0,0 +1,134 @@
+// Bounded producer/consumer queue between a thread faulting in pages of a QFile mapping and the block consumer
+
+#include "FileBlockReader.h"
+#include <algorithm>
+#include <cstring>
+#include "Trace.h"
+
+namespace
+{
+	constexpr size_t pageBytes = 4096; // Smallest page size of the platforms, touching more often costs nothing
+}
+
+FileBlockReader::FileBlockReader(const QString& filePath, size_t blockBytes, bool lineAligned, size_t queueDepth)
+	: blockBytes(std::max<size_t>(blockBytes, 1)), queueDepth(std::max<size_t>(queueDepth, 1)), lineAligned(lineAligned), file(filePath)
+{
+	thread = std::thread([this]() { run(); });
+}
+
+FileBlockReader::~FileBlockReader()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	changed.notify_all();
+	thread.join();
+	if (mapped)
+	{
+		file.unmap(reinterpret_cast<uchar*>(const_cast<char*>(mapped)));
+	}
+}
+
+bool FileBlockReader::next(std::span<const char>& block)
+{
+	TRACE_ZONE("Wait for block");
+	std::unique_lock<std::mutex> lock(mutex);
+	changed.wait(lock, [this]() { return !queue.empty() || finished; });
+	if (queue.empty())
+	{
+		return false;
+	}
+	block = queue.front();
+	queue.pop_front();
+	lock.unlock();
+	changed.notify_all();
+	return true;
+}
+
+bool FileBlockReader::failed() const
+{
+	return error;
+}
+qint64 FileBlockReader::fileSize() const
+{
+	return size;
+}
+qint64 FileBlockReader::bytesRead() const
+{
+	return readBytes;
+}
+
+void FileBlockReader::run()
+{
+	TRACE_THREAD_NAME("File reader");
+	if (!file.open(QIODevice::ReadOnly))
+	{
+		error = true;
+	}
+	else
+	{
+		size = file.size();
+		// An empty file has nothing to map and no blocks
+		if (size > 0)
+		{
+			mapped = reinterpret_cast<const char*>(file.map(0, size));
+			error = mapped == nullptr;
+		}
+	}
+
+	const char* const fileEnd = mapped ? mapped + size : nullptr;
+	const char* begin = mapped;
+	while (!error && begin < fileEnd)
+	{
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			changed.wait(lock, [this]() { return queue.size() < queueDepth || stopping; });
+			if (stopping)
+			{
+				break;
+			}
+		}
+
+		TRACE_ZONE("Page in block");
+		const char* end = begin + std::min<size_t>(blockBytes, fileEnd - begin);
+		if (lineAligned && end < fileEnd)
+		{
+			// Back to the last line end in the block, or on to the first one after it when the block has none
+			const char* lineEnd = end;
+			while (lineEnd > begin && lineEnd[-1] != '\n')
+			{
+				--lineEnd;
+			}
+			if (lineEnd == begin)
+			{
+				const void* next = memchr(end, '\n', fileEnd - end);
+				lineEnd = next ? static_cast<const char*>(next) + 1 : fileEnd;
+			}
+			end = lineEnd;
+		}
+
+		// Reading one byte per page makes the OS fetch the block now, on this thread, instead of in page faults of the
+		// parser. The bytes stay in the mapping's page cache, nothing is copied.
+		char touched = 0;
+		for (const char* page = begin; page < end; page += pageBytes)
+		{
+			touched ^= *reinterpret_cast<const volatile char*>(page);
+		}
+		(void)touched;
+		readBytes += end - begin;
+
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			queue.emplace_back(begin, end);
+		}
+		changed.notify_all();
+		begin = end;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		finished = true;
+	}
+	changed.notify_all();
+}
\ No newline at end of file
@@ -0,0 +1,131 @@
+// Slot pacing and ring sub-allocation, all GPU progress comes in through FrameFence
+
+#include "FrameRing.h"
+#include <algorithm>
+
+namespace
+{
+	size_t alignUp(size_t value, size_t alignment)
+	{
+		return (value + alignment - 1) & ~(alignment - 1);
+	}
+
+	void waitFor(FrameFence& fence, uint64_t value)
+	{
+		if (fence.completedValue() < value)
+		{
+			fence.wait(value);
+		}
+	}
+}
+
+FramePacer::FramePacer(FrameFence& fence, unsigned int framesInFlight) : fence(fence), slotFences(std::max(framesInFlight, 1u), 0) {}
+
+unsigned int FramePacer::beginFrame()
+{
+	const unsigned int slot = static_cast<unsigned int>(frameNumber % slotFences.size());
+	waitFor(fence, slotFences[slot]);
+	return slot;
+}
+
+void FramePacer::endFrame(uint64_t fenceValue)
+{
+	slotFences[frameNumber % slotFences.size()] = fenceValue;
+	lastFenceValue = fenceValue;
+	++frameNumber;
+}
+
+void FramePacer::waitIdle()
+{
+	waitFor(fence, lastFenceValue);
+}
+
+unsigned int FramePacer::getFramesInFlight() const
+{
+	return static_cast<unsigned int>(slotFences.size());
+}
+
+UploadRing::UploadRing(FrameFence& fence, size_t capacity) : fence(fence), capacity(capacity) {}
+
+bool UploadRing::allocate(size_t size, size_t alignment, Allocation& out)
+{
+	alignment = std::max<size_t>(alignment, 1);
+	if (size > capacity || (alignment & (alignment - 1)) != 0)
+	{
+		return false;
+	}
+	retire();
+	while (!tryAllocate(size, alignment, out))
+	{
+		if (frames.empty())
+		{
+			return false; // Only the current frame's own allocations are in the way
+		}
+		waitFor(fence, frames.front().fenceValue);
+		retire();
+	}
+	return true;
+}
+
+// In use is [tail, head), wrapping around the end of the ring. A request that does not fit before the end skips
+// the rest of the ring and starts at 0, the skipped bytes count as used by the current frame.
+bool UploadRing::tryAllocate(size_t size, size_t alignment, Allocation& out)
+{
+	const uint64_t used = allocatedBytes - releasedBytes;
+	if (used == 0 && frames.empty())
+	{
+		head = 0;
+		tail = 0;
+	}
+	if (used == capacity)
+	{
+		return false;
+	}
+
+	const size_t aligned = alignUp(head, alignment);
+	const size_t end = head < tail ? tail : capacity; // Free space up to there without wrapping
+	if (aligned <= end && size <= end - aligned)
+	{
+		out = { aligned, size };
+		allocatedBytes += aligned + size - head;
+		head = aligned + size;
+		return true;
+	}
+	if (head >= tail && size <= tail)
+	{
+		out = { 0, size };
+		allocatedBytes += capacity - head + size;
+		head = size;
+		return true;
+	}
+	return false;
+}
+
+void UploadRing::endFrame(uint64_t fenceValue)
+{
+	frames.push_back({ fenceValue, head, allocatedBytes });
+}
+
+void UploadRing::retire()
+{
+	const uint64_t completed = fence.completedValue();
+	while (!frames.empty() && frames.front().fenceValue <= completed)
+	{
+		tail = frames.front().end;
+		releasedBytes = frames.front().allocatedTotal;
+		frames.pop_front();
+	}
+}
+
+size_t UploadRing::getCapacity() const
+{
+	return capacity;
+}
+size_t UploadRing::usedBytes() const
+{
+	return static_cast<size_t>(allocatedBytes - releasedBytes);
+}
+size_t UploadRing::framesPending() const
+{
+	return frames.size();
+}
\ No newline at end of file
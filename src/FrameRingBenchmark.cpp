@@ -0,0 +1,183 @@
+// Drives FramePacer and UploadRing with random per-frame allocations while a thread plays the GPU
+
+#include "FrameRingBenchmark.h"
+#include "FrameRing.h"
+#include <QDebug>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+
+namespace
+{
+	constexpr size_t ringBytes = 64 * 1024;
+	constexpr size_t granule = 16; // Smallest alignment handed to the ring, ownership is tracked per granule
+	constexpr unsigned int framesInFlight = 3;
+
+	struct SubmittedFrame
+	{
+		uint64_t fenceValue = 0;
+		std::vector<UploadRing::Allocation> allocations;
+	};
+
+	// Executes submitted frames in order after a random delay. Before completing a frame's fence it checks that every
+	// granule of the frame's allocations still belongs to that frame, i.e. the ring did not reuse it early.
+	class FakeGpu : public FrameFence
+	{
+	public:
+		explicit FakeGpu(const std::vector<std::atomic<uint64_t>>& owners) : owners(owners)
+		{
+			thread = std::thread([this]() { run(); });
+		}
+		~FakeGpu() override
+		{
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				stopping = true;
+			}
+			changed.notify_all();
+			thread.join();
+		}
+
+		uint64_t completedValue() const override
+		{
+			return completed.load(std::memory_order_acquire);
+		}
+		void wait(uint64_t value) override
+		{
+			++waits;
+			std::unique_lock<std::mutex> lock(mutex);
+			changed.wait(lock, [this, value]() { return completed.load(std::memory_order_relaxed) >= value; });
+		}
+
+		void submit(SubmittedFrame&& frame)
+		{
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				queue.push_back(std::move(frame));
+			}
+			changed.notify_all();
+		}
+		size_t getWaits() const { return waits; }
+		size_t getErrors() const { return errors; }
+
+	private:
+		void run()
+		{
+			std::mt19937 random(7);
+			while (true)
+			{
+				SubmittedFrame frame;
+				{
+					std::unique_lock<std::mutex> lock(mutex);
+					changed.wait(lock, [this]() { return !queue.empty() || stopping; });
+					if (queue.empty())
+					{
+						return;
+					}
+					frame = std::move(queue.front());
+					queue.pop_front();
+				}
+
+				std::this_thread::sleep_for(std::chrono::microseconds(random() % 100));
+				for (const UploadRing::Allocation& allocation : frame.allocations)
+				{
+					for (size_t g = allocation.offset / granule; g < (allocation.offset + allocation.size + granule - 1) / granule; ++g)
+					{
+						errors += owners[g].load(std::memory_order_relaxed) != frame.fenceValue ? 1 : 0;
+					}
+				}
+				{
+					std::lock_guard<std::mutex> lock(mutex);
+					completed.store(frame.fenceValue, std::memory_order_release);
+				}
+				changed.notify_all();
+			}
+		}
+
+		const std::vector<std::atomic<uint64_t>>& owners;
+		std::mutex mutex;
+		std::condition_variable changed;
+		std::deque<SubmittedFrame> queue;
+		std::atomic<uint64_t> completed{ 0 };
+		std::atomic<size_t> waits{ 0 };
+		std::atomic<size_t> errors{ 0 };
+		bool stopping = false;
+		std::thread thread;
+	};
+}
+
+bool runFrameRingStress(size_t frameCount)
+{
+	std::vector<std::atomic<uint64_t>> owners(ringBytes / granule);
+	size_t pacingErrors = 0;
+	size_t allocationCount = 0;
+	size_t allocatedBytes = 0;
+	size_t maxUsed = 0;
+	bool rejectsOversized = false;
+	size_t gpuErrors = 0;
+	size_t waits = 0;
+
+	std::mt19937 random(12345);
+	const auto start = std::chrono::steady_clock::now();
+	{
+		FakeGpu gpu(owners);
+		FramePacer pacer(gpu, framesInFlight);
+		UploadRing ring(gpu, ringBytes);
+		UploadRing::Allocation allocation;
+		rejectsOversized = !ring.allocate(ringBytes + 1, granule, allocation);
+
+		for (uint64_t fenceValue = 1; fenceValue <= frameCount; ++fenceValue)
+		{
+			pacer.beginFrame();
+			pacingErrors += fenceValue - 1 - gpu.completedValue() >= framesInFlight ? 1 : 0;
+
+			// Mostly small constant blocks, now and then one big enough to force a wrap or a wait. A frame needs at most
+			// about 55 KB with padding and a skipped ring end, so it always fits once the older frames retired.
+			SubmittedFrame frame;
+			frame.fenceValue = fenceValue;
+			const unsigned int count = 1 + random() % 8;
+			for (unsigned int i = 0; i < count; ++i)
+			{
+				const size_t size = i == 0 && random() % 16 == 0 ? ringBytes / 4 + random() % (ringBytes / 12) : 1 + random() % 4096;
+				const size_t alignment = granule << (random() % 5);
+				if (!ring.allocate(size, alignment, allocation))
+				{
+					qCritical() << "Upload ring refused" << size << "bytes with" << ring.usedBytes() << "in use";
+					return false;
+				}
+				pacingErrors += allocation.offset % alignment != 0 || allocation.offset + allocation.size > ringBytes ? 1 : 0;
+				for (size_t g = allocation.offset / granule; g < (allocation.offset + allocation.size + granule - 1) / granule; ++g)
+				{
+					owners[g].store(fenceValue, std::memory_order_relaxed);
+				}
+				frame.allocations.push_back(allocation);
+				++allocationCount;
+				allocatedBytes += size;
+				maxUsed = std::max(maxUsed, ring.usedBytes());
+			}
+
+			ring.endFrame(fenceValue);
+			pacer.endFrame(fenceValue);
+			gpu.submit(std::move(frame));
+		}
+		pacer.waitIdle();
+		ring.retire();
+		pacingErrors += ring.usedBytes() != 0 || ring.framesPending() != 0 ? 1 : 0;
+		waits = gpu.getWaits();
+		gpuErrors = gpu.getErrors(); // Every frame was checked before its fence completed
+	}
+	const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	qInfo().nospace() << "Frame ring stress: " << frameCount << " frames, " << allocationCount << " allocations, "
+		<< allocatedBytes / (1024.0 * 1024.0) << " MB through a " << ringBytes / 1024 << " KB ring in " << seconds << " s";
+	qInfo().nospace() << framesInFlight << " frames in flight, " << waits << " CPU waits, peak " << maxUsed / 1024.0 << " KB in use, "
+		<< gpuErrors << " allocations reused early, " << pacingErrors << " pacing or alignment errors, oversized request "
+		<< (rejectsOversized ? "rejected" : "accepted");
+	return gpuErrors == 0 && pacingErrors == 0 && rejectsOversized;
+}
\ No newline at end of file
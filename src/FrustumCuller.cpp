@@ -0,0 +1,262 @@
+// Plane extraction, chunk bounds and the scalar/SSE2/AVX2 box-versus-frustum tests
+
+#include "FrustumCuller.h"
+#include <algorithm>
+#include <utility>
+#include <cmath>
+#include "MeshKernels.h"
+#include "SimdSupport.h"
+
+namespace
+{
+	// A box is outside when even its corner furthest along the plane normal is behind the plane.
+	// That corner takes max or min per axis by the sign of the normal, which is the same for every box.
+	struct PlaneStreams
+	{
+		const float* x;
+		const float* y;
+		const float* z;
+	};
+
+	PlaneStreams furthestCorner(const float* plane, const ChunkBounds& chunks)
+	{
+		return {
+			plane[0] >= 0.0f ? chunks.maxX.data() : chunks.minX.data(),
+			plane[1] >= 0.0f ? chunks.maxY.data() : chunks.minY.data(),
+			plane[2] >= 0.0f ? chunks.maxZ.data() : chunks.minZ.data() };
+	}
+
+	void testScalar(const Frustum& frustum, const PlaneStreams* corners, uint8_t* visible, size_t begin, size_t end)
+	{
+		for (size_t i = begin; i < end; ++i)
+		{
+			bool inside = true;
+			for (int p = 0; p < 6; ++p)
+			{
+				const float* plane = frustum.planes[p];
+				const float distance = plane[0] * corners[p].x[i] + plane[1] * corners[p].y[i] + plane[2] * corners[p].z[i] + plane[3];
+				inside = inside && !(distance < 0.0f);
+			}
+			visible[i] = inside ? 1 : 0;
+		}
+	}
+
+#if MESH_KERNELS_X86
+	void testSSE2(const Frustum& frustum, const PlaneStreams* corners, uint8_t* visible, size_t count)
+	{
+		const size_t blockEnd = count & ~size_t(3);
+		for (size_t i = 0; i < blockEnd; i += 4)
+		{
+			__m128 outside = _mm_setzero_ps();
+			for (int p = 0; p < 6; ++p)
+			{
+				const float* plane = frustum.planes[p];
+				const __m128 distance = _mm_add_ps(_mm_add_ps(_mm_add_ps(
+					_mm_mul_ps(_mm_set1_ps(plane[0]), _mm_loadu_ps(corners[p].x + i)),
+					_mm_mul_ps(_mm_set1_ps(plane[1]), _mm_loadu_ps(corners[p].y + i))),
+					_mm_mul_ps(_mm_set1_ps(plane[2]), _mm_loadu_ps(corners[p].z + i))),
+					_mm_set1_ps(plane[3]));
+				outside = _mm_or_ps(outside, _mm_cmplt_ps(distance, _mm_setzero_ps()));
+			}
+			const int mask = _mm_movemask_ps(outside);
+			for (int lane = 0; lane < 4; ++lane)
+			{
+				visible[i + lane] = (mask >> lane) & 1 ? 0 : 1;
+			}
+		}
+		testScalar(frustum, corners, visible, blockEnd, count);
+	}
+
+	MESH_KERNELS_AVX2_TARGET
+	void testAVX2(const Frustum& frustum, const PlaneStreams* corners, uint8_t* visible, size_t count)
+	{
+		const size_t blockEnd = count & ~size_t(7);
+		for (size_t i = 0; i < blockEnd; i += 8)
+		{
+			__m256 outside = _mm256_setzero_ps();
+			for (int p = 0; p < 6; ++p)
+			{
+				const float* plane = frustum.planes[p];
+				const __m256 distance = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(
+					_mm256_mul_ps(_mm256_set1_ps(plane[0]), _mm256_loadu_ps(corners[p].x + i)),
+					_mm256_mul_ps(_mm256_set1_ps(plane[1]), _mm256_loadu_ps(corners[p].y + i))),
+					_mm256_mul_ps(_mm256_set1_ps(plane[2]), _mm256_loadu_ps(corners[p].z + i))),
+					_mm256_set1_ps(plane[3]));
+				outside = _mm256_or_ps(outside, _mm256_cmp_ps(distance, _mm256_setzero_ps(), _CMP_LT_OQ));
+			}
+			const int mask = _mm256_movemask_ps(outside);
+			for (int lane = 0; lane < 8; ++lane)
+			{
+				visible[i + lane] = (mask >> lane) & 1 ? 0 : 1;
+			}
+		}
+		testScalar(frustum, corners, visible, blockEnd, count);
+	}
+#endif
+}
+
+Frustum Frustum::fromMatrix(const float* m)
+{
+	// Column c of the matrix gives clip component c as a plane in object space
+	auto column = [m](int c, int row) { return m[row * 4 + c]; };
+	Frustum frustum;
+	for (int row = 0; row < 4; ++row)
+	{
+		frustum.planes[0][row] = column(3, row) + column(0, row); // -w <= x
+		frustum.planes[1][row] = column(3, row) - column(0, row); // x <= w
+		frustum.planes[2][row] = column(3, row) + column(1, row); // -w <= y
+		frustum.planes[3][row] = column(3, row) - column(1, row); // y <= w
+		frustum.planes[4][row] = column(2, row); // 0 <= z
+		frustum.planes[5][row] = column(3, row) - column(2, row); // z <= w
+	}
+	for (auto& plane : frustum.planes)
+	{
+		const float length = std::sqrt(plane[0] * plane[0] + plane[1] * plane[1] + plane[2] * plane[2]);
+		if (length > 0.0f)
+		{
+			for (float& value : plane)
+			{
+				value /= length;
+			}
+		}
+	}
+	return frustum;
+}
+
+void ChunkBounds::clear()
+{
+	minX.clear();
+	minY.clear();
+	minZ.clear();
+	maxX.clear();
+	maxY.clear();
+	maxZ.clear();
+	ranges.clear();
+}
+
+void FrustumCuller::buildChunks(Vec3Streams positions, std::span<const unsigned int> indices, size_t trianglesPerChunk, ChunkBounds& out, uint32_t baseIndex)
+{
+	out.clear();
+	const size_t chunkIndices = std::max<size_t>(trianglesPerChunk, 1) * 3;
+	const size_t chunkCount = (indices.size() + chunkIndices - 1) / chunkIndices;
+	out.minX.resize(chunkCount);
+	out.minY.resize(chunkCount);
+	out.minZ.resize(chunkCount);
+	out.maxX.resize(chunkCount);
+	out.maxY.resize(chunkCount);
+	out.maxZ.resize(chunkCount);
+	out.ranges.resize(chunkCount);
+	size_t kept = 0;
+	for (size_t chunk = 0; chunk < chunkCount; ++chunk)
+	{
+		const size_t first = chunk * chunkIndices;
+		const size_t end = std::min(first + chunkIndices, indices.size());
+		float low[3] = { INFINITY, INFINITY, INFINITY };
+		float high[3] = { -INFINITY, -INFINITY, -INFINITY };
+		for (size_t i = first; i < end; ++i)
+		{
+			const unsigned int v = indices[i];
+			if (v >= positions.count)
+			{
+				continue;
+			}
+			low[0] = std::min(low[0], positions.x[v]);
+			low[1] = std::min(low[1], positions.y[v]);
+			low[2] = std::min(low[2], positions.z[v]);
+			high[0] = std::max(high[0], positions.x[v]);
+			high[1] = std::max(high[1], positions.y[v]);
+			high[2] = std::max(high[2], positions.z[v]);
+		}
+		if (low[0] > high[0])
+		{
+			// No valid vertices. The inverted box is not rejected reliably: a zero plane coefficient times an infinite
+			// bound gives NaN, which tests as inside. The range has nothing to draw, so the chunk is left out instead.
+			continue;
+		}
+		out.minX[kept] = low[0];
+		out.minY[kept] = low[1];
+		out.minZ[kept] = low[2];
+		out.maxX[kept] = high[0];
+		out.maxY[kept] = high[1];
+		out.maxZ[kept] = high[2];
+		out.ranges[kept] = { baseIndex + uint32_t(first), uint32_t(end - first) };
+		++kept;
+	}
+	out.minX.resize(kept);
+	out.minY.resize(kept);
+	out.minZ.resize(kept);
+	out.maxX.resize(kept);
+	out.maxY.resize(kept);
+	out.maxZ.resize(kept);
+	out.ranges.resize(kept);
+}
+
+void FrustumCuller::replaceTail(ChunkBounds& chunks, const ChunkBounds& tail, uint32_t firstIndex)
+{
+	const size_t kept = std::lower_bound(chunks.ranges.begin(), chunks.ranges.end(), firstIndex,
+		[](const IndexRange& range, uint32_t index) { return range.firstIndex < index; }) - chunks.ranges.begin();
+	for (auto [stream, added] : { std::pair{ &chunks.minX, &tail.minX }, std::pair{ &chunks.minY, &tail.minY }, std::pair{ &chunks.minZ, &tail.minZ },
+		std::pair{ &chunks.maxX, &tail.maxX }, std::pair{ &chunks.maxY, &tail.maxY }, std::pair{ &chunks.maxZ, &tail.maxZ } })
+	{
+		stream->resize(kept);
+		stream->insert(stream->end(), added->begin(), added->end());
+	}
+	chunks.ranges.resize(kept);
+	chunks.ranges.insert(chunks.ranges.end(), tail.ranges.begin(), tail.ranges.end());
+}
+
+size_t FrustumCuller::cull(const Frustum& frustum, const ChunkBounds& chunks, std::vector<IndexRange>& visible)
+{
+	const size_t count = chunks.size();
+	if (count == 0)
+	{
+		return 0;
+	}
+
+	PlaneStreams corners[6];
+	for (int p = 0; p < 6; ++p)
+	{
+		corners[p] = furthestCorner(frustum.planes[p], chunks);
+	}
+
+	thread_local std::vector<uint8_t> flags; // Reused between frames
+	flags.resize(count);
+#if MESH_KERNELS_X86
+	switch (MeshKernels::activeIsa())
+	{
+	case MeshKernels::Isa::AVX2:
+		testAVX2(frustum, corners, flags.data(), count);
+		break;
+	case MeshKernels::Isa::SSE2:
+		testSSE2(frustum, corners, flags.data(), count);
+		break;
+	default:
+		testScalar(frustum, corners, flags.data(), 0, count);
+		break;
+	}
+#else
+	testScalar(frustum, corners, flags.data(), 0, count);
+#endif
+
+	// Compact, extending the previous range when the next visible chunk continues it
+	size_t visibleCount = 0;
+	const size_t firstOutput = visible.size();
+	for (size_t i = 0; i < count; ++i)
+	{
+		if (!flags[i])
+		{
+			continue;
+		}
+		++visibleCount;
+		const IndexRange& range = chunks.ranges[i];
+		if (visible.size() > firstOutput && visible.back().firstIndex + visible.back().indexCount == range.firstIndex)
+		{
+			visible.back().indexCount += range.indexCount;
+		}
+		else
+		{
+			visible.push_back(range);
+		}
+	}
+	return visibleCount;
+}
\ No newline at end of file
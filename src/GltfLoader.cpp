@@ -0,0 +1,764 @@
+// GLB container and glTF JSON parsing, accessor decoding into the flat SoA mesh Model works with
+
+#include "GltfLoader.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <numeric>
+#include <QDebug>
+#include <QDir>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QQuaternion>
+#include <QUrl>
+#include "MeshKernels.h"
+#include "Parallel.h"
+#include "Trace.h"
+
+namespace
+{
+	constexpr uint32_t glbMagic = 0x46546C67; // "glTF"
+	constexpr uint32_t jsonChunkType = 0x4E4F534A; // "JSON"
+	constexpr uint32_t binaryChunkType = 0x004E4942; // "BIN\0"
+
+	enum ComponentType : unsigned int
+	{
+		Byte = 5120,
+		UnsignedByte = 5121,
+		Short = 5122,
+		UnsignedShort = 5123,
+		UnsignedInt = 5125,
+		Float = 5126
+	};
+
+	size_t componentBytes(unsigned int type)
+	{
+		switch (type)
+		{
+		case Byte:
+		case UnsignedByte: return 1;
+		case Short:
+		case UnsignedShort: return 2;
+		case UnsignedInt:
+		case Float: return 4;
+		}
+		return 0;
+	}
+
+	bool isIndexType(unsigned int type)
+	{
+		return type == UnsignedByte || type == UnsignedShort || type == UnsignedInt;
+	}
+
+	unsigned int typeComponents(const QString& type)
+	{
+		if (type == "SCALAR") return 1;
+		if (type == "VEC2") return 2;
+		if (type == "VEC3") return 3;
+		if (type == "VEC4" || type == "MAT2") return 4;
+		if (type == "MAT3") return 9;
+		if (type == "MAT4") return 16;
+		return 0;
+	}
+
+	// glTF data is little-endian like every platform the viewer runs on, memcpy keeps unaligned reads legal
+	template <typename T>
+	T readValue(const unsigned char* bytes)
+	{
+		T value;
+		std::memcpy(&value, bytes, sizeof(T));
+		return value;
+	}
+
+	float readComponent(const unsigned char* bytes, unsigned int type, bool normalized)
+	{
+		switch (type)
+		{
+		case Float: return readValue<float>(bytes);
+		case Byte: return normalized ? std::max(readValue<int8_t>(bytes) / 127.0f, -1.0f) : readValue<int8_t>(bytes);
+		case UnsignedByte: return normalized ? bytes[0] / 255.0f : bytes[0];
+		case Short: return normalized ? std::max(readValue<int16_t>(bytes) / 32767.0f, -1.0f) : readValue<int16_t>(bytes);
+		case UnsignedShort: return normalized ? readValue<uint16_t>(bytes) / 65535.0f : readValue<uint16_t>(bytes);
+		case UnsignedInt: return static_cast<float>(readValue<uint32_t>(bytes));
+		}
+		return 0.0f;
+	}
+
+	uint32_t readIndex(const unsigned char* bytes, unsigned int type)
+	{
+		switch (type)
+		{
+		case UnsignedByte: return bytes[0];
+		case UnsignedShort: return readValue<uint16_t>(bytes);
+		case UnsignedInt: return readValue<uint32_t>(bytes);
+		}
+		return 0;
+	}
+
+	QMatrix4x4 localTransform(const QJsonObject& node)
+	{
+		const QJsonArray matrix = node.value("matrix").toArray();
+		if (matrix.size() == 16)
+		{
+			float values[16];
+			for (int i = 0; i < 16; ++i)
+			{
+				values[i] = static_cast<float>(matrix.at(i).toDouble());
+			}
+			return QMatrix4x4(values).transposed(); // glTF stores columns, the constructor takes rows
+		}
+
+		QMatrix4x4 local;
+		const QJsonArray translation = node.value("translation").toArray();
+		const QJsonArray rotation = node.value("rotation").toArray();
+		const QJsonArray scale = node.value("scale").toArray();
+		if (translation.size() == 3)
+		{
+			local.translate(translation.at(0).toDouble(), translation.at(1).toDouble(), translation.at(2).toDouble());
+		}
+		if (rotation.size() == 4)
+		{
+			// Stored as x, y, z, w
+			local.rotate(QQuaternion(rotation.at(3).toDouble(), rotation.at(0).toDouble(), rotation.at(1).toDouble(), rotation.at(2).toDouble()));
+		}
+		if (scale.size() == 3)
+		{
+			local.scale(scale.at(0).toDouble(), scale.at(1).toDouble(), scale.at(2).toDouble());
+		}
+		return local;
+	}
+
+	// A negative determinant of the linear part turns the front faces around, glTF then wants the winding reversed
+	bool mirrors(const QMatrix4x4& transform)
+	{
+		const float* m = transform.constData(); // Column-major
+		const float determinant = m[0] * (m[5] * m[10] - m[9] * m[6]) - m[4] * (m[1] * m[10] - m[9] * m[2]) + m[8] * (m[1] * m[6] - m[5] * m[2]);
+		return determinant < 0.0f;
+	}
+
+	// One triangle primitive of one mesh instance and the slices of the output it writes
+	struct PrimitiveTask
+	{
+		unsigned int mode = GltfAsset::triangles;
+		const QMatrix4x4* transform = nullptr;
+		bool mirrored = false;
+		GltfAccessor positions;
+		GltfAccessor normals;
+		GltfAccessor texcoords;
+		GltfAccessor indices;
+		bool indexed = false;
+		size_t firstVertex = 0;
+		size_t firstIndex = 0;
+		size_t indexCount = 0;
+	};
+
+	// Strips and fans become lists, glTF's corner order keeps every triangle's winding
+	void expandTriangles(unsigned int mode, const unsigned int* corners, size_t triangleCount, unsigned int* out)
+	{
+		for (size_t i = 0; i < triangleCount; ++i, out += 3)
+		{
+			if (mode == GltfAsset::triangleStrip)
+			{
+				out[0] = corners[i];
+				out[1] = corners[i + 1 + i % 2];
+				out[2] = corners[i + 2 - i % 2];
+			}
+			else if (mode == GltfAsset::triangleFan)
+			{
+				out[0] = corners[i + 1];
+				out[1] = corners[i + 2];
+				out[2] = corners[0];
+			}
+			else
+			{
+				out[0] = corners[i * 3];
+				out[1] = corners[i * 3 + 1];
+				out[2] = corners[i * 3 + 2];
+			}
+		}
+	}
+
+	// Returns false when an index points outside the primitive's own vertices
+	bool decodePrimitive(const PrimitiveTask& task, GltfMeshData& out, bool indicesInPlace)
+	{
+		const size_t first = task.firstVertex;
+		const size_t count = task.positions.count;
+		task.positions.decodeComponent(0, out.vertices.x.data() + first);
+		task.positions.decodeComponent(1, out.vertices.y.data() + first);
+		task.positions.decodeComponent(2, out.vertices.z.data() + first);
+		const bool hasNormals = !out.normals.empty();
+		if (hasNormals)
+		{
+			task.normals.decodeComponent(0, out.normals.x.data() + first);
+			task.normals.decodeComponent(1, out.normals.y.data() + first);
+			task.normals.decodeComponent(2, out.normals.z.data() + first);
+		}
+		if (!out.texcoords.empty())
+		{
+			task.texcoords.decodeComponent(0, out.texcoords.x.data() + first);
+			task.texcoords.decodeComponent(1, out.texcoords.y.data() + first);
+		}
+
+		if (!task.transform->isIdentity())
+		{
+			MeshKernels::transformPoints(out.vertices.x.data() + first, out.vertices.y.data() + first, out.vertices.z.data() + first, count, task.transform->constData());
+			if (hasNormals)
+			{
+				const QMatrix3x3 inverseTranspose = task.transform->normalMatrix();
+				const float* n = inverseTranspose.constData();
+				const float normalMatrix[16] = { n[0], n[1], n[2], 0.0f, n[3], n[4], n[5], 0.0f, n[6], n[7], n[8], 0.0f, 0.0f, 0.0f, 0.0f, 1.0f };
+				MeshKernels::transformDirections(out.normals.x.data() + first, out.normals.y.data() + first, out.normals.z.data() + first, count, normalMatrix);
+				MeshKernels::normalize(out.normals.x.data() + first, out.normals.y.data() + first, out.normals.z.data() + first, count);
+			}
+		}
+
+		const unsigned int base = static_cast<unsigned int>(first);
+		std::span<const unsigned int> written;
+		if (indicesInPlace)
+		{
+			written = task.indices.asUint32().first(task.indexCount);
+		}
+		else
+		{
+			unsigned int* target = out.indices.data() + task.firstIndex;
+			if (task.indexed && task.mode == GltfAsset::triangles && task.indices.count == task.indexCount)
+			{
+				task.indices.decodeIndices(base, target);
+			}
+			else
+			{
+				std::vector<unsigned int> corners(task.indexed ? task.indices.count : count);
+				if (task.indexed)
+				{
+					task.indices.decodeIndices(base, corners.data());
+				}
+				else
+				{
+					std::iota(corners.begin(), corners.end(), base);
+				}
+				expandTriangles(task.mode, corners.data(), task.indexCount / 3, target);
+			}
+			if (task.mirrored)
+			{
+				for (size_t i = 0; i + 2 < task.indexCount; i += 3)
+				{
+					std::swap(target[i + 1], target[i + 2]);
+				}
+			}
+			written = { target, task.indexCount };
+		}
+		// Unsigned wrap-around turns indices below base into huge values as well
+		return std::all_of(written.begin(), written.end(), [base, count](unsigned int index) { return index - base < count; });
+	}
+
+	// Every triangle primitive of instances decoded into out, each with its instance's transform. filePath is for messages.
+	bool decodeInstances(std::shared_ptr<const GltfAsset> asset, std::span<const GltfAsset::MeshInstance> instances, const QString& filePath,
+		GltfMeshData& out, unsigned int threadCount)
+	{
+		// Lay the primitive instances out back to back so every task writes its own slice of the output
+		std::vector<PrimitiveTask> tasks;
+		bool allNormals = true;
+		bool allTexcoords = true;
+		size_t vertexCount = 0;
+		size_t indexCount = 0;
+		for (const GltfAsset::MeshInstance& instance : instances)
+		{
+			for (const GltfAsset::Primitive& primitive : asset->getMeshes()[instance.mesh])
+			{
+				if (primitive.mode != GltfAsset::triangles && primitive.mode != GltfAsset::triangleStrip && primitive.mode != GltfAsset::triangleFan)
+				{
+					++out.skippedPrimitives;
+					continue;
+				}
+				PrimitiveTask task;
+				task.mode = primitive.mode;
+				task.transform = &instance.transform;
+				task.mirrored = mirrors(instance.transform);
+				if (!asset->getAccessor(primitive.positions, task.positions) || task.positions.components != 3)
+				{
+					qCritical() << "Primitive without valid positions in" << filePath;
+					return false;
+				}
+				task.indexed = primitive.indices >= 0;
+				if (task.indexed && (!asset->getAccessor(primitive.indices, task.indices) || task.indices.components != 1 || !isIndexType(task.indices.componentType)))
+				{
+					qCritical() << "Invalid index accessor in" << filePath;
+					return false;
+				}
+				allNormals = allNormals && asset->getAccessor(primitive.normals, task.normals) && task.normals.components == 3 && task.normals.count == task.positions.count;
+				allTexcoords = allTexcoords && asset->getAccessor(primitive.texcoords, task.texcoords) && task.texcoords.components == 2 && task.texcoords.count == task.positions.count;
+
+				const size_t corners = task.indexed ? task.indices.count : task.positions.count;
+				task.indexCount = primitive.mode == GltfAsset::triangles ? corners / 3 * 3 : (corners < 3 ? 0 : (corners - 2) * 3);
+				task.firstVertex = vertexCount;
+				task.firstIndex = indexCount;
+				vertexCount += task.positions.count;
+				indexCount += task.indexCount;
+				tasks.push_back(task);
+			}
+		}
+		if (vertexCount > 0xFFFFFFFFull)
+		{
+			qCritical() << filePath << "has more vertices than 32-bit indices can address";
+			return false;
+		}
+		out.primitiveCount = tasks.size();
+		out.vertices.resize(vertexCount);
+		if (!tasks.empty() && allNormals)
+		{
+			out.normals.resize(vertexCount);
+		}
+		if (!tasks.empty() && allTexcoords)
+		{
+			out.texcoords.resize(vertexCount);
+		}
+
+		// A single triangle list with 32-bit indices is already the index buffer the model needs, unless it must be flipped
+		const bool indicesInPlace = tasks.size() == 1 && tasks[0].mode == GltfAsset::triangles && !tasks[0].mirrored && !tasks[0].indices.asUint32().empty();
+		if (!indicesInPlace)
+		{
+			out.indices.resize(indexCount);
+		}
+
+		std::atomic<size_t> nextTask{ 0 };
+		std::atomic<bool> indicesValid{ true };
+		Parallel::run(std::min<size_t>(Parallel::resolveThreadCount(threadCount), tasks.size()), [&](size_t)
+		{
+			for (size_t i = nextTask++; i < tasks.size(); i = nextTask++)
+			{
+				TRACE_ZONE("Decode primitive");
+				if (!decodePrimitive(tasks[i], out, indicesInPlace))
+				{
+					indicesValid = false;
+				}
+			}
+		});
+		if (!indicesValid)
+		{
+			qCritical() << "Vertex index out of range in" << filePath;
+			out = GltfMeshData();
+			return false;
+		}
+
+		if (indicesInPlace)
+		{
+			out.indexView = tasks[0].indices.asUint32().first(tasks[0].indexCount);
+			out.asset = std::move(asset);
+		}
+		else
+		{
+			out.indexView = out.indices;
+		}
+		qInfo().nospace() << "Loaded " << out.primitiveCount << " glTF primitives: " << vertexCount << " vertices, " << indexCount / 3 << " triangles"
+			<< (indicesInPlace ? ", indices used in place" : "") << (out.skippedPrimitives ? ", skipped points and lines" : "");
+		return true;
+	}
+}
+
+std::span<const unsigned int> GltfAccessor::asUint32() const
+{
+	if (!data || sparseCount > 0 || componentType != UnsignedInt || components != 1 || stride != sizeof(unsigned int)
+		|| reinterpret_cast<uintptr_t>(data) % alignof(unsigned int) != 0)
+	{
+		return {};
+	}
+	return { reinterpret_cast<const unsigned int*>(data), count };
+}
+
+void GltfAccessor::decodeComponent(unsigned int component, float* out) const
+{
+	const size_t offset = component * componentBytes(componentType);
+	if (!data)
+	{
+		std::fill(out, out + count, 0.0f);
+	}
+	else if (componentType == Float)
+	{
+		const unsigned char* source = data + offset;
+		for (size_t i = 0; i < count; ++i, source += stride)
+		{
+			std::memcpy(out + i, source, sizeof(float));
+		}
+	}
+	else
+	{
+		const unsigned char* source = data + offset;
+		for (size_t i = 0; i < count; ++i, source += stride)
+		{
+			out[i] = readComponent(source, componentType, normalized);
+		}
+	}
+
+	const size_t indexBytes = componentBytes(sparseIndexType);
+	const size_t valueBytes = components * componentBytes(componentType);
+	for (size_t i = 0; i < sparseCount; ++i)
+	{
+		const uint32_t element = readIndex(sparseIndices + i * indexBytes, sparseIndexType);
+		if (element < count)
+		{
+			out[element] = readComponent(sparseValues + i * valueBytes + offset, componentType, normalized);
+		}
+	}
+}
+
+void GltfAccessor::decodeIndices(unsigned int base, unsigned int* out) const
+{
+	if (!data)
+	{
+		std::fill(out, out + count, base);
+	}
+	else
+	{
+		const unsigned char* source = data;
+		for (size_t i = 0; i < count; ++i, source += stride)
+		{
+			out[i] = base + readIndex(source, componentType);
+		}
+	}
+
+	const size_t indexBytes = componentBytes(sparseIndexType);
+	const size_t valueBytes = componentBytes(componentType);
+	for (size_t i = 0; i < sparseCount; ++i)
+	{
+		const uint32_t element = readIndex(sparseIndices + i * indexBytes, sparseIndexType);
+		if (element < count)
+		{
+			out[element] = base + readIndex(sparseValues + i * valueBytes, componentType);
+		}
+	}
+}
+
+GltfAsset::~GltfAsset()
+{
+	for (Mapping& mapping : mappings)
+	{
+		mapping.file->unmap(mapping.data);
+	}
+}
+
+std::shared_ptr<GltfAsset> GltfAsset::open(const QString& filePath)
+{
+	TRACE_ZONE("GltfAsset::open");
+	std::shared_ptr<GltfAsset> asset(new GltfAsset);
+	std::span<const unsigned char> file;
+	if (!asset->mapFile(filePath, file))
+	{
+		return nullptr;
+	}
+	const QString directory = QFileInfo(filePath).absolutePath();
+	if (file.size() < 12 || readValue<uint32_t>(file.data()) != glbMagic)
+	{
+		// .gltf, the whole file is JSON and the buffers are separate files or data URIs
+		const QByteArray json = QByteArray::fromRawData(reinterpret_cast<const char*>(file.data()), static_cast<qsizetype>(file.size()));
+		return asset->parse(json, directory, {}) ? asset : nullptr;
+	}
+
+	// .glb: a 12-byte header, the JSON chunk and usually one binary chunk, every chunk padded to 4 bytes
+	const uint32_t version = readValue<uint32_t>(file.data() + 4);
+	if (version != 2)
+	{
+		qCritical() << filePath << "is binary glTF version" << version << "- only version 2 is supported";
+		return nullptr;
+	}
+	const size_t length = std::min<size_t>(readValue<uint32_t>(file.data() + 8), file.size());
+	QByteArray json;
+	std::span<const unsigned char> binary;
+	for (size_t offset = 12; offset + 8 <= length;)
+	{
+		const size_t chunkLength = readValue<uint32_t>(file.data() + offset);
+		const uint32_t type = readValue<uint32_t>(file.data() + offset + 4);
+		if (chunkLength > length - offset - 8)
+		{
+			qCritical() << "Truncated chunk at byte" << offset << "of" << filePath;
+			return nullptr;
+		}
+		const unsigned char* chunk = file.data() + offset + 8;
+		if (type == jsonChunkType && json.isEmpty())
+		{
+			json = QByteArray::fromRawData(reinterpret_cast<const char*>(chunk), static_cast<qsizetype>(chunkLength));
+		}
+		else if (type == binaryChunkType && binary.empty())
+		{
+			binary = { chunk, chunkLength };
+		}
+		offset += 8 + ((chunkLength + 3) & ~size_t(3));
+	}
+	return asset->parse(json, directory, binary) ? asset : nullptr;
+}
+
+bool GltfAsset::mapFile(const QString& path, std::span<const unsigned char>& out)
+{
+	Mapping mapping;
+	mapping.file = std::make_unique<QFile>(path);
+	if (!mapping.file->open(QIODevice::ReadOnly) || mapping.file->size() == 0)
+	{
+		qCritical() << "Cannot open" << path;
+		return false;
+	}
+	mapping.data = mapping.file->map(0, mapping.file->size());
+	if (!mapping.data)
+	{
+		qCritical() << "Cannot map" << path;
+		return false;
+	}
+	out = { mapping.data, static_cast<size_t>(mapping.file->size()) };
+	mappings.push_back(std::move(mapping));
+	return true;
+}
+
+bool GltfAsset::parse(const QByteArray& json, const QString& directory, std::span<const unsigned char> binaryChunk)
+{
+	QJsonParseError error;
+	const QJsonDocument document = QJsonDocument::fromJson(json, &error);
+	if (!document.isObject())
+	{
+		qCritical() << "Invalid glTF JSON:" << error.errorString();
+		return false;
+	}
+	const QJsonObject root = document.object();
+	const QString version = root.value("asset").toObject().value("version").toString();
+	if (!version.startsWith("2."))
+	{
+		qCritical() << "glTF version" << version << "is not supported, only 2.x";
+		return false;
+	}
+
+	// Buffers: the GLB binary chunk, an external file mapped next to the others, or a base64 data URI
+	const QJsonArray bufferArray = root.value("buffers").toArray();
+	decodedBuffers.reserve(bufferArray.size()); // Spans point into these
+	for (const QJsonValue& value : bufferArray)
+	{
+		const QJsonObject buffer = value.toObject();
+		const size_t byteLength = static_cast<size_t>(buffer.value("byteLength").toDouble());
+		std::span<const unsigned char> data;
+		if (!buffer.contains("uri"))
+		{
+			data = binaryChunk;
+		}
+		else
+		{
+			const QString uri = buffer.value("uri").toString();
+			if (uri.startsWith("data:"))
+			{
+				const qsizetype comma = uri.indexOf(',');
+				if (comma < 0 || !uri.left(comma).endsWith(";base64"))
+				{
+					qCritical() << "Unsupported glTF buffer URI" << uri.left(64);
+					return false;
+				}
+				decodedBuffers.push_back(QByteArray::fromBase64(uri.mid(comma + 1).toLatin1()));
+				data = { reinterpret_cast<const unsigned char*>(decodedBuffers.back().constData()), static_cast<size_t>(decodedBuffers.back().size()) };
+			}
+			else if (!mapFile(QDir(directory).filePath(QUrl::fromPercentEncoding(uri.toUtf8())), data))
+			{
+				return false;
+			}
+		}
+		if (data.size() < byteLength)
+		{
+			qCritical() << "glTF buffer" << buffers.size() << "is shorter than its byteLength";
+			return false;
+		}
+		buffers.push_back(data.first(byteLength));
+	}
+
+	struct BufferView
+	{
+		int buffer = -1; // -1 when the view lies outside its buffer
+		size_t offset = 0;
+		size_t length = 0;
+		size_t stride = 0; // 0 = tightly packed
+	};
+	std::vector<BufferView> views;
+	for (const QJsonValue& value : root.value("bufferViews").toArray())
+	{
+		const QJsonObject object = value.toObject();
+		BufferView view;
+		const int buffer = object.value("buffer").toInt(-1);
+		view.offset = static_cast<size_t>(object.value("byteOffset").toDouble());
+		view.length = static_cast<size_t>(object.value("byteLength").toDouble());
+		view.stride = static_cast<size_t>(object.value("byteStride").toDouble());
+		if (buffer >= 0 && static_cast<size_t>(buffer) < buffers.size() && view.offset <= buffers[buffer].size() && view.length <= buffers[buffer].size() - view.offset)
+		{
+			view.buffer = buffer;
+		}
+		views.push_back(view);
+	}
+
+	// Finds count elements at offset into a view, checked against the view's bounds
+	auto resolve = [&](int index, size_t offset, size_t count, size_t elementBytes, bool strided, const unsigned char*& data, size_t& stride)
+	{
+		if (index < 0 || static_cast<size_t>(index) >= views.size() || views[index].buffer < 0)
+		{
+			return false;
+		}
+		const BufferView& view = views[index];
+		stride = strided && view.stride > 0 ? view.stride : elementBytes;
+		if (stride < elementBytes || count > view.length || offset > view.length)
+		{
+			return false;
+		}
+		if (count > 0 && (count - 1) * stride + elementBytes > view.length - offset)
+		{
+			return false;
+		}
+		data = buffers[view.buffer].data() + view.offset + offset;
+		return true;
+	};
+
+	for (const QJsonValue& value : root.value("accessors").toArray())
+	{
+		const QJsonObject object = value.toObject();
+		GltfAccessor accessor;
+		accessor.count = static_cast<size_t>(object.value("count").toDouble());
+		accessor.componentType = static_cast<unsigned int>(object.value("componentType").toInt());
+		accessor.components = typeComponents(object.value("type").toString());
+		accessor.normalized = object.value("normalized").toBool();
+		const size_t elementBytes = accessor.components * componentBytes(accessor.componentType);
+		bool valid = elementBytes > 0;
+		if (valid && object.contains("bufferView"))
+		{
+			valid = resolve(object.value("bufferView").toInt(-1), static_cast<size_t>(object.value("byteOffset").toDouble()), accessor.count, elementBytes, true, accessor.data, accessor.stride);
+		}
+		else
+		{
+			accessor.stride = elementBytes;
+		}
+
+		// Sparse indices and values are always tightly packed
+		const QJsonObject sparse = object.value("sparse").toObject();
+		if (valid && !sparse.isEmpty())
+		{
+			const QJsonObject indices = sparse.value("indices").toObject();
+			const QJsonObject values = sparse.value("values").toObject();
+			accessor.sparseCount = static_cast<size_t>(sparse.value("count").toDouble());
+			accessor.sparseIndexType = static_cast<unsigned int>(indices.value("componentType").toInt());
+			size_t stride = 0;
+			valid = isIndexType(accessor.sparseIndexType)
+				&& resolve(indices.value("bufferView").toInt(-1), static_cast<size_t>(indices.value("byteOffset").toDouble()), accessor.sparseCount,
+					componentBytes(accessor.sparseIndexType), false, accessor.sparseIndices, stride)
+				&& resolve(values.value("bufferView").toInt(-1), static_cast<size_t>(values.value("byteOffset").toDouble()), accessor.sparseCount,
+					elementBytes, false, accessor.sparseValues, stride);
+		}
+		accessors.push_back(accessor);
+		accessorValid.push_back(valid ? 1 : 0);
+	}
+
+	for (const QJsonValue& mesh : root.value("meshes").toArray())
+	{
+		std::vector<Primitive> primitives;
+		for (const QJsonValue& value : mesh.toObject().value("primitives").toArray())
+		{
+			const QJsonObject object = value.toObject();
+			const QJsonObject attributes = object.value("attributes").toObject();
+			Primitive primitive;
+			primitive.positions = attributes.value("POSITION").toInt(-1);
+			primitive.normals = attributes.value("NORMAL").toInt(-1);
+			primitive.texcoords = attributes.value("TEXCOORD_0").toInt(-1);
+			primitive.indices = object.value("indices").toInt(-1);
+			primitive.mode = static_cast<unsigned int>(object.value("mode").toInt(triangles));
+			primitives.push_back(primitive);
+		}
+		meshes.push_back(std::move(primitives));
+	}
+
+	const QJsonArray scenes = root.value("scenes").toArray();
+	if (scenes.isEmpty())
+	{
+		for (unsigned int mesh = 0; mesh < meshes.size(); ++mesh)
+		{
+			instances.push_back({ mesh, QMatrix4x4() });
+		}
+		return true;
+	}
+
+	// Walk the default scene depth-first in document order. The depth limit stops files with cyclic node graphs.
+	struct PendingNode
+	{
+		int node;
+		QMatrix4x4 parent;
+		qsizetype depth;
+	};
+	const QJsonArray nodes = root.value("nodes").toArray();
+	const QJsonArray sceneNodes = scenes.at(std::clamp<qsizetype>(root.value("scene").toInt(0), 0, scenes.size() - 1)).toObject().value("nodes").toArray();
+	std::vector<PendingNode> stack;
+	for (qsizetype i = sceneNodes.size() - 1; i >= 0; --i)
+	{
+		stack.push_back({ sceneNodes.at(i).toInt(-1), QMatrix4x4(), 0 });
+	}
+	while (!stack.empty())
+	{
+		const PendingNode pending = stack.back();
+		stack.pop_back();
+		if (pending.node < 0 || pending.node >= nodes.size() || pending.depth > nodes.size())
+		{
+			continue;
+		}
+		const QJsonObject node = nodes.at(pending.node).toObject();
+		const QMatrix4x4 world = pending.parent * localTransform(node);
+		const int mesh = node.value("mesh").toInt(-1);
+		if (mesh >= 0 && static_cast<size_t>(mesh) < meshes.size())
+		{
+			instances.push_back({ static_cast<unsigned int>(mesh), world });
+		}
+		const QJsonArray children = node.value("children").toArray();
+		for (qsizetype i = children.size() - 1; i >= 0; --i)
+		{
+			stack.push_back({ children.at(i).toInt(-1), world, pending.depth + 1 });
+		}
+	}
+	return true;
+}
+
+const std::vector<std::vector<GltfAsset::Primitive>>& GltfAsset::getMeshes() const
+{
+	return meshes;
+}
+const std::vector<GltfAsset::MeshInstance>& GltfAsset::getInstances() const
+{
+	return instances;
+}
+bool GltfAsset::getAccessor(int index, GltfAccessor& out) const
+{
+	if (index < 0 || static_cast<size_t>(index) >= accessors.size() || !accessorValid[index])
+	{
+		return false;
+	}
+	out = accessors[index];
+	return true;
+}
+
+bool GltfLoader::isGltfFile(const QString& filePath)
+{
+	const QString suffix = QFileInfo(filePath).suffix().toLower();
+	return suffix == "glb" || suffix == "gltf";
+}
+
+bool GltfLoader::load(const QString& filePath, GltfMeshData& out, unsigned int threadCount)
+{
+	TRACE_ZONE("GltfLoader::load");
+	out = GltfMeshData();
+	std::shared_ptr<GltfAsset> asset = GltfAsset::open(filePath);
+	if (!asset)
+	{
+		return false;
+	}
+	const std::vector<GltfAsset::MeshInstance>& instances = asset->getInstances();
+	return decodeInstances(std::move(asset), instances, filePath, out, threadCount);
+}
+
+bool GltfLoader::loadMesh(const QString& filePath, std::shared_ptr<const GltfAsset> asset, unsigned int mesh, GltfMeshData& out, unsigned int threadCount)
+{
+	TRACE_ZONE("GltfLoader::loadMesh");
+	out = GltfMeshData();
+	if (!asset || mesh >= asset->getMeshes().size())
+	{
+		qCritical() << "No mesh" << mesh << "in" << filePath;
+		return false;
+	}
+	const GltfAsset::MeshInstance instance = { mesh, QMatrix4x4() };
+	return decodeInstances(std::move(asset), { &instance, 1 }, filePath, out, threadCount);
+}
\ No newline at end of file
@@ -0,0 +1,145 @@
+// Times normal generation, bounds and transforms on a procedural grid, old AoS loops vs MeshKernels
+
+#include "KernelBenchmark.h"
+#include "MeshKernels.h"
+#include <QDebug>
+#include <QMatrix4x4>
+#include <chrono>
+#include <cmath>
+#include <vector>
+
+namespace
+{
+	struct BenchmarkMesh
+	{
+		std::vector<QVector3D> positions; // Layout Model used before the SoA streams
+		Vec3Array streams;
+		std::vector<unsigned int> indices;
+	};
+
+	// Wavy square grid with about triangleCount triangles
+	BenchmarkMesh makeGrid(size_t triangleCount)
+	{
+		const size_t side = std::max<size_t>(1, static_cast<size_t>(std::sqrt(triangleCount / 2.0)));
+		BenchmarkMesh mesh;
+		mesh.positions.reserve((side + 1) * (side + 1));
+		mesh.streams.reserve((side + 1) * (side + 1));
+		for (size_t row = 0; row <= side; ++row)
+		{
+			for (size_t column = 0; column <= side; ++column)
+			{
+				const float x = static_cast<float>(column) / side;
+				const float z = static_cast<float>(row) / side;
+				const float y = 0.05f * std::sin(x * 40.0f) * std::cos(z * 40.0f);
+				mesh.positions.push_back(QVector3D(x, y, z));
+				mesh.streams.push_back(x, y, z);
+			}
+		}
+		mesh.indices.reserve(side * side * 6);
+		for (size_t row = 0; row < side; ++row)
+		{
+			for (size_t column = 0; column < side; ++column)
+			{
+				const unsigned int corner = static_cast<unsigned int>(row * (side + 1) + column);
+				const unsigned int below = corner + static_cast<unsigned int>(side + 1);
+				mesh.indices.insert(mesh.indices.end(), { corner, below, corner + 1, corner + 1, below, below + 1 });
+			}
+		}
+		return mesh;
+	}
+
+	template <typename Function>
+	double timeMs(const Function& function)
+	{
+		auto start = std::chrono::steady_clock::now();
+		function();
+		return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	void logRow(const char* name, double normalsMs, double boundsMs, double transformMs, double baselineTotal)
+	{
+		const double total = normalsMs + boundsMs + transformMs;
+		qInfo().nospace() << name << ": normals " << normalsMs << " ms, bounds " << boundsMs << " ms, transform "
+			<< transformMs << " ms, speed-up x" << (total > 0.0 ? baselineTotal / total : 0.0);
+	}
+}
+
+bool runKernelBenchmark(size_t triangleCount)
+{
+	BenchmarkMesh mesh = makeGrid(triangleCount);
+	const auto& positions = mesh.positions;
+	const auto& indices = mesh.indices;
+	qInfo() << "Kernel benchmark:" << indices.size() / 3 << "triangles," << positions.size() << "vertices";
+
+	QMatrix4x4 matrix;
+	matrix.rotate(30.0f, 0.0f, 1.0f, 0.0f);
+	matrix.translate(1.0f, 2.0f, 3.0f);
+	matrix.scale(2.0f);
+
+	// Baseline: the loops Model::loadFromFile ran before the SoA conversion
+	std::vector<QVector3D> normals;
+	const double baselineNormals = timeMs([&]()
+	{
+		normals.assign(positions.size(), QVector3D(0, 0, 0));
+		for (size_t i = 0; i + 2 < indices.size(); i += 3)
+		{
+			QVector3D v0 = positions[indices[i]];
+			QVector3D v1 = positions[indices[i + 1]];
+			QVector3D v2 = positions[indices[i + 2]];
+			QVector3D normal = QVector3D::crossProduct(v1 - v0, v2 - v0).normalized();
+			normals[indices[i]] += normal;
+			normals[indices[i + 1]] += normal;
+			normals[indices[i + 2]] += normal;
+		}
+		for (auto& normal : normals)
+		{
+			normal.normalize();
+		}
+	});
+	QVector3D low, high;
+	const double baselineBounds = timeMs([&]()
+	{
+		low = high = positions.front();
+		for (const auto& position : positions)
+		{
+			for (int axis = 0; axis < 3; ++axis)
+			{
+				low[axis] = std::min(low[axis], position[axis]);
+				high[axis] = std::max(high[axis], position[axis]);
+			}
+		}
+	});
+	std::vector<QVector3D> transformed = positions;
+	const double baselineTransform = timeMs([&]()
+	{
+		for (auto& position : transformed)
+		{
+			position = matrix.map(position);
+		}
+	});
+	const double baselineTotal = baselineNormals + baselineBounds + baselineTransform;
+	logRow("QVector3D loops", baselineNormals, baselineBounds, baselineTransform, baselineTotal);
+
+	const MeshKernels::Isa previous = MeshKernels::activeIsa();
+	for (int isa = 0; isa <= static_cast<int>(MeshKernels::bestSupportedIsa()); ++isa)
+	{
+		MeshKernels::setActiveIsa(static_cast<MeshKernels::Isa>(isa));
+		Vec3Array kernelNormals;
+		const double normalsMs = timeMs([&]()
+		{
+			kernelNormals.resize(0);
+			kernelNormals.resize(mesh.streams.size(), 0.0f);
+			MeshKernels::accumulateFaceNormals(mesh.streams.view(), indices.data(), indices.size(), kernelNormals.x.data(), kernelNormals.y.data(), kernelNormals.z.data());
+			MeshKernels::normalize(kernelNormals.x.data(), kernelNormals.y.data(), kernelNormals.z.data(), kernelNormals.size());
+		});
+		const double boundsMs = timeMs([&]() { MeshKernels::computeBounds(mesh.streams.view()); });
+		Vec3Array kernelTransformed = mesh.streams;
+		const double transformMs = timeMs([&]()
+		{
+			MeshKernels::transformPoints(kernelTransformed.x.data(), kernelTransformed.y.data(), kernelTransformed.z.data(), kernelTransformed.size(), matrix.constData());
+		});
+		logRow(MeshKernels::isaName(MeshKernels::activeIsa()), normalsMs, boundsMs, transformMs, baselineTotal);
+	}
+	MeshKernels::setActiveIsa(previous);
+	return true;
+}
\ No newline at end of file
@@ -0,0 +1,282 @@
+// Generates meshes of growing size, times every stage of loading them and writes the results as JSON
+
+#include "LoadBenchmark.h"
+#include "Camera.h"
+#include "FileBlockReader.h"
+#include "MeshKernels.h"
+#include "MeshPacker.h"
+#include "Model.h"
+#include "Parallel.h"
+#include <QDateTime>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTemporaryDir>
+#include <algorithm>
+#include <chrono>
+#include <limits>
+
+namespace
+{
+	constexpr size_t cameraUpdates = 1000000;
+	constexpr double notRun = -1.0; // Timing of a stage that was skipped or failed
+
+	struct LoadRun
+	{
+		MeshGenerator::Shape shape = MeshGenerator::Shape::Grid;
+		size_t requestedTriangles = 0;
+		MeshGenerator::Stats file;
+		size_t vertices = 0; // After loading, welded vertices for files with vt/vn corners
+		size_t triangles = 0;
+		double generateMs = 0.0;
+		// Fastest of the repeats
+		double readMs = std::numeric_limits<double>::max(); // Raw block reads of the file, no parsing
+		double parseMs = std::numeric_limits<double>::max(); // Read and parse overlap inside loadFromFile
+		double normalsMs = std::numeric_limits<double>::max(); // Welding or normal generation and bounds
+		double optimizeMs = std::numeric_limits<double>::max();
+		double loadMs = std::numeric_limits<double>::max(); // All of loadFromFile
+		double normalKernelMs = std::numeric_limits<double>::max(); // Normal generation alone on the loaded mesh
+		double packMs = std::numeric_limits<double>::max();
+	};
+
+	double elapsedMs(std::chrono::steady_clock::time_point start)
+	{
+		return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	double timeReadMs(const QString& filePath)
+	{
+		const auto start = std::chrono::steady_clock::now();
+		FileBlockReader reader(filePath);
+		std::span<const char> block;
+		while (reader.next(block))
+		{
+		}
+		return reader.failed() ? notRun : elapsedMs(start);
+	}
+
+	double timeNormalKernelMs(const Model& model)
+	{
+		const Vec3Streams positions = model.getVertices();
+		const auto indices = model.getIndices();
+		const auto start = std::chrono::steady_clock::now();
+		Vec3Array normals;
+		normals.resize(positions.size(), 0.0f);
+		MeshKernels::accumulateFaceNormals(positions, indices.data(), indices.size(), normals.x.data(), normals.y.data(), normals.z.data());
+		MeshKernels::normalize(normals.x.data(), normals.y.data(), normals.z.data(), normals.size());
+		return elapsedMs(start);
+	}
+
+	// Load the file once and fold its stage times into run, the stage boundaries come from the progress reports
+	bool measureLoad(const QString& filePath, const LoadBenchmarkSettings& settings, LoadRun& run)
+	{
+		const auto start = std::chrono::steady_clock::now();
+		double normalsStart = notRun;
+		double normalsEnd = notRun;
+		double optimizeEnd = notRun;
+		LoadProgress progress;
+		progress.report = [&](LoadStage stage, double fraction)
+		{
+			if (stage == LoadStage::Normals && fraction == 0.0)
+			{
+				normalsStart = elapsedMs(start);
+			}
+			else if (stage == LoadStage::Normals && fraction == 1.0)
+			{
+				normalsEnd = elapsedMs(start);
+			}
+			else if (stage == LoadStage::Optimize && fraction == 1.0)
+			{
+				optimizeEnd = elapsedMs(start);
+			}
+		};
+
+		Model model;
+		model.setParseThreadCount(settings.threadCount);
+		model.setOptimizeOnLoad(settings.optimize);
+		if (!model.loadFromFile(filePath, &progress) || model.getIndices().empty())
+		{
+			qCritical() << "Cannot load" << filePath << "for the load benchmark";
+			return false;
+		}
+		const double loadMs = elapsedMs(start);
+
+		run.vertices = model.getVertices().size();
+		run.triangles = model.getIndices().size() / 3;
+		run.loadMs = std::min(run.loadMs, loadMs);
+		run.parseMs = std::min(run.parseMs, normalsStart);
+		run.normalsMs = std::min(run.normalsMs, normalsEnd - normalsStart);
+		run.optimizeMs = std::min(run.optimizeMs, optimizeEnd - normalsEnd);
+		run.normalKernelMs = std::min(run.normalKernelMs, timeNormalKernelMs(model));
+
+		PackedMesh packed;
+		const auto packStart = std::chrono::steady_clock::now();
+		run.packMs = MeshPacker::pack(model, false, packed) ? std::min(run.packMs, elapsedMs(packStart)) : notRun;
+		return true;
+	}
+
+	// Orbit steps each followed by a full view-projection rebuild, what the viewer does per mouse move
+	double timeCameraUpdateNs()
+	{
+		Camera camera;
+		float checksum = 0.0f;
+		const auto start = std::chrono::steady_clock::now();
+		for (size_t i = 0; i < cameraUpdates; ++i)
+		{
+			camera.orbit(1.0f, (i & 1) ? 0.5f : -0.5f);
+			checksum += camera.getMVPMatrix(16.0f / 9.0f).m[0][0];
+		}
+		const double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / cameraUpdates;
+		qInfo().nospace() << "Camera: " << ns << " ns per orbit and MVP update (checksum " << checksum << ")";
+		return ns;
+	}
+
+	double nsPerTriangle(double ms, size_t triangles)
+	{
+		return triangles > 0 && ms >= 0.0 ? ms * 1.0e6 / triangles : 0.0;
+	}
+
+	QString sizeLabel(size_t triangles)
+	{
+		if (triangles >= 1000000 && triangles % 1000000 == 0)
+		{
+			return QString::number(static_cast<qulonglong>(triangles / 1000000)) + "M";
+		}
+		if (triangles >= 1000 && triangles % 1000 == 0)
+		{
+			return QString::number(static_cast<qulonglong>(triangles / 1000)) + "K";
+		}
+		return QString::number(static_cast<qulonglong>(triangles));
+	}
+
+	// Load time per triangle against the smallest size of the same shape, above 1 means worse than linear
+	void logRun(const LoadRun& run, const LoadRun& smallest)
+	{
+		const double perTriangle = nsPerTriangle(run.loadMs, run.triangles);
+		const double baseline = nsPerTriangle(smallest.loadMs, smallest.triangles);
+		qInfo().nospace() << MeshGenerator::shapeName(run.shape) << " " << sizeLabel(run.requestedTriangles).toUtf8().constData() << ": "
+			<< run.triangles << " triangles, " << run.vertices << " vertices, " << run.file.bytes / (1024.0 * 1024.0) << " MB, generated in "
+			<< run.generateMs << " ms";
+		qInfo().nospace() << "  read " << run.readMs << " ms, parse " << run.parseMs << " ms, normals " << run.normalsMs << " ms, optimize "
+			<< run.optimizeMs << " ms, load " << run.loadMs << " ms (" << perTriangle << " ns/triangle, x"
+			<< (baseline > 0.0 ? perTriangle / baseline : 0.0) << " vs " << sizeLabel(smallest.requestedTriangles).toUtf8().constData()
+			<< "), normal kernel " << run.normalKernelMs << " ms, pack " << run.packMs << " ms";
+	}
+
+	QJsonObject toJson(const LoadRun& run)
+	{
+		QJsonObject object;
+		object["shape"] = MeshGenerator::shapeName(run.shape);
+		object["requestedTriangles"] = static_cast<double>(run.requestedTriangles);
+		object["triangles"] = static_cast<double>(run.triangles);
+		object["vertices"] = static_cast<double>(run.vertices);
+		object["fileVertices"] = static_cast<double>(run.file.vertices);
+		object["fileFaces"] = static_cast<double>(run.file.faces);
+		object["fileBytes"] = static_cast<double>(run.file.bytes);
+		object["generateMs"] = run.generateMs;
+		object["readMs"] = run.readMs;
+		object["parseMs"] = run.parseMs;
+		object["normalsMs"] = run.normalsMs;
+		object["optimizeMs"] = run.optimizeMs;
+		object["loadMs"] = run.loadMs;
+		object["normalKernelMs"] = run.normalKernelMs;
+		object["packMs"] = run.packMs;
+		object["loadNsPerTriangle"] = nsPerTriangle(run.loadMs, run.triangles);
+		return object;
+	}
+
+	bool writeJson(const QString& jsonPath, const LoadBenchmarkSettings& settings, double cameraNs, const std::vector<LoadRun>& runs)
+	{
+		QJsonObject root;
+		root["benchmark"] = "load";
+		root["date"] = QDateTime::currentDateTimeUtc().toString(Qt::ISODate);
+		root["threads"] = static_cast<int>(Parallel::resolveThreadCount(settings.threadCount));
+		root["isa"] = MeshKernels::isaName(MeshKernels::activeIsa());
+		root["repeats"] = settings.repeats;
+		root["optimize"] = settings.optimize;
+		QJsonObject camera;
+		camera["updates"] = static_cast<double>(cameraUpdates);
+		camera["nsPerUpdate"] = cameraNs;
+		root["camera"] = camera;
+		QJsonArray results;
+		for (const LoadRun& run : runs)
+		{
+			results.append(toJson(run));
+		}
+		root["runs"] = results;
+
+		QFile file(jsonPath);
+		if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate) || file.write(QJsonDocument(root).toJson()) < 0)
+		{
+			qCritical() << "Cannot write" << jsonPath;
+			return false;
+		}
+		qInfo() << "Results written to" << jsonPath;
+		return true;
+	}
+}
+
+bool runLoadBenchmark(const LoadBenchmarkSettings& settings)
+{
+	QTemporaryDir temporary;
+	const QDir directory(settings.directory.isEmpty() ? temporary.path() : settings.directory);
+	if ((settings.directory.isEmpty() && !temporary.isValid()) || !QDir().mkpath(directory.absolutePath()))
+	{
+		qCritical() << "No directory for the generated meshes";
+		return false;
+	}
+	qInfo().nospace() << "Load benchmark: " << Parallel::resolveThreadCount(settings.threadCount) << " threads, "
+		<< MeshKernels::isaName(MeshKernels::activeIsa()) << ", best of " << std::max(settings.repeats, 1) << ", files in "
+		<< directory.absolutePath().toUtf8().constData();
+
+	const double cameraNs = timeCameraUpdateNs();
+	std::vector<size_t> counts = settings.triangleCounts;
+	std::sort(counts.begin(), counts.end());
+	std::vector<LoadRun> runs;
+	bool succeeded = true;
+	for (MeshGenerator::Shape shape : settings.shapes)
+	{
+		const size_t firstRun = runs.size();
+		for (size_t count : counts)
+		{
+			LoadRun run;
+			run.shape = shape;
+			run.requestedTriangles = count;
+			const QString filePath = directory.filePath(QString("%1-%2.obj").arg(MeshGenerator::shapeName(shape), sizeLabel(count)));
+			const auto start = std::chrono::steady_clock::now();
+			if (!MeshGenerator::writeObj(filePath, shape, count, 1, &run.file))
+			{
+				succeeded = false;
+				break;
+			}
+			run.generateMs = elapsedMs(start);
+
+			bool loaded = true;
+			for (int repeat = 0; loaded && repeat < std::max(settings.repeats, 1); ++repeat)
+			{
+				run.readMs = std::min(run.readMs, timeReadMs(filePath));
+				loaded = measureLoad(filePath, settings, run);
+			}
+			if (!settings.keepFiles)
+			{
+				QFile::remove(filePath);
+			}
+			if (!loaded)
+			{
+				succeeded = false;
+				break;
+			}
+			runs.push_back(run);
+			logRun(run, runs[firstRun]);
+		}
+	}
+
+	if (!settings.jsonPath.isEmpty())
+	{
+		succeeded = writeJson(settings.jsonPath, settings, cameraNs, runs) && succeeded;
+	}
+	return succeeded;
+}
\ No newline at end of file
@@ -0,0 +1,43 @@
+// Builds the default LOD chain of a loaded model at doubling thread counts
+
+#include "LodBenchmark.h"
+#include "MeshSimplifier.h"
+#include "Model.h"
+#include "Parallel.h"
+#include <QDebug>
+#include <algorithm>
+#include <chrono>
+
+bool runLodBenchmark(const QString& filePath, unsigned int maxThreads)
+{
+	Model model;
+	if (!model.loadFromFile(filePath) || model.getIndices().empty())
+	{
+		qCritical() << "Cannot load" << filePath << "for the LOD report";
+		return false;
+	}
+
+	// The chain is the same at every thread count, only the time changes
+	const unsigned int threadLimit = Parallel::resolveThreadCount(maxThreads);
+	LodChain chain;
+	for (unsigned int threads = 1;; threads = std::min(threads * 2, threadLimit))
+	{
+		const auto start = std::chrono::steady_clock::now();
+		MeshSimplifier::buildLodChain(model.getVertices(), model.getIndices(), MeshSimplifier::defaultLodRatios, chain, threads);
+		const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		qInfo().nospace() << threads << " threads: " << seconds << " s (" << model.getIndices().size() / 3 / seconds / 1.0e6 << " M triangles/s)";
+		if (threads == threadLimit)
+		{
+			break;
+		}
+	}
+
+	const MeshBounds& bounds = model.getBounds();
+	qInfo().nospace() << "LOD chain for " << filePath << ": " << model.getIndices().size() / 3 << " triangles, radius " << bounds.radius;
+	for (const LodLevel& level : chain.levels)
+	{
+		qInfo().nospace() << "  " << level.ratio * 100.0f << "%: " << level.indexCount / 3 << " triangles, error " << level.error
+			<< " (" << (bounds.radius > 0.0f ? level.error / bounds.radius * 100.0f : 0.0f) << "% of radius)";
+	}
+	return true;
+}
\ No newline at end of file
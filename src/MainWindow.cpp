@@ -1,21 +1,60 @@
 // Basic UI layout
 
 #include <QMenuBar>
+#include <QStatusBar>
 #include <QFileDialog>
+#include <QFileInfo>
+#include <QFileSystemWatcher>
+#include <QTimer>
 #include "MainWindow.h"
 #include "D3D12Viewport.h"
 #include "Model.h"
+#include "ModelLoader.h"
+#include "MeshCache.h"
+#include "Trace.h"
 #include <QVBoxLayout>
 
 MainWindow::MainWindow(QWidget* parent) : QMainWindow(parent)
 {
 	setWindowTitle("Simple 3D Object Viewer");
+	meshCache = new MeshCache();
+	model = std::make_shared<Model>();
+	loadSettings = std::make_unique<Model>();
+	loadSettings->setMeshCache(meshCache);
 	
 	QMenuBar* menuBar = new QMenuBar(this);
 	setMenuBar(menuBar);
 	QMenu* fileMenu = menuBar->addMenu("File");
 	QAction* openAction = fileMenu->addAction("Open");
 	connect(openAction, &QAction::triggered, this, &MainWindow::openFile);
+	QAction* clearCacheAction = fileMenu->addAction("Clear Mesh Cache");
+	connect(clearCacheAction, &QAction::triggered, this, &MainWindow::clearMeshCache);
+	QAction* optimizeAction = fileMenu->addAction("Optimize Vertex Order on Load");
+	optimizeAction->setCheckable(true);
+	connect(optimizeAction, &QAction::toggled, this, [this](bool enabled) { loadSettings->setOptimizeOnLoad(enabled); });
+	QAction* lodAction = fileMenu->addAction("Build LOD Chain on Load");
+	lodAction->setCheckable(true);
+	connect(lodAction, &QAction::toggled, this, [this](bool enabled) { loadSettings->setLodChainOnLoad(enabled); });
+	QAction* smoothStlAction = fileMenu->addAction("Weld and Smooth STL Normals");
+	smoothStlAction->setCheckable(true);
+	smoothStlAction->setChecked(true);
+	connect(smoothStlAction, &QAction::toggled, this, [this](bool enabled) { loadSettings->setStlSmoothing(enabled); });
+	QAction* outOfCoreAction = fileMenu->addAction("Out-of-Core Loading for .stl, .ply and .obj");
+	outOfCoreAction->setCheckable(true);
+	connect(outOfCoreAction, &QAction::toggled, this, [this](bool enabled)
+	{
+		// The memory budget comes from SIMPLE3DVIEWER_MEMORY_BUDGET_MB, 4 GB when unset
+		bool ok = false;
+		const int megabytes = qEnvironmentVariableIntValue("SIMPLE3DVIEWER_MEMORY_BUDGET_MB", &ok);
+		loadSettings->setOutOfCoreBudget(enabled ? size_t(ok && megabytes > 0 ? megabytes : 4096) * 1024 * 1024 : 0);
+	});
+	QAction* compactAction = fileMenu->addAction("Compact Vertex Format");
+	compactAction->setCheckable(true);
+	compactAction->setChecked(true);
+	connect(compactAction, &QAction::toggled, this, &MainWindow::setCompactVertices);
+	QAction* watchAction = fileMenu->addAction("Watch File for Changes");
+	watchAction->setCheckable(true);
+	connect(watchAction, &QAction::toggled, this, &MainWindow::setWatchFile);
 
 	resize(800, 600);
 	viewport = new D3D12Viewport(this);
@@ -28,25 +67,140 @@ MainWindow::MainWindow(QWidget* parent) : QMainWindow(parent)
 	layout->addWidget(wireframeButton);
 	setCentralWidget(centralWidget);
 	connect(wireframeButton, &QPushButton::clicked, this, &MainWindow::toggleWireframe);
+	connect(viewport, &D3D12Viewport::trianglePicked, this, [this](unsigned int node, unsigned int triangle, unsigned int vertex, const QVector3D& point)
+	{
+		statusBar()->showMessage(QString("Node %1, triangle %2, vertex %3 at (%4, %5, %6)").arg(node).arg(triangle).arg(vertex).arg(point.x()).arg(point.y()).arg(point.z()));
+	});
 
-	model = new Model();
+	// Loads run in the background, the current model stays on screen and interactive until the new one is swapped in
+	loader = new ModelLoader(this);
+	loader->setMeshBufferAllocator(viewport->getMeshBufferAllocator()); // Packs into the buffers the viewport then binds
+	loadProgress = new QProgressBar(this);
+	loadProgress->setRange(0, 100);
+	loadProgress->setMaximumWidth(200);
+	loadProgress->hide();
+	cancelLoadButton = new QPushButton("Cancel", this);
+	cancelLoadButton->hide();
+	statusBar()->addPermanentWidget(loadProgress);
+	statusBar()->addPermanentWidget(cancelLoadButton);
+	connect(cancelLoadButton, &QPushButton::clicked, loader, &ModelLoader::cancel);
+	connect(loader, &ModelLoader::progress, this, [this](const QString& stage, int percent)
+	{
+		loadProgress->setValue(percent);
+		loadProgress->setFormat(stage + " %p%");
+	});
+	connect(loader, &ModelLoader::finished, this, &MainWindow::modelLoaded);
+	connect(loader, &ModelLoader::appended, this, [this](const QString& filePath)
+	{
+		TRACE_ZONE("MainWindow::appended");
+		const size_t triangles = model->getIndices().size() / 3;
+		PackedAppend packed = loader->takePackedAppend();
+		if (model->appendText(loader->takeAppendedText()))
+		{
+			if (!viewport->appendPackedModel(model.get(), std::move(packed)))
+			{
+				viewport->loadModel(model); // The buffers were replaced since the append was packed
+			}
+			statusBar()->showMessage(QString("Appended %1 triangles from %2").arg(model->getIndices().size() / 3 - triangles).arg(QFileInfo(filePath).fileName()), 5000);
+		}
+	});
+	connect(loader, &ModelLoader::failed, this, [this](const QString& filePath)
+	{
+		showLoadProgress(false);
+		statusBar()->showMessage("Could not load " + QFileInfo(filePath).fileName());
+	});
+	connect(loader, &ModelLoader::canceled, this, [this](const QString& filePath)
+	{
+		showLoadProgress(false);
+		statusBar()->showMessage("Canceled loading " + QFileInfo(filePath).fileName());
+	});
+
+	// Change notifications come from the platform's file monitor (inotify on Linux)
+	watcher = new QFileSystemWatcher(this);
+	reloadTimer = new QTimer(this);
+	reloadTimer->setSingleShot(true);
+	reloadTimer->setInterval(250);
+	connect(watcher, &QFileSystemWatcher::fileChanged, reloadTimer, qOverload<>(&QTimer::start));
+	connect(reloadTimer, &QTimer::timeout, this, &MainWindow::reloadModel);
 }
 
 MainWindow::~MainWindow() {}
 
 void MainWindow::openFile()
 {
-	QString filePath = QFileDialog::getOpenFileName(this, "Open 3D Model", "", "3D Models (*.obj *.fbx *.gltf)");
+	QString filePath = QFileDialog::getOpenFileName(this, "Open 3D Model", "", "3D Models (*.obj *.glb *.gltf *.ply *.stl)");
 	if (!filePath.isEmpty())
 	{
-		if (model->loadFromFile(filePath))
-		{
-			viewport->loadModel(model);
-			viewport->update(); // Placeholder to trigger a redraw
-		}
+		loader->load(filePath, *loadSettings, viewport->getCompactVertices());
+		statusBar()->showMessage("Loading " + QFileInfo(filePath).fileName());
+		showLoadProgress(true);
+	}
+}
+
+void MainWindow::modelLoaded(const QString& filePath)
+{
+	TRACE_ZONE("MainWindow::modelLoaded");
+	showLoadProgress(false);
+	model = loader->takeModel(); // The viewport's scene keeps sharing the model until the next load replaces it
+	viewport->loadPackedScene(loader->takeScene(), loader->takePackedMeshes());
+	statusBar()->showMessage("Loaded " + QFileInfo(filePath).fileName(), 5000);
+	modelPath = filePath;
+	watchModelFile();
+}
+
+void MainWindow::setWatchFile(bool enabled)
+{
+	loadSettings->setIncrementalReload(enabled); // Takes effect with the next load, the first change reloads in full
+	watchModelFile();
+}
+
+void MainWindow::watchModelFile()
+{
+	if (!watcher->files().isEmpty())
+	{
+		watcher->removePaths(watcher->files());
+	}
+	if (loadSettings->getIncrementalReload() && !modelPath.isEmpty())
+	{
+		watcher->addPath(modelPath);
 	}
 }
 
+void MainWindow::reloadModel()
+{
+	if (modelPath.isEmpty() || !loadSettings->getIncrementalReload())
+	{
+		return;
+	}
+	// Editors that save by replacing the file end the watch on the old one
+	if (!watcher->files().contains(modelPath))
+	{
+		watcher->addPath(modelPath);
+	}
+	if (!loader->reload(modelPath, model, *loadSettings, viewport->getCompactVertices(), viewport->getAppendCapacity(model.get())))
+	{
+		reloadTimer->start(); // Try again once the running load is done
+	}
+}
+
+void MainWindow::showLoadProgress(bool visible)
+{
+	loadProgress->setValue(0);
+	loadProgress->setFormat("%p%");
+	loadProgress->setVisible(visible);
+	cancelLoadButton->setVisible(visible);
+}
+
+void MainWindow::clearMeshCache()
+{
+	meshCache->clear();
+}
+
+void MainWindow::setCompactVertices(bool enabled)
+{
+	viewport->setCompactVertices(enabled); // Re-uploads the loaded meshes in the new format
+}
+
 void MainWindow::toggleWireframe()
 {
 	viewport->toggleWireframe();
@@ -0,0 +1,400 @@
+// Writes finished meshes as header + aligned raw arrays and maps them back without any decoding
+
+#include "MeshCache.h"
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QFileInfo>
+#include <QStandardPaths>
+#include <QTemporaryFile>
+#include <QDebug>
+#include <cstring>
+
+namespace
+{
+	constexpr char cacheMagic[8] = { 'S', '3', 'D', 'M', 'E', 'S', 'H', '\0' };
+	constexpr uint32_t cacheVersion = 5;
+	constexpr qint64 arrayAlignment = 64; // Every array starts on a cache line
+	constexpr qint64 sampleBlockSize = 64 * 1024;
+	constexpr int sampleBlockCount = 16;
+	constexpr qint64 defaultSizeLimit = 8ll * 1024 * 1024 * 1024;
+
+	// Fixed-size header at the start of every cache file, the component streams and indices follow at the recorded offsets
+	struct CacheHeader
+	{
+		char magic[8];
+		uint32_t version;
+		uint32_t headerSize;
+		int64_t sourceSize;
+		int64_t sourceModified;
+		uint8_t contentHash[20];
+		uint8_t pathHash[20];
+		uint64_t vertexCount;
+		uint64_t normalCount;
+		uint64_t texcoordCount;
+		uint64_t indexCount;
+		uint64_t vertexOffset[3];
+		uint64_t normalOffset[3];
+		uint64_t texcoordOffset[2];
+		uint64_t indexOffset;
+		uint64_t lodLevelCount;
+		uint64_t lodLevelOffset;
+		uint64_t lodIndexCount;
+		uint64_t lodIndexOffset;
+		float boundsMin[3];
+		float boundsMax[3];
+		float boundsCenter[3];
+		float boundsRadius;
+	};
+
+	qint64 alignUp(qint64 value)
+	{
+		return (value + arrayAlignment - 1) & ~(arrayAlignment - 1);
+	}
+
+	QString normalizedPath(const QString& path)
+	{
+		QFileInfo info(path);
+		QString canonical = info.canonicalFilePath();
+		return canonical.isEmpty() ? info.absoluteFilePath() : canonical;
+	}
+
+	QByteArray pathHash(const QString& path)
+	{
+		return QCryptographicHash::hash(path.toUtf8(), QCryptographicHash::Sha1);
+	}
+
+	// Hash of evenly spaced blocks (or the whole file when small) so keying a multi-GB file stays cheap
+	bool hashContent(QFile& file, QByteArray& hash)
+	{
+		QCryptographicHash hasher(QCryptographicHash::Sha1);
+		const qint64 size = file.size();
+		if (size <= sampleBlockSize * sampleBlockCount)
+		{
+			if (!hasher.addData(&file))
+			{
+				return false;
+			}
+		}
+		else
+		{
+			const qint64 stride = (size - sampleBlockSize) / (sampleBlockCount - 1);
+			for (int i = 0; i < sampleBlockCount; ++i)
+			{
+				if (!file.seek(i * stride))
+				{
+					return false;
+				}
+				hasher.addData(file.read(sampleBlockSize));
+			}
+		}
+		hash = hasher.result();
+		return true;
+	}
+
+	bool readHeader(QFile& file, CacheHeader& header)
+	{
+		return file.read(reinterpret_cast<char*>(&header), sizeof(header)) == sizeof(header)
+			&& std::memcmp(header.magic, cacheMagic, sizeof(cacheMagic)) == 0
+			&& header.version == cacheVersion
+			&& header.headerSize == sizeof(CacheHeader);
+	}
+
+	bool writeArray(QFile& file, qint64 offset, const void* data, qint64 bytes)
+	{
+		return file.seek(offset) && (bytes == 0 || file.write(static_cast<const char*>(data), bytes) == bytes);
+	}
+
+	// Lay streamCount streams out one after another from offset, returns the end of the last one
+	uint64_t layoutStreams(uint64_t offset, size_t count, uint64_t* streamOffsets, int streamCount)
+	{
+		for (int i = 0; i < streamCount; ++i)
+		{
+			streamOffsets[i] = offset;
+			offset = alignUp(offset + count * sizeof(float));
+		}
+		return offset;
+	}
+
+	bool writeStreams(QFile& file, const uint64_t streamOffsets[3], Vec3Streams streams)
+	{
+		const qint64 bytes = streams.count * sizeof(float);
+		return writeArray(file, streamOffsets[0], streams.x, bytes)
+			&& writeArray(file, streamOffsets[1], streams.y, bytes)
+			&& writeArray(file, streamOffsets[2], streams.z, bytes);
+	}
+
+	bool writeStreams(QFile& file, const uint64_t streamOffsets[2], Vec2Streams streams)
+	{
+		const qint64 bytes = streams.count * sizeof(float);
+		return writeArray(file, streamOffsets[0], streams.x, bytes)
+			&& writeArray(file, streamOffsets[1], streams.y, bytes);
+	}
+
+	QVector3D toVector(const float values[3])
+	{
+		return QVector3D(values[0], values[1], values[2]);
+	}
+}
+
+CachedMesh::~CachedMesh()
+{
+	if (mapped)
+	{
+		file.unmap(mapped);
+	}
+}
+
+MeshCache::MeshCache(const QString& directory) : directory(directory), sizeLimit(defaultSizeLimit)
+{
+	if (this->directory.isEmpty())
+	{
+		this->directory = QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/meshes";
+	}
+	QDir().mkpath(this->directory);
+}
+
+void MeshCache::setSizeLimit(qint64 bytes)
+{
+	sizeLimit = bytes;
+	evictToLimit();
+}
+qint64 MeshCache::getSizeLimit() const
+{
+	return sizeLimit;
+}
+const QString& MeshCache::getDirectory() const
+{
+	return directory;
+}
+
+bool MeshCache::makeKey(const QString& sourcePath, Key& key, const QByteArray& variant)
+{
+	QFileInfo info(sourcePath);
+	QFile file(sourcePath);
+	if (!info.exists() || !file.open(QIODevice::ReadOnly))
+	{
+		return false;
+	}
+
+	key.sourcePath = normalizedPath(sourcePath);
+	key.sourceSize = info.size();
+	key.sourceModified = info.lastModified().toMSecsSinceEpoch();
+	if (!hashContent(file, key.contentHash))
+	{
+		return false;
+	}
+
+	QCryptographicHash digest(QCryptographicHash::Sha1);
+	digest.addData(key.sourcePath.toUtf8());
+	digest.addData(QByteArray::number(key.sourceSize));
+	digest.addData(QByteArray::number(key.sourceModified));
+	digest.addData(key.contentHash);
+	digest.addData(variant);
+	key.digest = digest.result();
+	return true;
+}
+
+QString MeshCache::entryPath(const Key& key) const
+{
+	return directory + "/" + QString::fromLatin1(key.digest.toHex()) + ".mesh";
+}
+
+std::shared_ptr<const CachedMesh> MeshCache::load(const Key& key) const
+{
+	auto mesh = std::make_shared<CachedMesh>();
+	mesh->file.setFileName(entryPath(key));
+	if (!mesh->file.open(QIODevice::ReadOnly))
+	{
+		return nullptr;
+	}
+
+	CacheHeader header;
+	if (!readHeader(mesh->file, header)
+		|| header.sourceSize != key.sourceSize
+		|| header.sourceModified != key.sourceModified
+		|| QByteArray(reinterpret_cast<const char*>(header.contentHash), sizeof(header.contentHash)) != key.contentHash)
+	{
+		return nullptr;
+	}
+
+	// Reject truncated files before handing out pointers into them
+	const uint64_t fileSize = static_cast<uint64_t>(mesh->file.size());
+	auto fits = [fileSize](uint64_t offset, uint64_t count, uint64_t elementSize)
+	{
+		return offset % arrayAlignment == 0 && offset <= fileSize && count <= (fileSize - offset) / elementSize;
+	};
+	bool valid = fits(header.indexOffset, header.indexCount, sizeof(unsigned int))
+		&& fits(header.lodLevelOffset, header.lodLevelCount, sizeof(LodLevel))
+		&& fits(header.lodIndexOffset, header.lodIndexCount, sizeof(unsigned int));
+	for (int i = 0; i < 3; ++i)
+	{
+		valid = valid && fits(header.vertexOffset[i], header.vertexCount, sizeof(float)) && fits(header.normalOffset[i], header.normalCount, sizeof(float));
+	}
+	for (int i = 0; i < 2; ++i)
+	{
+		valid = valid && fits(header.texcoordOffset[i], header.texcoordCount, sizeof(float));
+	}
+	if (!valid)
+	{
+		qWarning() << "Discarding corrupt mesh cache entry" << mesh->file.fileName();
+		return nullptr;
+	}
+
+	mesh->mapped = mesh->file.map(0, mesh->file.size());
+	if (!mesh->mapped)
+	{
+		return nullptr;
+	}
+	auto stream = [&mesh](uint64_t offset) { return reinterpret_cast<const float*>(mesh->mapped + offset); };
+	mesh->vertices = { stream(header.vertexOffset[0]), stream(header.vertexOffset[1]), stream(header.vertexOffset[2]), header.vertexCount };
+	mesh->normals = { stream(header.normalOffset[0]), stream(header.normalOffset[1]), stream(header.normalOffset[2]), header.normalCount };
+	mesh->texcoords = { stream(header.texcoordOffset[0]), stream(header.texcoordOffset[1]), header.texcoordCount };
+	mesh->indices = { reinterpret_cast<const unsigned int*>(mesh->mapped + header.indexOffset), header.indexCount };
+	mesh->lods.levels = { reinterpret_cast<const LodLevel*>(mesh->mapped + header.lodLevelOffset), header.lodLevelCount };
+	mesh->lods.indices = { reinterpret_cast<const unsigned int*>(mesh->mapped + header.lodIndexOffset), header.lodIndexCount };
+	for (const LodLevel& level : mesh->lods.levels)
+	{
+		if (uint64_t(level.firstIndex) + level.indexCount > header.lodIndexCount)
+		{
+			qWarning() << "Discarding corrupt mesh cache entry" << mesh->file.fileName();
+			return nullptr;
+		}
+	}
+	mesh->bounds.min = toVector(header.boundsMin);
+	mesh->bounds.max = toVector(header.boundsMax);
+	mesh->bounds.center = toVector(header.boundsCenter);
+	mesh->bounds.radius = header.boundsRadius;
+
+	// Bump the modification time so eviction sees this entry as recently used
+	QFile touch(mesh->file.fileName());
+	if (touch.open(QIODevice::ReadWrite))
+	{
+		touch.setFileTime(QDateTime::currentDateTimeUtc(), QFileDevice::FileModificationTime);
+	}
+	return mesh;
+}
+
+bool MeshCache::store(const Key& key, Vec3Streams vertices, Vec3Streams normals, Vec2Streams texcoords, std::span<const unsigned int> indices, const MeshBounds& bounds, LodChainView lods)
+{
+	CacheHeader header = {};
+	std::memcpy(header.magic, cacheMagic, sizeof(cacheMagic));
+	header.version = cacheVersion;
+	header.headerSize = sizeof(CacheHeader);
+	header.sourceSize = key.sourceSize;
+	header.sourceModified = key.sourceModified;
+	std::memcpy(header.contentHash, key.contentHash.constData(), std::min<size_t>(key.contentHash.size(), sizeof(header.contentHash)));
+	QByteArray sourceHash = pathHash(key.sourcePath);
+	std::memcpy(header.pathHash, sourceHash.constData(), sizeof(header.pathHash));
+	header.vertexCount = vertices.size();
+	header.normalCount = normals.size();
+	header.texcoordCount = texcoords.size();
+	header.indexCount = indices.size();
+	const uint64_t normalStart = layoutStreams(alignUp(sizeof(CacheHeader)), vertices.size(), header.vertexOffset, 3);
+	const uint64_t texcoordStart = layoutStreams(normalStart, normals.size(), header.normalOffset, 3);
+	header.indexOffset = layoutStreams(texcoordStart, texcoords.size(), header.texcoordOffset, 2);
+	header.lodLevelCount = lods.levels.size();
+	header.lodLevelOffset = alignUp(header.indexOffset + indices.size_bytes());
+	header.lodIndexCount = lods.indices.size();
+	header.lodIndexOffset = alignUp(header.lodLevelOffset + lods.levels.size_bytes());
+	for (int i = 0; i < 3; ++i)
+	{
+		header.boundsMin[i] = bounds.min[i];
+		header.boundsMax[i] = bounds.max[i];
+		header.boundsCenter[i] = bounds.center[i];
+	}
+	header.boundsRadius = bounds.radius;
+
+	// Write under a unique temporary name next to the entry, so a crash never leaves a half-written entry behind the real
+	// name and two loads of the same source never write into the same file. The file is removed again unless renamed.
+	const QString finalPath = entryPath(key);
+	QTemporaryFile file(finalPath + ".XXXXXX.tmp");
+	if (!file.open())
+	{
+		qWarning() << "Cannot write mesh cache entry" << finalPath << file.errorString();
+		return false;
+	}
+	const QString tempPath = file.fileName();
+	bool written = file.resize(alignUp(header.lodIndexOffset + lods.indices.size_bytes()))
+		&& writeArray(file, 0, &header, sizeof(header))
+		&& writeStreams(file, header.vertexOffset, vertices)
+		&& writeStreams(file, header.normalOffset, normals)
+		&& writeStreams(file, header.texcoordOffset, texcoords)
+		&& writeArray(file, header.indexOffset, indices.data(), indices.size_bytes())
+		&& writeArray(file, header.lodLevelOffset, lods.levels.data(), lods.levels.size_bytes())
+		&& writeArray(file, header.lodIndexOffset, lods.indices.data(), lods.indices.size_bytes());
+	file.close();
+
+	// An entry already under the name is one load() rejected as stale or corrupt, or a racing writer's, and is replaced:
+	// the last writer wins. Between the remove and the rename there is no entry, a load() then misses and parses the
+	// source. An entry still mapped cannot be removed on Windows, this store then fails and the mapped entry stays.
+	if (!written || (QFile::exists(finalPath) && !QFile::remove(finalPath)) || !QFile::rename(tempPath, finalPath))
+	{
+		return false;
+	}
+
+	evictToLimit();
+	return true;
+}
+
+void MeshCache::invalidate(const QString& sourcePath)
+{
+	const QByteArray sourceHash = pathHash(normalizedPath(sourcePath));
+	const QFileInfoList entries = QDir(directory).entryInfoList({ "*.mesh" }, QDir::Files);
+	for (const QFileInfo& entry : entries)
+	{
+		QFile file(entry.absoluteFilePath());
+		CacheHeader header;
+		if (!file.open(QIODevice::ReadOnly) || !readHeader(file, header))
+		{
+			continue;
+		}
+		file.close();
+		if (QByteArray(reinterpret_cast<const char*>(header.pathHash), sizeof(header.pathHash)) == sourceHash)
+		{
+			QFile::remove(entry.absoluteFilePath());
+		}
+	}
+}
+
+void MeshCache::clear()
+{
+	const QFileInfoList entries = QDir(directory).entryInfoList({ "*.mesh", "*.tmp" }, QDir::Files);
+	for (const QFileInfo& entry : entries)
+	{
+		QFile::remove(entry.absoluteFilePath()); // Entries still mapped by a live model stay until it is released
+	}
+}
+
+qint64 MeshCache::totalSize() const
+{
+	qint64 total = 0;
+	const QFileInfoList entries = QDir(directory).entryInfoList({ "*.mesh" }, QDir::Files);
+	for (const QFileInfo& entry : entries)
+	{
+		total += entry.size();
+	}
+	return total;
+}
+
+// Remove least recently used entries (oldest modification time) until the cache fits the limit
+void MeshCache::evictToLimit()
+{
+	const QFileInfoList entries = QDir(directory).entryInfoList({ "*.mesh" }, QDir::Files, QDir::Time | QDir::Reversed);
+	qint64 total = 0;
+	for (const QFileInfo& entry : entries)
+	{
+		total += entry.size();
+	}
+	for (const QFileInfo& entry : entries)
+	{
+		if (total <= sizeLimit)
+		{
+			break;
+		}
+		if (QFile::remove(entry.absoluteFilePath()))
+		{
+			total -= entry.size();
+		}
+	}
+}
\ No newline at end of file
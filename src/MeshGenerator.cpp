@@ -0,0 +1,360 @@
+// Procedural .obj writer: grids, spheres, noisy scans and n-gon-heavy CAD parts streamed to disk
+
+#include "MeshGenerator.h"
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <numbers>
+#include <numeric>
+#include <random>
+#include <vector>
+#include <QDebug>
+#include <QFile>
+
+namespace
+{
+	constexpr size_t flushBytes = 4 << 20;
+	constexpr int cadSides[] = { 6, 8, 12, 16, 24, 32 }; // Cycled through by the CAD prisms
+
+	// Appends records to a block buffer and writes it out whenever it grows past flushBytes
+	class ObjWriter
+	{
+	public:
+		ObjWriter(QFile& file, MeshGenerator::Stats& stats) : file(file), stats(stats)
+		{
+			buffer.reserve(flushBytes + 4096);
+		}
+
+		// fixedPoint writes six decimals like most CAD exporters, otherwise the shortest text that round-trips
+		void vertex(float x, float y, float z, bool fixedPoint = false)
+		{
+			append("v");
+			number(x, fixedPoint);
+			number(y, fixedPoint);
+			number(z, fixedPoint);
+			endLine();
+			++stats.vertices;
+		}
+		void texcoord(float u, float v)
+		{
+			append("vt");
+			number(u, false);
+			number(v, false);
+			endLine();
+		}
+		void normal(float x, float y, float z)
+		{
+			append("vn");
+			number(x, false);
+			number(y, false);
+			number(z, false);
+			endLine();
+		}
+		// Corners are 1-based or negative (relative), withAttributes repeats each index as v/vt/vn
+		void face(std::initializer_list<long long> corners, bool withAttributes = false)
+		{
+			face(corners.begin(), corners.size(), withAttributes);
+		}
+		void face(const long long* corners, size_t count, bool withAttributes = false)
+		{
+			append("f");
+			for (size_t i = 0; i < count; ++i)
+			{
+				buffer.push_back(' ');
+				integer(corners[i]);
+				if (withAttributes)
+				{
+					buffer.push_back('/');
+					integer(corners[i]);
+					buffer.push_back('/');
+					integer(corners[i]);
+				}
+			}
+			endLine();
+			++stats.faces;
+			stats.triangles += count >= 3 ? count - 2 : 0;
+		}
+		void line(const char* text)
+		{
+			append(text);
+			endLine();
+		}
+
+		bool finish()
+		{
+			flush();
+			return ok;
+		}
+
+	private:
+		void append(const char* text)
+		{
+			while (*text)
+			{
+				buffer.push_back(*text++);
+			}
+		}
+		void number(float value, bool fixedPoint)
+		{
+			char text[64];
+			text[0] = ' ';
+			const auto result = fixedPoint ? std::to_chars(text + 1, text + sizeof(text), value, std::chars_format::fixed, 6)
+				: std::to_chars(text + 1, text + sizeof(text), value);
+			buffer.insert(buffer.end(), text, result.ptr);
+		}
+		void integer(long long value)
+		{
+			char text[24];
+			const auto result = std::to_chars(text, text + sizeof(text), value);
+			buffer.insert(buffer.end(), text, result.ptr);
+		}
+		void endLine()
+		{
+			buffer.push_back('\n');
+			if (buffer.size() >= flushBytes)
+			{
+				flush();
+			}
+		}
+		void flush()
+		{
+			if (ok && !buffer.empty() && file.write(buffer.data(), static_cast<qint64>(buffer.size())) != static_cast<qint64>(buffer.size()))
+			{
+				ok = false;
+			}
+			stats.bytes += static_cast<qint64>(buffer.size());
+			buffer.clear();
+		}
+
+		QFile& file;
+		MeshGenerator::Stats& stats;
+		std::vector<char> buffer;
+		bool ok = true;
+	};
+
+	// Portable uniform value in [-1, 1), std::uniform_real_distribution differs between standard libraries
+	float signedUnit(std::mt19937& random)
+	{
+		return static_cast<float>(random() >> 8) * (2.0f / 16777216.0f) - 1.0f;
+	}
+
+	float gridHeight(float x, float z)
+	{
+		return 0.05f * std::sin(x * 40.0f) * std::cos(z * 40.0f);
+	}
+
+	size_t gridSide(size_t triangleCount)
+	{
+		return std::max<size_t>(1, static_cast<size_t>(std::lround(std::sqrt(triangleCount / 2.0))));
+	}
+
+	// Two triangles per cell of a side x side height field, row by row
+	void writeGridFaces(ObjWriter& writer, size_t side, size_t row)
+	{
+		for (size_t column = 0; column < side; ++column)
+		{
+			const long long corner = static_cast<long long>(row * (side + 1) + column) + 1;
+			const long long below = corner + static_cast<long long>(side + 1);
+			writer.face({ corner, below, corner + 1 });
+			writer.face({ corner + 1, below, below + 1 });
+		}
+	}
+
+	void writeGrid(ObjWriter& writer, size_t triangleCount)
+	{
+		const size_t side = gridSide(triangleCount);
+		for (size_t row = 0; row <= side; ++row)
+		{
+			for (size_t column = 0; column <= side; ++column)
+			{
+				const float x = static_cast<float>(column) / side;
+				const float z = static_cast<float>(row) / side;
+				writer.vertex(x, gridHeight(x, z), z);
+			}
+		}
+		for (size_t row = 0; row < side; ++row)
+		{
+			writeGridFaces(writer, side, row);
+		}
+	}
+
+	// Rings x (2 * rings) segments, single triangles at the poles. Every corner shares one index for v, vt and vn.
+	void writeSphere(ObjWriter& writer, size_t triangleCount)
+	{
+		const size_t rings = std::max<size_t>(2, static_cast<size_t>(std::lround(std::sqrt(triangleCount / 4.0))));
+		const size_t segments = rings * 2;
+		for (size_t ring = 0; ring <= rings; ++ring)
+		{
+			const float v = static_cast<float>(ring) / rings;
+			const float polar = v * std::numbers::pi_v<float>;
+			for (size_t segment = 0; segment <= segments; ++segment)
+			{
+				const float u = static_cast<float>(segment) / segments;
+				const float azimuth = u * 2.0f * std::numbers::pi_v<float>;
+				const float x = std::sin(polar) * std::cos(azimuth);
+				const float y = std::cos(polar);
+				const float z = std::sin(polar) * std::sin(azimuth);
+				writer.vertex(x, y, z);
+				writer.texcoord(u, 1.0f - v);
+				writer.normal(x, y, z);
+			}
+		}
+		for (size_t ring = 0; ring < rings; ++ring)
+		{
+			for (size_t segment = 0; segment < segments; ++segment)
+			{
+				const long long a = static_cast<long long>(ring * (segments + 1) + segment) + 1;
+				const long long c = a + static_cast<long long>(segments + 1);
+				if (ring > 0)
+				{
+					writer.face({ a, a + 1, c + 1 }, true);
+				}
+				if (ring + 1 < rings)
+				{
+					writer.face({ a, c + 1, c }, true);
+				}
+			}
+		}
+	}
+
+	// A grid whose samples are jittered in all three axes and whose face rows come out in a scrambled order,
+	// so neither the vertex cache nor the prefetcher gets the orderly input of writeGrid
+	void writeScan(ObjWriter& writer, size_t triangleCount, std::mt19937& random)
+	{
+		const size_t side = gridSide(triangleCount);
+		const float spacing = 1.0f / side;
+		for (size_t row = 0; row <= side; ++row)
+		{
+			for (size_t column = 0; column <= side; ++column)
+			{
+				const float x = (column + 0.3f * signedUnit(random)) * spacing;
+				const float z = (row + 0.3f * signedUnit(random)) * spacing;
+				writer.vertex(x, gridHeight(x, z) + 0.002f * signedUnit(random), z);
+			}
+		}
+
+		// Visit the rows with a stride coprime to their count, every row exactly once
+		size_t stride = std::max<size_t>(1, side * 5 / 8);
+		while (std::gcd(stride, side) != 1)
+		{
+			++stride;
+		}
+		for (size_t i = 0; i < side; ++i)
+		{
+			writeGridFaces(writer, side, i * stride % side);
+		}
+	}
+
+	// One prism per part: two n-gon caps and n quad sides, 4n - 4 triangles, laid out on a square grid
+	void writeCad(ObjWriter& writer, size_t triangleCount, std::mt19937& random)
+	{
+		size_t parts = 0;
+		for (size_t triangles = 0; triangles < std::max<size_t>(triangleCount, 1); ++parts)
+		{
+			triangles += 4 * cadSides[parts % std::size(cadSides)] - 4;
+		}
+		const size_t columns = static_cast<size_t>(std::ceil(std::sqrt(static_cast<double>(parts))));
+
+		std::vector<long long> cap;
+		for (size_t part = 0; part < parts; ++part)
+		{
+			const int sides = cadSides[part % std::size(cadSides)];
+			const float centerX = 2.0f * (part % columns);
+			const float centerZ = 2.0f * (part / columns);
+			const float radius = 0.5f + 0.125f * (random() % 4);
+			const float height = 0.25f * (1 + random() % 8);
+
+			const QByteArray name = "o part_" + QByteArray::number(static_cast<qulonglong>(part));
+			writer.line(name.constData());
+			for (int level = 0; level < 2; ++level)
+			{
+				for (int i = 0; i < sides; ++i)
+				{
+					const float angle = 2.0f * std::numbers::pi_v<float> * i / sides;
+					writer.vertex(centerX + radius * std::cos(angle), level * height, centerZ + radius * std::sin(angle), true);
+				}
+			}
+
+			// Relative indices: the bottom ring starts at -2n, the top ring at -n
+			const long long bottom = -2 * sides;
+			const long long top = -sides;
+			cap.clear();
+			for (int i = sides - 1; i >= 0; --i)
+			{
+				cap.push_back(bottom + i);
+			}
+			writer.face(cap.data(), cap.size());
+			cap.clear();
+			for (int i = 0; i < sides; ++i)
+			{
+				cap.push_back(top + i);
+			}
+			writer.face(cap.data(), cap.size());
+			for (int i = 0; i < sides; ++i)
+			{
+				const int next = (i + 1) % sides;
+				writer.face({ bottom + i, top + i, top + next, bottom + next });
+			}
+		}
+	}
+}
+
+const char* MeshGenerator::shapeName(Shape shape)
+{
+	switch (shape)
+	{
+	case Shape::Grid: return "grid";
+	case Shape::Sphere: return "sphere";
+	case Shape::Scan: return "scan";
+	case Shape::Cad: return "cad";
+	}
+	return "unknown";
+}
+
+bool MeshGenerator::shapeFromName(const QString& name, Shape& shape)
+{
+	for (Shape candidate : allShapes)
+	{
+		if (name.compare(QString::fromLatin1(shapeName(candidate)), Qt::CaseInsensitive) == 0)
+		{
+			shape = candidate;
+			return true;
+		}
+	}
+	return false;
+}
+
+bool MeshGenerator::writeObj(const QString& filePath, Shape shape, size_t triangleCount, uint32_t seed, Stats* stats)
+{
+	QFile file(filePath);
+	if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+	{
+		qCritical() << "Cannot write" << filePath;
+		return false;
+	}
+
+	Stats written;
+	ObjWriter writer(file, written);
+	std::mt19937 random(seed);
+	const QByteArray header = QByteArray("# ") + shapeName(shape) + " mesh, " + QByteArray::number(static_cast<qulonglong>(triangleCount))
+		+ " triangles requested, seed " + QByteArray::number(seed);
+	writer.line(header.constData());
+	switch (shape)
+	{
+	case Shape::Grid: writeGrid(writer, triangleCount); break;
+	case Shape::Sphere: writeSphere(writer, triangleCount); break;
+	case Shape::Scan: writeScan(writer, triangleCount, random); break;
+	case Shape::Cad: writeCad(writer, triangleCount, random); break;
+	}
+
+	if (!writer.finish())
+	{
+		qCritical() << "Writing" << filePath << "failed";
+		return false;
+	}
+	if (stats)
+	{
+		*stats = written;
+	}
+	return true;
+}
\ No newline at end of file
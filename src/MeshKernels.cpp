@@ -0,0 +1,663 @@
+// Scalar, SSE2 and AVX2 versions of the bulk mesh kernels plus the runtime dispatch between them
+
+#include "MeshKernels.h"
+#include <algorithm>
+#include <atomic>
+#include <climits>
+#include <cmath>
+#include "SimdSupport.h"
+
+namespace
+{
+	// ---- Scalar reference versions, also used for the tails of the SIMD loops ----
+
+	void accumulateFaceNormalsScalar(Vec3Streams p, const unsigned int* indices, size_t begin, size_t end, float* nx, float* ny, float* nz)
+	{
+		for (size_t i = begin; i + 2 < end; i += 3)
+		{
+			const unsigned int a = indices[i];
+			const unsigned int b = indices[i + 1];
+			const unsigned int c = indices[i + 2];
+			const float e1x = p.x[b] - p.x[a], e1y = p.y[b] - p.y[a], e1z = p.z[b] - p.z[a];
+			const float e2x = p.x[c] - p.x[a], e2y = p.y[c] - p.y[a], e2z = p.z[c] - p.z[a];
+			float cx = e1y * e2z - e1z * e2y;
+			float cy = e1z * e2x - e1x * e2z;
+			float cz = e1x * e2y - e1y * e2x;
+			const float length = std::sqrt(cx * cx + cy * cy + cz * cz);
+			if (length > 0.0f)
+			{
+				cx /= length;
+				cy /= length;
+				cz /= length;
+			}
+			else
+			{
+				cx = cy = cz = 0.0f;
+			}
+			nx[a] += cx; ny[a] += cy; nz[a] += cz;
+			nx[b] += cx; ny[b] += cy; nz[b] += cz;
+			nx[c] += cx; ny[c] += cy; nz[c] += cz;
+		}
+	}
+
+	void normalizeScalar(float* x, float* y, float* z, size_t begin, size_t end)
+	{
+		for (size_t i = begin; i < end; ++i)
+		{
+			const float length = std::sqrt(x[i] * x[i] + y[i] * y[i] + z[i] * z[i]);
+			if (length > 0.0f)
+			{
+				x[i] /= length;
+				y[i] /= length;
+				z[i] /= length;
+			}
+		}
+	}
+
+	void minMaxScalar(const float* values, size_t begin, size_t end, float& low, float& high)
+	{
+		for (size_t i = begin; i < end; ++i)
+		{
+			low = std::min(low, values[i]);
+			high = std::max(high, values[i]);
+		}
+	}
+
+	float maxDistanceSquaredScalar(Vec3Streams p, const QVector3D& center, size_t begin, size_t end, float current)
+	{
+		for (size_t i = begin; i < end; ++i)
+		{
+			const float dx = p.x[i] - center.x(), dy = p.y[i] - center.y(), dz = p.z[i] - center.z();
+			current = std::max(current, dx * dx + dy * dy + dz * dz);
+		}
+		return current;
+	}
+
+	void transformScalar(float* x, float* y, float* z, size_t begin, size_t end, const float* m, float w)
+	{
+		for (size_t i = begin; i < end; ++i)
+		{
+			const float vx = x[i], vy = y[i], vz = z[i];
+			x[i] = m[0] * vx + m[4] * vy + m[8] * vz + m[12] * w;
+			y[i] = m[1] * vx + m[5] * vy + m[9] * vz + m[13] * w;
+			z[i] = m[2] * vx + m[6] * vy + m[10] * vz + m[14] * w;
+		}
+	}
+
+	void composeAffineScalar(const float* const p[12], const float* const l[12], float* const out[12], size_t begin, size_t end)
+	{
+		for (size_t i = begin; i < end; ++i)
+		{
+			float result[12];
+			for (int c = 0; c < 4; ++c)
+			{
+				for (int r = 0; r < 3; ++r)
+				{
+					result[c * 3 + r] = p[r][i] * l[c * 3][i] + p[3 + r][i] * l[c * 3 + 1][i] + p[6 + r][i] * l[c * 3 + 2][i] + (c == 3 ? p[9 + r][i] : 0.0f);
+				}
+			}
+			for (int k = 0; k < 12; ++k) // Only after every read, out may be l
+			{
+				out[k][i] = result[k];
+			}
+		}
+	}
+
+	void boundsScalar(Vec3Streams p, MeshBounds& bounds)
+	{
+		float low[3] = { p.x[0], p.y[0], p.z[0] };
+		float high[3] = { p.x[0], p.y[0], p.z[0] };
+		minMaxScalar(p.x, 0, p.count, low[0], high[0]);
+		minMaxScalar(p.y, 0, p.count, low[1], high[1]);
+		minMaxScalar(p.z, 0, p.count, low[2], high[2]);
+		bounds.min = QVector3D(low[0], low[1], low[2]);
+		bounds.max = QVector3D(high[0], high[1], high[2]);
+		bounds.center = (bounds.min + bounds.max) * 0.5f;
+		bounds.radius = std::sqrt(maxDistanceSquaredScalar(p, bounds.center, 0, p.count, 0.0f));
+	}
+
+#if MESH_KERNELS_X86
+	// ---- SSE2, four lanes. Baseline on every x64 CPU. ----
+
+	void accumulateFaceNormalsSSE2(Vec3Streams p, const unsigned int* indices, size_t indexCount, float* nx, float* ny, float* nz)
+	{
+		const size_t triangleCount = indexCount / 3;
+		const size_t blockEnd = (triangleCount / 4) * 4 * 3;
+		alignas(16) float fx[4], fy[4], fz[4];
+		for (size_t i = 0; i < blockEnd; i += 12)
+		{
+			const unsigned int* t = indices + i;
+			// No gather in SSE2, assemble the lanes from scalar loads
+			__m128 ax = _mm_setr_ps(p.x[t[0]], p.x[t[3]], p.x[t[6]], p.x[t[9]]);
+			__m128 ay = _mm_setr_ps(p.y[t[0]], p.y[t[3]], p.y[t[6]], p.y[t[9]]);
+			__m128 az = _mm_setr_ps(p.z[t[0]], p.z[t[3]], p.z[t[6]], p.z[t[9]]);
+			__m128 e1x = _mm_sub_ps(_mm_setr_ps(p.x[t[1]], p.x[t[4]], p.x[t[7]], p.x[t[10]]), ax);
+			__m128 e1y = _mm_sub_ps(_mm_setr_ps(p.y[t[1]], p.y[t[4]], p.y[t[7]], p.y[t[10]]), ay);
+			__m128 e1z = _mm_sub_ps(_mm_setr_ps(p.z[t[1]], p.z[t[4]], p.z[t[7]], p.z[t[10]]), az);
+			__m128 e2x = _mm_sub_ps(_mm_setr_ps(p.x[t[2]], p.x[t[5]], p.x[t[8]], p.x[t[11]]), ax);
+			__m128 e2y = _mm_sub_ps(_mm_setr_ps(p.y[t[2]], p.y[t[5]], p.y[t[8]], p.y[t[11]]), ay);
+			__m128 e2z = _mm_sub_ps(_mm_setr_ps(p.z[t[2]], p.z[t[5]], p.z[t[8]], p.z[t[11]]), az);
+
+			__m128 cx = _mm_sub_ps(_mm_mul_ps(e1y, e2z), _mm_mul_ps(e1z, e2y));
+			__m128 cy = _mm_sub_ps(_mm_mul_ps(e1z, e2x), _mm_mul_ps(e1x, e2z));
+			__m128 cz = _mm_sub_ps(_mm_mul_ps(e1x, e2y), _mm_mul_ps(e1y, e2x));
+			__m128 length = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(cx, cx), _mm_mul_ps(cy, cy)), _mm_mul_ps(cz, cz)));
+			__m128 valid = _mm_cmpgt_ps(length, _mm_setzero_ps());
+			_mm_store_ps(fx, _mm_and_ps(_mm_div_ps(cx, length), valid));
+			_mm_store_ps(fy, _mm_and_ps(_mm_div_ps(cy, length), valid));
+			_mm_store_ps(fz, _mm_and_ps(_mm_div_ps(cz, length), valid));
+
+			// Scatter stays scalar, lanes may hit the same vertex
+			for (int lane = 0; lane < 4; ++lane)
+			{
+				for (int corner = 0; corner < 3; ++corner)
+				{
+					const unsigned int v = t[lane * 3 + corner];
+					nx[v] += fx[lane];
+					ny[v] += fy[lane];
+					nz[v] += fz[lane];
+				}
+			}
+		}
+		accumulateFaceNormalsScalar(p, indices, blockEnd, indexCount, nx, ny, nz);
+	}
+
+	void normalizeSSE2(float* x, float* y, float* z, size_t count)
+	{
+		const size_t blockEnd = count & ~size_t(3);
+		for (size_t i = 0; i < blockEnd; i += 4)
+		{
+			__m128 vx = _mm_loadu_ps(x + i), vy = _mm_loadu_ps(y + i), vz = _mm_loadu_ps(z + i);
+			__m128 length = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(vx, vx), _mm_mul_ps(vy, vy)), _mm_mul_ps(vz, vz)));
+			__m128 valid = _mm_cmpgt_ps(length, _mm_setzero_ps());
+			__m128 scale = _mm_or_ps(_mm_and_ps(valid, length), _mm_andnot_ps(valid, _mm_set1_ps(1.0f)));
+			_mm_storeu_ps(x + i, _mm_div_ps(vx, scale));
+			_mm_storeu_ps(y + i, _mm_div_ps(vy, scale));
+			_mm_storeu_ps(z + i, _mm_div_ps(vz, scale));
+		}
+		normalizeScalar(x, y, z, blockEnd, count);
+	}
+
+	void minMaxSSE2(const float* values, size_t count, float& low, float& high)
+	{
+		const size_t blockEnd = count & ~size_t(3);
+		__m128 vlow = _mm_set1_ps(low), vhigh = _mm_set1_ps(high);
+		for (size_t i = 0; i < blockEnd; i += 4)
+		{
+			__m128 v = _mm_loadu_ps(values + i);
+			vlow = _mm_min_ps(vlow, v);
+			vhigh = _mm_max_ps(vhigh, v);
+		}
+		alignas(16) float lows[4], highs[4];
+		_mm_store_ps(lows, vlow);
+		_mm_store_ps(highs, vhigh);
+		for (int lane = 0; lane < 4; ++lane)
+		{
+			low = std::min(low, lows[lane]);
+			high = std::max(high, highs[lane]);
+		}
+		minMaxScalar(values, blockEnd, count, low, high);
+	}
+
+	void boundsSSE2(Vec3Streams p, MeshBounds& bounds)
+	{
+		float low[3] = { p.x[0], p.y[0], p.z[0] };
+		float high[3] = { p.x[0], p.y[0], p.z[0] };
+		minMaxSSE2(p.x, p.count, low[0], high[0]);
+		minMaxSSE2(p.y, p.count, low[1], high[1]);
+		minMaxSSE2(p.z, p.count, low[2], high[2]);
+		bounds.min = QVector3D(low[0], low[1], low[2]);
+		bounds.max = QVector3D(high[0], high[1], high[2]);
+		bounds.center = (bounds.min + bounds.max) * 0.5f;
+
+		const size_t blockEnd = p.count & ~size_t(3);
+		const __m128 cx = _mm_set1_ps(bounds.center.x()), cy = _mm_set1_ps(bounds.center.y()), cz = _mm_set1_ps(bounds.center.z());
+		__m128 farthest = _mm_setzero_ps();
+		for (size_t i = 0; i < blockEnd; i += 4)
+		{
+			__m128 dx = _mm_sub_ps(_mm_loadu_ps(p.x + i), cx);
+			__m128 dy = _mm_sub_ps(_mm_loadu_ps(p.y + i), cy);
+			__m128 dz = _mm_sub_ps(_mm_loadu_ps(p.z + i), cz);
+			farthest = _mm_max_ps(farthest, _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz)));
+		}
+		alignas(16) float lanes[4];
+		_mm_store_ps(lanes, farthest);
+		float distanceSquared = std::max(std::max(lanes[0], lanes[1]), std::max(lanes[2], lanes[3]));
+		bounds.radius = std::sqrt(maxDistanceSquaredScalar(p, bounds.center, blockEnd, p.count, distanceSquared));
+	}
+
+	void transformSSE2(float* x, float* y, float* z, size_t count, const float* m, float w)
+	{
+		const size_t blockEnd = count & ~size_t(3);
+		const __m128 m0 = _mm_set1_ps(m[0]), m1 = _mm_set1_ps(m[1]), m2 = _mm_set1_ps(m[2]);
+		const __m128 m4 = _mm_set1_ps(m[4]), m5 = _mm_set1_ps(m[5]), m6 = _mm_set1_ps(m[6]);
+		const __m128 m8 = _mm_set1_ps(m[8]), m9 = _mm_set1_ps(m[9]), m10 = _mm_set1_ps(m[10]);
+		const __m128 tx = _mm_set1_ps(m[12] * w), ty = _mm_set1_ps(m[13] * w), tz = _mm_set1_ps(m[14] * w);
+		for (size_t i = 0; i < blockEnd; i += 4)
+		{
+			__m128 vx = _mm_loadu_ps(x + i), vy = _mm_loadu_ps(y + i), vz = _mm_loadu_ps(z + i);
+			_mm_storeu_ps(x + i, _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(m0, vx), _mm_mul_ps(m4, vy)), _mm_mul_ps(m8, vz)), tx));
+			_mm_storeu_ps(y + i, _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(m1, vx), _mm_mul_ps(m5, vy)), _mm_mul_ps(m9, vz)), ty));
+			_mm_storeu_ps(z + i, _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(m2, vx), _mm_mul_ps(m6, vy)), _mm_mul_ps(m10, vz)), tz));
+		}
+		transformScalar(x, y, z, blockEnd, count, m, w);
+	}
+
+	void composeAffineSSE2(const float* const p[12], const float* const l[12], float* const out[12], size_t count)
+	{
+		const size_t blockEnd = count & ~size_t(3);
+		for (size_t i = 0; i < blockEnd; i += 4)
+		{
+			__m128 pm[12], lm[12];
+			for (int k = 0; k < 12; ++k)
+			{
+				pm[k] = _mm_loadu_ps(p[k] + i);
+				lm[k] = _mm_loadu_ps(l[k] + i);
+			}
+			for (int c = 0; c < 4; ++c)
+			{
+				for (int r = 0; r < 3; ++r)
+				{
+					__m128 v = _mm_add_ps(_mm_add_ps(_mm_mul_ps(pm[r], lm[c * 3]), _mm_mul_ps(pm[3 + r], lm[c * 3 + 1])), _mm_mul_ps(pm[6 + r], lm[c * 3 + 2]));
+					_mm_storeu_ps(out[c * 3 + r] + i, c == 3 ? _mm_add_ps(v, pm[9 + r]) : v);
+				}
+			}
+		}
+		composeAffineScalar(p, l, out, blockEnd, count);
+	}
+
+	// ---- AVX2, eight lanes with hardware gathers ----
+
+	MESH_KERNELS_AVX2_TARGET
+	void accumulateFaceNormalsAVX2(Vec3Streams p, const unsigned int* indices, size_t indexCount, float* nx, float* ny, float* nz)
+	{
+		const size_t triangleCount = indexCount / 3;
+		const size_t blockEnd = (triangleCount / 8) * 8 * 3;
+		const __m256i cornerStride = _mm256_setr_epi32(0, 3, 6, 9, 12, 15, 18, 21);
+		alignas(32) float fx[8], fy[8], fz[8];
+		for (size_t i = 0; i < blockEnd; i += 24)
+		{
+			const int* t = reinterpret_cast<const int*>(indices + i);
+			__m256i ia = _mm256_i32gather_epi32(t, cornerStride, 4);
+			__m256i ib = _mm256_i32gather_epi32(t + 1, cornerStride, 4);
+			__m256i ic = _mm256_i32gather_epi32(t + 2, cornerStride, 4);
+
+			__m256 ax = _mm256_i32gather_ps(p.x, ia, 4), ay = _mm256_i32gather_ps(p.y, ia, 4), az = _mm256_i32gather_ps(p.z, ia, 4);
+			__m256 e1x = _mm256_sub_ps(_mm256_i32gather_ps(p.x, ib, 4), ax);
+			__m256 e1y = _mm256_sub_ps(_mm256_i32gather_ps(p.y, ib, 4), ay);
+			__m256 e1z = _mm256_sub_ps(_mm256_i32gather_ps(p.z, ib, 4), az);
+			__m256 e2x = _mm256_sub_ps(_mm256_i32gather_ps(p.x, ic, 4), ax);
+			__m256 e2y = _mm256_sub_ps(_mm256_i32gather_ps(p.y, ic, 4), ay);
+			__m256 e2z = _mm256_sub_ps(_mm256_i32gather_ps(p.z, ic, 4), az);
+
+			__m256 cx = _mm256_sub_ps(_mm256_mul_ps(e1y, e2z), _mm256_mul_ps(e1z, e2y));
+			__m256 cy = _mm256_sub_ps(_mm256_mul_ps(e1z, e2x), _mm256_mul_ps(e1x, e2z));
+			__m256 cz = _mm256_sub_ps(_mm256_mul_ps(e1x, e2y), _mm256_mul_ps(e1y, e2x));
+			__m256 length = _mm256_sqrt_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(cx, cx), _mm256_mul_ps(cy, cy)), _mm256_mul_ps(cz, cz)));
+			__m256 valid = _mm256_cmp_ps(length, _mm256_setzero_ps(), _CMP_GT_OQ);
+			_mm256_store_ps(fx, _mm256_and_ps(_mm256_div_ps(cx, length), valid));
+			_mm256_store_ps(fy, _mm256_and_ps(_mm256_div_ps(cy, length), valid));
+			_mm256_store_ps(fz, _mm256_and_ps(_mm256_div_ps(cz, length), valid));
+
+			const unsigned int* corners = indices + i;
+			for (int lane = 0; lane < 8; ++lane)
+			{
+				for (int corner = 0; corner < 3; ++corner)
+				{
+					const unsigned int v = corners[lane * 3 + corner];
+					nx[v] += fx[lane];
+					ny[v] += fy[lane];
+					nz[v] += fz[lane];
+				}
+			}
+		}
+		accumulateFaceNormalsScalar(p, indices, blockEnd, indexCount, nx, ny, nz);
+	}
+
+	MESH_KERNELS_AVX2_TARGET
+	void normalizeAVX2(float* x, float* y, float* z, size_t count)
+	{
+		const size_t blockEnd = count & ~size_t(7);
+		const __m256 one = _mm256_set1_ps(1.0f);
+		for (size_t i = 0; i < blockEnd; i += 8)
+		{
+			__m256 vx = _mm256_loadu_ps(x + i), vy = _mm256_loadu_ps(y + i), vz = _mm256_loadu_ps(z + i);
+			__m256 length = _mm256_sqrt_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(vx, vx), _mm256_mul_ps(vy, vy)), _mm256_mul_ps(vz, vz)));
+			__m256 scale = _mm256_blendv_ps(one, length, _mm256_cmp_ps(length, _mm256_setzero_ps(), _CMP_GT_OQ));
+			_mm256_storeu_ps(x + i, _mm256_div_ps(vx, scale));
+			_mm256_storeu_ps(y + i, _mm256_div_ps(vy, scale));
+			_mm256_storeu_ps(z + i, _mm256_div_ps(vz, scale));
+		}
+		normalizeScalar(x, y, z, blockEnd, count);
+	}
+
+	MESH_KERNELS_AVX2_TARGET
+	void minMaxAVX2(const float* values, size_t count, float& low, float& high)
+	{
+		const size_t blockEnd = count & ~size_t(7);
+		__m256 vlow = _mm256_set1_ps(low), vhigh = _mm256_set1_ps(high);
+		for (size_t i = 0; i < blockEnd; i += 8)
+		{
+			__m256 v = _mm256_loadu_ps(values + i);
+			vlow = _mm256_min_ps(vlow, v);
+			vhigh = _mm256_max_ps(vhigh, v);
+		}
+		alignas(32) float lows[8], highs[8];
+		_mm256_store_ps(lows, vlow);
+		_mm256_store_ps(highs, vhigh);
+		for (int lane = 0; lane < 8; ++lane)
+		{
+			low = std::min(low, lows[lane]);
+			high = std::max(high, highs[lane]);
+		}
+		minMaxScalar(values, blockEnd, count, low, high);
+	}
+
+	MESH_KERNELS_AVX2_TARGET
+	void boundsAVX2(Vec3Streams p, MeshBounds& bounds)
+	{
+		float low[3] = { p.x[0], p.y[0], p.z[0] };
+		float high[3] = { p.x[0], p.y[0], p.z[0] };
+		minMaxAVX2(p.x, p.count, low[0], high[0]);
+		minMaxAVX2(p.y, p.count, low[1], high[1]);
+		minMaxAVX2(p.z, p.count, low[2], high[2]);
+		bounds.min = QVector3D(low[0], low[1], low[2]);
+		bounds.max = QVector3D(high[0], high[1], high[2]);
+		bounds.center = (bounds.min + bounds.max) * 0.5f;
+
+		const size_t blockEnd = p.count & ~size_t(7);
+		const __m256 cx = _mm256_set1_ps(bounds.center.x()), cy = _mm256_set1_ps(bounds.center.y()), cz = _mm256_set1_ps(bounds.center.z());
+		__m256 farthest = _mm256_setzero_ps();
+		for (size_t i = 0; i < blockEnd; i += 8)
+		{
+			__m256 dx = _mm256_sub_ps(_mm256_loadu_ps(p.x + i), cx);
+			__m256 dy = _mm256_sub_ps(_mm256_loadu_ps(p.y + i), cy);
+			__m256 dz = _mm256_sub_ps(_mm256_loadu_ps(p.z + i), cz);
+			farthest = _mm256_max_ps(farthest, _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy)), _mm256_mul_ps(dz, dz)));
+		}
+		alignas(32) float lanes[8];
+		_mm256_store_ps(lanes, farthest);
+		float distanceSquared = *std::max_element(lanes, lanes + 8);
+		bounds.radius = std::sqrt(maxDistanceSquaredScalar(p, bounds.center, blockEnd, p.count, distanceSquared));
+	}
+
+	MESH_KERNELS_AVX2_TARGET
+	void transformAVX2(float* x, float* y, float* z, size_t count, const float* m, float w)
+	{
+		const size_t blockEnd = count & ~size_t(7);
+		const __m256 m0 = _mm256_set1_ps(m[0]), m1 = _mm256_set1_ps(m[1]), m2 = _mm256_set1_ps(m[2]);
+		const __m256 m4 = _mm256_set1_ps(m[4]), m5 = _mm256_set1_ps(m[5]), m6 = _mm256_set1_ps(m[6]);
+		const __m256 m8 = _mm256_set1_ps(m[8]), m9 = _mm256_set1_ps(m[9]), m10 = _mm256_set1_ps(m[10]);
+		const __m256 tx = _mm256_set1_ps(m[12] * w), ty = _mm256_set1_ps(m[13] * w), tz = _mm256_set1_ps(m[14] * w);
+		for (size_t i = 0; i < blockEnd; i += 8)
+		{
+			__m256 vx = _mm256_loadu_ps(x + i), vy = _mm256_loadu_ps(y + i), vz = _mm256_loadu_ps(z + i);
+			_mm256_storeu_ps(x + i, _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(m0, vx), _mm256_mul_ps(m4, vy)), _mm256_mul_ps(m8, vz)), tx));
+			_mm256_storeu_ps(y + i, _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(m1, vx), _mm256_mul_ps(m5, vy)), _mm256_mul_ps(m9, vz)), ty));
+			_mm256_storeu_ps(z + i, _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(m2, vx), _mm256_mul_ps(m6, vy)), _mm256_mul_ps(m10, vz)), tz));
+		}
+		transformScalar(x, y, z, blockEnd, count, m, w);
+	}
+
+	MESH_KERNELS_AVX2_TARGET
+	void composeAffineAVX2(const float* const p[12], const float* const l[12], float* const out[12], size_t count)
+	{
+		const size_t blockEnd = count & ~size_t(7);
+		for (size_t i = 0; i < blockEnd; i += 8)
+		{
+			__m256 pm[12], lm[12];
+			for (int k = 0; k < 12; ++k)
+			{
+				pm[k] = _mm256_loadu_ps(p[k] + i);
+				lm[k] = _mm256_loadu_ps(l[k] + i);
+			}
+			for (int c = 0; c < 4; ++c)
+			{
+				for (int r = 0; r < 3; ++r)
+				{
+					__m256 v = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(pm[r], lm[c * 3]), _mm256_mul_ps(pm[3 + r], lm[c * 3 + 1])), _mm256_mul_ps(pm[6 + r], lm[c * 3 + 2]));
+					_mm256_storeu_ps(out[c * 3 + r] + i, c == 3 ? _mm256_add_ps(v, pm[9 + r]) : v);
+				}
+			}
+		}
+		composeAffineScalar(p, l, out, blockEnd, count);
+	}
+
+	bool cpuSupportsAVX2()
+	{
+#if defined(_MSC_VER) && !defined(__clang__)
+		int info[4];
+		__cpuid(info, 0);
+		if (info[0] < 7)
+		{
+			return false;
+		}
+		__cpuid(info, 1);
+		const bool osUsesXSave = (info[2] & (1 << 27)) != 0;
+		const bool hasAVX = (info[2] & (1 << 28)) != 0;
+		if (!osUsesXSave || !hasAVX || (_xgetbv(0) & 0x6) != 0x6) // OS must save the YMM registers
+		{
+			return false;
+		}
+		__cpuidex(info, 7, 0);
+		return (info[1] & (1 << 5)) != 0;
+#else
+		return __builtin_cpu_supports("avx2");
+#endif
+	}
+#endif
+
+	MeshKernels::Isa detectIsa()
+	{
+#if MESH_KERNELS_X86
+		return cpuSupportsAVX2() ? MeshKernels::Isa::AVX2 : MeshKernels::Isa::SSE2;
+#else
+		return MeshKernels::Isa::Scalar;
+#endif
+	}
+
+	std::atomic<MeshKernels::Isa>& currentIsa()
+	{
+		static std::atomic<MeshKernels::Isa> isa(MeshKernels::bestSupportedIsa());
+		return isa;
+	}
+
+	// Spread the low 10 bits of v so there are two zero bits between each
+	uint32_t spreadBits(uint32_t v)
+	{
+		v &= 0x3FF;
+		v = (v | (v << 16)) & 0x030000FF;
+		v = (v | (v << 8)) & 0x0300F00F;
+		v = (v | (v << 4)) & 0x030C30C3;
+		v = (v | (v << 2)) & 0x09249249;
+		return v;
+	}
+}
+
+MeshKernels::Isa MeshKernels::bestSupportedIsa()
+{
+	static const Isa best = detectIsa();
+	return best;
+}
+
+MeshKernels::Isa MeshKernels::activeIsa()
+{
+	return currentIsa().load(std::memory_order_relaxed);
+}
+
+void MeshKernels::setActiveIsa(Isa isa)
+{
+	currentIsa().store(std::min(isa, bestSupportedIsa()), std::memory_order_relaxed);
+}
+
+const char* MeshKernels::isaName(Isa isa)
+{
+	switch (isa)
+	{
+	case Isa::AVX2:
+		return "AVX2";
+	case Isa::SSE2:
+		return "SSE2";
+	default:
+		return "Scalar";
+	}
+}
+
+void MeshKernels::accumulateFaceNormals(Vec3Streams positions, const unsigned int* indices, size_t indexCount, float* nx, float* ny, float* nz)
+{
+#if MESH_KERNELS_X86
+	switch (activeIsa())
+	{
+	case Isa::AVX2:
+		if (positions.count <= static_cast<size_t>(INT_MAX)) // Gathers take signed 32-bit offsets
+		{
+			accumulateFaceNormalsAVX2(positions, indices, indexCount, nx, ny, nz);
+			return;
+		}
+		[[fallthrough]];
+	case Isa::SSE2:
+		accumulateFaceNormalsSSE2(positions, indices, indexCount, nx, ny, nz);
+		return;
+	default:
+		break;
+	}
+#endif
+	accumulateFaceNormalsScalar(positions, indices, 0, indexCount, nx, ny, nz);
+}
+
+void MeshKernels::normalize(float* x, float* y, float* z, size_t count)
+{
+#if MESH_KERNELS_X86
+	switch (activeIsa())
+	{
+	case Isa::AVX2:
+		normalizeAVX2(x, y, z, count);
+		return;
+	case Isa::SSE2:
+		normalizeSSE2(x, y, z, count);
+		return;
+	default:
+		break;
+	}
+#endif
+	normalizeScalar(x, y, z, 0, count);
+}
+
+MeshBounds MeshKernels::computeBounds(Vec3Streams positions)
+{
+	MeshBounds bounds;
+	if (positions.empty())
+	{
+		return bounds;
+	}
+#if MESH_KERNELS_X86
+	switch (activeIsa())
+	{
+	case Isa::AVX2:
+		boundsAVX2(positions, bounds);
+		return bounds;
+	case Isa::SSE2:
+		boundsSSE2(positions, bounds);
+		return bounds;
+	default:
+		break;
+	}
+#endif
+	boundsScalar(positions, bounds);
+	return bounds;
+}
+
+void MeshKernels::transformPoints(float* x, float* y, float* z, size_t count, const float* matrix)
+{
+#if MESH_KERNELS_X86
+	switch (activeIsa())
+	{
+	case Isa::AVX2:
+		transformAVX2(x, y, z, count, matrix, 1.0f);
+		return;
+	case Isa::SSE2:
+		transformSSE2(x, y, z, count, matrix, 1.0f);
+		return;
+	default:
+		break;
+	}
+#endif
+	transformScalar(x, y, z, 0, count, matrix, 1.0f);
+}
+
+void MeshKernels::transformDirections(float* x, float* y, float* z, size_t count, const float* matrix)
+{
+#if MESH_KERNELS_X86
+	switch (activeIsa())
+	{
+	case Isa::AVX2:
+		transformAVX2(x, y, z, count, matrix, 0.0f);
+		return;
+	case Isa::SSE2:
+		transformSSE2(x, y, z, count, matrix, 0.0f);
+		return;
+	default:
+		break;
+	}
+#endif
+	transformScalar(x, y, z, 0, count, matrix, 0.0f);
+}
+
+void MeshKernels::composeAffine(const float* const parent[12], const float* const local[12], float* const out[12], size_t count)
+{
+#if MESH_KERNELS_X86
+	switch (activeIsa())
+	{
+	case Isa::AVX2:
+		composeAffineAVX2(parent, local, out, count);
+		return;
+	case Isa::SSE2:
+		composeAffineSSE2(parent, local, out, count);
+		return;
+	default:
+		break;
+	}
+#endif
+	composeAffineScalar(parent, local, out, 0, count);
+}
+
+std::vector<unsigned int> MeshKernels::mortonTriangleOrder(Vec3Streams p, std::span<const unsigned int> indices, const MeshBounds& bounds)
+{
+	const size_t triangleCount = indices.size() / 3;
+	float scale[3];
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		const float extent = bounds.max[axis] - bounds.min[axis];
+		scale[axis] = extent > 0.0f ? 1023.0f / extent : 0.0f;
+	}
+
+	// The triangle id in the low half keeps equal codes in a fixed order
+	std::vector<uint64_t> keys(triangleCount);
+	for (size_t t = 0; t < triangleCount; ++t)
+	{
+		uint32_t cell[3] = { 0, 0, 0 };
+		const unsigned int a = indices[t * 3], b = indices[t * 3 + 1], c = indices[t * 3 + 2];
+		if (a < p.count && b < p.count && c < p.count)
+		{
+			const float centroid[3] = {
+				(p.x[a] + p.x[b] + p.x[c]) / 3.0f,
+				(p.y[a] + p.y[b] + p.y[c]) / 3.0f,
+				(p.z[a] + p.z[b] + p.z[c]) / 3.0f };
+			for (int axis = 0; axis < 3; ++axis)
+			{
+				const float q = (centroid[axis] - bounds.min[axis]) * scale[axis];
+				cell[axis] = uint32_t(std::min(std::max(q, 0.0f), 1023.0f));
+			}
+		}
+		const uint32_t code = spreadBits(cell[0]) | (spreadBits(cell[1]) << 1) | (spreadBits(cell[2]) << 2);
+		keys[t] = (uint64_t(code) << 32) | uint64_t(t);
+	}
+	std::sort(keys.begin(), keys.end());
+
+	std::vector<unsigned int> order(triangleCount);
+	for (size_t t = 0; t < triangleCount; ++t)
+	{
+		order[t] = unsigned(keys[t] & 0xFFFFFFFF);
+	}
+	return order;
+}
\ No newline at end of file
@@ -0,0 +1,333 @@
+// Forsyth vertex-cache triangle ordering, first-use vertex ordering and cache simulation
+
+#include "MeshOptimizer.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include "Parallel.h"
+
+namespace
+{
+	constexpr unsigned int invalidIndex = 0xFFFFFFFF;
+
+	// Average triangles per independently optimized block. Fixed so the output never depends on the thread
+	// count, large enough that the seams between blocks cost a negligible amount of reuse.
+	constexpr size_t blockTriangles = 1 << 16;
+
+	// Forsyth's scoring constants, tuned for an LRU cache of 32 entries
+	constexpr int lruSize = 32;
+	constexpr float lastTriangleScore = 0.75f;
+	constexpr float cacheDecayPower = 1.5f;
+	constexpr float valenceBoostScale = 2.0f;
+	constexpr float valenceBoostPower = 0.5f;
+	constexpr unsigned int maxValence = 64; // Scores above this are all treated alike
+
+	struct ScoreTables
+	{
+		float cache[lruSize];
+		float valence[maxValence + 1];
+
+		ScoreTables()
+		{
+			for (int i = 0; i < lruSize; ++i)
+			{
+				// The three vertices of the triangle just drawn get a fixed score so the next pick is not biased by their order
+				cache[i] = i < 3 ? lastTriangleScore : std::pow(1.0f - float(i - 3) / float(lruSize - 3), cacheDecayPower);
+			}
+			valence[0] = 0.0f;
+			for (unsigned int i = 1; i <= maxValence; ++i)
+			{
+				// Favour vertices with few triangles left so they leave the working set early
+				valence[i] = valenceBoostScale * std::pow(float(i), -valenceBoostPower);
+			}
+		}
+	};
+
+	const ScoreTables& scoreTables()
+	{
+		static const ScoreTables tables;
+		return tables;
+	}
+
+	float vertexScore(int cachePosition, unsigned int liveTriangles)
+	{
+		if (liveTriangles == 0)
+		{
+			return -1.0f; // No triangles left, never worth picking
+		}
+		const ScoreTables& tables = scoreTables();
+		const float cacheScore = cachePosition >= 0 ? tables.cache[cachePosition] : 0.0f;
+		return cacheScore + tables.valence[std::min(liveTriangles, maxValence)];
+	}
+
+	// Reorder the triangles of one block in place. Vertices are renumbered locally so the working arrays
+	// scale with the block, not with the whole mesh.
+	void optimizeBlock(unsigned int* indices, size_t triangleCount)
+	{
+		const size_t indexCount = triangleCount * 3;
+
+		std::vector<unsigned int> globalIds(indices, indices + indexCount);
+		std::sort(globalIds.begin(), globalIds.end());
+		globalIds.erase(std::unique(globalIds.begin(), globalIds.end()), globalIds.end());
+		const size_t vertexCount = globalIds.size();
+
+		std::vector<unsigned int> local(indexCount);
+		for (size_t i = 0; i < indexCount; ++i)
+		{
+			local[i] = unsigned(std::lower_bound(globalIds.begin(), globalIds.end(), indices[i]) - globalIds.begin());
+		}
+
+		// Vertex to triangle adjacency as offsets into one flat list
+		std::vector<unsigned int> liveTriangles(vertexCount, 0);
+		for (unsigned int vertex : local)
+		{
+			++liveTriangles[vertex];
+		}
+		std::vector<unsigned int> adjacencyOffset(vertexCount + 1, 0);
+		for (size_t v = 0; v < vertexCount; ++v)
+		{
+			adjacencyOffset[v + 1] = adjacencyOffset[v] + liveTriangles[v];
+		}
+		std::vector<unsigned int> adjacency(indexCount);
+		std::vector<unsigned int> fill(adjacencyOffset.begin(), adjacencyOffset.end() - 1);
+		for (size_t i = 0; i < indexCount; ++i)
+		{
+			adjacency[fill[local[i]]++] = unsigned(i / 3);
+		}
+
+		std::vector<int> cachePosition(vertexCount, -1);
+		std::vector<float> score(vertexCount);
+		for (size_t v = 0; v < vertexCount; ++v)
+		{
+			score[v] = vertexScore(-1, liveTriangles[v]);
+		}
+
+		std::vector<float> triangleScore(triangleCount);
+		std::vector<char> emitted(triangleCount, 0);
+		unsigned int bestTriangle = invalidIndex;
+		float bestScore = -1.0f;
+		for (size_t t = 0; t < triangleCount; ++t)
+		{
+			triangleScore[t] = score[local[t * 3]] + score[local[t * 3 + 1]] + score[local[t * 3 + 2]];
+			if (triangleScore[t] > bestScore)
+			{
+				bestScore = triangleScore[t];
+				bestTriangle = unsigned(t);
+			}
+		}
+
+		// The cache holds lruSize entries plus room for the three vertices pushed in front of them
+		unsigned int cache[lruSize + 3];
+		unsigned int cacheScratch[lruSize + 3];
+		int cacheCount = 0;
+
+		std::vector<unsigned int> output(indexCount);
+		size_t emittedCount = 0;
+		size_t scanCursor = 0;
+		while (emittedCount < triangleCount)
+		{
+			if (bestTriangle == invalidIndex)
+			{
+				// Nothing in the cache has triangles left, continue with the next untouched triangle
+				while (scanCursor < triangleCount && emitted[scanCursor])
+				{
+					++scanCursor;
+				}
+				bestTriangle = unsigned(scanCursor);
+			}
+
+			const unsigned int* corners = &local[size_t(bestTriangle) * 3];
+			for (int k = 0; k < 3; ++k)
+			{
+				output[emittedCount * 3 + k] = corners[k];
+			}
+			++emittedCount;
+			emitted[bestTriangle] = 1;
+
+			// Drop the triangle from its vertices' live lists
+			for (int k = 0; k < 3; ++k)
+			{
+				const unsigned int vertex = corners[k];
+				unsigned int* begin = &adjacency[adjacencyOffset[vertex]];
+				unsigned int* end = begin + liveTriangles[vertex];
+				unsigned int* found = std::find(begin, end, bestTriangle);
+				if (found != end)
+				{
+					std::swap(*found, *(end - 1));
+					--liveTriangles[vertex];
+				}
+			}
+
+			// Push the three corners to the front of the LRU cache, keeping the rest in order
+			int scratchCount = 0;
+			for (int k = 0; k < 3; ++k)
+			{
+				cacheScratch[scratchCount++] = corners[k];
+			}
+			for (int i = 0; i < cacheCount; ++i)
+			{
+				const unsigned int vertex = cache[i];
+				if (vertex != corners[0] && vertex != corners[1] && vertex != corners[2])
+				{
+					cacheScratch[scratchCount++] = vertex;
+				}
+			}
+			std::copy(cacheScratch, cacheScratch + scratchCount, cache);
+			cacheCount = scratchCount;
+
+			// Rescore everything whose cache position changed and pick the best triangle touching the cache
+			bestTriangle = invalidIndex;
+			bestScore = -1.0f;
+			for (int i = 0; i < cacheCount; ++i)
+			{
+				const unsigned int vertex = cache[i];
+				const int position = i < lruSize ? i : -1;
+				cachePosition[vertex] = position;
+				const float newScore = vertexScore(position, liveTriangles[vertex]);
+				const float delta = newScore - score[vertex];
+				score[vertex] = newScore;
+
+				const unsigned int* begin = &adjacency[adjacencyOffset[vertex]];
+				for (const unsigned int* triangle = begin; triangle != begin + liveTriangles[vertex]; ++triangle)
+				{
+					triangleScore[*triangle] += delta;
+					if (triangleScore[*triangle] > bestScore)
+					{
+						bestScore = triangleScore[*triangle];
+						bestTriangle = *triangle;
+					}
+				}
+			}
+			cacheCount = std::min(cacheCount, lruSize);
+		}
+
+		for (size_t i = 0; i < indexCount; ++i)
+		{
+			indices[i] = globalIds[output[i]];
+		}
+	}
+}
+
+namespace MeshOptimizer
+{
+	VertexCacheStats analyzeVertexCache(const unsigned int* indices, size_t indexCount, size_t vertexCount, unsigned int cacheSize)
+	{
+		VertexCacheStats stats;
+		if (indexCount < 3 || vertexCount == 0 || cacheSize == 0)
+		{
+			return stats;
+		}
+
+		// A vertex is in the FIFO while fewer than cacheSize misses happened since it was inserted
+		std::vector<size_t> insertedAt(vertexCount, 0);
+		std::vector<char> seen(vertexCount, 0);
+		size_t misses = 0;
+		size_t uniqueVertices = 0;
+		for (size_t i = 0; i < indexCount; ++i)
+		{
+			const unsigned int vertex = indices[i];
+			if (vertex >= vertexCount)
+			{
+				continue;
+			}
+			if (!seen[vertex])
+			{
+				seen[vertex] = 1;
+				++uniqueVertices;
+			}
+			else if (misses - insertedAt[vertex] < cacheSize)
+			{
+				continue;
+			}
+			insertedAt[vertex] = misses;
+			++misses;
+		}
+
+		stats.acmr = double(misses) / double(indexCount / 3);
+		stats.atvr = uniqueVertices > 0 ? double(misses) / double(uniqueVertices) : 0.0;
+		return stats;
+	}
+
+	void optimizeVertexCache(unsigned int* indices, size_t indexCount, size_t vertexCount, unsigned int threadCount)
+	{
+		const size_t triangleCount = indexCount / 3;
+		if (triangleCount == 0 || vertexCount == 0)
+		{
+			return;
+		}
+
+		const size_t blockCount = (triangleCount + blockTriangles - 1) / blockTriangles;
+		std::vector<size_t> blockStart(blockCount + 1, 0);
+		if (blockCount == 1)
+		{
+			blockStart[1] = triangleCount;
+		}
+		else
+		{
+			// Group triangles by their lowest vertex index so each block holds a connected-ish region even when the
+			// file lists triangles in no useful order. Stable counting sort, the layout depends on the input only.
+			auto blockOf = [&](size_t t)
+			{
+				const unsigned int lowest = std::min({ indices[t * 3], indices[t * 3 + 1], indices[t * 3 + 2] });
+				return std::min<size_t>(size_t(lowest) * blockCount / vertexCount, blockCount - 1);
+			};
+			for (size_t t = 0; t < triangleCount; ++t)
+			{
+				++blockStart[blockOf(t) + 1];
+			}
+			for (size_t b = 0; b < blockCount; ++b)
+			{
+				blockStart[b + 1] += blockStart[b];
+			}
+			std::vector<size_t> fill(blockStart.begin(), blockStart.end() - 1);
+			std::vector<unsigned int> grouped(triangleCount * 3);
+			for (size_t t = 0; t < triangleCount; ++t)
+			{
+				std::copy(indices + t * 3, indices + t * 3 + 3, &grouped[fill[blockOf(t)]++ * 3]);
+			}
+			std::copy(grouped.begin(), grouped.end(), indices);
+		}
+
+		const size_t workerCount = std::min<size_t>(Parallel::resolveThreadCount(threadCount), blockCount);
+
+		// Workers pull blocks from a shared counter, each block touches only its own index range
+		std::atomic<size_t> nextBlock{ 0 };
+		Parallel::run(workerCount, [&](size_t)
+		{
+			for (size_t block = nextBlock++; block < blockCount; block = nextBlock++)
+			{
+				const size_t first = blockStart[block];
+				optimizeBlock(indices + first * 3, blockStart[block + 1] - first);
+			}
+		});
+	}
+
+	size_t optimizeVertexFetch(unsigned int* indices, size_t indexCount, size_t vertexCount, std::vector<unsigned int>& remap)
+	{
+		remap.assign(vertexCount, invalidIndex);
+		unsigned int next = 0;
+		for (size_t i = 0; i < indexCount; ++i)
+		{
+			const unsigned int vertex = indices[i];
+			if (vertex >= vertexCount)
+			{
+				continue;
+			}
+			if (remap[vertex] == invalidIndex)
+			{
+				remap[vertex] = next++;
+			}
+			indices[i] = remap[vertex];
+		}
+
+		const size_t referenced = next;
+		for (size_t v = 0; v < vertexCount; ++v)
+		{
+			if (remap[v] == invalidIndex)
+			{
+				remap[v] = next++;
+			}
+		}
+		return referenced;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,256 @@
+// Vertex encoding, index narrowing and chunk bounds for one upload
+
+#include "MeshPacker.h"
+#include <algorithm>
+#include <climits>
+#include <cstring>
+#include <numeric>
+#include <QDebug>
+#include "Model.h"
+#include "Trace.h"
+
+namespace
+{
+	// Capacity of a mesh that may be appended to never starts below this, small files grow by more than half at once
+	constexpr size_t minimumAppendBytes = 64 * 1024;
+
+	size_t appendCapacity(size_t bytes)
+	{
+		return std::max(bytes + bytes / 2, minimumAppendBytes);
+	}
+}
+
+void PackedMesh::clear()
+{
+	vertexData.clear();
+	indexData.clear();
+	buffers.reset();
+	vertexBytes = 0;
+	indexBytes = 0;
+	vertexCapacity = 0;
+	indexCapacity = 0;
+	vertexStride = 0;
+	indexCount = 0;
+	compactVertices = false;
+	shortIndices = false;
+	quantization = PositionQuantization();
+	cullChunks.clear();
+	lodLevels.clear();
+}
+
+bool MeshPacker::pack(const Model& model, bool compactVertices, PackedMesh& out, const MeshBufferAllocator& allocator)
+{
+	TRACE_ZONE("MeshPacker::pack");
+	if (!layout(model, compactVertices, out))
+	{
+		return false;
+	}
+	if (allocator)
+	{
+		out.buffers = allocator(out.vertexCapacity, out.indexCapacity);
+	}
+	if (out.buffers)
+	{
+		writeVertices(model, out, out.buffers->vertexData());
+		writeIndices(model, out, out.buffers->indexData());
+		return true;
+	}
+	out.vertexData.resize(out.vertexBytes);
+	out.indexData.resize(out.indexBytes);
+	writeVertices(model, out, out.vertexData.data());
+	writeIndices(model, out, out.indexData.data());
+
+	if (out.compactVertices)
+	{
+		// Decode once to report what the quantization cost, only bytes in the vectors are cheap to read back. Mapped
+		// upload heaps are write-combined.
+		const Vec3Streams positions = model.getVertices();
+		const CompactVertex* compact = reinterpret_cast<const CompactVertex*>(out.vertexData.data());
+		const QuantizationError error = VertexQuantizer::measureError(positions, model.getNormals(), compact, out.quantization);
+		const size_t packedBytes = out.vertexBytes + out.indexBytes;
+		const size_t fullBytes = positions.size() * sizeof(Vertex) + out.indexCount * sizeof(unsigned int);
+		qInfo().nospace() << "Compact vertices: max position error " << error.maxPositionError << " (radius " << model.getBounds().radius
+			<< "), max normal error " << error.maxNormalErrorDegrees << " deg, " << (out.shortIndices ? "16" : "32") << "-bit indices, "
+			<< packedBytes / 1024.0 << " KB instead of " << fullBytes / 1024.0 << " KB (x" << double(fullBytes) / double(packedBytes) << ")";
+	}
+	return true;
+}
+
+bool MeshPacker::layout(const Model& model, bool compactVertices, PackedMesh& out)
+{
+	TRACE_ZONE("MeshPacker::layout");
+	out.clear();
+	const Vec3Streams positions = model.getVertices();
+	const std::span<const unsigned int> indices = model.getIndices();
+	const LodChainView lods = model.getLodChain();
+
+	if (positions.empty() || indices.empty())
+	{
+		qCritical() << "Model has no vertices or indices";
+		return false;
+	}
+	if (positions.size() > UINT_MAX || indices.size() + lods.indices.size() > UINT_MAX)
+	{
+		qCritical() << "Model too large for 32-bit buffers";
+		return false;
+	}
+
+	// 16-bit indices whenever every vertex is addressable with them, in either vertex format. Appends must not
+	// change the format, bounds they grow would change the quantization and more vertices the index size.
+	const bool appendable = model.canAppend();
+	compactVertices = compactVertices && !appendable;
+	const bool shortIndices = !appendable && positions.size() <= 0x10000;
+	const size_t vertexStride = compactVertices ? sizeof(CompactVertex) : sizeof(Vertex);
+	const size_t indexStride = shortIndices ? sizeof(uint16_t) : sizeof(unsigned int);
+	out.vertexStride = vertexStride;
+	out.indexCount = indices.size();
+	out.compactVertices = compactVertices;
+	out.shortIndices = shortIndices;
+	out.vertexBytes = positions.size() * vertexStride;
+	out.indexBytes = (indices.size() + lods.indices.size()) * indexStride;
+	out.vertexCapacity = appendable ? appendCapacity(out.vertexBytes) : out.vertexBytes;
+	out.indexCapacity = appendable ? appendCapacity(out.indexBytes) : out.indexBytes;
+	if (compactVertices)
+	{
+		out.quantization = VertexQuantizer::positionQuantization(model.getBounds());
+	}
+
+	out.lodLevels.assign(lods.levels.begin(), lods.levels.end());
+	out.cullChunks.resize(out.lodLevels.size() + 1);
+	FrustumCuller::buildChunks(positions, indices, FrustumCuller::defaultChunkTriangles, out.cullChunks[0]);
+	for (size_t level = 0; level < out.lodLevels.size(); ++level)
+	{
+		const LodLevel& lod = out.lodLevels[level];
+		FrustumCuller::buildChunks(positions, lods.indices.subspan(lod.firstIndex, lod.indexCount), FrustumCuller::defaultChunkTriangles,
+			out.cullChunks[level + 1], static_cast<uint32_t>(indices.size() + lod.firstIndex));
+	}
+	return true;
+}
+
+void MeshPacker::writeVertices(const Model& model, const PackedMesh& layout, void* destination)
+{
+	TRACE_ZONE("MeshPacker::writeVertices");
+	const Vec3Streams positions = model.getVertices();
+	const Vec3Streams normals = model.getNormals();
+	if (layout.compactVertices)
+	{
+		VertexQuantizer::encode(positions, normals, layout.quantization, static_cast<CompactVertex*>(destination));
+		return;
+	}
+	// Whole records built in registers and stored once, upload heaps are write-combined
+	Vertex* full = static_cast<Vertex*>(destination);
+	for (size_t i = 0; i < positions.size(); ++i)
+	{
+		const Vertex vertex = { positions[i], (i < normals.size()) ? normals[i] : QVector3D(0.0f, 1.0f, 0.0f) };
+		full[i] = vertex;
+	}
+}
+
+void MeshPacker::writeIndices(const Model& model, const PackedMesh& layout, void* destination)
+{
+	TRACE_ZONE("MeshPacker::writeIndices");
+	const std::span<const unsigned int> indices = model.getIndices();
+	const std::span<const unsigned int> lodIndices = model.getLodChain().indices;
+	if (layout.shortIndices)
+	{
+		uint16_t* shortData = static_cast<uint16_t*>(destination);
+		for (size_t i = 0; i < indices.size(); ++i)
+		{
+			shortData[i] = static_cast<uint16_t>(indices[i]);
+		}
+		for (size_t i = 0; i < lodIndices.size(); ++i)
+		{
+			shortData[indices.size() + i] = static_cast<uint16_t>(lodIndices[i]);
+		}
+	}
+	else
+	{
+		uint8_t* bytes = static_cast<uint8_t*>(destination);
+		memcpy(bytes, indices.data(), indices.size_bytes());
+		memcpy(bytes + indices.size_bytes(), lodIndices.data(), lodIndices.size_bytes());
+	}
+}
+
+bool MeshPacker::packAppend(const Model& model, const ObjAppend& append, const AppendCapacity& capacity, PackedAppend& out)
+{
+	TRACE_ZONE("MeshPacker::packAppend");
+	out = PackedAppend();
+	const Vec3Streams positions = model.getVertices();
+	const Vec3Streams normals = model.getNormals();
+	const std::span<const unsigned int> indices = model.getIndices();
+	const ObjData& lines = append.lines;
+	const ObjData& partialLine = append.partialLine;
+	const size_t kept = append.keptVertices;
+	const size_t added = lines.vertices.size() + partialLine.vertices.size();
+	const size_t indexCount = append.keptIndices + lines.indices.size() + partialLine.indices.size();
+	if ((kept + added) * sizeof(Vertex) > capacity.vertexBytes || indexCount * sizeof(unsigned int) > capacity.indexBytes || indexCount > UINT_MAX)
+	{
+		return false;
+	}
+
+	// The mesh after the append, kept records of the model followed by the new text's
+	auto fromParts = [](const Vec3Array& first, const Vec3Array& second, size_t i)
+	{
+		return i < first.size() ? QVector3D(first.x[i], first.y[i], first.z[i])
+			: QVector3D(second.x[i - first.size()], second.y[i - first.size()], second.z[i - first.size()]);
+	};
+	auto position = [&](size_t v)
+	{
+		return v < kept ? positions[v] : fromParts(lines.vertices, partialLine.vertices, v - kept);
+	};
+	// Generated normals come with the append. vn records are taken in order like writeVertices() does, a vertex
+	// past them has the same default, so records change from the first replaced vn record on too.
+	const bool generated = !append.normals.empty();
+	const size_t fileNormals = append.keptNormals + lines.normals.size() + partialLine.normals.size();
+	auto normal = [&](size_t v)
+	{
+		if (generated)
+		{
+			return v < kept ? normals[v] : QVector3D(append.normals.x[v - kept], append.normals.y[v - kept], append.normals.z[v - kept]);
+		}
+		if (v < append.keptNormals)
+		{
+			return v < normals.size() ? normals[v] : QVector3D(0.0f, 1.0f, 0.0f);
+		}
+		return v < fileNormals ? fromParts(lines.normals, partialLine.normals, v - append.keptNormals) : QVector3D(0.0f, 1.0f, 0.0f);
+	};
+
+	out.firstVertex = generated ? kept : std::min(kept, append.keptNormals);
+	out.vertices.reserve(kept + added - out.firstVertex);
+	for (size_t v = out.firstVertex; v < kept + added; ++v)
+	{
+		out.vertices.push_back({ position(v), normal(v) });
+	}
+	if (generated)
+	{
+		out.patchedVertices.assign(append.touched.begin(), append.touched.end());
+		for (size_t i = 0; i < append.touched.size(); ++i)
+		{
+			const unsigned int v = append.touched[i];
+			out.patches.push_back({ positions[v], QVector3D(append.normals.x[added + i], append.normals.y[added + i], append.normals.z[added + i]) });
+		}
+	}
+	out.firstIndex = append.keptIndices;
+	out.indices.reserve(indexCount - out.firstIndex);
+	out.indices.insert(out.indices.end(), lines.indices.begin(), lines.indices.end());
+	out.indices.insert(out.indices.end(), partialLine.indices.begin(), partialLine.indices.end());
+	out.vertexBytes = (kept + added) * sizeof(Vertex);
+	out.indexBytes = indexCount * sizeof(unsigned int);
+	out.indexCount = indexCount;
+
+	// Chunks before the one the first new index falls in keep their triangles. The rest is rebuilt from the corners'
+	// positions in index order, which bound the same boxes as the vertices they reference.
+	const size_t chunkIndices = FrustumCuller::defaultChunkTriangles * 3;
+	out.firstChunkIndex = static_cast<uint32_t>(out.firstIndex / chunkIndices * chunkIndices);
+	Vec3Array corners;
+	corners.reserve(indexCount - out.firstChunkIndex);
+	for (size_t i = out.firstChunkIndex; i < indexCount; ++i)
+	{
+		const QVector3D corner = position(i < out.firstIndex ? indices[i] : out.indices[i - out.firstIndex]);
+		corners.push_back(corner.x(), corner.y(), corner.z());
+	}
+	std::vector<unsigned int> cornerOrder(corners.size());
+	std::iota(cornerOrder.begin(), cornerOrder.end(), 0u);
+	FrustumCuller::buildChunks(corners.view(), cornerOrder, FrustumCuller::defaultChunkTriangles, out.tailChunks, out.firstChunkIndex);
+	return true;
+}
\ No newline at end of file
@@ -0,0 +1,674 @@
+// Greedy quadric edge collapse over Morton-order blocks in parallel, chained into LOD levels
+
+#include "MeshSimplifier.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include "Parallel.h"
+
+namespace
+{
+	// Triangles per independently simplified block, fixed so the output never depends on the thread count
+	constexpr size_t blockTriangles = 1 << 16;
+	constexpr double borderWeight = 10.0; // Extra pull of the planes that keep open borders in place
+	constexpr double flipCosine = 0.25; // Collapses that turn a neighbouring face by more than ~75 degrees are refused
+	constexpr double passLimitScale = 1.5; // A pass stops past this multiple of the error its quota would need
+	constexpr size_t minPassShare = 8; // Every pass may reach at least the cheapest 1/minPassShare of the candidates
+	constexpr uint32_t noBlock = std::numeric_limits<uint32_t>::max();
+	constexpr uint32_t sharedVertex = noBlock - 1;
+
+	// Manifold vertices collapse along any edge, border vertices only along the border, locked ones never move
+	enum VertexKind : uint8_t
+	{
+		Manifold,
+		Border,
+		Locked
+	};
+
+	// Sum of weighted squared plane distances, stored as the symmetric 4x4 matrix's upper triangle
+	struct Quadric
+	{
+		double a2 = 0.0, ab = 0.0, ac = 0.0, ad = 0.0;
+		double b2 = 0.0, bc = 0.0, bd = 0.0;
+		double c2 = 0.0, cd = 0.0;
+		double d2 = 0.0;
+		double weight = 0.0;
+
+		void addPlane(double a, double b, double c, double d, double w)
+		{
+			a2 += w * a * a; ab += w * a * b; ac += w * a * c; ad += w * a * d;
+			b2 += w * b * b; bc += w * b * c; bd += w * b * d;
+			c2 += w * c * c; cd += w * c * d;
+			d2 += w * d * d;
+			weight += w;
+		}
+		void add(const Quadric& other)
+		{
+			a2 += other.a2; ab += other.ab; ac += other.ac; ad += other.ad;
+			b2 += other.b2; bc += other.bc; bd += other.bd;
+			c2 += other.c2; cd += other.cd;
+			d2 += other.d2;
+			weight += other.weight;
+		}
+	};
+
+	// Weighted mean squared distance of (x, y, z) to the planes of both quadrics
+	double collapseCost(const Quadric& q, const Quadric& r, double x, double y, double z)
+	{
+		const double weight = q.weight + r.weight;
+		if (weight <= 0.0)
+		{
+			return 0.0;
+		}
+		const double a2 = q.a2 + r.a2, b2 = q.b2 + r.b2, c2 = q.c2 + r.c2;
+		const double ab = q.ab + r.ab, ac = q.ac + r.ac, bc = q.bc + r.bc;
+		const double ad = q.ad + r.ad, bd = q.bd + r.bd, cd = q.cd + r.cd;
+		const double d2 = q.d2 + r.d2;
+		const double sum = a2 * x * x + b2 * y * y + c2 * z * z + 2.0 * (ab * x * y + ac * x * z + bc * y * z + ad * x + bd * y + cd * z) + d2;
+		return std::max(sum / weight, 0.0);
+	}
+
+	// One block with its own vertex numbering
+	struct LocalMesh
+	{
+		std::vector<unsigned int> globalVertices; // Local vertex -> mesh vertex
+		std::vector<double> x, y, z;
+		std::vector<uint32_t> corners; // Three local vertices per triangle
+		std::vector<uint8_t> kind;
+	};
+
+	// Triangles around each vertex, rebuilt once per pass
+	struct Adjacency
+	{
+		std::vector<uint32_t> offsets;
+		std::vector<uint32_t> triangles;
+
+		void build(const std::vector<uint32_t>& corners, size_t vertexCount)
+		{
+			offsets.assign(vertexCount + 1, 0);
+			for (uint32_t v : corners)
+			{
+				++offsets[v + 1];
+			}
+			for (size_t v = 0; v < vertexCount; ++v)
+			{
+				offsets[v + 1] += offsets[v];
+			}
+			triangles.resize(corners.size());
+			std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+			for (size_t i = 0; i < corners.size(); ++i)
+			{
+				triangles[fill[corners[i]]++] = uint32_t(i / 3);
+			}
+		}
+
+		// Number of triangles that use both a and b
+		uint32_t sharedCount(const std::vector<uint32_t>& corners, uint32_t a, uint32_t b) const
+		{
+			uint32_t count = 0;
+			for (uint32_t i = offsets[a]; i < offsets[a + 1]; ++i)
+			{
+				const uint32_t* triangle = &corners[size_t(triangles[i]) * 3];
+				count += (triangle[0] == b || triangle[1] == b || triangle[2] == b) ? 1 : 0;
+			}
+			return count;
+		}
+	};
+
+	struct Candidate
+	{
+		double cost;
+		uint32_t from;
+		uint32_t to;
+
+		bool operator<(const Candidate& other) const
+		{
+			if (cost != other.cost)
+			{
+				return cost < other.cost;
+			}
+			return from != other.from ? from < other.from : to < other.to;
+		}
+	};
+
+	void cross(const double* u, const double* v, double* out)
+	{
+		out[0] = u[1] * v[2] - u[2] * v[1];
+		out[1] = u[2] * v[0] - u[0] * v[2];
+		out[2] = u[0] * v[1] - u[1] * v[0];
+	}
+
+	double dot(const double* u, const double* v)
+	{
+		return u[0] * v[0] + u[1] * v[1] + u[2] * v[2];
+	}
+
+	// Unnormalized normal of the triangle with corner `moved` placed at `target`
+	void triangleNormal(const LocalMesh& mesh, const uint32_t* triangle, uint32_t moved, uint32_t target, double* normal)
+	{
+		double p[3][3];
+		for (int k = 0; k < 3; ++k)
+		{
+			const uint32_t v = triangle[k] == moved ? target : triangle[k];
+			p[k][0] = mesh.x[v];
+			p[k][1] = mesh.y[v];
+			p[k][2] = mesh.z[v];
+		}
+		const double e1[3] = { p[1][0] - p[0][0], p[1][1] - p[0][1], p[1][2] - p[0][2] };
+		const double e2[3] = { p[2][0] - p[0][0], p[2][1] - p[0][1], p[2][2] - p[0][2] };
+		cross(e1, e2, normal);
+	}
+
+	// True when moving `from` onto `to` folds or collapses one of the triangles that survive the collapse
+	bool collapseFlips(const LocalMesh& mesh, const Adjacency& adjacency, uint32_t from, uint32_t to)
+	{
+		for (uint32_t i = adjacency.offsets[from]; i < adjacency.offsets[from + 1]; ++i)
+		{
+			const uint32_t* triangle = &mesh.corners[size_t(adjacency.triangles[i]) * 3];
+			if (triangle[0] == to || triangle[1] == to || triangle[2] == to)
+			{
+				continue; // Degenerates and is removed
+			}
+			double before[3], after[3];
+			triangleNormal(mesh, triangle, from, from, before);
+			triangleNormal(mesh, triangle, from, to, after);
+			const double lengthBefore = std::sqrt(dot(before, before));
+			if (lengthBefore == 0.0)
+			{
+				continue; // Already degenerate, there is no orientation to keep
+			}
+			if (dot(before, after) <= flipCosine * lengthBefore * std::sqrt(dot(after, after)))
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+
+	// Face planes weighted by area, plus perpendicular planes along open borders. Also classifies the vertices.
+	void computeQuadrics(LocalMesh& mesh, const Adjacency& adjacency, std::vector<Quadric>& quadrics)
+	{
+		quadrics.assign(mesh.x.size(), Quadric());
+		for (size_t t = 0; t < mesh.corners.size() / 3; ++t)
+		{
+			const uint32_t* triangle = &mesh.corners[t * 3];
+			double normal[3];
+			triangleNormal(mesh, triangle, triangle[0], triangle[0], normal);
+			const double length = std::sqrt(dot(normal, normal));
+			if (length == 0.0)
+			{
+				continue;
+			}
+			for (double& component : normal)
+			{
+				component /= length;
+			}
+			const double origin[3] = { mesh.x[triangle[0]], mesh.y[triangle[0]], mesh.z[triangle[0]] };
+			const double d = -dot(normal, origin);
+			for (int k = 0; k < 3; ++k)
+			{
+				quadrics[triangle[k]].addPlane(normal[0], normal[1], normal[2], d, length * 0.5);
+			}
+
+			for (int k = 0; k < 3; ++k)
+			{
+				const uint32_t a = triangle[k], b = triangle[(k + 1) % 3];
+				const uint32_t shared = adjacency.sharedCount(mesh.corners, a, b);
+				if (shared > 2)
+				{
+					// Non-manifold edges are kept exactly
+					mesh.kind[a] = Locked;
+					mesh.kind[b] = Locked;
+					continue;
+				}
+				if (shared != 1)
+				{
+					continue;
+				}
+				mesh.kind[a] = std::max<uint8_t>(mesh.kind[a], Border);
+				mesh.kind[b] = std::max<uint8_t>(mesh.kind[b], Border);
+				const double edge[3] = { mesh.x[b] - mesh.x[a], mesh.y[b] - mesh.y[a], mesh.z[b] - mesh.z[a] };
+				double side[3];
+				cross(edge, normal, side);
+				const double sideLength = std::sqrt(dot(side, side));
+				if (sideLength == 0.0)
+				{
+					continue;
+				}
+				for (double& component : side)
+				{
+					component /= sideLength;
+				}
+				const double start[3] = { mesh.x[a], mesh.y[a], mesh.z[a] };
+				const double sideD = -dot(side, start);
+				const double weight = dot(edge, edge) * borderWeight;
+				quadrics[a].addPlane(side[0], side[1], side[2], sideD, weight);
+				quadrics[b].addPlane(side[0], side[1], side[2], sideD, weight);
+			}
+		}
+	}
+
+	// Squared distance from point p to triangle abc (closest point by Voronoi region, Ericson's RTCD 5.1.5)
+	double pointTriangleDistance2(const double* p, const double* a, const double* b, const double* c)
+	{
+		const double ab[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+		const double ac[3] = { c[0] - a[0], c[1] - a[1], c[2] - a[2] };
+		const double ap[3] = { p[0] - a[0], p[1] - a[1], p[2] - a[2] };
+		auto distance2 = [p](double x, double y, double z)
+		{
+			return (p[0] - x) * (p[0] - x) + (p[1] - y) * (p[1] - y) + (p[2] - z) * (p[2] - z);
+		};
+		const double d1 = dot(ab, ap), d2 = dot(ac, ap);
+		if (d1 <= 0.0 && d2 <= 0.0)
+		{
+			return distance2(a[0], a[1], a[2]);
+		}
+		const double bp[3] = { p[0] - b[0], p[1] - b[1], p[2] - b[2] };
+		const double d3 = dot(ab, bp), d4 = dot(ac, bp);
+		if (d3 >= 0.0 && d4 <= d3)
+		{
+			return distance2(b[0], b[1], b[2]);
+		}
+		const double vc = d1 * d4 - d3 * d2;
+		if (vc <= 0.0 && d1 >= 0.0 && d3 <= 0.0)
+		{
+			const double v = d1 / (d1 - d3);
+			return distance2(a[0] + v * ab[0], a[1] + v * ab[1], a[2] + v * ab[2]);
+		}
+		const double cp[3] = { p[0] - c[0], p[1] - c[1], p[2] - c[2] };
+		const double d5 = dot(ab, cp), d6 = dot(ac, cp);
+		if (d6 >= 0.0 && d5 <= d6)
+		{
+			return distance2(c[0], c[1], c[2]);
+		}
+		const double vb = d5 * d2 - d1 * d6;
+		if (vb <= 0.0 && d2 >= 0.0 && d6 <= 0.0)
+		{
+			const double w = d2 / (d2 - d6);
+			return distance2(a[0] + w * ac[0], a[1] + w * ac[1], a[2] + w * ac[2]);
+		}
+		const double va = d3 * d6 - d5 * d4;
+		if (va <= 0.0 && (d4 - d3) >= 0.0 && (d5 - d6) >= 0.0)
+		{
+			const double w = (d4 - d3) / ((d4 - d3) + (d5 - d6));
+			return distance2(b[0] + w * (c[0] - b[0]), b[1] + w * (c[1] - b[1]), b[2] + w * (c[2] - b[2]));
+		}
+		const double denominator = 1.0 / (va + vb + vc);
+		const double v = vb * denominator, w = vc * denominator;
+		return distance2(a[0] + ab[0] * v + ac[0] * w, a[1] + ab[1] * v + ac[1] * w, a[2] + ab[2] * v + ac[2] * w);
+	}
+
+	// Squared distance from point p to segment ab
+	double pointSegmentDistance2(const double* p, const double* a, const double* b)
+	{
+		const double ab[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+		const double ap[3] = { p[0] - a[0], p[1] - a[1], p[2] - a[2] };
+		const double length2 = dot(ab, ab);
+		const double t = length2 > 0.0 ? std::clamp(dot(ap, ab) / length2, 0.0, 1.0) : 0.0;
+		const double offset[3] = { ap[0] - t * ab[0], ap[1] - t * ab[1], ap[2] - t * ab[2] };
+		return dot(offset, offset);
+	}
+
+	// Distance from the removed vertex to the surface that replaces it: the moved fan, plus the edges left
+	// behind by the triangles that collapse away. The quadric cost averages over all accumulated planes and
+	// says little about the worst point, this is what gets reported.
+	double fanDistance(const LocalMesh& mesh, const Adjacency& adjacency, uint32_t from, uint32_t to)
+	{
+		double nearest = std::numeric_limits<double>::infinity();
+		const double removed[3] = { mesh.x[from], mesh.y[from], mesh.z[from] };
+		const double target[3] = { mesh.x[to], mesh.y[to], mesh.z[to] };
+		for (uint32_t i = adjacency.offsets[from]; i < adjacency.offsets[from + 1]; ++i)
+		{
+			const uint32_t* triangle = &mesh.corners[size_t(adjacency.triangles[i]) * 3];
+			double corner[3][3];
+			uint32_t other = to;
+			for (int k = 0; k < 3; ++k)
+			{
+				const uint32_t v = triangle[k] == from ? to : triangle[k];
+				other = v != to ? v : other;
+				corner[k][0] = mesh.x[v];
+				corner[k][1] = mesh.y[v];
+				corner[k][2] = mesh.z[v];
+			}
+			if (triangle[0] == to || triangle[1] == to || triangle[2] == to)
+			{
+				const double edgeEnd[3] = { mesh.x[other], mesh.y[other], mesh.z[other] };
+				nearest = std::min(nearest, pointSegmentDistance2(removed, target, edgeEnd));
+			}
+			else
+			{
+				nearest = std::min(nearest, pointTriangleDistance2(removed, corner[0], corner[1], corner[2]));
+			}
+		}
+		return nearest == std::numeric_limits<double>::infinity() ? 0.0 : std::sqrt(nearest);
+	}
+
+	// Collapse in passes until targetTriangles remain or nothing can move. Returns the largest distance between
+	// a removed vertex and the surface that replaced it, accumulated over repeated collapses.
+	double simplifyBlock(LocalMesh& mesh, size_t targetTriangles)
+	{
+		const size_t vertexCount = mesh.x.size();
+		Adjacency adjacency;
+		adjacency.build(mesh.corners, vertexCount);
+		std::vector<Quadric> quadrics;
+		computeQuadrics(mesh, adjacency, quadrics);
+
+		double maxError = 0.0;
+		std::vector<double> vertexError(vertexCount, 0.0); // Deviation of the collapses already merged into each vertex
+		std::vector<Candidate> candidates;
+		std::vector<uint8_t> touched;
+		std::vector<uint32_t> remap(vertexCount);
+		auto allowed = [&mesh](uint32_t from, bool borderEdge)
+		{
+			return mesh.kind[from] == Manifold || (mesh.kind[from] == Border && borderEdge);
+		};
+
+		size_t triangleCount = mesh.corners.size() / 3;
+		bool firstPass = true;
+		while (triangleCount > targetTriangles)
+		{
+			if (!firstPass)
+			{
+				adjacency.build(mesh.corners, vertexCount);
+			}
+			firstPass = false;
+
+			// Each edge once: manifold edges appear in two triangles with opposite directions
+			candidates.clear();
+			for (size_t t = 0; t < triangleCount; ++t)
+			{
+				for (int k = 0; k < 3; ++k)
+				{
+					const uint32_t a = mesh.corners[t * 3 + k], b = mesh.corners[t * 3 + (k + 1) % 3];
+					const bool borderEdge = adjacency.sharedCount(mesh.corners, a, b) == 1;
+					if (a > b && !borderEdge)
+					{
+						continue;
+					}
+					Candidate best = { std::numeric_limits<double>::infinity(), 0, 0 };
+					if (allowed(a, borderEdge))
+					{
+						best = { collapseCost(quadrics[a], quadrics[b], mesh.x[b], mesh.y[b], mesh.z[b]), a, b };
+					}
+					if (allowed(b, borderEdge))
+					{
+						const Candidate reverse = { collapseCost(quadrics[a], quadrics[b], mesh.x[a], mesh.y[a], mesh.z[a]), b, a };
+						if (reverse < best)
+						{
+							best = reverse;
+						}
+					}
+					if (best.cost != std::numeric_limits<double>::infinity())
+					{
+						candidates.push_back(best);
+					}
+				}
+			}
+			if (candidates.empty())
+			{
+				break;
+			}
+			std::sort(candidates.begin(), candidates.end());
+
+			// Most collapses remove two triangles, the quota's error times a margin bounds this pass. Near the
+			// target the quota is tiny, a minimum share of the candidates keeps the last passes from crawling.
+			const size_t needed = triangleCount - targetTriangles;
+			const size_t limitIndex = std::min(candidates.size() - 1, std::max(needed / 2, candidates.size() / minPassShare));
+			const double passLimit = candidates[limitIndex].cost * passLimitScale;
+			touched.assign(vertexCount, 0);
+			for (uint32_t v = 0; v < vertexCount; ++v)
+			{
+				remap[v] = v;
+			}
+			size_t removed = 0;
+			size_t collapsed = 0;
+			for (const Candidate& candidate : candidates)
+			{
+				if (candidate.cost > passLimit && collapsed > 0)
+				{
+					break;
+				}
+				// Triangles around a moved vertex keep their corners fixed for the rest of the pass,
+				// so every flip test below sees the geometry it will really produce
+				if (touched[candidate.from] || touched[candidate.to] || collapseFlips(mesh, adjacency, candidate.from, candidate.to))
+				{
+					continue;
+				}
+				const double error = std::max(vertexError[candidate.from], fanDistance(mesh, adjacency, candidate.from, candidate.to));
+				vertexError[candidate.to] = std::max(vertexError[candidate.to], error);
+				maxError = std::max(maxError, error);
+				for (uint32_t i = adjacency.offsets[candidate.from]; i < adjacency.offsets[candidate.from + 1]; ++i)
+				{
+					const uint32_t* triangle = &mesh.corners[size_t(adjacency.triangles[i]) * 3];
+					removed += (triangle[0] == candidate.to || triangle[1] == candidate.to || triangle[2] == candidate.to) ? 1 : 0;
+					touched[triangle[0]] = 1;
+					touched[triangle[1]] = 1;
+					touched[triangle[2]] = 1;
+				}
+				remap[candidate.from] = candidate.to;
+				quadrics[candidate.to].add(quadrics[candidate.from]);
+				++collapsed;
+				if (removed >= needed)
+				{
+					break;
+				}
+			}
+			if (collapsed == 0)
+			{
+				break;
+			}
+
+			size_t kept = 0;
+			for (size_t t = 0; t < triangleCount; ++t)
+			{
+				const uint32_t a = remap[mesh.corners[t * 3]], b = remap[mesh.corners[t * 3 + 1]], c = remap[mesh.corners[t * 3 + 2]];
+				if (a == b || b == c || c == a)
+				{
+					continue;
+				}
+				mesh.corners[kept * 3] = a;
+				mesh.corners[kept * 3 + 1] = b;
+				mesh.corners[kept * 3 + 2] = c;
+				++kept;
+			}
+			triangleCount = kept;
+			mesh.corners.resize(kept * 3);
+		}
+		return maxError;
+	}
+
+	uint32_t positionHash(Vec3Streams p, unsigned int v)
+	{
+		uint32_t bits[3];
+		std::memcpy(&bits[0], &p.x[v], sizeof(float));
+		std::memcpy(&bits[1], &p.y[v], sizeof(float));
+		std::memcpy(&bits[2], &p.z[v], sizeof(float));
+		return (bits[0] * 73856093u) ^ (bits[1] * 19349663u) ^ (bits[2] * 83492791u);
+	}
+
+	// Flag vertices that share their position with another vertex, the seams the welder split at vt/vn changes.
+	// Collapsing one side of a seam without the other would open a crack, so these stay in place.
+	std::vector<uint8_t> findSeamVertices(Vec3Streams p)
+	{
+		std::vector<uint8_t> seam(p.count, 0);
+		size_t tableSize = 1;
+		while (tableSize < p.count * 2)
+		{
+			tableSize <<= 1;
+		}
+		std::vector<uint32_t> table(tableSize, noBlock);
+		for (unsigned int v = 0; v < p.count; ++v)
+		{
+			for (size_t slot = positionHash(p, v) & (tableSize - 1);; slot = (slot + 1) & (tableSize - 1))
+			{
+				const uint32_t other = table[slot];
+				if (other == noBlock)
+				{
+					table[slot] = v;
+					break;
+				}
+				if (p.x[other] == p.x[v] && p.y[other] == p.y[v] && p.z[other] == p.z[v])
+				{
+					seam[other] = 1;
+					seam[v] = 1;
+					break;
+				}
+			}
+		}
+		return seam;
+	}
+}
+
+size_t LodChainView::selectLevel(float pixelsPerUnit, float maxPixelError) const
+{
+	for (size_t level = levels.size(); level > 0; --level)
+	{
+		if (levels[level - 1].error * pixelsPerUnit <= maxPixelError)
+		{
+			return level;
+		}
+	}
+	return 0;
+}
+
+void LodChain::clear()
+{
+	indices.clear();
+	levels.clear();
+}
+
+float MeshSimplifier::simplify(Vec3Streams positions, std::span<const unsigned int> indices, size_t targetIndexCount, std::vector<unsigned int>& out, unsigned int threadCount)
+{
+	out.clear();
+	if (indices.size() < 3 || positions.empty())
+	{
+		return 0.0f;
+	}
+
+	// Spatially coherent blocks keep the vertices held between them few
+	const std::vector<unsigned int> order = MeshKernels::mortonTriangleOrder(positions, indices, MeshKernels::computeBounds(positions));
+	std::vector<unsigned int> triangles;
+	triangles.reserve(order.size());
+	for (unsigned int t : order)
+	{
+		if (indices[size_t(t) * 3] < positions.count && indices[size_t(t) * 3 + 1] < positions.count && indices[size_t(t) * 3 + 2] < positions.count)
+		{
+			triangles.push_back(t);
+		}
+	}
+	const size_t blockCount = (triangles.size() + blockTriangles - 1) / blockTriangles;
+
+	// Vertices used by more than one block must not move
+	std::vector<uint32_t> owner(positions.count, noBlock);
+	for (size_t block = 0; block < blockCount; ++block)
+	{
+		const size_t end = std::min(triangles.size(), (block + 1) * blockTriangles);
+		for (size_t i = block * blockTriangles; i < end; ++i)
+		{
+			for (int k = 0; k < 3; ++k)
+			{
+				uint32_t& vertexOwner = owner[indices[size_t(triangles[i]) * 3 + k]];
+				vertexOwner = vertexOwner == noBlock || vertexOwner == block ? uint32_t(block) : sharedVertex;
+			}
+		}
+	}
+	const std::vector<uint8_t> seam = findSeamVertices(positions);
+
+	const double keepRatio = std::min(1.0, double(targetIndexCount) / double(indices.size()));
+	std::vector<std::vector<unsigned int>> blockOutput(blockCount);
+	std::vector<double> blockError(blockCount, 0.0);
+	const size_t workerCount = std::min<size_t>(Parallel::resolveThreadCount(threadCount), blockCount);
+	std::atomic<size_t> nextBlock{ 0 };
+	Parallel::run(workerCount, [&](size_t)
+	{
+		LocalMesh mesh;
+		for (size_t block = nextBlock++; block < blockCount; block = nextBlock++)
+		{
+			const size_t first = block * blockTriangles;
+			const size_t count = std::min(triangles.size(), first + blockTriangles) - first;
+
+			mesh.globalVertices.clear();
+			for (size_t i = first; i < first + count; ++i)
+			{
+				for (int k = 0; k < 3; ++k)
+				{
+					mesh.globalVertices.push_back(indices[size_t(triangles[i]) * 3 + k]);
+				}
+			}
+			std::sort(mesh.globalVertices.begin(), mesh.globalVertices.end());
+			mesh.globalVertices.erase(std::unique(mesh.globalVertices.begin(), mesh.globalVertices.end()), mesh.globalVertices.end());
+
+			const size_t vertexCount = mesh.globalVertices.size();
+			mesh.x.resize(vertexCount);
+			mesh.y.resize(vertexCount);
+			mesh.z.resize(vertexCount);
+			mesh.kind.resize(vertexCount);
+			for (size_t v = 0; v < vertexCount; ++v)
+			{
+				const unsigned int global = mesh.globalVertices[v];
+				mesh.x[v] = positions.x[global];
+				mesh.y[v] = positions.y[global];
+				mesh.z[v] = positions.z[global];
+				mesh.kind[v] = owner[global] == sharedVertex || seam[global] ? Locked : Manifold;
+			}
+			mesh.corners.resize(count * 3);
+			for (size_t i = 0; i < count; ++i)
+			{
+				for (int k = 0; k < 3; ++k)
+				{
+					const unsigned int global = indices[size_t(triangles[first + i]) * 3 + k];
+					mesh.corners[i * 3 + k] = uint32_t(std::lower_bound(mesh.globalVertices.begin(), mesh.globalVertices.end(), global) - mesh.globalVertices.begin());
+				}
+			}
+
+			blockError[block] = simplifyBlock(mesh, size_t(std::llround(double(count) * keepRatio)));
+			std::vector<unsigned int>& output = blockOutput[block];
+			output.resize(mesh.corners.size());
+			for (size_t i = 0; i < mesh.corners.size(); ++i)
+			{
+				output[i] = mesh.globalVertices[mesh.corners[i]];
+			}
+		}
+	});
+
+	size_t total = 0;
+	double maxError = 0.0;
+	for (size_t block = 0; block < blockCount; ++block)
+	{
+		total += blockOutput[block].size();
+		maxError = std::max(maxError, blockError[block]);
+	}
+	out.reserve(total);
+	for (const auto& output : blockOutput)
+	{
+		out.insert(out.end(), output.begin(), output.end());
+	}
+	return float(maxError);
+}
+
+void MeshSimplifier::buildLodChain(Vec3Streams positions, std::span<const unsigned int> indices, std::span<const float> ratios, LodChain& out, unsigned int threadCount)
+{
+	out.clear();
+	std::vector<unsigned int> previous(indices.begin(), indices.end());
+	std::vector<unsigned int> level;
+	float error = 0.0f;
+	for (float ratio : ratios)
+	{
+		const size_t target = size_t(double(indices.size() / 3) * ratio) * 3;
+		error += simplify(positions, previous, target, level, threadCount);
+		if (level.empty() || level.size() >= previous.size())
+		{
+			break; // Nothing left to collapse, coarser levels would repeat this one
+		}
+		out.levels.push_back({ uint32_t(out.indices.size()), uint32_t(level.size()), error, ratio });
+		out.indices.insert(out.indices.end(), level.begin(), level.end());
+		previous.swap(level);
+	}
+}
+
+float MeshSimplifier::pixelsPerUnit(float distance, float viewportHeight, float verticalFov)
+{
+	return viewportHeight / (2.0f * std::tan(verticalFov * 0.5f) * std::max(distance, 1e-6f));
+}
\ No newline at end of file
@@ -0,0 +1,312 @@
+// Morton-ordered greedy meshlet clustering with per-cluster spheres, boxes and normal cones
+
+#include "MeshletBuilder.h"
+#include <algorithm>
+#include <atomic>
+#include "MeshKernels.h"
+#include "Parallel.h"
+
+namespace
+{
+	// Triangles per independently clustered block, fixed so the output never depends on the thread count
+	constexpr size_t blockTriangles = 1 << 14;
+	constexpr uint8_t notInMeshlet = 0xFF;
+
+	// Sphere, box and normal cone of one finished meshlet
+	void computeMeshletBounds(Vec3Streams p, const MeshletData& data, Meshlet& meshlet)
+	{
+		float low[3] = { 0.0f, 0.0f, 0.0f }, high[3] = { 0.0f, 0.0f, 0.0f };
+		for (uint32_t i = 0; i < meshlet.vertexCount; ++i)
+		{
+			const unsigned int v = data.vertices[meshlet.vertexOffset + i];
+			const float position[3] = { p.x[v], p.y[v], p.z[v] };
+			for (int axis = 0; axis < 3; ++axis)
+			{
+				low[axis] = i == 0 ? position[axis] : std::min(low[axis], position[axis]);
+				high[axis] = i == 0 ? position[axis] : std::max(high[axis], position[axis]);
+			}
+		}
+		float radiusSquared = 0.0f;
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			meshlet.boundsMin[axis] = low[axis];
+			meshlet.boundsMax[axis] = high[axis];
+			meshlet.center[axis] = (low[axis] + high[axis]) * 0.5f;
+		}
+		for (uint32_t i = 0; i < meshlet.vertexCount; ++i)
+		{
+			const unsigned int v = data.vertices[meshlet.vertexOffset + i];
+			const float dx = p.x[v] - meshlet.center[0], dy = p.y[v] - meshlet.center[1], dz = p.z[v] - meshlet.center[2];
+			radiusSquared = std::max(radiusSquared, dx * dx + dy * dy + dz * dz);
+		}
+		meshlet.radius = std::sqrt(radiusSquared);
+
+		// Cone around the average face normal, widened to the least aligned triangle
+		std::vector<float> normals;
+		normals.reserve(meshlet.triangleCount * 3);
+		float axis[3] = { 0.0f, 0.0f, 0.0f };
+		for (uint32_t t = 0; t < meshlet.triangleCount; ++t)
+		{
+			const uint8_t* corner = &data.triangles[(size_t(meshlet.triangleOffset) + t) * 3];
+			const unsigned int a = data.vertices[meshlet.vertexOffset + corner[0]];
+			const unsigned int b = data.vertices[meshlet.vertexOffset + corner[1]];
+			const unsigned int c = data.vertices[meshlet.vertexOffset + corner[2]];
+			const float e1x = p.x[b] - p.x[a], e1y = p.y[b] - p.y[a], e1z = p.z[b] - p.z[a];
+			const float e2x = p.x[c] - p.x[a], e2y = p.y[c] - p.y[a], e2z = p.z[c] - p.z[a];
+			const float nx = e1y * e2z - e1z * e2y, ny = e1z * e2x - e1x * e2z, nz = e1x * e2y - e1y * e2x;
+			const float length = std::sqrt(nx * nx + ny * ny + nz * nz);
+			if (length > 0.0f)
+			{
+				normals.insert(normals.end(), { nx / length, ny / length, nz / length });
+				axis[0] += nx / length;
+				axis[1] += ny / length;
+				axis[2] += nz / length;
+			}
+		}
+		const float axisLength = std::sqrt(axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2]);
+		float minDot = 1.0f;
+		if (axisLength > 0.0f)
+		{
+			for (int k = 0; k < 3; ++k)
+			{
+				axis[k] /= axisLength;
+			}
+			for (size_t i = 0; i < normals.size(); i += 3)
+			{
+				minDot = std::min(minDot, normals[i] * axis[0] + normals[i + 1] * axis[1] + normals[i + 2] * axis[2]);
+			}
+		}
+		else
+		{
+			axis[2] = 1.0f;
+			minDot = -1.0f;
+		}
+		for (int k = 0; k < 3; ++k)
+		{
+			meshlet.coneAxis[k] = axis[k];
+		}
+		// Cones wider than a hemisphere (plus a margin for the sphere approximation) never cull anything
+		meshlet.coneCutoff = minDot > 0.1f ? std::sqrt(1.0f - minDot * minDot) : 1.0f;
+	}
+
+	// Grow meshlets over the triangles of one block, always taking the adjacent triangle that adds the fewest new
+	// vertices and, among those, the one closest to the meshlet's centroid so clusters stay round.
+	// A meshlet closes when the next triangle would not fit.
+	void buildBlock(Vec3Streams p, std::span<const unsigned int> indices, const unsigned int* triangles, size_t triangleCount, MeshletData& out)
+	{
+		const size_t cornerCount = triangleCount * 3;
+		std::vector<unsigned int> globalIds(cornerCount);
+		for (size_t t = 0; t < triangleCount; ++t)
+		{
+			for (int k = 0; k < 3; ++k)
+			{
+				globalIds[t * 3 + k] = indices[size_t(triangles[t]) * 3 + k];
+			}
+		}
+		std::vector<unsigned int> local(globalIds);
+		std::sort(globalIds.begin(), globalIds.end());
+		globalIds.erase(std::unique(globalIds.begin(), globalIds.end()), globalIds.end());
+		const size_t vertexCount = globalIds.size();
+		for (unsigned int& vertex : local)
+		{
+			vertex = unsigned(std::lower_bound(globalIds.begin(), globalIds.end(), vertex) - globalIds.begin());
+		}
+
+		// Vertex to triangle adjacency as offsets into one flat list
+		std::vector<unsigned int> adjacencyOffset(vertexCount + 1, 0);
+		for (unsigned int vertex : local)
+		{
+			++adjacencyOffset[vertex + 1];
+		}
+		for (size_t v = 0; v < vertexCount; ++v)
+		{
+			adjacencyOffset[v + 1] += adjacencyOffset[v];
+		}
+		std::vector<unsigned int> adjacency(cornerCount);
+		std::vector<unsigned int> fill(adjacencyOffset.begin(), adjacencyOffset.end() - 1);
+		for (size_t i = 0; i < cornerCount; ++i)
+		{
+			adjacency[fill[local[i]]++] = unsigned(i / 3);
+		}
+
+		std::vector<uint8_t> slot(vertexCount, notInMeshlet); // Position of a block vertex in the open meshlet
+		std::vector<char> used(triangleCount, 0);
+		std::vector<unsigned int> meshletVertices; // Block-local ids
+		std::vector<uint8_t> meshletTriangles;
+		meshletVertices.reserve(MeshletData::maxVertices);
+		meshletTriangles.reserve(MeshletData::maxTriangles * 3);
+
+		std::vector<float> centroids(triangleCount * 3);
+		for (size_t t = 0; t < triangleCount; ++t)
+		{
+			const unsigned int a = globalIds[local[t * 3]], b = globalIds[local[t * 3 + 1]], c = globalIds[local[t * 3 + 2]];
+			centroids[t * 3] = (p.x[a] + p.x[b] + p.x[c]) / 3.0f;
+			centroids[t * 3 + 1] = (p.y[a] + p.y[b] + p.y[c]) / 3.0f;
+			centroids[t * 3 + 2] = (p.z[a] + p.z[b] + p.z[c]) / 3.0f;
+		}
+		float centroidSum[3] = { 0.0f, 0.0f, 0.0f }; // Sum of the open meshlet's triangle centroids
+
+		auto newVertexCount = [&](size_t t)
+		{
+			return unsigned(slot[local[t * 3]] == notInMeshlet) + unsigned(slot[local[t * 3 + 1]] == notInMeshlet) + unsigned(slot[local[t * 3 + 2]] == notInMeshlet);
+		};
+		auto closeMeshlet = [&]()
+		{
+			if (meshletTriangles.empty())
+			{
+				return;
+			}
+			Meshlet meshlet = {};
+			meshlet.vertexOffset = uint32_t(out.vertices.size());
+			meshlet.triangleOffset = uint32_t(out.triangles.size() / 3);
+			meshlet.vertexCount = uint32_t(meshletVertices.size());
+			meshlet.triangleCount = uint32_t(meshletTriangles.size() / 3);
+			for (unsigned int vertex : meshletVertices)
+			{
+				out.vertices.push_back(globalIds[vertex]);
+				slot[vertex] = notInMeshlet;
+			}
+			out.triangles.insert(out.triangles.end(), meshletTriangles.begin(), meshletTriangles.end());
+			computeMeshletBounds(p, out, meshlet);
+			out.meshlets.push_back(meshlet);
+			meshletVertices.clear();
+			meshletTriangles.clear();
+			centroidSum[0] = centroidSum[1] = centroidSum[2] = 0.0f;
+		};
+
+		size_t cursor = 0;
+		size_t remaining = triangleCount;
+		while (remaining > 0)
+		{
+			// Best unused neighbour of the open meshlet, remaining ties go to the earlier triangle in Morton order
+			size_t best = triangleCount;
+			unsigned int bestCost = 4;
+			float bestDistance = 0.0f;
+			const float openTriangles = float(meshletTriangles.size() / 3);
+			const float center[3] = {
+				openTriangles > 0.0f ? centroidSum[0] / openTriangles : 0.0f,
+				openTriangles > 0.0f ? centroidSum[1] / openTriangles : 0.0f,
+				openTriangles > 0.0f ? centroidSum[2] / openTriangles : 0.0f };
+			for (unsigned int vertex : meshletVertices)
+			{
+				for (unsigned int i = adjacencyOffset[vertex]; i < adjacencyOffset[vertex + 1]; ++i)
+				{
+					const unsigned int t = adjacency[i];
+					if (used[t])
+					{
+						continue;
+					}
+					const unsigned int cost = newVertexCount(t);
+					if (cost > bestCost)
+					{
+						continue;
+					}
+					const float dx = centroids[t * 3] - center[0], dy = centroids[t * 3 + 1] - center[1], dz = centroids[t * 3 + 2] - center[2];
+					const float distance = dx * dx + dy * dy + dz * dz;
+					if (cost < bestCost || distance < bestDistance || (distance == bestDistance && t < best))
+					{
+						best = t;
+						bestCost = cost;
+						bestDistance = distance;
+					}
+				}
+			}
+
+			if (best == triangleCount)
+			{
+				// Nothing connected is left, continue with the next unused triangle along the curve. It is close by
+				// in space, and filling the meshlet up keeps the cluster count low.
+				while (used[cursor])
+				{
+					++cursor;
+				}
+				best = cursor;
+				bestCost = newVertexCount(best);
+			}
+			if (meshletVertices.size() + bestCost > MeshletData::maxVertices || meshletTriangles.size() / 3 + 1 > MeshletData::maxTriangles)
+			{
+				closeMeshlet();
+				bestCost = 3;
+			}
+
+			used[best] = 1;
+			--remaining;
+			for (int k = 0; k < 3; ++k)
+			{
+				centroidSum[k] += centroids[best * 3 + k];
+			}
+			for (int k = 0; k < 3; ++k)
+			{
+				const unsigned int vertex = local[best * 3 + k];
+				if (slot[vertex] == notInMeshlet)
+				{
+					slot[vertex] = uint8_t(meshletVertices.size());
+					meshletVertices.push_back(vertex);
+				}
+				meshletTriangles.push_back(slot[vertex]);
+			}
+		}
+		closeMeshlet();
+	}
+}
+
+void MeshletBuilder::build(Vec3Streams positions, std::span<const unsigned int> indices, const MeshBounds& bounds, MeshletData& out, unsigned int threadCount)
+{
+	out.clear();
+	const size_t triangleCount = indices.size() / 3;
+	if (triangleCount == 0 || positions.empty())
+	{
+		return;
+	}
+
+	const std::vector<unsigned int> order = MeshKernels::mortonTriangleOrder(positions, indices, bounds);
+
+	// Out-of-range indices would make the bounds read garbage, such triangles are left out
+	std::vector<unsigned int> valid;
+	valid.reserve(triangleCount);
+	for (unsigned int t : order)
+	{
+		if (indices[size_t(t) * 3] < positions.count && indices[size_t(t) * 3 + 1] < positions.count && indices[size_t(t) * 3 + 2] < positions.count)
+		{
+			valid.push_back(t);
+		}
+	}
+
+	const size_t blockCount = (valid.size() + blockTriangles - 1) / blockTriangles;
+	std::vector<MeshletData> blocks(blockCount);
+	const size_t workerCount = std::min<size_t>(Parallel::resolveThreadCount(threadCount), blockCount);
+	std::atomic<size_t> nextBlock{ 0 };
+	Parallel::run(workerCount, [&](size_t)
+	{
+		for (size_t block = nextBlock++; block < blockCount; block = nextBlock++)
+		{
+			const size_t first = block * blockTriangles;
+			buildBlock(positions, indices, valid.data() + first, std::min(blockTriangles, valid.size() - first), blocks[block]);
+		}
+	});
+
+	// Concatenate in block order, rebasing every block's offsets
+	size_t meshletCount = 0, vertexCount = 0, triangleBytes = 0;
+	for (const MeshletData& block : blocks)
+	{
+		meshletCount += block.meshlets.size();
+		vertexCount += block.vertices.size();
+		triangleBytes += block.triangles.size();
+	}
+	out.meshlets.reserve(meshletCount);
+	out.vertices.reserve(vertexCount);
+	out.triangles.reserve(triangleBytes);
+	for (const MeshletData& block : blocks)
+	{
+		const uint32_t vertexBase = uint32_t(out.vertices.size());
+		const uint32_t triangleBase = uint32_t(out.triangles.size() / 3);
+		for (Meshlet meshlet : block.meshlets)
+		{
+			meshlet.vertexOffset += vertexBase;
+			meshlet.triangleOffset += triangleBase;
+			out.meshlets.push_back(meshlet);
+		}
+		out.vertices.insert(out.vertices.end(), block.vertices.begin(), block.vertices.end());
+		out.triangles.insert(out.triangles.end(), block.triangles.begin(), block.triangles.end());
+	}
+}
\ No newline at end of file
@@ -1,126 +1,1243 @@
-// Parsing .obj file into verices and indices
+// Loading .obj, glTF, .ply and .stl files into vertices and indices
 
 #include "Model.h"
+#include <chrono>
+#include <climits>
+#include <iterator>
+#include <QCryptographicHash>
 #include <QFile>
-#include <QTextStream>
+#include <QFileInfo>
+#include "FileBlockReader.h"
+#include "GltfLoader.h"
+#include "ObjParser.h"
+#include "OutOfCoreMesh.h"
+#include "PlyReader.h"
+#include "StlLoader.h"
+#include "Parallel.h"
+#include "MeshCache.h"
+#include "MeshKernels.h"
+#include "MeshOptimizer.h"
+#include "MeshSimplifier.h"
+#include "Trace.h"
+#include "VertexWelder.h"
+#include <QDebug>
 
-Model::Model() {}
+namespace
+{
+	// What the preview of an out-of-core load may cost in memory per triangle through the rest of the load and packing
+	constexpr size_t previewBytesPerTriangle = 256;
+	// Positions of an out-of-core .ply file decoded at a time before they go to the scratch file
+	constexpr size_t plyVertexWindow = 1 << 20;
+	// Pieces of the parsed part of an .obj file hashed for appends, 20 bytes of hash per piece. An append check
+	// compares the first and last piece and up to appendSamplePieces between, about 1 MB whatever the file size.
+	constexpr qint64 appendPieceBytes = 64 * 1024;
+	constexpr size_t appendSamplePieces = 16;
+
+	// Source's components after destination's
+	void appendStreams(const Vec3Array& source, Vec3Array& destination)
+	{
+		destination.x.insert(destination.x.end(), source.x.begin(), source.x.end());
+		destination.y.insert(destination.y.end(), source.y.begin(), source.y.end());
+		destination.z.insert(destination.z.end(), source.z.begin(), source.z.end());
+	}
+
+	// Sha1 of each appendPieceBytes piece of a text fed in parts of any size. Starts after the full pieces of an
+	// earlier run, all pieces but the last are full.
+	class PieceHasher
+	{
+	public:
+		explicit PieceHasher(std::vector<QByteArray> fullPieces = {}) : hashes(std::move(fullPieces)) {}
+
+		void add(const char* begin, const char* end)
+		{
+			while (begin < end)
+			{
+				const qint64 bytes = std::min<qint64>(end - begin, appendPieceBytes - pieceBytes);
+				hash.addData(QByteArray::fromRawData(begin, bytes));
+				begin += bytes;
+				pieceBytes += bytes;
+				if (pieceBytes == appendPieceBytes)
+				{
+					hashes.push_back(hash.result());
+					hash.reset();
+					pieceBytes = 0;
+				}
+			}
+		}
+		// Hashes of all pieces, the last one short if the text ended inside it
+		std::vector<QByteArray> finish()
+		{
+			if (pieceBytes > 0)
+			{
+				hashes.push_back(hash.result());
+			}
+			return std::move(hashes);
+		}
+
+	private:
+		QCryptographicHash hash{ QCryptographicHash::Sha1 };
+		qint64 pieceBytes = 0;
+		std::vector<QByteArray> hashes;
+	};
+
+	void logWeldStats(const WeldStats& stats)
+	{
+		qInfo().nospace() << "Welded " << stats.cornerCount << " corners into " << stats.vertexCount << " vertices (x"
+			<< stats.dedupRatio() << " dedup, " << stats.cornersPerSecond() / 1.0e6 << " M corners/s)";
+	}
+
+	void logLodLevels(LodChainView lods, const MeshBounds& bounds)
+	{
+		for (const LodLevel& level : lods.levels)
+		{
+			qInfo().nospace() << "  " << level.ratio * 100.0f << "%: " << level.indexCount / 3 << " triangles, error " << level.error
+				<< " (" << (bounds.radius > 0.0f ? level.error / bounds.radius * 100.0f : 0.0f) << "% of radius)";
+		}
+	}
+}
+
+// What an .obj load keeps for appendText(). "Complete" is the text up to the last '\n', a last line without one is
+// drawn but taken back once the rest of it arrives.
+struct ObjAppendState
+{
+	QString filePath; // Absolute
+	qint64 parsedBytes = 0; // End of the complete lines
+	qint64 fileSize = 0;
+	QDateTime modified;
+	std::vector<QByteArray> prefixHashes; // Of the appendPieceBytes pieces of the complete lines
+	ObjParser::RecordCounts records; // In the complete lines
+	size_t indexCount = 0; // Indices from the complete lines
+	bool fileNormals = false; // The vn records are the normals, generated from normalSums otherwise
+	Vec3Array normalSums; // Face normal sums of the complete lines, not normalized
+	std::vector<unsigned int> partialTouched; // Vertices whose normal also has the last line's faces in it
+};
 
-bool Model::loadFromFile(const QString& filePath)
+const char* loadStageName(LoadStage stage)
+{
+	switch (stage)
+	{
+	case LoadStage::Read: return "Reading";
+	case LoadStage::Parse: return "Parsing";
+	case LoadStage::Normals: return "Generating normals";
+	case LoadStage::Optimize: return "Optimizing";
+	case LoadStage::Pack: return "Packing";
+	}
+	return "";
+}
+
+Model::Model() : parseThreadCount(0), optimizeOnLoad(false), lodChainOnLoad(false), stlSmoothing(true), stlWeldEpsilon(0.0f), outOfCoreBudget(0), incrementalReload(false), meshCache(nullptr) {}
+
+Model::~Model() {}
+
+void Model::clear()
 {
 	vertices.clear();
 	indices.clear();
 	normals.clear();
+	texcoords.clear();
+	cachedMesh.reset();
+	gltfAsset.reset();
+	outOfCore.reset();
+	previewRanges.clear();
+	appendState.reset();
+	vertexView = {};
+	indexView = {};
+	normalView = {};
+	texcoordView = {};
+	bounds = MeshBounds();
+	meshlets.clear();
+	lods.clear();
+	lodView = {};
+	weldStats = WeldStats();
+}
 
-	QFile file(filePath);
-	if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+bool Model::loadFromFile(const QString& filePath, const LoadProgress* progress)
+{
+	TRACE_ZONE("Model::loadFromFile");
+	return load(filePath, progress, nullptr, 0);
+}
+
+bool Model::loadGltfMesh(const QString& filePath, std::shared_ptr<const GltfAsset> asset, unsigned int mesh, const LoadProgress* progress)
+{
+	TRACE_ZONE("Model::loadGltfMesh");
+	return asset && load(filePath, progress, std::move(asset), mesh);
+}
+
+bool Model::load(const QString& filePath, const LoadProgress* progress, std::shared_ptr<const GltfAsset> gltfScene, unsigned int gltfMesh)
+{
+	clear();
+	auto report = [progress](LoadStage stage, double fraction)
+	{
+		if (progress && progress->report)
+		{
+			progress->report(stage, fraction);
+		}
+	};
+	auto canceled = [this, progress]()
+	{
+		if (progress && progress->canceled())
+		{
+			clear();
+			return true;
+		}
+		return false;
+	};
+
+	// A cache hit maps the finished arrays and skips parsing and normal generation entirely
+	MeshCache::Key cacheKey;
+	QByteArray variant = optimizeOnLoad ? "optimized" : "";
+	if (lodChainOnLoad)
+	{
+		variant += "+lod";
+	}
+	if (StlLoader::isStlFile(filePath))
+	{
+		variant += stlSmoothing ? "+weld" + QByteArray::number(stlWeldEpsilon) : QByteArray("+flat");
+	}
+	if (gltfScene)
+	{
+		variant += "+mesh" + QByteArray::number(gltfMesh);
+	}
+	// Out-of-core loads keep their chunks in a scratch file that only lives as long as the model, they are not cached
+	const bool chunked = outOfCoreBudget > 0 && !GltfLoader::isGltfFile(filePath);
+	// An .obj watched for appends has to be parsed to keep its append state, and each version of it would be stored
+	const bool watched = incrementalReload && !GltfLoader::isGltfFile(filePath) && !PlyReader::isPlyFile(filePath) && !StlLoader::isStlFile(filePath);
+	const bool cacheable = !chunked && !watched && meshCache && MeshCache::makeKey(filePath, cacheKey, variant);
+	if (cacheable)
+	{
+		TRACE_ZONE("Mesh cache lookup");
+		if (auto mesh = meshCache->load(cacheKey))
+		{
+			cachedMesh = mesh;
+			vertexView = mesh->vertices;
+			indexView = mesh->indices;
+			normalView = mesh->normals;
+			texcoordView = mesh->texcoords;
+			lodView = mesh->lods;
+			bounds = mesh->bounds;
+			report(LoadStage::Optimize, 1.0);
+			return true;
+		}
+	}
+
+	// Positions, indices and normals from the file, everything after that is the same for every format
+	bool loaded = false;
+	if (chunked)
+	{
+		loaded = loadOutOfCore(filePath, report, canceled);
+	}
+	else if (GltfLoader::isGltfFile(filePath))
+	{
+		loaded = loadGltf(filePath, report, std::move(gltfScene), gltfMesh);
+	}
+	else if (PlyReader::isPlyFile(filePath))
+	{
+		loaded = loadPly(filePath, report, canceled);
+	}
+	else if (StlLoader::isStlFile(filePath))
+	{
+		loaded = loadStl(filePath, report);
+	}
+	else
+	{
+		loaded = loadObj(filePath, report, canceled);
+	}
+	if (!loaded)
 	{
+		clear();
 		return false;
 	}
 
-	QTextStream in(&file);
-	std::vector<QVector3D> tempVertices;
-	std::vector<QVector3D> tempNormals;
-	std::vector<unsigned int> tempIndices;
+	{
+		TRACE_ZONE("Compute bounds");
+		bounds = MeshKernels::computeBounds(vertices.view());
+	}
+	updateViews();
+	report(LoadStage::Normals, 1.0);
+	if (canceled())
+	{
+		return false;
+	}
 
-	while (!in.atEnd())
+	if (optimizeOnLoad)
 	{
-		QString line = in.readLine().trimmed();
-		if (line.startsWith("v ")) // .obj way of telling us that vertice coordinates are next
+		optimizeVertexOrder();
+		report(LoadStage::Optimize, lodChainOnLoad ? 0.5 : 1.0);
+		if (canceled())
 		{
-			QStringList parts = line.split(' ', Qt::SkipEmptyParts);
-			if (parts.size() >= 4)
-			{
-				float x = parts[1].toFloat();
-				float y = parts[2].toFloat();
-				float z = parts[3].toFloat();
-				tempVertices.push_back(QVector3D(x, y, z));
-			}
+			return false;
 		}
-		else if (line.startsWith("vn "))
+	}
+	if (lodChainOnLoad)
+	{
+		buildLodChain();
+		if (canceled())
 		{
-			QStringList parts = line.split(' ', Qt::SkipEmptyParts);
-			if (parts.size() >= 4)
-			{
-				float x = parts[1].toFloat();
-				float y = parts[2].toFloat();
-				float z = parts[3].toFloat();
-				tempNormals.push_back(QVector3D(x, y, z));
-			}
+			return false;
 		}
-		else if (line.startsWith("f ")) // .obj format to tell us that faces indices are next
+	}
+	report(LoadStage::Optimize, 1.0);
+
+	if (cacheable)
+	{
+		TRACE_ZONE("Mesh cache store");
+		meshCache->store(cacheKey, vertexView, normalView, texcoordView, indexView, bounds, lodView);
+	}
+	return true;
+}
+
+bool Model::loadObj(const QString& filePath, const ReportFunction& report, const std::function<bool()>& canceled, OutOfCoreMesh* chunked)
+{
+	// Line-aligned blocks parse independently and append to data, while one block is tokenized in place the
+	// reader thread already fetches the next
+	ObjData data;
+	std::unique_ptr<ObjAppendState> state;
+	if (incrementalReload && !optimizeOnLoad && !lodChainOnLoad && !chunked) // Both reorder what an append would extend
+	{
+		state = std::make_unique<ObjAppendState>();
+	}
+	// Out of core, each block's records move on to chunked and leave data empty for the next: the vertices go to the
+	// scratch file, then the faces, which index vertices of this block and the ones before, follow as 64-bit indices
+	ObjParser::RecordCounts streamed;
+	std::vector<uint64_t> wideIndices;
+	auto streamBlock = [&data, &streamed, &wideIndices, chunked]()
+	{
+		if (streamed.vertices + data.vertices.size() > UINT_MAX)
+		{
+			qCritical() << "More vertices than 32-bit .obj indices can address";
+			return false;
+		}
+		wideIndices.assign(data.indices.begin(), data.indices.end());
+		const bool added = chunked->addVertices(data.vertices.view()) && chunked->addIndexedTriangles(wideIndices);
+		streamed.vertices += data.vertices.size();
+		streamed.texcoords += data.texcoords.size();
+		streamed.normals += data.normals.size();
+		data.vertices.clear();
+		data.texcoords.clear();
+		data.normals.clear();
+		data.indices.clear();
+		data.attributeIndices = false;
+		data.texcoordIndices.clear();
+		data.normalIndices.clear();
+		return added;
+	};
+	{
+		FileBlockReader reader(filePath, FileBlockReader::defaultBlockBytes, true);
+		std::span<const char> block;
+		ObjParseScratch scratch; // Chunk arrays shared by all blocks, freed together once the file is parsed
+		PieceHasher prefix;
+		qint64 parsedBytes = 0;
+		while (reader.next(block))
 		{
-			QStringList parts = line.split(' ', Qt::SkipEmptyParts);
-			if (parts.size() >= 4)
+			const char* begin = block.data();
+			const char* end = begin + block.size();
+			// Blocks end after a '\n' except at the end of the file, a last line without one is parsed on its own there
+			const char* complete = end;
+			if (state && begin < end && end[-1] != '\n')
 			{
-				std::vector<int> faceIndices;
-				for (int i = 1; i < parts.size(); ++i)
+				while (complete > begin && complete[-1] != '\n') --complete;
+			}
+			{
+				TRACE_ZONE("Parse block");
+				if (chunked)
 				{
-					QStringList indexParts = parts[i].split('/');
-					if (!indexParts.isEmpty())
+					ObjParser::parseContinuation(begin, complete, streamed, data, parseThreadCount, &scratch);
+					if (!streamBlock())
 					{
-						faceIndices.push_back(indexParts[0].toUInt() - 1); // .obj indices are 1-based
+						return false;
 					}
 				}
-
-				// Triangulate if more than 3 vertices (fan triangulation)
-				for (int i = 1; i < faceIndices.size() - 1; ++i)
+				else
 				{
-					tempIndices.push_back(faceIndices[0]);
-					tempIndices.push_back(faceIndices[i]);
-					tempIndices.push_back(faceIndices[i + 1]);
+					ObjParser::parseParallel(begin, complete, data, parseThreadCount, &scratch);
 				}
 			}
+			if (state)
+			{
+				state->parsedBytes = parsedBytes + (complete - begin);
+				state->records = { data.vertices.size(), data.texcoords.size(), data.normals.size() };
+				state->indexCount = data.indices.size();
+				prefix.add(begin, complete);
+				ObjParser::parse(complete, end, data);
+			}
+			parsedBytes += static_cast<qint64>(block.size());
+			const double fileSize = static_cast<double>(std::max<qint64>(reader.fileSize(), 1));
+			report(LoadStage::Read, reader.bytesRead() / fileSize);
+			report(LoadStage::Parse, parsedBytes / fileSize);
+			if (canceled())
+			{
+				return false;
+			}
+		}
+		if (reader.failed())
+		{
+			return false;
+		}
+		if (state)
+		{
+			state->fileSize = parsedBytes;
+			state->prefixHashes = prefix.finish();
 		}
 	}
+	if (chunked)
+	{
+		return true;
+	}
 
-	vertices = tempVertices;
-	indices = tempIndices;
-
-	// If normals are not provided, we can compute them
-	if (tempNormals.empty() && !vertices.empty() && !indices.empty())
+	report(LoadStage::Normals, 0.0);
+	if (data.attributeIndices)
+	{
+		// Faces reference vt/vn separately, give every unique (v, vt, vn) tuple its own vertex
+		weldVertices(data);
+	}
+	else
 	{
-		normals.resize(vertices.size(), QVector3D(0, 0, 0));
+		vertices = std::move(data.vertices);
+		indices = std::move(data.indices);
+
+		// If normals are not provided, we can compute them
+		if (data.normals.empty() && state)
+		{
+			// Same as generateNormals(), but the sums of the complete lines are kept for later appends
+			TRACE_ZONE("Generate normals");
+			state->normalSums.resize(vertices.size(), 0.0f);
+			MeshKernels::accumulateFaceNormals(vertices.view(), indices.data(), state->indexCount, state->normalSums.x.data(), state->normalSums.y.data(), state->normalSums.z.data());
+			normals = state->normalSums;
+			MeshKernels::accumulateFaceNormals(vertices.view(), indices.data() + state->indexCount, indices.size() - state->indexCount, normals.x.data(), normals.y.data(), normals.z.data());
+			MeshKernels::normalize(normals.x.data(), normals.y.data(), normals.z.data(), normals.size());
+			state->partialTouched.assign(indices.begin() + state->indexCount, indices.end());
+		}
+		else if (data.normals.empty())
+		{
+			TRACE_ZONE("Generate normals");
+			generateNormals(vertices.view(), indices, normals);
+		}
+		else
+		{
+			normals = std::move(data.normals);
+		}
+		if (state)
+		{
+			state->filePath = QFileInfo(filePath).absoluteFilePath();
+			state->modified = QFileInfo(filePath).lastModified();
+			state->fileNormals = !normals.empty() && state->normalSums.empty();
+			appendState = std::move(state);
+		}
+	}
+	return true;
+}
 
-		// Calculate face normals and accumulate
-		for (size_t i = 0; i < indices.size(); i += 3)
+ObjAppend Model::readAppendedText(const QString& filePath) const
+{
+	TRACE_ZONE("Model::readAppendedText");
+	ObjAppend append;
+	if (!appendState || QFileInfo(filePath).absoluteFilePath() != appendState->filePath)
+	{
+		return append;
+	}
+	const ObjAppendState& state = *appendState;
+	QFile file(filePath);
+	if (!file.open(QIODevice::ReadOnly))
+	{
+		return append;
+	}
+	append.fileSize = file.size();
+	append.modified = QFileInfo(filePath).lastModified();
+	if (append.fileSize == state.fileSize && append.modified == state.modified)
+	{
+		append.change = ObjAppend::Change::None;
+		return append;
+	}
+	if (append.fileSize <= state.fileSize)
+	{
+		return append;
+	}
+	// Only an append leaves every piece of the parsed text as it was. Like the mesh cache key, the check samples the
+	// pieces so that its cost follows the delta rather than the file size: the first, the last, which is hashed again
+	// with the new text anyway, and evenly spaced ones between, shifted with the file size so that successive appends
+	// compare different ones. Up to appendSamplePieces + 2 pieces are compared whole. An edit that lengthens the file
+	// and leaves every sampled piece alone is taken for an append, the same bargain the cache makes.
+	auto samePiece = [&file, &state](size_t piece, QByteArray& text)
+	{
+		const qint64 offset = static_cast<qint64>(piece) * appendPieceBytes;
+		text = file.seek(offset) ? file.read(std::min(appendPieceBytes, state.parsedBytes - offset)) : QByteArray();
+		return QCryptographicHash::hash(text, QCryptographicHash::Sha1) == state.prefixHashes[piece];
+	};
+	QByteArray lastPiece;
+	if (!state.prefixHashes.empty())
+	{
+		const size_t last = state.prefixHashes.size() - 1;
+		const size_t between = last > 1 ? last - 1 : 0;
+		const size_t samples = std::min(between, appendSamplePieces);
+		const size_t stride = samples > 0 ? between / samples : 1;
+		const size_t shift = static_cast<size_t>(append.fileSize) % stride;
+		QByteArray sample;
+		if (last > 0 && !samePiece(0, sample))
 		{
-			if (i + 2 < indices.size())
+			return append;
+		}
+		for (size_t i = 0; i < samples; ++i)
+		{
+			if (!samePiece(1 + i * stride + shift, sample))
 			{
-				QVector3D v0 = vertices[indices[i]];
-				QVector3D v1 = vertices[indices[i + 1]];
-				QVector3D v2 = vertices[indices[i + 2]];
+				return append;
+			}
+		}
+		if (!samePiece(last, lastPiece))
+		{
+			return append;
+		}
+	}
+	const QByteArray text = file.seek(state.parsedBytes) ? file.read(append.fileSize - state.parsedBytes) : QByteArray();
+	if (text.size() != append.fileSize - state.parsedBytes)
+	{
+		qCritical() << "Cannot read the end of" << filePath;
+		return append;
+	}
 
-				QVector3D normal = QVector3D::crossProduct(v1 - v0, v2 - v0).normalized();
+	const char* begin = text.constData();
+	const char* end = begin + text.size();
+	const char* complete = begin + (text.lastIndexOf('\n') + 1);
+	ObjParser::parseContinuation(begin, complete, state.records, append.lines, parseThreadCount);
+	const ObjParser::RecordCounts records = { state.records.vertices + append.lines.vertices.size(),
+		state.records.texcoords + append.lines.texcoords.size(), state.records.normals + append.lines.normals.size() };
+	ObjParser::parseContinuation(complete, end, records, append.partialLine, 1);
+	append.parsedBytes = state.parsedBytes + (complete - begin);
+	PieceHasher prefix(std::vector<QByteArray>(state.prefixHashes.begin(), state.prefixHashes.end() - (state.prefixHashes.empty() ? 0 : 1)));
+	prefix.add(lastPiece.constData(), lastPiece.constData() + lastPiece.size());
+	prefix.add(begin, complete);
+	append.prefixHashes = prefix.finish();
 
-				normals[indices[i]] += normal;
-				normals[indices[i + 1]] += normal;
-				normals[indices[i + 2]] += normal;
+	// v/vt/vn faces need the whole weld, vn records cannot join generated normals, and faces only use vertices before them
+	auto appendable = [&state](const ObjData& data, size_t vertexCount)
+	{
+		return !data.attributeIndices && (state.fileNormals || data.normals.empty())
+			&& std::all_of(data.indices.begin(), data.indices.end(), [vertexCount](unsigned int index) { return index < vertexCount; });
+	};
+	if (!appendable(append.lines, records.vertices) || !appendable(append.partialLine, records.vertices + append.partialLine.vertices.size()))
+	{
+		return append;
+	}
+	append.change = ObjAppend::Change::Appended;
+	append.keptVertices = state.records.vertices;
+	append.keptNormals = state.fileNormals ? state.records.normals : state.records.vertices;
+	append.keptIndices = state.indexCount;
+	if (!state.fileNormals)
+	{
+		generateAppendedNormals(append);
+	}
+	return append;
+}
+
+// Only the vertices an append adds or touches are gathered, numbered with the new ones first and the touched kept
+// ones after them, so the work follows the size of the append
+void Model::generateAppendedNormals(ObjAppend& append) const
+{
+	TRACE_ZONE("Model::generateAppendedNormals");
+	const ObjAppendState& state = *appendState;
+	const size_t kept = append.keptVertices;
+	const size_t added = append.lines.vertices.size() + append.partialLine.vertices.size();
+
+	// Kept vertices that had the faces of the unterminated line taken back in their normal, or get new faces
+	std::vector<unsigned int>& touched = append.touched;
+	std::copy_if(state.partialTouched.begin(), state.partialTouched.end(), std::back_inserter(touched), [kept](unsigned int v) { return v < kept; });
+	for (const ObjData* data : { &append.lines, &append.partialLine })
+	{
+		std::copy_if(data->indices.begin(), data->indices.end(), std::back_inserter(touched), [kept](unsigned int v) { return v < kept; });
+	}
+	std::sort(touched.begin(), touched.end());
+	touched.erase(std::unique(touched.begin(), touched.end()), touched.end());
+
+	Vec3Array positions;
+	positions.reserve(added + touched.size());
+	appendStreams(append.lines.vertices, positions);
+	appendStreams(append.partialLine.vertices, positions);
+	append.normalSums.reserve(added + touched.size());
+	append.normalSums.resize(added, 0.0f);
+	for (unsigned int v : touched)
+	{
+		positions.push_back(vertexView.x[v], vertexView.y[v], vertexView.z[v]);
+		append.normalSums.push_back(state.normalSums.x[v], state.normalSums.y[v], state.normalSums.z[v]);
+	}
+	std::vector<unsigned int> local;
+	local.reserve(append.lines.indices.size() + append.partialLine.indices.size());
+	for (const ObjData* data : { &append.lines, &append.partialLine })
+	{
+		for (unsigned int v : data->indices)
+		{
+			local.push_back(v >= kept ? static_cast<unsigned int>(v - kept)
+				: static_cast<unsigned int>(added + (std::lower_bound(touched.begin(), touched.end(), v) - touched.begin())));
+		}
+	}
+
+	// Sums over the complete lines are kept for the next append, the unterminated line's faces only go into normals
+	const size_t lineIndices = append.lines.indices.size();
+	MeshKernels::accumulateFaceNormals(positions.view(), local.data(), lineIndices, append.normalSums.x.data(), append.normalSums.y.data(), append.normalSums.z.data());
+	append.normals = append.normalSums;
+	MeshKernels::accumulateFaceNormals(positions.view(), local.data() + lineIndices, local.size() - lineIndices, append.normals.x.data(), append.normals.y.data(), append.normals.z.data());
+	MeshKernels::normalize(append.normals.x.data(), append.normals.y.data(), append.normals.z.data(), append.normals.size());
+}
+
+bool Model::appendText(ObjAppend&& append)
+{
+	if (!appendState || append.change != ObjAppend::Change::Appended || append.parsedBytes < appendState->parsedBytes
+		|| append.keptVertices != appendState->records.vertices || append.keptIndices != appendState->indexCount)
+	{
+		return false;
+	}
+	TRACE_ZONE("Model::appendText");
+	ObjAppendState& state = *appendState;
+
+	// Take back the unterminated last line, the new text starts with all of it
+	const size_t firstVertex = append.keptVertices;
+	vertices.resize(firstVertex);
+	indices.resize(append.keptIndices);
+	normals.resize(append.keptNormals);
+	for (const ObjData* data : { &append.lines, &append.partialLine })
+	{
+		appendStreams(data->vertices, vertices);
+		indices.insert(indices.end(), data->indices.begin(), data->indices.end());
+		if (state.fileNormals)
+		{
+			appendStreams(data->normals, normals);
+		}
+	}
+	if (!state.fileNormals)
+	{
+		// New vertices first, then the touched kept ones, as readAppendedText() generated them
+		const size_t added = vertices.size() - firstVertex;
+		state.normalSums.resize(firstVertex);
+		for (auto [source, destination] : { std::pair{ &append.normalSums, &state.normalSums }, std::pair{ &append.normals, &normals } })
+		{
+			destination->x.insert(destination->x.end(), source->x.begin(), source->x.begin() + added);
+			destination->y.insert(destination->y.end(), source->y.begin(), source->y.begin() + added);
+			destination->z.insert(destination->z.end(), source->z.begin(), source->z.begin() + added);
+			for (size_t i = 0; i < append.touched.size(); ++i)
+			{
+				const unsigned int v = append.touched[i];
+				destination->x[v] = source->x[added + i];
+				destination->y[v] = source->y[added + i];
+				destination->z[v] = source->z[added + i];
 			}
 		}
+		state.partialTouched = append.partialLine.indices;
+	}
+	state.parsedBytes = append.parsedBytes;
+	state.fileSize = append.fileSize;
+	state.modified = append.modified;
+	state.prefixHashes = std::move(append.prefixHashes);
+	state.records.vertices = firstVertex + append.lines.vertices.size();
+	state.records.texcoords += append.lines.texcoords.size();
+	state.records.normals += append.lines.normals.size();
+	state.indexCount = append.keptIndices + append.lines.indices.size();
+
+	// Grow the box and the sphere around the new box center to hold the old sphere and the new vertices, the full
+	// bounds would read every vertex
+	if (vertices.size() > firstVertex)
+	{
+		const MeshBounds added = MeshKernels::computeBounds({ vertices.x.data() + firstVertex, vertices.y.data() + firstVertex, vertices.z.data() + firstVertex, vertices.size() - firstVertex });
+		const MeshBounds previous = firstVertex > 0 ? bounds : added;
+		bounds.min = QVector3D(std::min(previous.min.x(), added.min.x()), std::min(previous.min.y(), added.min.y()), std::min(previous.min.z(), added.min.z()));
+		bounds.max = QVector3D(std::max(previous.max.x(), added.max.x()), std::max(previous.max.y(), added.max.y()), std::max(previous.max.z(), added.max.z()));
+		bounds.center = (bounds.min + bounds.max) * 0.5f;
+		bounds.radius = std::max((previous.center - bounds.center).length() + previous.radius, (added.center - bounds.center).length() + added.radius);
+	}
+	meshlets.clear();
+	lods.clear();
+	updateViews();
+	return true;
+}
+
+// Accessors are decoded straight into the final arrays, a single 32-bit index buffer is used where it lies in the mapping
+bool Model::loadGltf(const QString& filePath, const ReportFunction& report, std::shared_ptr<const GltfAsset> scene, unsigned int mesh)
+{
+	GltfMeshData data;
+	if (scene ? !GltfLoader::loadMesh(filePath, std::move(scene), mesh, data, parseThreadCount) : !GltfLoader::load(filePath, data, parseThreadCount))
+	{
+		return false;
+	}
+	report(LoadStage::Read, 1.0);
+	report(LoadStage::Parse, 1.0);
+	report(LoadStage::Normals, 0.0);
+	vertices = std::move(data.vertices);
+	normals = std::move(data.normals);
+	texcoords = std::move(data.texcoords);
+	indices = std::move(data.indices);
+	gltfAsset = std::move(data.asset);
+	indexView = gltfAsset ? data.indexView : std::span<const unsigned int>(indices);
+	if (normals.empty())
+	{
+		TRACE_ZONE("Generate normals");
+		generateNormals(vertices.view(), indexView, normals);
+	}
+	return true;
+}
 
-		// Normalize the accumulated normals
-		for (auto& normal : normals)
+// Blocks of any size go to the reader, which decodes records straight into the arrays moved in here
+bool Model::loadPly(const QString& filePath, const ReportFunction& report, const std::function<bool()>& canceled, OutOfCoreMesh* chunked)
+{
+	PlyReader reader(parseThreadCount);
+	// Out of core, the vertices stream to the scratch file window by window, whatever their count, and the faces of
+	// every block move on into chunks once the vertices they index are all there
+	if (chunked)
+	{
+		reader.streamVertices(plyVertexWindow, [chunked](Vec3Streams window) { return chunked->addVertices(window); });
+	}
+	auto drainFaces = [&reader, chunked]()
+	{
+		PlyMesh& mesh = reader.getMesh();
+		if (!chunked || !reader.verticesDone() || mesh.wideIndices.empty())
 		{
-			normal.normalize();
+			return true;
 		}
+		const bool added = chunked->addIndexedTriangles(mesh.wideIndices);
+		mesh.wideIndices.clear();
+		return added;
+	};
+	{
+		FileBlockReader blocks(filePath);
+		std::span<const char> block;
+		qint64 parsedBytes = 0;
+		while (blocks.next(block))
+		{
+			{
+				TRACE_ZONE("Parse block");
+				if (!reader.consume(block.data(), block.data() + block.size()) || !drainFaces())
+				{
+					return false;
+				}
+			}
+			parsedBytes += static_cast<qint64>(block.size());
+			const double fileSize = static_cast<double>(std::max<qint64>(blocks.fileSize(), 1));
+			report(LoadStage::Read, blocks.bytesRead() / fileSize);
+			report(LoadStage::Parse, parsedBytes / fileSize);
+			if (canceled())
+			{
+				return false;
+			}
+		}
+		if (blocks.failed() || !reader.finish() || !drainFaces())
+		{
+			return false;
+		}
+	}
+	if (chunked)
+	{
+		return true;
+	}
+
+	report(LoadStage::Normals, 0.0);
+	PlyMesh& mesh = reader.getMesh();
+	vertices = std::move(mesh.vertices);
+	normals = std::move(mesh.normals);
+	texcoords = std::move(mesh.texcoords);
+	indices = std::move(mesh.indices);
+	if (normals.empty())
+	{
+		TRACE_ZONE("Generate normals");
+		generateNormals(vertices.view(), indices, normals);
+	}
+	return true;
+}
+
+// Triangle soup welded for smooth normals, or kept flat with the file's facet normals when smoothing is off
+bool Model::loadStl(const QString& filePath, const ReportFunction& report)
+{
+	auto start = std::chrono::steady_clock::now();
+	StlMeshData data;
+	if (!StlLoader::load(filePath, data, stlSmoothing, stlWeldEpsilon, parseThreadCount))
+	{
+		return false;
+	}
+	const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	const double megabytes = QFileInfo(filePath).size() / (1024.0 * 1024.0);
+	qInfo().nospace() << "Loaded " << data.triangleCount << " " << (data.binary ? "binary" : "ASCII") << " STL triangles, "
+		<< megabytes << " MB in " << seconds << " s (" << (seconds > 0.0 ? megabytes / seconds : 0.0) << " MB/s)";
+	report(LoadStage::Read, 1.0);
+	report(LoadStage::Parse, 1.0);
+	report(LoadStage::Normals, 0.0);
+
+	vertices = std::move(data.vertices);
+	normals = std::move(data.normals);
+	indices = std::move(data.indices);
+	weldStats = data.weldStats;
+	if (weldStats.cornerCount > 0)
+	{
+		logWeldStats(weldStats);
+	}
+	if (normals.empty())
+	{
+		TRACE_ZONE("Generate normals");
+		generateNormals(vertices.view(), indices, normals);
+	}
+	return true;
+}
+
+// Chunks go to a scratch file while parsing. The model itself becomes a preview: every chunk paged in once and
+// simplified by the same ratio, so everything after loading works on a mesh that fits half the budget.
+bool Model::loadOutOfCore(const QString& filePath, const ReportFunction& report, const std::function<bool()>& canceled)
+{
+	auto start = std::chrono::steady_clock::now();
+	auto chunked = std::make_unique<OutOfCoreMesh>(outOfCoreBudget / 2, QString(), parseThreadCount);
+	bool parsed = false;
+	if (StlLoader::isStlFile(filePath))
+	{
+		parsed = StlLoader::loadChunked(filePath, *chunked, parseThreadCount, [&report, &canceled](double fraction)
+		{
+			report(LoadStage::Read, fraction);
+			report(LoadStage::Parse, fraction);
+			return !canceled();
+		});
+	}
+	else if (PlyReader::isPlyFile(filePath))
+	{
+		parsed = loadPly(filePath, report, canceled, chunked.get());
 	}
 	else
 	{
-		normals = tempNormals;
+		parsed = loadObj(filePath, report, canceled, chunked.get());
+	}
+	if (!parsed || !chunked->finish() || chunked->getChunks().empty())
+	{
+		return false;
 	}
+	const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	qInfo().nospace() << "Split " << chunked->getTriangleCount() << " triangles into " << chunked->getChunks().size() << " chunks of up to "
+		<< chunked->getChunkTriangleLimit() << ", " << chunked->getScratchBytes() / (1024.0 * 1024.0) << " MB spilled in " << seconds << " s";
+
+	TRACE_ZONE("Build preview");
+	report(LoadStage::Normals, 0.0);
+	// Every chunk gets its share of the room the preview has left, so a chunk the simplifier could not bring down far
+	// enough is made up for by the ones after it. The budget is a target, 32-bit indices are a limit: a chunk over its
+	// share of the room left below them is simplified again to that share, and thinned to evenly spaced triangles if
+	// even that stops short of it.
+	const uint64_t budgetTriangles = outOfCoreBudget / 2 / previewBytesPerTriangle;
+	const uint64_t maxTriangles = (UINT_MAX - 1) / 3;
+	const uint64_t previewTriangles = std::min(budgetTriangles, maxTriangles);
+	const auto& chunks = chunked->getChunks();
+	uint64_t remainingTriangles = chunked->getTriangleCount();
+	size_t thinnedChunks = 0;
+	std::vector<unsigned int> simplified;
+	std::vector<unsigned int> thinned;
+	std::vector<unsigned int> remap;
+	for (size_t i = 0; i < chunks.size(); ++i)
+	{
+		auto chunk = chunked->page(i);
+		if (!chunk)
+		{
+			return false;
+		}
+		const uint64_t chunkTriangles = chunk->indices.size() / 3;
+		const uint64_t usedTriangles = indices.size() / 3;
+		const uint64_t room = previewTriangles > usedTriangles ? previewTriangles - usedTriangles : 0;
+		const uint64_t share = static_cast<uint64_t>(static_cast<double>(room) * chunkTriangles / remainingTriangles);
+		const uint64_t limitShare = static_cast<uint64_t>(static_cast<double>(maxTriangles - usedTriangles) * chunkTriangles / remainingTriangles);
+		remainingTriangles -= chunkTriangles;
+		std::span<const unsigned int> kept = chunk->indices;
+		if (share < chunkTriangles)
+		{
+			MeshSimplifier::simplify(chunk->vertices, chunk->indices, std::max<uint64_t>(share, 1) * 3, simplified, parseThreadCount);
+			kept = simplified;
+		}
+		if (kept.size() / 3 > limitShare && limitShare > 0)
+		{
+			MeshSimplifier::simplify(chunk->vertices, chunk->indices, limitShare * 3, simplified, parseThreadCount);
+			kept = simplified;
+		}
+		if (kept.size() / 3 > limitShare)
+		{
+			const size_t keptTriangles = kept.size() / 3;
+			thinned.clear();
+			for (uint64_t t = 0; t < limitShare; ++t)
+			{
+				const size_t first = static_cast<size_t>(t * keptTriangles / limitShare) * 3;
+				thinned.insert(thinned.end(), kept.begin() + first, kept.begin() + first + 3);
+			}
+			kept = thinned;
+			++thinnedChunks;
+		}
+
+		// Only the vertices the kept triangles use, with the normals of the full chunk
+		previewRanges.push_back({ static_cast<uint32_t>(indices.size()), static_cast<uint32_t>(kept.size()) });
+		remap.assign(chunk->vertices.size(), UINT_MAX);
+		for (unsigned int index : kept)
+		{
+			if (remap[index] == UINT_MAX)
+			{
+				remap[index] = static_cast<unsigned int>(vertices.size());
+				vertices.x.push_back(chunk->vertices.x[index]);
+				vertices.y.push_back(chunk->vertices.y[index]);
+				vertices.z.push_back(chunk->vertices.z[index]);
+				normals.x.push_back(chunk->normals.x[index]);
+				normals.y.push_back(chunk->normals.y[index]);
+				normals.z.push_back(chunk->normals.z[index]);
+			}
+			indices.push_back(remap[index]);
+		}
+		report(LoadStage::Normals, static_cast<double>(i + 1) / chunks.size());
+		if (canceled())
+		{
+			return false;
+		}
+	}
+	const double ratio = static_cast<double>(indices.size() / 3) / static_cast<double>(chunked->getTriangleCount());
+	qInfo().nospace() << "Out-of-core preview: " << indices.size() / 3 << " of " << chunked->getTriangleCount() << " triangles ("
+		<< ratio * 100.0 << "%), " << chunked->getPagedBytes() / (1024.0 * 1024.0) << " MB of chunks paged in";
+	if (budgetTriangles > maxTriangles && chunked->getTriangleCount() > maxTriangles)
+	{
+		qInfo().nospace() << "Out-of-core preview simplified to " << maxTriangles << " triangles to fit 32-bit indices instead of the "
+			<< budgetTriangles << " the budget has room for";
+	}
+	if (thinnedChunks > 0)
+	{
+		qWarning().nospace() << "Out-of-core preview thinned " << thinnedChunks << " chunks that did not simplify to fit 32-bit indices,"
+			<< " it has holes where triangles were left out";
+	}
+	outOfCore = std::move(chunked);
 	return true;
 }
 
-const std::vector<QVector3D>& Model::getVertices() const
+// Smooth per-vertex normals: area-independent face normals summed per vertex, then normalized
+void Model::generateNormals(Vec3Streams positions, std::span<const unsigned int> faceIndices, Vec3Array& out)
+{
+	out.clear();
+	if (positions.empty() || faceIndices.empty())
+	{
+		return;
+	}
+	out.resize(positions.size(), 0.0f);
+	MeshKernels::accumulateFaceNormals(positions, faceIndices.data(), faceIndices.size(), out.x.data(), out.y.data(), out.z.data());
+	MeshKernels::normalize(out.x.data(), out.y.data(), out.z.data(), out.size());
+}
+
+void Model::weldVertices(ObjData& data)
+{
+	TRACE_ZONE("Weld vertices");
+	std::vector<VertexTuple> tuples;
+	const size_t expected = VertexWelder::estimateVertexCount(data.vertices.size(), data.texcoords.size(), data.normals.size(), data.indices.size());
+	weldStats = VertexWelder::weld(data.indices.data(), data.texcoordIndices.data(), data.normalIndices.data(), data.indices.size(), expected, indices, tuples);
+	logWeldStats(weldStats);
+
+	// Gather the attributes of every welded vertex. File normals are only used when every vertex has one.
+	const size_t vertexCount = tuples.size();
+	vertices.resize(vertexCount);
+	bool useFileNormals = !data.normals.empty();
+	bool useFileTexcoords = !data.texcoords.empty();
+	if (useFileNormals)
+	{
+		normals.resize(vertexCount);
+	}
+	if (useFileTexcoords)
+	{
+		texcoords.resize(vertexCount);
+	}
+	for (size_t i = 0; i < vertexCount; ++i)
+	{
+		const VertexTuple& tuple = tuples[i];
+		if (tuple.position < data.vertices.size())
+		{
+			vertices.x[i] = data.vertices.x[tuple.position];
+			vertices.y[i] = data.vertices.y[tuple.position];
+			vertices.z[i] = data.vertices.z[tuple.position];
+		}
+		if (useFileNormals)
+		{
+			if (tuple.normal < data.normals.size())
+			{
+				normals.x[i] = data.normals.x[tuple.normal];
+				normals.y[i] = data.normals.y[tuple.normal];
+				normals.z[i] = data.normals.z[tuple.normal];
+			}
+			else
+			{
+				useFileNormals = false;
+			}
+		}
+		if (useFileTexcoords && tuple.texcoord < data.texcoords.size())
+		{
+			texcoords.x[i] = data.texcoords.x[tuple.texcoord];
+			texcoords.y[i] = data.texcoords.y[tuple.texcoord];
+		}
+	}
+
+	if (!useFileNormals)
+	{
+		TRACE_ZONE("Generate normals");
+		// Generate per position so vertices split only by vt still share one smooth normal
+		Vec3Array positionNormals;
+		generateNormals(data.vertices.view(), data.indices, positionNormals);
+		normals.resize(vertexCount);
+		for (size_t i = 0; i < vertexCount; ++i)
+		{
+			const unsigned int position = tuples[i].position;
+			const bool valid = position < positionNormals.size();
+			normals.x[i] = valid ? positionNormals.x[position] : 0.0f;
+			normals.y[i] = valid ? positionNormals.y[position] : 0.0f;
+			normals.z[i] = valid ? positionNormals.z[position] : 0.0f;
+		}
+	}
+}
+
+void Model::updateViews()
+{
+	vertexView = vertices.view();
+	indexView = gltfAsset ? indexView : std::span<const unsigned int>(indices);
+	normalView = normals.view();
+	texcoordView = texcoords.view();
+	lodView = lods.view();
+}
+
+// Copy mapped data into owned arrays so it can be modified
+void Model::detachFromMapping()
+{
+	if (gltfAsset)
+	{
+		// Only the indices come from the file, the vertex streams were decoded into owned arrays already
+		indices.assign(indexView.begin(), indexView.end());
+		gltfAsset.reset();
+		updateViews();
+	}
+	if (!cachedMesh)
+	{
+		return;
+	}
+	auto copyStreams = [](Vec3Streams source, Vec3Array& destination)
+	{
+		destination.x.assign(source.x, source.x + source.count);
+		destination.y.assign(source.y, source.y + source.count);
+		destination.z.assign(source.z, source.z + source.count);
+	};
+	copyStreams(vertexView, vertices);
+	copyStreams(normalView, normals);
+	texcoords.x.assign(texcoordView.x, texcoordView.x + texcoordView.count);
+	texcoords.y.assign(texcoordView.y, texcoordView.y + texcoordView.count);
+	indices.assign(indexView.begin(), indexView.end());
+	lods.indices.assign(lodView.indices.begin(), lodView.indices.end());
+	lods.levels.assign(lodView.levels.begin(), lodView.levels.end());
+	cachedMesh.reset();
+	updateViews();
+}
+
+void Model::applyTransform(const QMatrix4x4& matrix)
+{
+	detachFromMapping();
+	appendState.reset(); // Appended positions would come in the old space
+	outOfCore.reset(); // So would the full-resolution chunks
+	previewRanges.clear();
+	MeshKernels::transformPoints(vertices.x.data(), vertices.y.data(), vertices.z.data(), vertices.size(), matrix.constData());
+
+	// Normals go through the inverse transpose and are renormalized, non-uniform scale would skew them otherwise
+	const QMatrix3x3 inverseTranspose = matrix.normalMatrix();
+	const float* n = inverseTranspose.constData(); // Column-major like QMatrix4x4
+	const float normalMatrix[16] = { n[0], n[1], n[2], 0.0f, n[3], n[4], n[5], 0.0f, n[6], n[7], n[8], 0.0f, 0.0f, 0.0f, 0.0f, 1.0f };
+	MeshKernels::transformDirections(normals.x.data(), normals.y.data(), normals.z.data(), normals.size(), normalMatrix);
+	MeshKernels::normalize(normals.x.data(), normals.y.data(), normals.z.data(), normals.size());
+
+	bounds = MeshKernels::computeBounds(vertices.view());
+	meshlets.clear();
+	lods.clear(); // Errors were measured in the old space
+	updateViews();
+}
+
+const MeshletData& Model::buildMeshlets()
+{
+	const auto start = std::chrono::steady_clock::now();
+	MeshletBuilder::build(vertexView, indexView, bounds, meshlets, parseThreadCount);
+	const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	qInfo().nospace() << "Built " << meshlets.meshlets.size() << " meshlets from " << meshlets.triangleCount() << " triangles in " << seconds << " s ("
+		<< (meshlets.empty() ? 0.0 : double(meshlets.vertices.size()) / double(meshlets.meshlets.size())) << " vertices, "
+		<< (meshlets.empty() ? 0.0 : double(meshlets.triangleCount()) / double(meshlets.meshlets.size())) << " triangles per meshlet)";
+	return meshlets;
+}
+const MeshletData& Model::getMeshlets() const
+{
+	return meshlets;
+}
+
+LodChainView Model::buildLodChain(std::span<const float> ratios)
+{
+	TRACE_ZONE("Build LOD chain");
+	detachFromMapping();
+	const auto start = std::chrono::steady_clock::now();
+	MeshSimplifier::buildLodChain(vertexView, indexView, ratios, lods, parseThreadCount);
+	const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	updateViews();
+
+	qInfo().nospace() << "Built " << lods.levels.size() << " LOD levels from " << indexView.size() / 3 << " triangles in " << seconds << " s";
+	logLodLevels(lodView, bounds);
+	return lodView;
+}
+LodChainView Model::getLodChain() const
+{
+	return lodView;
+}
+
+MeshOptimizeReport Model::optimizeVertexOrder()
 {
-	return vertices;
+	MeshOptimizeReport report;
+	detachFromMapping();
+	if (indices.empty() || vertices.empty())
+	{
+		return report;
+	}
+
+	TRACE_ZONE("Optimize vertex order");
+	appendState.reset(); // Renumbered vertices no longer match the file
+	const auto start = std::chrono::steady_clock::now();
+	report.before = MeshOptimizer::analyzeVertexCache(indices.data(), indices.size(), vertices.size());
+	if (previewRanges.empty())
+	{
+		MeshOptimizer::optimizeVertexCache(indices.data(), indices.size(), vertices.size(), parseThreadCount);
+	}
+	// An out-of-core preview keeps each chunk's triangles in its range, the viewport swaps them for the full chunk.
+	// The chunk's vertices are consecutive as well and are numbered from 0 for the call, blocks split its range.
+	for (const IndexRange& range : previewRanges)
+	{
+		unsigned int* first = indices.data() + range.firstIndex;
+		unsigned int* last = first + range.indexCount;
+		if (first == last)
+		{
+			continue;
+		}
+		const auto [lowest, highest] = std::minmax_element(first, last);
+		const unsigned int base = *lowest;
+		const size_t rangeVertices = size_t(*highest) - base + 1;
+		std::for_each(first, last, [base](unsigned int& index) { index -= base; });
+		MeshOptimizer::optimizeVertexCache(first, range.indexCount, rangeVertices, parseThreadCount);
+		std::for_each(first, last, [base](unsigned int& index) { index += base; });
+	}
+
+	// Renumber vertices in the order the new index buffer first touches them, every stream moves together
+	std::vector<unsigned int> remap;
+	MeshOptimizer::optimizeVertexFetch(indices.data(), indices.size(), vertices.size(), remap);
+	for (FloatStream* stream : { &vertices.x, &vertices.y, &vertices.z, &normals.x, &normals.y, &normals.z, &texcoords.x, &texcoords.y })
+	{
+		if (stream->size() == remap.size())
+		{
+			MeshOptimizer::applyRemap(*stream, remap);
+		}
+	}
+	for (unsigned int& index : lods.indices)
+	{
+		index = index < remap.size() ? remap[index] : index;
+	}
+	report.after = MeshOptimizer::analyzeVertexCache(indices.data(), indices.size(), vertices.size());
+	report.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	meshlets.clear();
+	updateViews();
+
+	qInfo().nospace() << "Vertex order optimized in " << report.seconds << " s: ACMR " << report.before.acmr << " -> " << report.after.acmr
+		<< ", ATVR " << report.before.atvr << " -> " << report.after.atvr;
+	return report;
+}
+
+Vec3Streams Model::getVertices() const
+{
+	return vertexView;
+}
+std::span<const unsigned int> Model::getIndices() const
+{
+	return indexView;
 }
-const std::vector<unsigned int>& Model::getIndices() const
+Vec3Streams Model::getNormals() const
+{
+	return normalView;
+}
+Vec2Streams Model::getTexCoords() const
+{
+	return texcoordView;
+}
+const WeldStats& Model::getWeldStats() const
+{
+	return weldStats;
+}
+const MeshBounds& Model::getBounds() const
+{
+	return bounds;
+}
+
+void Model::setMeshCache(MeshCache* cache)
+{
+	meshCache = cache;
+}
+MeshCache* Model::getMeshCache() const
+{
+	return meshCache;
+}
+
+void Model::setParseThreadCount(unsigned int count)
+{
+	parseThreadCount = count;
+}
+unsigned int Model::getParseThreadCount() const
+{
+	return parseThreadCount;
+}
+
+void Model::setOptimizeOnLoad(bool enabled)
+{
+	optimizeOnLoad = enabled;
+}
+bool Model::getOptimizeOnLoad() const
+{
+	return optimizeOnLoad;
+}
+
+void Model::setLodChainOnLoad(bool enabled)
+{
+	lodChainOnLoad = enabled;
+}
+bool Model::getLodChainOnLoad() const
+{
+	return lodChainOnLoad;
+}
+
+void Model::setStlSmoothing(bool enabled)
+{
+	stlSmoothing = enabled;
+}
+bool Model::getStlSmoothing() const
+{
+	return stlSmoothing;
+}
+
+void Model::setOutOfCoreBudget(size_t bytes)
+{
+	outOfCoreBudget = bytes;
+}
+size_t Model::getOutOfCoreBudget() const
+{
+	return outOfCoreBudget;
+}
+void Model::setIncrementalReload(bool enabled)
+{
+	incrementalReload = enabled;
+}
+
+bool Model::getIncrementalReload() const
+{
+	return incrementalReload;
+}
+bool Model::canAppend() const
+{
+	return appendState != nullptr;
+}
+
+const OutOfCoreMesh* Model::getOutOfCoreMesh() const
+{
+	return outOfCore.get();
+}
+
+std::span<const IndexRange> Model::getPreviewRanges() const
+{
+	return previewRanges;
+}
+
+void Model::setStlWeldEpsilon(float epsilon)
 {
-	return indices;
+	stlWeldEpsilon = std::max(epsilon, 0.0f);
 }
-const std::vector<QVector3D>& Model::getNormals() const
+float Model::getStlWeldEpsilon() const
 {
-	return normals;
+	return stlWeldEpsilon;
 }
\ No newline at end of file
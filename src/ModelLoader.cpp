@@ -0,0 +1,296 @@
+// Worker thread per load, results and progress are handed to the GUI thread through queued calls
+
+#include "ModelLoader.h"
+#include <algorithm>
+#include <cmath>
+#include <utility>
+#include <QMetaObject>
+#include "GltfLoader.h"
+#include "Trace.h"
+
+namespace
+{
+	// Cache, threads and on-load steps
+	void copySettings(const Model& from, Model& to)
+	{
+		to.setMeshCache(from.getMeshCache());
+		to.setParseThreadCount(from.getParseThreadCount());
+		to.setOptimizeOnLoad(from.getOptimizeOnLoad());
+		to.setLodChainOnLoad(from.getLodChainOnLoad());
+		to.setStlSmoothing(from.getStlSmoothing());
+		to.setStlWeldEpsilon(from.getStlWeldEpsilon());
+		to.setOutOfCoreBudget(from.getOutOfCoreBudget());
+		to.setIncrementalReload(from.getIncrementalReload());
+	}
+}
+
+ModelLoader::ModelLoader(QObject* parent) : QObject(parent) {}
+
+ModelLoader::~ModelLoader()
+{
+	for (const auto& job : jobs)
+	{
+		job->cancel = true;
+	}
+	for (std::thread& thread : threads)
+	{
+		thread.join();
+	}
+}
+
+void ModelLoader::load(const QString& filePath, const Model& templateModel, bool compactVertices)
+{
+	if (currentJobId != 0)
+	{
+		jobs.back()->cancel = true;
+	}
+	reapThreads();
+	start(filePath, templateModel, compactVertices);
+}
+
+bool ModelLoader::reload(const QString& filePath, std::shared_ptr<const Model> current, const Model& templateModel, bool compactVertices, const AppendCapacity& capacity)
+{
+	reapThreads();
+	if (!jobs.empty())
+	{
+		return false; // A job still reading current would race the appendText() of this one
+	}
+	Job& job = start(filePath, templateModel, compactVertices);
+	job.current = std::move(current);
+	job.capacity = capacity;
+	return true;
+}
+
+ModelLoader::Job& ModelLoader::start(const QString& filePath, const Model& templateModel, bool compactVertices)
+{
+	auto job = std::make_unique<Job>();
+	job->id = nextJobId++;
+	job->filePath = filePath;
+	job->compactVertices = compactVertices;
+	job->allocator = bufferAllocator;
+	job->model = std::make_shared<Model>();
+	copySettings(templateModel, *job->model);
+	currentJobId = job->id;
+
+	Job* running = job.get();
+	jobs.push_back(std::move(job));
+	threads.emplace_back([this, running]() { run(*running); });
+	return *running;
+}
+
+bool ModelLoader::isLoading() const
+{
+	return currentJobId != 0;
+}
+
+void ModelLoader::setMeshBufferAllocator(MeshBufferAllocator allocator)
+{
+	bufferAllocator = std::move(allocator);
+}
+
+void ModelLoader::cancel()
+{
+	if (currentJobId == 0)
+	{
+		return;
+	}
+	// The job stops at its next check and is reaped later, the caller keeps going with the old model right away
+	jobs.back()->cancel = true;
+	currentJobId = 0;
+	emit canceled(jobs.back()->filePath);
+}
+
+std::shared_ptr<Model> ModelLoader::takeModel()
+{
+	return std::move(resultModel);
+}
+Scene ModelLoader::takeScene()
+{
+	return std::exchange(resultScene, Scene());
+}
+std::vector<PackedMesh> ModelLoader::takePackedMeshes()
+{
+	return std::exchange(resultMeshes, std::vector<PackedMesh>());
+}
+ObjAppend ModelLoader::takeAppendedText()
+{
+	return std::exchange(resultAppend, ObjAppend());
+}
+PackedAppend ModelLoader::takePackedAppend()
+{
+	return std::exchange(resultPackedAppend, PackedAppend());
+}
+
+void ModelLoader::run(Job& job)
+{
+	TRACE_THREAD_NAME("Model loader");
+	// Forward whole-percent steps only. Reading runs ahead of parsing, once parsing reports it stands for both.
+	LoadProgress hooks;
+	hooks.cancel = &job.cancel;
+	LoadStage lastStage = LoadStage::Read;
+	int lastPercent = -1;
+	bool parsing = false;
+	hooks.report = [this, &job, &lastStage, &lastPercent, &parsing](LoadStage stage, double fraction)
+	{
+		parsing = parsing || stage == LoadStage::Parse;
+		const int percent = static_cast<int>(std::floor(std::clamp(fraction, 0.0, 1.0) * 100.0));
+		if ((stage == LoadStage::Read && parsing) || (stage == lastStage && percent == lastPercent))
+		{
+			return;
+		}
+		lastStage = stage;
+		lastPercent = percent;
+		const unsigned int id = job.id;
+		const QString name = loadStageName(stage);
+		QMetaObject::invokeMethod(this, [this, id, name, percent]()
+		{
+			if (id == currentJobId)
+			{
+				emit progress(name, percent);
+			}
+		}, Qt::QueuedConnection);
+	};
+
+	if (job.current)
+	{
+		job.append = job.current->readAppendedText(job.filePath);
+		if (job.append.change == ObjAppend::Change::Appended && !MeshPacker::packAppend(*job.current, job.append, job.capacity, job.packedAppend))
+		{
+			// The buffers are full, a full load packs with room to grow again
+			job.append = ObjAppend();
+		}
+		job.current.reset();
+	}
+	if (job.append.change == ObjAppend::Change::Rewritten)
+	{
+		if (GltfLoader::isGltfFile(job.filePath))
+		{
+			job.succeeded = loadGltfScene(job, hooks);
+		}
+		else
+		{
+			job.succeeded = job.model->loadFromFile(job.filePath, &hooks);
+			job.scene.addNode(Scene::none, QMatrix4x4(), job.scene.addMesh(job.model));
+		}
+	}
+	if (job.succeeded && !hooks.canceled())
+	{
+		hooks.report(LoadStage::Pack, 0.0);
+		job.meshes.resize(job.scene.getMeshCount());
+		for (uint32_t mesh = 0; mesh < job.scene.getMeshCount(); ++mesh)
+		{
+			MeshPacker::pack(*job.scene.getMesh(mesh), job.compactVertices, job.meshes[mesh], job.allocator);
+			hooks.report(LoadStage::Pack, double(mesh + 1) / job.scene.getMeshCount());
+		}
+	}
+
+	job.done = true;
+	const unsigned int id = job.id;
+	QMetaObject::invokeMethod(this, [this, id]() { complete(id); }, Qt::QueuedConnection);
+}
+
+void ModelLoader::complete(unsigned int id)
+{
+	if (id == currentJobId)
+	{
+		currentJobId = 0;
+		Job& job = *jobs.back();
+		const QString filePath = job.filePath;
+		if (job.append.change == ObjAppend::Change::Appended)
+		{
+			resultAppend = std::move(job.append);
+			resultPackedAppend = std::move(job.packedAppend);
+			reapThreads();
+			emit appended(filePath);
+		}
+		else if (job.append.change == ObjAppend::Change::None)
+		{
+			reapThreads();
+		}
+		else if (job.succeeded)
+		{
+			resultModel = std::move(job.model);
+			resultScene = std::move(job.scene);
+			resultMeshes = std::move(job.meshes);
+			reapThreads();
+			emit finished(filePath);
+		}
+		else
+		{
+			reapThreads();
+			emit failed(filePath);
+		}
+		return;
+	}
+	reapThreads();
+}
+
+void ModelLoader::reapThreads()
+{
+	for (size_t i = 0; i < jobs.size();)
+	{
+		if (jobs[i]->done)
+		{
+			threads[i].join();
+			threads.erase(threads.begin() + i);
+			jobs.erase(jobs.begin() + i);
+		}
+		else
+		{
+			++i;
+		}
+	}
+}
+
+bool ModelLoader::loadGltfScene(Job& job, const LoadProgress& hooks)
+{
+	TRACE_ZONE("ModelLoader::loadGltfScene");
+	std::shared_ptr<const GltfAsset> asset = GltfAsset::open(job.filePath);
+	if (!asset)
+	{
+		return false;
+	}
+	const std::vector<GltfAsset::MeshInstance>& instances = asset->getInstances();
+	if (instances.empty())
+	{
+		// Nothing to place, an empty model keeps the load settings
+		job.scene.addNode(Scene::none, QMatrix4x4(), job.scene.addMesh(job.model));
+		return job.model->loadFromFile(job.filePath, &hooks);
+	}
+
+	// A model per mesh the nodes use, in the order of first use, every stage of each mapped onto its share of the bar
+	std::vector<bool> used(asset->getMeshes().size(), false);
+	for (const GltfAsset::MeshInstance& instance : instances)
+	{
+		used[instance.mesh] = true;
+	}
+	const size_t usedMeshes = std::count(used.begin(), used.end(), true);
+	std::vector<uint32_t> sceneMeshes(used.size(), Scene::none);
+	for (const GltfAsset::MeshInstance& instance : instances)
+	{
+		uint32_t& sceneMesh = sceneMeshes[instance.mesh];
+		if (sceneMesh == Scene::none)
+		{
+			const size_t loaded = job.scene.getMeshCount();
+			std::shared_ptr<Model> model = job.model;
+			if (loaded > 0)
+			{
+				model = std::make_shared<Model>();
+				copySettings(*job.model, *model);
+			}
+			LoadProgress meshHooks;
+			meshHooks.cancel = hooks.cancel;
+			meshHooks.report = [&hooks, loaded, usedMeshes](LoadStage stage, double fraction)
+			{
+				hooks.report(stage, (loaded + fraction) / usedMeshes);
+			};
+			if (!model->loadGltfMesh(job.filePath, asset, instance.mesh, &meshHooks))
+			{
+				return false;
+			}
+			sceneMesh = job.scene.addMesh(std::move(model));
+		}
+		job.scene.addNode(Scene::none, instance.transform, sceneMesh);
+	}
+	return true;
+}
\ No newline at end of file
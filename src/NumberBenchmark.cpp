@@ -0,0 +1,255 @@
+// Round-trip checks against the C library and per-token throughput of the number parsers, all on one thread
+
+#include "NumberBenchmark.h"
+#include "NumberParser.h"
+#include <QDebug>
+#include <QString>
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <chrono>
+#include <clocale>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+	constexpr int repeats = 3;
+	constexpr size_t maxReportedMismatches = 10;
+
+	const char* const edgeCases[] = {
+		"0", "-0", "+0", "1", "-1", "+1.5", "0.1", ".5", "5.", "-.5", "1e", "1e+", "1E5", "1e-5", "2.5e-7",
+		"1e22", "1e23", "1e-22", "16777216", "16777217", "16777218", "16777219", "33554435", "9007199254740993",
+		"1.00000005960464477539062500", "1.0000000596046447753906250001", "1.0000000596046447753906249999",
+		"3.4028235e38", "3.4028236e38", "1.17549435e-38", "1.4e-45", "7e-46", "1e-40", "7.038531e-26",
+		"1234567890123456789", "12345678901234567890", "123456789012345678901234567890", "0.3333333333333333333333",
+		"00000000000000000000000001.5", "1.5e0000000000000003", "1e-1000", "1e1000", "inf", "-inf", "nan", "-", "+", "." };
+
+	// Space-separated numbers, each parsed up to the end of the text the way the loaders parse up to the end of a line
+	struct Tokens
+	{
+		std::string text;
+		std::vector<size_t> starts;
+		std::vector<size_t> ends;
+	};
+
+	// True when both parsers agree with the C library on value and on where the number ends. The C library has no
+	// out-of-range failure, it returns 0 or infinity with ERANGE where NumberParser returns nullptr.
+	bool matchesLibrary(const char* text)
+	{
+		const char* last = text + strlen(text);
+		char* end = nullptr;
+		errno = 0;
+		const float reference = strtof(text, &end);
+		const bool referenceOk = end != text && !(errno == ERANGE && (reference == 0.0f || std::isinf(reference)));
+		float value = 0.0f;
+		const char* parsed = NumberParser::parseFloat(text, last, value);
+		if ((parsed != nullptr) != referenceOk || (parsed && (parsed != end || memcmp(&value, &reference, sizeof(value)) != 0)))
+		{
+			return false;
+		}
+
+		errno = 0;
+		const double referenceDouble = strtod(text, &end);
+		const bool referenceDoubleOk = end != text && !(errno == ERANGE && (referenceDouble == 0.0 || std::isinf(referenceDouble)));
+		double valueDouble = 0.0;
+		parsed = NumberParser::parseDouble(text, last, valueDouble);
+		return (parsed != nullptr) == referenceDoubleOk
+			&& (!parsed || (parsed == end && memcmp(&valueDouble, &referenceDouble, sizeof(valueDouble)) == 0));
+	}
+
+	size_t checkParsers(size_t valueCount)
+	{
+		size_t mismatches = 0;
+		auto report = [&mismatches](const char* kind, const char* text)
+		{
+			if (++mismatches <= maxReportedMismatches)
+			{
+				qCritical().nospace() << kind << " mismatch for \"" << text << "\"";
+			}
+		};
+		for (const char* text : edgeCases)
+		{
+			if (!matchesLibrary(text))
+			{
+				report("Edge case", text);
+			}
+		}
+
+		std::mt19937_64 random(25);
+		char text[64];
+		for (size_t i = 0; i < valueCount;)
+		{
+			const uint32_t bits = static_cast<uint32_t>(random());
+			float original;
+			memcpy(&original, &bits, sizeof(original));
+			if (!std::isfinite(original))
+			{
+				continue;
+			}
+			++i;
+			snprintf(text, sizeof(text), "%.9g", original);
+			float value = 0.0f;
+			if (!NumberParser::parseFloat(text, text + strlen(text), value) || memcmp(&value, &original, sizeof(value)) != 0)
+			{
+				report("Round-trip", text);
+			}
+			// Every other value is replaced by the point halfway to the next float up, where rounding twice goes wrong
+			const double magnitude = std::fabs(original);
+			const double halfway = (magnitude + std::nextafter(static_cast<float>(magnitude), INFINITY)) / 2.0;
+			snprintf(text, sizeof(text), "%.17g", i % 2 ? static_cast<double>(original) : halfway);
+			if (!matchesLibrary(text))
+			{
+				report("Library", text);
+			}
+		}
+		return mismatches;
+	}
+
+	Tokens makeTokens(int kind, size_t count)
+	{
+		std::mt19937 random(kind);
+		std::uniform_real_distribution<float> coordinate(-100.0f, 100.0f);
+		std::uniform_int_distribution<uint32_t> fullBits(0, 0x7F7FFFFF);
+		std::uniform_int_distribution<unsigned int> index(1, 10000000);
+		Tokens tokens;
+		tokens.text.reserve(count * 12);
+		tokens.starts.reserve(count);
+		tokens.ends.reserve(count);
+		char text[64];
+		for (size_t i = 0; i < count; ++i)
+		{
+			if (kind == 0)
+			{
+				snprintf(text, sizeof(text), "%.6f", coordinate(random));
+			}
+			else if (kind == 1)
+			{
+				snprintf(text, sizeof(text), "%.9g", coordinate(random) * std::pow(10.0f, static_cast<float>(static_cast<int>(i % 7) - 3)));
+			}
+			else if (kind == 2)
+			{
+				const uint32_t bits = fullBits(random) | (i % 2 ? 0x80000000 : 0);
+				float value = 0.0f;
+				memcpy(&value, &bits, sizeof(value));
+				snprintf(text, sizeof(text), "%.9g", value);
+			}
+			else
+			{
+				snprintf(text, sizeof(text), "%u", index(random));
+			}
+			tokens.starts.push_back(tokens.text.size());
+			tokens.text += text;
+			tokens.ends.push_back(tokens.text.size());
+			tokens.text += ' ';
+		}
+		return tokens;
+	}
+
+	// Fastest of the repeats in values per second. parse(first, last) returns where the number ends, or nullptr.
+	template <typename Parse>
+	double valuesPerSecond(const Tokens& tokens, Parse parse)
+	{
+		const char* text = tokens.text.data();
+		const char* last = text + tokens.text.size();
+		double best = 0.0;
+		for (int repeat = 0; repeat < repeats; ++repeat)
+		{
+			const auto start = std::chrono::steady_clock::now();
+			for (size_t i = 0; i < tokens.starts.size(); ++i)
+			{
+				if (parse(text + tokens.starts[i], last) != text + tokens.ends[i])
+				{
+					return 0.0;
+				}
+			}
+			const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+			best = std::max(best, tokens.starts.size() / std::max(seconds, 1e-9));
+		}
+		return best;
+	}
+}
+
+bool runNumberBenchmark(size_t valueCount)
+{
+	// The C library parses '.' as the decimal point only in the C locale, NumberParser does so in any
+	const std::string previousLocale = std::setlocale(LC_NUMERIC, nullptr);
+	std::setlocale(LC_NUMERIC, "C");
+	const size_t mismatches = checkParsers(valueCount);
+	std::setlocale(LC_NUMERIC, previousLocale.c_str());
+	qInfo().nospace() << "Number parser check: " << valueCount << " random floats and " << std::size(edgeCases)
+		<< " edge cases, " << mismatches << " mismatches with strtof and strtod";
+
+	// Floats of any magnitude mostly have exponents past the exact powers of ten and take the from_chars path
+	const char* kinds[4] = { "Coordinates (%.6f)", "Coordinates (%.9g)", "Floats of random bits (%.9g)", "Indices" };
+	for (int kind = 0; kind < 4; ++kind)
+	{
+		const Tokens tokens = makeTokens(kind, valueCount);
+		double sum = 0.0; // Keeps the parses from being optimized away
+		double rates[3];
+		if (kind < 3)
+		{
+			rates[0] = valuesPerSecond(tokens, [&sum](const char* first, const char* last)
+			{
+				float value = 0.0f;
+				const char* end = NumberParser::parseFloat(first, last, value);
+				sum += value;
+				return end;
+			});
+			rates[1] = valuesPerSecond(tokens, [&sum](const char* first, const char* last)
+			{
+				float value = 0.0f;
+				const std::from_chars_result parsed = std::from_chars(first, last, value);
+				sum += value;
+				return parsed.ec == std::errc() ? parsed.ptr : nullptr;
+			});
+			rates[2] = valuesPerSecond(tokens, [&sum](const char* first, const char* last)
+			{
+				// QString has no partial parse, the token is cut out at the next space first
+				const char* end = std::find(first, last, ' ');
+				bool ok = false;
+				sum += QString::fromLatin1(first, end - first).toFloat(&ok);
+				return ok ? end : nullptr;
+			});
+		}
+		else
+		{
+			rates[0] = valuesPerSecond(tokens, [&sum](const char* first, const char* last)
+			{
+				unsigned int value = 0;
+				const char* end = NumberParser::parseUInt(first, last, value);
+				sum += value;
+				return end;
+			});
+			rates[1] = valuesPerSecond(tokens, [&sum](const char* first, const char* last)
+			{
+				unsigned int value = 0;
+				const std::from_chars_result parsed = std::from_chars(first, last, value);
+				sum += value;
+				return parsed.ec == std::errc() ? parsed.ptr : nullptr;
+			});
+			rates[2] = valuesPerSecond(tokens, [&sum](const char* first, const char* last)
+			{
+				// QString has no partial parse, the token is cut out at the next space first
+				const char* end = std::find(first, last, ' ');
+				bool ok = false;
+				sum += QString::fromLatin1(first, end - first).toUInt(&ok);
+				return ok ? end : nullptr;
+			});
+		}
+		if (rates[0] == 0.0 || rates[1] == 0.0 || rates[2] == 0.0)
+		{
+			qCritical() << "A parser rejected a generated token:" << kinds[kind];
+			return false;
+		}
+		qInfo().nospace() << kinds[kind] << ": NumberParser " << rates[0] / 1.0e6 << " M values/s, std::from_chars "
+			<< rates[1] / 1.0e6 << " M values/s (" << rates[0] / rates[1] << "x), QString " << rates[2] / 1.0e6
+			<< " M values/s (" << rates[0] / rates[2] << "x), checksum " << sum;
+	}
+	return mismatches == 0;
+}
\ No newline at end of file
@@ -0,0 +1,247 @@
+// Short decimals are converted exactly with one floating-point operation, everything else goes through std::from_chars
+
+#include "NumberParser.h"
+#include <bit>
+#include <charconv>
+#include <climits>
+#include <cstdint>
+#include <cstring>
+
+namespace
+{
+	constexpr int maxMantissaDigits = 19; // Always fit a uint64_t
+	constexpr uint64_t maxExactMantissa = uint64_t(1) << 53; // Every integer up to here is a double
+	constexpr int maxExactPower = 22; // 1e22 is the largest power of ten that is a double
+
+	constexpr double exactPowers[maxExactPower + 1] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+		1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+
+	inline bool isDigit(char c)
+	{
+		return static_cast<unsigned char>(c - '0') < 10;
+	}
+
+	// One nonzero byte per byte of a little-endian word that is not an ASCII digit: its high nibble is not 3, or adding 6
+	// carries into it. A carry only runs into later bytes, so everything up to the first non-digit is exact.
+	inline uint64_t nonDigitBytes(uint64_t word)
+	{
+		return ((word & 0xF0F0F0F0F0F0F0F0) ^ 0x3030303030303030) | (((word + 0x0606060606060606) & 0xF0F0F0F0F0F0F0F0) ^ 0x3030303030303030);
+	}
+
+	// Value of eight ASCII digits in one word, pairs, then quads, then the whole word with three multiplies
+	inline uint32_t parseEightDigits(uint64_t word)
+	{
+		word -= 0x3030303030303030;
+		word = (word * 10) + (word >> 8);
+		word = (((word & 0x000000FF000000FF) * (100 + (uint64_t(1000000) << 32))) + (((word >> 16) & 0x000000FF000000FF) * (1 + (uint64_t(10000) << 32)))) >> 32;
+		return static_cast<uint32_t>(word);
+	}
+
+	constexpr uint32_t digitScales[9] = { 1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000 };
+
+	static_assert(std::endian::native == std::endian::little, "Digit words are read with the first digit in the low byte");
+
+	inline uint64_t loadWord(const char* p)
+	{
+		uint64_t word;
+		memcpy(&word, p, sizeof(word));
+		return word;
+	}
+
+	// A plain decimal: digits with an optional '.' and an optional exponent with digits, mantissa kept in 19 digits
+	struct Decimal
+	{
+		uint64_t mantissa = 0;
+		int exponent = 0; // Power of ten applied to mantissa
+		bool negative = false;
+		const char* end = nullptr;
+	};
+
+	// Appends the digits at p to mantissa, the first up to eight from one word: the run ends at the first non-digit
+	// byte, and moving the run to the top of the word with '0' bytes below it reads it as eight digits
+	inline const char* scanDigits(const char* p, const char* last, uint64_t& mantissa, int& digits)
+	{
+		while (last - p >= 8 && digits + 8 <= maxMantissaDigits)
+		{
+			const uint64_t word = loadWord(p);
+			const uint64_t nonDigits = nonDigitBytes(word);
+			const int count = nonDigits ? std::countr_zero(nonDigits) / 8 : 8;
+			if (count == 0)
+			{
+				return p;
+			}
+			const uint64_t run = count == 8 ? word : (word << (64 - 8 * count)) | (0x3030303030303030 >> (8 * count));
+			mantissa = mantissa * digitScales[count] + parseEightDigits(run);
+			digits += count;
+			p += count;
+			if (count < 8)
+			{
+				return p;
+			}
+		}
+		while (p < last && isDigit(*p))
+		{
+			if (++digits > maxMantissaDigits)
+			{
+				return nullptr;
+			}
+			mantissa = mantissa * 10 + static_cast<uint64_t>(*p - '0');
+			++p;
+		}
+		return p;
+	}
+
+	// Digits at p up to limit, or nullptr with from_chars' failures left to it: no digits, too many or too large
+	inline const char* scanInteger(const char* p, const char* last, uint64_t limit, uint64_t& value)
+	{
+		int digits = 0;
+		value = 0;
+		const char* end = scanDigits(p, last, value, digits);
+		return end && end > p && value <= limit ? end : nullptr;
+	}
+
+	// False for anything the fast path does not take: no digits, more than 19 of them, inf, nan or a long exponent.
+	// Digits count from the first one, leading zeros included, which only sends a few more inputs to the slow path.
+	bool scanDecimal(const char* p, const char* last, Decimal& out)
+	{
+		if (p < last && *p == '-')
+		{
+			out.negative = true;
+			++p;
+		}
+		int digits = 0;
+		const char* integerBegin = p;
+		p = scanDigits(p, last, out.mantissa, digits);
+		if (!p)
+		{
+			return false;
+		}
+		bool anyDigits = p > integerBegin;
+		if (p < last && *p == '.')
+		{
+			const char* fractionBegin = ++p;
+			p = scanDigits(p, last, out.mantissa, digits);
+			if (!p)
+			{
+				return false;
+			}
+			out.exponent = -static_cast<int>(p - fractionBegin);
+			anyDigits = anyDigits || p > fractionBegin;
+		}
+		if (!anyDigits)
+		{
+			return false;
+		}
+		if (p < last && (*p == 'e' || *p == 'E'))
+		{
+			const char* q = p + 1;
+			const bool negativeExponent = q < last && *q == '-';
+			q += q < last && (*q == '-' || *q == '+') ? 1 : 0;
+			if (q == last || !isDigit(*q))
+			{
+				return false; // from_chars stops before the 'e' here, rare enough to leave to it
+			}
+			int exponent = 0;
+			for (; q < last && isDigit(*q); ++q)
+			{
+				if (exponent > 1000)
+				{
+					return false;
+				}
+				exponent = exponent * 10 + (*q - '0');
+			}
+			out.exponent += negativeExponent ? -exponent : exponent;
+			p = q;
+		}
+		out.end = p;
+		return true;
+	}
+
+	// Clinger's fast path: mantissa and power of ten are both exact doubles, so one multiply or divide rounds once
+	bool exactDouble(const Decimal& decimal, double& value)
+	{
+		if (decimal.mantissa > maxExactMantissa || decimal.exponent < -maxExactPower || decimal.exponent > maxExactPower)
+		{
+			return false;
+		}
+		double result = static_cast<double>(decimal.mantissa);
+		result = decimal.exponent < 0 ? result / exactPowers[-decimal.exponent] : result * exactPowers[decimal.exponent];
+		value = decimal.negative ? -result : result;
+		return true;
+	}
+
+	template <typename T>
+	const char* parseSlow(const char* first, const char* last, T& value)
+	{
+		T result;
+		const std::from_chars_result parsed = std::from_chars(first, last, result);
+		if (parsed.ec != std::errc())
+		{
+			return nullptr;
+		}
+		value = result;
+		return parsed.ptr;
+	}
+
+	inline const char* skipPlus(const char* first, const char* last)
+	{
+		// from_chars rejects an explicit plus sign, but not a '-' after it
+		return first < last && *first == '+' && (last - first == 1 || first[1] != '-') ? first + 1 : first;
+	}
+}
+
+const char* NumberParser::parseFloat(const char* first, const char* last, float& value)
+{
+	first = skipPlus(first, last);
+	Decimal decimal;
+	double exact;
+	if (scanDecimal(first, last, decimal) && exactDouble(decimal, exact))
+	{
+		// The double is correctly rounded and is within float range above the subnormals, so rounding it again to float
+		// only goes wrong when it lands exactly halfway between two floats: the 29 bits float drops are 1000...0
+		uint64_t bits;
+		memcpy(&bits, &exact, sizeof(bits));
+		if ((bits & 0x1FFFFFFF) != 0x10000000)
+		{
+			value = static_cast<float>(exact);
+			return decimal.end;
+		}
+	}
+	return parseSlow(first, last, value);
+}
+
+const char* NumberParser::parseDouble(const char* first, const char* last, double& value)
+{
+	first = skipPlus(first, last);
+	Decimal decimal;
+	if (scanDecimal(first, last, decimal) && exactDouble(decimal, value))
+	{
+		return decimal.end;
+	}
+	return parseSlow(first, last, value);
+}
+
+const char* NumberParser::parseUInt(const char* first, const char* last, unsigned int& value)
+{
+	first = skipPlus(first, last);
+	uint64_t result;
+	if (const char* end = scanInteger(first, last, UINT_MAX, result))
+	{
+		value = static_cast<unsigned int>(result);
+		return end;
+	}
+	return parseSlow(first, last, value);
+}
+
+const char* NumberParser::parseInt(const char* first, const char* last, long long& value)
+{
+	first = skipPlus(first, last);
+	const bool negative = first < last && *first == '-';
+	uint64_t result;
+	if (const char* end = scanInteger(first + (negative ? 1 : 0), last, LLONG_MAX, result))
+	{
+		value = negative ? -static_cast<long long>(result) : static_cast<long long>(result);
+		return end;
+	}
+	return parseSlow(first, last, value);
+}
\ No newline at end of file
@@ -0,0 +1,301 @@
+// Reference .obj parse the way Model::loadFromFile read files before ObjParser, diffed against each ObjParser entry point
+
+#include "ObjCheck.h"
+#include "FileBlockReader.h"
+#include "MeshGenerator.h"
+#include "ObjParser.h"
+#include "Parallel.h"
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QTemporaryDir>
+#include <QTextStream>
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+	constexpr size_t generatedTriangles = 60000; // A few MB, enough for the chunked parse to split
+	constexpr size_t smallBlockBytes = 256; // Blocks of a few lines, negative indices reach back across many of them
+
+	struct CorpusFile
+	{
+		const char* name;
+		const char* text;
+	};
+
+	const CorpusFile corpus[] = {
+		{ "crlf.obj", "v 0 0 0\r\nv 1 0 0\r\nv 0 1 0\r\nvn 0 0 1\r\nvt 0 0\r\nf 1/1/1 2/1/1 3/1/1\r\n" },
+		{ "no-final-newline.obj", "v 0 0 0\nv 1 0 0\nv 0 1 0\nv 1 1 0\nf 1 2 3\nf 2 4 3" },
+		{ "crlf-no-final-newline.obj", "v 0 0 0\r\nv 1 0 0\r\nv 0 1 0\r\nf 1 2 3\r\nf 3 2 1" },
+		{ "negative.obj", "v 0 0 0\nv 1 0 0\nv 0 1 0\nv 1 1 0\nvt 0 0\nvt 1 1\nvn 0 0 1\n"
+			"f -4/-2/-1 -3/-1/-1 -2/-2/-1\nf -1 -2 -3\nv 2 2 0\nf -1//-1 -2//-1 -3//-1\nf -5/-1 -4/-2 -1/-1\n" },
+		{ "missing-attributes.obj", "v 0 0 0\nv 1 0 0\nv 0 1 0\nv 1 1 0\nv 2 0 0\nvt 0.5\nvt 0.25 0.75 1\nvn 0 0 1\n"
+			"f 1 2 3 4 5\nf 1/1 2/2 3/1\nf 1//1 2//1 3//1\nf 1/2/1 2 3//1\nf 1/ 2/ 3/\nf 1// 2// 3//\n" },
+		{ "whitespace.obj", "# comment\n\n   v  1.5   -2e-3  +4  \n\tv 1 2 3\t\nv 4 5 6 1\n  \t\n"
+			"o part\ng group\nusemtl steel\ns off\nvn 0 1 0 \nf  1   2  3 \n\tf 3 2 1\t\r\n" },
+		{ "malformed.obj", "v 1 2\nv a b c\nv 1 2 3\nv 4 5 6\nv 7 8 9\nvn 1 2\nvt\nf 1 2\nf 0 1 2\nf 1 2 99\n"
+			"f 1/x/1 2/1/y 3\nf 1.5 2 3\nf -9 -1 -2\nf 1//1/7 2 3\nv1 2 3 4\nfx 1 2 3\nvn0 0 1\n" },
+		{ "numbers.obj", "v 1e10 -0 .5\nv 5. 1E-5 -.25\nv 0.1 0.2 0.3\nv 3.4028235e38 1.17549435e-38 16777217\n"
+			"v 0.333333333333333333333 123456789012345678901234567890 -7\nv 0001.5000 +0 00\nf 1 2 3 4 5 6\n" },
+	};
+
+	// The line pipeline Model::loadFromFile used before ObjParser: QTextStream lines, trimmed(), split(' ') and split('/'),
+	// QString::toFloat() and toUInt(). It learned what the parser has learned since in the same style: vt records, vt/vn
+	// indices per corner and negative indices that count back from the records read so far.
+	unsigned int referenceIndex(const QString& field, size_t recordCount)
+	{
+		if (field.startsWith('-'))
+		{
+			bool ok = false;
+			const long long offset = field.toLongLong(&ok);
+			if (ok && offset < 0)
+			{
+				return static_cast<unsigned int>(static_cast<long long>(recordCount) + offset);
+			}
+		}
+		return field.toUInt() - 1; // .obj indices are 1-based
+	}
+
+	bool parseReference(const QString& filePath, ObjData& out, size_t& faceCount)
+	{
+		QFile file(filePath);
+		if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+		{
+			return false;
+		}
+		out.attributeIndices = true;
+		QTextStream in(&file);
+		while (!in.atEnd())
+		{
+			const QString line = in.readLine().trimmed();
+			if (line.startsWith("v ") || line.startsWith("vn "))
+			{
+				const QStringList parts = line.split(' ', Qt::SkipEmptyParts);
+				if (parts.size() >= 4)
+				{
+					Vec3Array& target = line.startsWith("v ") ? out.vertices : out.normals;
+					target.push_back(parts[1].toFloat(), parts[2].toFloat(), parts[3].toFloat());
+				}
+			}
+			else if (line.startsWith("vt "))
+			{
+				const QStringList parts = line.split(' ', Qt::SkipEmptyParts);
+				if (parts.size() >= 2)
+				{
+					out.texcoords.push_back(parts[1].toFloat(), parts.size() >= 3 ? parts[2].toFloat() : 0.0f);
+				}
+			}
+			else if (line.startsWith("f "))
+			{
+				const QStringList parts = line.split(' ', Qt::SkipEmptyParts);
+				if (parts.size() >= 4)
+				{
+					const size_t recordCounts[3] = { out.vertices.size(), out.texcoords.size(), out.normals.size() };
+					std::vector<unsigned int> corners[3];
+					for (qsizetype i = 1; i < parts.size(); ++i)
+					{
+						const QStringList fields = parts[i].split('/');
+						for (qsizetype field = 0; field < 3; ++field)
+						{
+							corners[field].push_back(field < fields.size() ? referenceIndex(fields[field], recordCounts[field]) : ObjData::missingIndex);
+						}
+					}
+					// Fan triangulation
+					for (size_t i = 1; i + 1 < corners[0].size(); ++i)
+					{
+						for (size_t corner : { size_t(0), i, i + 1 })
+						{
+							out.indices.push_back(corners[0][corner]);
+							out.texcoordIndices.push_back(corners[1][corner]);
+							out.normalIndices.push_back(corners[2][corner]);
+						}
+					}
+					++faceCount;
+				}
+			}
+		}
+		return true;
+	}
+
+	bool readAll(const QString& filePath, QByteArray& text)
+	{
+		QFile file(filePath);
+		if (!file.open(QIODevice::ReadOnly))
+		{
+			return false;
+		}
+		text = file.readAll();
+		return true;
+	}
+
+	// Parses as Model::loadObj does, line-aligned blocks appended one after the other with one scratch for all
+	bool parseBlocks(const QString& filePath, ObjData& out, unsigned int threadCount)
+	{
+		FileBlockReader reader(filePath, smallBlockBytes, true);
+		ObjParseScratch scratch;
+		std::span<const char> block;
+		while (reader.next(block))
+		{
+			ObjParser::parseParallel(block.data(), block.data() + block.size(), out, threadCount, &scratch);
+		}
+		return !reader.failed();
+	}
+
+	// First index at which two streams differ, in bits so -0 and 0 count as different. The shorter size when one is a
+	// prefix of the other.
+	size_t firstDifference(const FloatStream& a, const FloatStream& b)
+	{
+		const size_t count = std::min(a.size(), b.size());
+		for (size_t i = 0; i < count; ++i)
+		{
+			if (memcmp(&a[i], &b[i], sizeof(float)) != 0)
+			{
+				return i;
+			}
+		}
+		return count;
+	}
+
+	size_t firstDifference(const std::vector<unsigned int>& a, const std::vector<unsigned int>& b)
+	{
+		const size_t count = std::min(a.size(), b.size());
+		return std::mismatch(a.begin(), a.begin() + count, b.begin()).first - a.begin();
+	}
+
+	// Per-corner vt/vn indices, all missing for a parse that saw no v/vt/vn face and left them out
+	std::vector<unsigned int> cornerIndices(const ObjData& data, const std::vector<unsigned int>& indices)
+	{
+		return data.attributeIndices ? indices : std::vector<unsigned int>(data.indices.size(), ObjData::missingIndex);
+	}
+
+	bool compare(const QString& name, const char* mode, const ObjData& reference, const ObjData& parsed)
+	{
+		QStringList differences;
+		auto checkCount = [&differences](const char* what, size_t expected, size_t actual)
+		{
+			if (expected != actual)
+			{
+				differences << QString("%1 count %2 instead of %3").arg(what).arg(qulonglong(actual)).arg(qulonglong(expected));
+			}
+		};
+		checkCount("Position", reference.vertices.size(), parsed.vertices.size());
+		checkCount("Texcoord", reference.texcoords.size(), parsed.texcoords.size());
+		checkCount("Normal", reference.normals.size(), parsed.normals.size());
+		checkCount("Index", reference.indices.size(), parsed.indices.size());
+
+		auto checkVec3 = [&differences](const char* what, const Vec3Array& expected, const Vec3Array& actual)
+		{
+			const size_t i = std::min({ firstDifference(expected.x, actual.x), firstDifference(expected.y, actual.y), firstDifference(expected.z, actual.z) });
+			if (i < std::min(expected.size(), actual.size()))
+			{
+				differences << QString("%1 %2 is (%3, %4, %5) instead of (%6, %7, %8)").arg(what).arg(qulonglong(i))
+					.arg(actual.x[i]).arg(actual.y[i]).arg(actual.z[i]).arg(expected.x[i]).arg(expected.y[i]).arg(expected.z[i]);
+			}
+		};
+		checkVec3("Position", reference.vertices, parsed.vertices);
+		checkVec3("Normal", reference.normals, parsed.normals);
+		const Vec2Array& expected = reference.texcoords;
+		const Vec2Array& actual = parsed.texcoords;
+		const size_t texcoord = std::min(firstDifference(expected.x, actual.x), firstDifference(expected.y, actual.y));
+		if (texcoord < std::min(expected.size(), actual.size()))
+		{
+			differences << QString("Texcoord %1 is (%2, %3) instead of (%4, %5)").arg(qulonglong(texcoord))
+				.arg(actual.x[texcoord]).arg(actual.y[texcoord]).arg(expected.x[texcoord]).arg(expected.y[texcoord]);
+		}
+
+		auto checkIndices = [&differences](const char* what, const std::vector<unsigned int>& expected, const std::vector<unsigned int>& actual)
+		{
+			const size_t i = firstDifference(expected, actual);
+			if (i < std::min(expected.size(), actual.size()))
+			{
+				differences << QString("%1 %2 is %3 instead of %4").arg(what).arg(qulonglong(i)).arg(actual[i]).arg(expected[i]);
+			}
+		};
+		checkIndices("Position index", reference.indices, parsed.indices);
+		checkIndices("Texcoord index", reference.texcoordIndices, cornerIndices(parsed, parsed.texcoordIndices));
+		checkIndices("Normal index", reference.normalIndices, cornerIndices(parsed, parsed.normalIndices));
+
+		if (!differences.isEmpty())
+		{
+			qCritical().noquote() << name << mode << "differs:" << differences.join("; ");
+			return false;
+		}
+		return true;
+	}
+
+	bool checkFile(const QString& filePath, unsigned int threadCount)
+	{
+		ObjData reference;
+		size_t faceCount = 0;
+		QByteArray text;
+		if (!parseReference(filePath, reference, faceCount) || !readAll(filePath, text))
+		{
+			qCritical() << "Cannot read" << filePath << "for the .obj check";
+			return false;
+		}
+		const QString name = QFileInfo(filePath).fileName();
+		const char* begin = text.constData();
+		const char* end = begin + text.size();
+
+		ObjData whole;
+		ObjParser::parse(begin, end, whole);
+		bool same = compare(name, "in one piece", reference, whole);
+		ObjData chunked;
+		ObjParser::parseParallel(begin, end, chunked, threadCount);
+		same = compare(name, "in chunks", reference, chunked) && same;
+		ObjData blocks;
+		if (!parseBlocks(filePath, blocks, threadCount))
+		{
+			qCritical() << "Cannot read" << filePath << "in blocks";
+			return false;
+		}
+		same = compare(name, "in blocks", reference, blocks) && same;
+		qInfo().nospace().noquote() << name << ": " << reference.vertices.size() << " positions, " << reference.texcoords.size() << " texcoords, "
+			<< reference.normals.size() << " normals, " << faceCount << " faces, " << reference.indices.size() / 3 << " triangles, "
+			<< (same ? "identical" : "DIFFERENT");
+		return same;
+	}
+}
+
+bool runObjCheck(const QStringList& filePaths, unsigned int threadCount)
+{
+	threadCount = Parallel::resolveThreadCount(threadCount);
+	QTemporaryDir directory;
+	if (!directory.isValid())
+	{
+		qCritical() << "Cannot create a directory for the .obj check corpus";
+		return false;
+	}
+	QStringList files;
+	for (const CorpusFile& entry : corpus)
+	{
+		const QString path = QDir(directory.path()).filePath(entry.name);
+		QFile file(path);
+		if (!file.open(QIODevice::WriteOnly) || file.write(entry.text) != qint64(strlen(entry.text)))
+		{
+			qCritical() << "Cannot write" << path;
+			return false;
+		}
+		files << path;
+	}
+	for (MeshGenerator::Shape shape : MeshGenerator::allShapes)
+	{
+		const QString path = QDir(directory.path()).filePath(QString("%1.obj").arg(MeshGenerator::shapeName(shape)));
+		if (!MeshGenerator::writeObj(path, shape, generatedTriangles))
+		{
+			return false;
+		}
+		files << path;
+	}
+	files << filePaths;
+
+	size_t differing = 0;
+	for (const QString& path : files)
+	{
+		differing += checkFile(path, threadCount) ? 0 : 1;
+	}
+	qInfo().nospace() << ".obj check on " << threadCount << " threads: " << files.size() - differing << " of " << files.size() << " files identical";
+	return differing == 0;
+}
\ No newline at end of file
@@ -0,0 +1,449 @@
+// Scans .obj records in place with raw pointers instead of building QStrings per line
+
+#include "ObjParser.h"
+#include "NumberParser.h"
+#include "Parallel.h"
+#include <algorithm>
+#include <chrono>
+
+namespace
+{
+	// Below this a file is parsed on the calling thread, thread start-up would cost more than it saves
+	constexpr size_t minChunkBytes = 1 << 20;
+
+	// Same whitespace set QString::trimmed() strips
+	inline bool isSpace(char c)
+	{
+		return c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '\v' || c == '\f';
+	}
+
+	// Matches QString::toFloat(): the whole token must be a number, anything else reads as 0
+	float parseFloat(const char* first, const char* last)
+	{
+		while (first < last && isSpace(*first)) ++first;
+		while (last > first && isSpace(last[-1])) --last;
+
+		float value = 0.0f;
+		return NumberParser::parseFloat(first, last, value) == last ? value : 0.0f;
+	}
+
+	// Matches QString::toUInt(): base 10, no sign other than '+', 0 on failure or overflow
+	unsigned int parseUInt(const char* first, const char* last)
+	{
+		while (first < last && isSpace(*first)) ++first;
+		while (last > first && isSpace(last[-1])) --last;
+
+		unsigned int value = 0;
+		return NumberParser::parseUInt(first, last, value) == last ? value : 0;
+	}
+
+	// Walks the ' '-separated tokens of one line, skipping empty ones like split(' ', Qt::SkipEmptyParts)
+	struct TokenCursor
+	{
+		const char* pos;
+		const char* end;
+
+		bool next(const char*& tokenBegin, const char*& tokenEnd)
+		{
+			while (pos < end && *pos == ' ') ++pos;
+			if (pos == end)
+			{
+				return false;
+			}
+			tokenBegin = pos;
+			while (pos < end && *pos != ' ') ++pos;
+			tokenEnd = pos;
+			return true;
+		}
+	};
+
+	// Reads the three components of a "v" or "vn" record, returns false if the line has fewer than 3
+	bool parseVector(TokenCursor& cursor, float out[3])
+	{
+		const char* tokenBegin[3];
+		const char* tokenEnd[3];
+		for (int i = 0; i < 3; ++i)
+		{
+			if (!cursor.next(tokenBegin[i], tokenEnd[i]))
+			{
+				return false;
+			}
+		}
+		for (int i = 0; i < 3; ++i)
+		{
+			out[i] = parseFloat(tokenBegin[i], tokenEnd[i]);
+		}
+		return true;
+	}
+
+	// Chunk-local index slots that were resolved from negative (relative) indices, one list per attribute
+	struct RelativeSlots
+	{
+		std::vector<size_t> positions;
+		std::vector<size_t> texcoords;
+		std::vector<size_t> normals;
+	};
+
+	// A face corner's v/vt/vn indices after conversion to 0-based, ObjData::missingIndex where absent
+	struct FaceCorner
+	{
+		unsigned int index[3];
+		bool relative[3]; // Resolved against the records read so far, needs rebasing in a chunked parse
+		bool hasAttributes; // Written in the v/vt/vn form
+	};
+
+	// One index field of a face corner. Negative indices count back from the last record of that kind.
+	unsigned int parseIndexField(const char* first, const char* last, size_t recordCount, bool& relative)
+	{
+		relative = false;
+		if (first < last && *first == '-')
+		{
+			long long offset = 0;
+			if (NumberParser::parseInt(first, last, offset) == last && offset < 0)
+			{
+				relative = true;
+				return static_cast<unsigned int>(static_cast<long long>(recordCount) + offset);
+			}
+		}
+		return parseUInt(first, last) - 1; // .obj indices are 1-based, an empty field wraps to missingIndex
+	}
+
+	FaceCorner parseFaceCorner(const char* first, const char* last, const ObjData& out)
+	{
+		const size_t recordCounts[3] = { out.vertices.size(), out.texcoords.size(), out.normals.size() };
+		FaceCorner corner = { { ObjData::missingIndex, ObjData::missingIndex, ObjData::missingIndex }, { false, false, false }, false };
+		const char* fieldBegin = first;
+		for (int field = 0; field < 3; ++field)
+		{
+			const char* fieldEnd = fieldBegin;
+			while (fieldEnd < last && *fieldEnd != '/') ++fieldEnd;
+			corner.index[field] = parseIndexField(fieldBegin, fieldEnd, recordCounts[field], corner.relative[field]);
+			if (fieldEnd == last)
+			{
+				break;
+			}
+			corner.hasAttributes = true;
+			fieldBegin = fieldEnd + 1;
+		}
+		return corner;
+	}
+
+	// Start tracking vt/vn indices, corners emitted before now had none
+	void enableAttributeIndices(ObjData& out)
+	{
+		if (!out.attributeIndices)
+		{
+			out.attributeIndices = true;
+			out.texcoordIndices.assign(out.indices.size(), ObjData::missingIndex);
+			out.normalIndices.assign(out.indices.size(), ObjData::missingIndex);
+		}
+	}
+
+	void emitCorner(const FaceCorner& corner, ObjData& out, RelativeSlots* relativeSlots)
+	{
+		if (relativeSlots)
+		{
+			if (corner.relative[0]) relativeSlots->positions.push_back(out.indices.size());
+			if (corner.relative[1]) relativeSlots->texcoords.push_back(out.indices.size());
+			if (corner.relative[2]) relativeSlots->normals.push_back(out.indices.size());
+		}
+		out.indices.push_back(corner.index[0]);
+		if (out.attributeIndices)
+		{
+			out.texcoordIndices.push_back(corner.index[1]);
+			out.normalIndices.push_back(corner.index[2]);
+		}
+	}
+
+	// Fan-triangulates one "f" record directly into the index arrays, no temporary corner list needed
+	void parseFace(TokenCursor& cursor, ObjData& out, RelativeSlots* relativeSlots)
+	{
+		const char* tokenBegin;
+		const char* tokenEnd;
+		FaceCorner first = {};
+		FaceCorner previous = {};
+		int corner = 0;
+		while (cursor.next(tokenBegin, tokenEnd))
+		{
+			FaceCorner current = parseFaceCorner(tokenBegin, tokenEnd, out);
+			if (current.hasAttributes)
+			{
+				enableAttributeIndices(out);
+			}
+			if (corner == 0)
+			{
+				first = current;
+			}
+			else if (corner >= 2)
+			{
+				emitCorner(first, out, relativeSlots);
+				emitCorner(previous, out, relativeSlots);
+				emitCorner(current, out, relativeSlots);
+			}
+			previous = current;
+			++corner;
+		}
+	}
+
+	void parseRange(const char* begin, const char* end, ObjData& out, RelativeSlots* relativeSlots)
+	{
+		const char* lineBegin = begin;
+		while (lineBegin < end)
+		{
+			const char* lineEnd = lineBegin;
+			while (lineEnd < end && *lineEnd != '\n') ++lineEnd;
+			const char* next = lineEnd < end ? lineEnd + 1 : end;
+
+			// Trim the line in place
+			while (lineBegin < lineEnd && isSpace(*lineBegin)) ++lineBegin;
+			while (lineEnd > lineBegin && isSpace(lineEnd[-1])) --lineEnd;
+
+			const size_t length = lineEnd - lineBegin;
+			if (length >= 2 && lineBegin[0] == 'v' && lineBegin[1] == ' ') // .obj way of telling us that vertice coordinates are next
+			{
+				TokenCursor cursor = { lineBegin + 2, lineEnd };
+				float vertex[3];
+				if (parseVector(cursor, vertex))
+				{
+					out.vertices.push_back(vertex[0], vertex[1], vertex[2]);
+				}
+			}
+			else if (length >= 3 && lineBegin[0] == 'v' && lineBegin[1] == 'n' && lineBegin[2] == ' ')
+			{
+				TokenCursor cursor = { lineBegin + 3, lineEnd };
+				float normal[3];
+				if (parseVector(cursor, normal))
+				{
+					out.normals.push_back(normal[0], normal[1], normal[2]);
+				}
+			}
+			else if (length >= 3 && lineBegin[0] == 'v' && lineBegin[1] == 't' && lineBegin[2] == ' ')
+			{
+				// Texture coordinates: u and optional v (w is ignored)
+				TokenCursor cursor = { lineBegin + 3, lineEnd };
+				const char* tokenBegin;
+				const char* tokenEnd;
+				if (cursor.next(tokenBegin, tokenEnd))
+				{
+					const float u = parseFloat(tokenBegin, tokenEnd);
+					const float v = cursor.next(tokenBegin, tokenEnd) ? parseFloat(tokenBegin, tokenEnd) : 0.0f;
+					out.texcoords.push_back(u, v);
+				}
+			}
+			else if (length >= 2 && lineBegin[0] == 'f' && lineBegin[1] == ' ') // .obj format to tell us that faces indices are next
+			{
+				TokenCursor cursor = { lineBegin + 2, lineEnd };
+				parseFace(cursor, out, relativeSlots);
+			}
+
+			lineBegin = next;
+		}
+	}
+
+	// Per-chunk output of a parallel parse
+	struct ObjChunk
+	{
+		const char* begin = nullptr;
+		const char* end = nullptr;
+		ObjData data;
+		RelativeSlots relativeSlots; // Index slots resolved against the chunk-local record counts
+	};
+
+	void copyStreams(const Vec3Array& source, Vec3Array& destination, size_t offset)
+	{
+		std::copy(source.x.begin(), source.x.end(), destination.x.begin() + offset);
+		std::copy(source.y.begin(), source.y.end(), destination.y.begin() + offset);
+		std::copy(source.z.begin(), source.z.end(), destination.z.begin() + offset);
+	}
+
+	void copyStreams(const Vec2Array& source, Vec2Array& destination, size_t offset)
+	{
+		std::copy(source.x.begin(), source.x.end(), destination.x.begin() + offset);
+		std::copy(source.y.begin(), source.y.end(), destination.y.begin() + offset);
+	}
+
+	// Copy one chunk's index array into place and add the record count of earlier chunks to its relative slots
+	void copyIndices(const std::vector<unsigned int>& source, unsigned int* destination, const std::vector<size_t>& relativeSlots, size_t rebase)
+	{
+		std::copy(source.begin(), source.end(), destination);
+		for (size_t slot : relativeSlots)
+		{
+			destination[slot] += static_cast<unsigned int>(rebase);
+		}
+	}
+
+	// Empty data and slots that keep their capacity for the next block
+	void clearChunk(ObjChunk& chunk)
+	{
+		chunk.data.vertices.clear();
+		chunk.data.texcoords.clear();
+		chunk.data.normals.clear();
+		chunk.data.indices.clear();
+		chunk.data.attributeIndices = false;
+		chunk.data.texcoordIndices.clear();
+		chunk.data.normalIndices.clear();
+		chunk.relativeSlots.positions.clear();
+		chunk.relativeSlots.texcoords.clear();
+		chunk.relativeSlots.normals.clear();
+	}
+
+	// Split [begin, end) into up to chunkCount pieces that each start right after a '\n', reusing the chunks already
+	// in the list
+	void splitAtLines(const char* begin, const char* end, size_t chunkCount, std::vector<ObjChunk>& chunks)
+	{
+		size_t count = 0;
+		const size_t chunkBytes = (end - begin + chunkCount - 1) / chunkCount;
+		const char* chunkBegin = begin;
+		while (chunkBegin < end)
+		{
+			const char* chunkEnd = static_cast<size_t>(end - chunkBegin) > chunkBytes ? chunkBegin + chunkBytes : end;
+			while (chunkEnd < end && chunkEnd[-1] != '\n') ++chunkEnd;
+
+			if (count == chunks.size())
+			{
+				chunks.emplace_back();
+			}
+			ObjChunk& chunk = chunks[count++];
+			clearChunk(chunk);
+			chunk.begin = chunkBegin;
+			chunk.end = chunkEnd;
+			chunkBegin = chunkEnd;
+		}
+		chunks.resize(count);
+	}
+
+	// Parse [begin, end) split into chunkCount pieces, each on its own thread into private arrays, and append them to
+	// out. Negative indices resolve as if the records counted in before came ahead of out's. With reuse the chunk
+	// arrays are only emptied after the merge, they are released otherwise.
+	void parseChunks(const char* begin, const char* end, ObjData& out, size_t chunkCount, const ObjParser::RecordCounts& before,
+		std::vector<ObjChunk>& chunks, bool reuse)
+	{
+		splitAtLines(begin, end, chunkCount, chunks);
+		Parallel::run(chunks.size(), [&chunks](size_t i)
+		{
+			ObjChunk& chunk = chunks[i];
+			parseRange(chunk.begin, chunk.end, chunk.data, &chunk.relativeSlots);
+		});
+
+		// Prefix sums give each chunk its place in the merged arrays
+		std::vector<size_t> vertexBase(chunks.size() + 1, out.vertices.size());
+		std::vector<size_t> texcoordBase(chunks.size() + 1, out.texcoords.size());
+		std::vector<size_t> normalBase(chunks.size() + 1, out.normals.size());
+		std::vector<size_t> indexBase(chunks.size() + 1, out.indices.size());
+		bool attributeIndices = false;
+		for (size_t i = 0; i < chunks.size(); ++i)
+		{
+			vertexBase[i + 1] = vertexBase[i] + chunks[i].data.vertices.size();
+			texcoordBase[i + 1] = texcoordBase[i] + chunks[i].data.texcoords.size();
+			normalBase[i + 1] = normalBase[i] + chunks[i].data.normals.size();
+			indexBase[i + 1] = indexBase[i] + chunks[i].data.indices.size();
+			attributeIndices = attributeIndices || chunks[i].data.attributeIndices;
+		}
+		if (attributeIndices)
+		{
+			enableAttributeIndices(out);
+			out.texcoordIndices.resize(indexBase.back(), ObjData::missingIndex);
+			out.normalIndices.resize(indexBase.back(), ObjData::missingIndex);
+		}
+		out.vertices.resize(vertexBase.back());
+		out.texcoords.resize(texcoordBase.back());
+		out.normals.resize(normalBase.back());
+		out.indices.resize(indexBase.back());
+
+		// Copy chunks into place and rebase relative face indices. Absolute .obj indices do not depend on
+		// where a record sits in the file, so only the relative ones need the preceding vertex count added.
+		Parallel::run(chunks.size(), [&](size_t i)
+		{
+			ObjData& data = chunks[i].data;
+			const RelativeSlots& relativeSlots = chunks[i].relativeSlots;
+			copyStreams(data.vertices, out.vertices, vertexBase[i]);
+			copyStreams(data.texcoords, out.texcoords, texcoordBase[i]);
+			copyStreams(data.normals, out.normals, normalBase[i]);
+			copyIndices(data.indices, out.indices.data() + indexBase[i], relativeSlots.positions, before.vertices + vertexBase[i]);
+			if (data.attributeIndices) // Chunks without v/vt/vn corners keep the missingIndex fill
+			{
+				copyIndices(data.texcoordIndices, out.texcoordIndices.data() + indexBase[i], relativeSlots.texcoords, before.texcoords + texcoordBase[i]);
+				copyIndices(data.normalIndices, out.normalIndices.data() + indexBase[i], relativeSlots.normals, before.normals + normalBase[i]);
+			}
+			if (reuse)
+			{
+				clearChunk(chunks[i]);
+			}
+			else
+			{
+				data = ObjData(); // Release chunk memory as soon as it has been merged
+			}
+		});
+	}
+}
+
+struct ObjParseScratch::Chunks
+{
+	std::vector<ObjChunk> chunks;
+};
+
+ObjParseScratch::ObjParseScratch() : chunks(std::make_unique<Chunks>()) {}
+
+ObjParseScratch::~ObjParseScratch() = default;
+
+void ObjParser::parse(const char* begin, const char* end, ObjData& out)
+{
+	parseRange(begin, end, out, nullptr);
+}
+
+void ObjParser::parseParallel(const char* begin, const char* end, ObjData& out, unsigned int threadCount, ObjParseScratch* scratch)
+{
+	threadCount = Parallel::resolveThreadCount(threadCount);
+	const size_t byteCount = end - begin;
+	const size_t chunkCount = std::min<size_t>(threadCount, std::max<size_t>(1, byteCount / minChunkBytes));
+	if (chunkCount <= 1)
+	{
+		parse(begin, end, out);
+		return;
+	}
+	std::vector<ObjChunk> chunks;
+	parseChunks(begin, end, out, chunkCount, RecordCounts(), scratch ? scratch->chunks->chunks : chunks, scratch != nullptr);
+}
+
+void ObjParser::parseContinuation(const char* begin, const char* end, const RecordCounts& before, ObjData& out, unsigned int threadCount,
+	ObjParseScratch* scratch)
+{
+	// Always through the chunked path, it is the one that tracks which indices were relative
+	const size_t byteCount = end - begin;
+	const size_t chunkCount = std::min<size_t>(Parallel::resolveThreadCount(threadCount), std::max<size_t>(1, byteCount / minChunkBytes));
+	if (begin < end)
+	{
+		std::vector<ObjChunk> chunks;
+		parseChunks(begin, end, out, chunkCount, before, scratch ? scratch->chunks->chunks : chunks, scratch != nullptr);
+	}
+}
+
+std::vector<ObjParser::ScalingSample> ObjParser::measureScaling(const char* begin, const char* end, unsigned int maxThreads)
+{
+	maxThreads = Parallel::resolveThreadCount(maxThreads);
+
+	// 1, 2, 4 ... and always the requested maximum
+	std::vector<unsigned int> threadCounts;
+	for (unsigned int threads = 1; threads < maxThreads; threads *= 2)
+	{
+		threadCounts.push_back(threads);
+	}
+	threadCounts.push_back(maxThreads);
+
+	std::vector<ScalingSample> samples;
+	const double megabytes = static_cast<double>(end - begin) / (1024.0 * 1024.0);
+	for (unsigned int threads : threadCounts)
+	{
+		ObjData data;
+		auto start = std::chrono::steady_clock::now();
+		parseParallel(begin, end, data, threads);
+		std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+		ScalingSample sample;
+		sample.threadCount = threads;
+		sample.seconds = elapsed.count();
+		sample.megabytesPerSecond = sample.seconds > 0.0 ? megabytes / sample.seconds : 0.0;
+		samples.push_back(sample);
+	}
+	return samples;
+}
\ No newline at end of file
@@ -0,0 +1,493 @@
+// Chunks are welded with VertexWelder, laid out like mesh cache entries and mapped back one at a time
+
+#include "OutOfCoreMesh.h"
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstring>
+#include <QDebug>
+#include <QDir>
+#include <QTemporaryFile>
+#include "Trace.h"
+#include "VertexWelder.h"
+
+namespace
+{
+	// Corners, weld tables, welded arrays and edge keys while a chunk is spilled, with no vertex shared at all
+	constexpr size_t buildBytesPerTriangle = 184;
+	constexpr size_t minChunkTriangles = 4096;
+	constexpr size_t maxChunkTriangles = (UINT_MAX - 1) / 3;
+	constexpr uint64_t chunkAlignment = 64 * 1024; // Mapping granularity on Windows
+	constexpr uint64_t arrayAlignment = 64;
+
+	uint64_t alignUp(uint64_t value, uint64_t alignment)
+	{
+		return (value + alignment - 1) & ~(alignment - 1);
+	}
+
+	// Vertices of the edges that only one triangle uses, ascending
+	void findOpenEdgeVertices(std::span<const unsigned int> indices, std::vector<unsigned int>& out)
+	{
+		std::vector<uint64_t> edges;
+		edges.reserve(indices.size());
+		for (size_t i = 0; i + 2 < indices.size(); i += 3)
+		{
+			for (size_t corner = 0; corner < 3; ++corner)
+			{
+				const unsigned int a = indices[i + corner];
+				const unsigned int b = indices[i + (corner + 1) % 3];
+				edges.push_back(uint64_t(std::min(a, b)) << 32 | std::max(a, b));
+			}
+		}
+		std::sort(edges.begin(), edges.end());
+		out.clear();
+		for (size_t i = 0; i < edges.size();)
+		{
+			size_t next = i + 1;
+			while (next < edges.size() && edges[next] == edges[i])
+			{
+				++next;
+			}
+			if (next - i == 1)
+			{
+				out.push_back(static_cast<unsigned int>(edges[i] >> 32));
+				out.push_back(static_cast<unsigned int>(edges[i]));
+			}
+			i = next;
+		}
+		std::sort(out.begin(), out.end());
+		out.erase(std::unique(out.begin(), out.end()), out.end());
+	}
+
+	// Offsets of x, y, z, nx, ny, nz and the indices relative to the chunk start
+	void layoutChunk(uint64_t vertexCount, uint64_t indexCount, uint64_t offsets[7], uint64_t& bytes)
+	{
+		const uint64_t streamBytes = alignUp(vertexCount * sizeof(float), arrayAlignment);
+		for (int i = 0; i < 6; ++i)
+		{
+			offsets[i] = i * streamBytes;
+		}
+		offsets[6] = 6 * streamBytes;
+		bytes = offsets[6] + indexCount * sizeof(unsigned int);
+	}
+}
+
+PagedChunk::~PagedChunk()
+{
+	if (mapped)
+	{
+		file.unmap(mapped);
+	}
+}
+
+OutOfCoreMesh::OutOfCoreMesh(size_t memoryBudget, const QString& scratchDirectory, unsigned int threadCount)
+	: threadCount(threadCount), directory(scratchDirectory.isEmpty() ? QDir::tempPath() : scratchDirectory)
+{
+	// Border vertices take a quarter of the building half
+	chunkTriangles = std::clamp((memoryBudget / 2 - memoryBudget / 8) / buildBytesPerTriangle, minChunkTriangles, maxChunkTriangles);
+	maxBorderVertices = memoryBudget / 8 / sizeof(BorderVertex);
+	pagingBudget = memoryBudget - memoryBudget / 2;
+	scratch = std::make_unique<QTemporaryFile>(directory + "/simple3dviewer-XXXXXX.chunks");
+	if (!scratch->open())
+	{
+		qCritical() << "Cannot create a scratch file in" << directory;
+		failed = true;
+	}
+}
+
+OutOfCoreMesh::~OutOfCoreMesh()
+{
+	if (mappedVertices)
+	{
+		vertexScratch->unmap(reinterpret_cast<uchar*>(const_cast<float*>(mappedVertices)));
+	}
+}
+
+bool OutOfCoreMesh::addTriangles(Vec3Streams source)
+{
+	for (size_t first = 0; first + 2 < source.size() && !failed;)
+	{
+		if (corners.x.capacity() < chunkTriangles * 3)
+		{
+			corners.reserve(chunkTriangles * 3);
+		}
+		const size_t take = std::min(source.size() / 3 - first / 3, chunkTriangles - corners.size() / 3) * 3;
+		corners.x.insert(corners.x.end(), source.x + first, source.x + first + take);
+		corners.y.insert(corners.y.end(), source.y + first, source.y + first + take);
+		corners.z.insert(corners.z.end(), source.z + first, source.z + first + take);
+		first += take;
+		if (corners.size() == chunkTriangles * 3)
+		{
+			spill();
+		}
+	}
+	return !failed;
+}
+
+bool OutOfCoreMesh::addVertices(Vec3Streams positions)
+{
+	if (failed || positions.empty())
+	{
+		return !failed;
+	}
+	if (mappedVertices)
+	{
+		// The mapping ends at the vertices added so far, the next triangles map the longer file again
+		vertexScratch->unmap(reinterpret_cast<uchar*>(const_cast<float*>(mappedVertices)));
+		mappedVertices = nullptr;
+	}
+	if (!vertexScratch)
+	{
+		vertexScratch = std::make_unique<QTemporaryFile>(directory + "/simple3dviewer-XXXXXX.vertices");
+		if (!vertexScratch->open())
+		{
+			qCritical() << "Cannot create a scratch file in" << directory;
+			failed = true;
+			return false;
+		}
+	}
+	std::vector<float> interleaved(positions.size() * 3);
+	for (size_t v = 0; v < positions.size(); ++v)
+	{
+		interleaved[v * 3] = positions.x[v];
+		interleaved[v * 3 + 1] = positions.y[v];
+		interleaved[v * 3 + 2] = positions.z[v];
+	}
+	const qint64 bytes = static_cast<qint64>(interleaved.size() * sizeof(float));
+	if (vertexScratch->write(reinterpret_cast<const char*>(interleaved.data()), bytes) != bytes)
+	{
+		qCritical() << "Cannot write to the scratch file" << vertexScratch->fileName();
+		failed = true;
+		return false;
+	}
+	vertexScratchCount += positions.size();
+	return true;
+}
+
+// The whole vertex file in one read-only mapping, the system pages it in as corners are gathered
+bool OutOfCoreMesh::mapVertices()
+{
+	if (mappedVertices)
+	{
+		return true;
+	}
+	uchar* mapped = vertexScratch && vertexScratch->flush() ? vertexScratch->map(0, static_cast<qint64>(vertexScratchCount * 3 * sizeof(float))) : nullptr;
+	if (!mapped)
+	{
+		qCritical() << "Cannot map the vertices of" << (vertexScratch ? vertexScratch->fileName() : QString("an empty mesh"));
+		failed = true;
+		return false;
+	}
+	mappedVertices = reinterpret_cast<const float*>(mapped);
+	return true;
+}
+
+bool OutOfCoreMesh::addIndexedTriangles(std::span<const uint64_t> indices)
+{
+	if (indices.size() < 3 || failed || !mapVertices())
+	{
+		return !failed;
+	}
+	for (size_t first = 0; first + 2 < indices.size() && !failed;)
+	{
+		if (corners.x.capacity() < chunkTriangles * 3)
+		{
+			corners.reserve(chunkTriangles * 3);
+		}
+		const size_t take = std::min(indices.size() / 3 - first / 3, chunkTriangles - corners.size() / 3) * 3;
+		for (size_t i = first; i < first + take; ++i)
+		{
+			if (indices[i] >= vertexScratchCount)
+			{
+				qCritical() << "A triangle refers to vertex" << indices[i] << "of" << vertexScratchCount;
+				failed = true;
+				return false;
+			}
+			const float* position = mappedVertices + indices[i] * 3;
+			corners.x.push_back(position[0]);
+			corners.y.push_back(position[1]);
+			corners.z.push_back(position[2]);
+		}
+		first += take;
+		if (corners.size() == chunkTriangles * 3)
+		{
+			spill();
+		}
+	}
+	return !failed;
+}
+
+bool OutOfCoreMesh::finish()
+{
+	if (!failed && !corners.empty())
+	{
+		spill();
+	}
+	Vec3Array().x.swap(corners.x); // Release the build buffer, only paging needs memory from here on
+	Vec3Array().y.swap(corners.y);
+	Vec3Array().z.swap(corners.z);
+	if (mappedVertices)
+	{
+		vertexScratch->unmap(reinterpret_cast<uchar*>(const_cast<float*>(mappedVertices)));
+		mappedVertices = nullptr;
+	}
+	vertexScratch.reset();
+	return !failed && scratch->flush() && shareBorderNormals();
+}
+
+// Weld the chunk's corners, drop collapsed triangles, generate normals and append the result to the scratch file
+bool OutOfCoreMesh::spill()
+{
+	TRACE_ZONE("Spill chunk");
+	std::vector<unsigned int> indices;
+	Vec3Array vertices;
+	{
+		std::vector<unsigned int> firstCorners;
+		VertexWelder::weldPositions(corners.view(), 0.0f, threadCount, indices, firstCorners);
+		vertices.resize(firstCorners.size());
+		for (size_t v = 0; v < firstCorners.size(); ++v)
+		{
+			vertices.x[v] = corners.x[firstCorners[v]];
+			vertices.y[v] = corners.y[firstCorners[v]];
+			vertices.z[v] = corners.z[firstCorners[v]];
+		}
+	}
+	corners.clear();
+	size_t kept = 0;
+	for (size_t i = 0; i + 2 < indices.size(); i += 3)
+	{
+		const unsigned int a = indices[i], b = indices[i + 1], c = indices[i + 2];
+		if (a != b && b != c && a != c)
+		{
+			indices[kept++] = a;
+			indices[kept++] = b;
+			indices[kept++] = c;
+		}
+	}
+	indices.resize(kept);
+	if (indices.empty())
+	{
+		return true;
+	}
+	Vec3Array normals;
+	normals.resize(vertices.size(), 0.0f);
+	MeshKernels::accumulateFaceNormals(vertices.view(), indices.data(), indices.size(), normals.x.data(), normals.y.data(), normals.z.data());
+	std::vector<unsigned int> border;
+	if (!borderOverflow)
+	{
+		findOpenEdgeVertices(indices, border);
+		if (borderVertices.size() + border.size() > maxBorderVertices)
+		{
+			qWarning() << "More chunk border vertices than the budget holds, chunk borders keep their shading seams";
+			borderOverflow = true;
+			std::vector<BorderVertex>().swap(borderVertices);
+			border.clear();
+		}
+	}
+	for (unsigned int v : border)
+	{
+		borderVertices.push_back({ { vertices.x[v], vertices.y[v], vertices.z[v] }, { normals.x[v], normals.y[v], normals.z[v] },
+			static_cast<uint32_t>(chunks.size()), v });
+	}
+	MeshKernels::normalize(normals.x.data(), normals.y.data(), normals.z.data(), normals.size());
+
+	Chunk chunk;
+	chunk.offset = alignUp(scratchBytes, chunkAlignment);
+	chunk.vertexCount = static_cast<uint32_t>(vertices.size());
+	chunk.indexCount = static_cast<uint32_t>(indices.size());
+	chunk.bounds = MeshKernels::computeBounds(vertices.view());
+	uint64_t offsets[7];
+	layoutChunk(chunk.vertexCount, chunk.indexCount, offsets, chunk.bytes);
+	const float* streams[6] = { vertices.x.data(), vertices.y.data(), vertices.z.data(), normals.x.data(), normals.y.data(), normals.z.data() };
+	auto write = [this](uint64_t offset, const void* data, uint64_t bytes)
+	{
+		return scratch->seek(static_cast<qint64>(offset)) && scratch->write(static_cast<const char*>(data), static_cast<qint64>(bytes)) == static_cast<qint64>(bytes);
+	};
+	bool written = write(chunk.offset + offsets[6], indices.data(), indices.size() * sizeof(unsigned int));
+	for (int i = 0; i < 6 && written; ++i)
+	{
+		written = write(chunk.offset + offsets[i], streams[i], vertices.size() * sizeof(float));
+	}
+	if (!written)
+	{
+		qCritical() << "Cannot write to the scratch file" << scratch->fileName();
+		failed = true;
+		return false;
+	}
+	chunks.push_back(chunk);
+	triangleCount += chunk.indexCount / 3;
+	vertexCount += chunk.vertexCount;
+	scratchBytes = chunk.offset + chunk.bytes;
+	return true;
+}
+
+// Sorted by position, runs of one position span as many chunks as vertices since every chunk is welded. Their summed
+// sums give the normal written over each chunk's own, chunk by chunk through a writable mapping of the scratch file.
+bool OutOfCoreMesh::shareBorderNormals()
+{
+	TRACE_ZONE("Share border normals");
+	std::sort(borderVertices.begin(), borderVertices.end(), [](const BorderVertex& a, const BorderVertex& b)
+	{
+		return std::memcmp(a.position, b.position, sizeof(a.position)) < 0;
+	});
+	size_t shared = 0;
+	for (size_t first = 0; first < borderVertices.size();)
+	{
+		size_t last = first + 1;
+		while (last < borderVertices.size() && std::memcmp(borderVertices[last].position, borderVertices[first].position, sizeof(BorderVertex::position)) == 0)
+		{
+			++last;
+		}
+		if (last - first > 1)
+		{
+			float sum[3] = {};
+			for (size_t i = first; i < last; ++i)
+			{
+				for (int c = 0; c < 3; ++c)
+				{
+					sum[c] += borderVertices[i].normalSum[c];
+				}
+			}
+			const float length = std::sqrt(sum[0] * sum[0] + sum[1] * sum[1] + sum[2] * sum[2]);
+			const float scale = length > 0.0f ? 1.0f / length : 0.0f;
+			for (size_t i = first; i < last; ++i)
+			{
+				BorderVertex& vertex = borderVertices[shared++];
+				vertex = borderVertices[i];
+				for (int c = 0; c < 3; ++c)
+				{
+					vertex.normalSum[c] = sum[c] * scale;
+				}
+			}
+		}
+		first = last;
+	}
+	borderVertices.resize(shared);
+	std::sort(borderVertices.begin(), borderVertices.end(), [](const BorderVertex& a, const BorderVertex& b)
+	{
+		return a.chunk != b.chunk ? a.chunk < b.chunk : a.vertex < b.vertex;
+	});
+
+	for (size_t first = 0; first < borderVertices.size();)
+	{
+		const Chunk& chunk = chunks[borderVertices[first].chunk];
+		uchar* mapped = scratch->map(static_cast<qint64>(chunk.offset), static_cast<qint64>(chunk.bytes));
+		if (!mapped)
+		{
+			qCritical() << "Cannot map chunk" << borderVertices[first].chunk << "of" << scratch->fileName() << "for writing";
+			failed = true;
+			return false;
+		}
+		uint64_t offsets[7];
+		uint64_t bytes = 0;
+		layoutChunk(chunk.vertexCount, chunk.indexCount, offsets, bytes);
+		float* normals[3] = { reinterpret_cast<float*>(mapped + offsets[3]), reinterpret_cast<float*>(mapped + offsets[4]), reinterpret_cast<float*>(mapped + offsets[5]) };
+		size_t last = first;
+		for (; last < borderVertices.size() && borderVertices[last].chunk == borderVertices[first].chunk; ++last)
+		{
+			for (int c = 0; c < 3; ++c)
+			{
+				normals[c][borderVertices[last].vertex] = borderVertices[last].normalSum[c];
+			}
+		}
+		scratch->unmap(mapped);
+		first = last;
+	}
+	std::vector<BorderVertex>().swap(borderVertices);
+	return true;
+}
+
+const std::vector<OutOfCoreMesh::Chunk>& OutOfCoreMesh::getChunks() const
+{
+	return chunks;
+}
+
+uint64_t OutOfCoreMesh::getTriangleCount() const
+{
+	return triangleCount;
+}
+
+uint64_t OutOfCoreMesh::getVertexCount() const
+{
+	return vertexCount;
+}
+
+uint64_t OutOfCoreMesh::getScratchBytes() const
+{
+	return scratchBytes;
+}
+
+size_t OutOfCoreMesh::getChunkTriangleLimit() const
+{
+	return chunkTriangles;
+}
+
+// Box around every chunk box, the sphere around the box center that holds every chunk's sphere
+MeshBounds OutOfCoreMesh::getBounds() const
+{
+	MeshBounds bounds;
+	if (chunks.empty())
+	{
+		return bounds;
+	}
+	bounds.min = chunks.front().bounds.min;
+	bounds.max = chunks.front().bounds.max;
+	for (const Chunk& chunk : chunks)
+	{
+		bounds.min = QVector3D(std::min(bounds.min.x(), chunk.bounds.min.x()), std::min(bounds.min.y(), chunk.bounds.min.y()), std::min(bounds.min.z(), chunk.bounds.min.z()));
+		bounds.max = QVector3D(std::max(bounds.max.x(), chunk.bounds.max.x()), std::max(bounds.max.y(), chunk.bounds.max.y()), std::max(bounds.max.z(), chunk.bounds.max.z()));
+	}
+	bounds.center = (bounds.min + bounds.max) * 0.5f;
+	for (const Chunk& chunk : chunks)
+	{
+		bounds.radius = std::max(bounds.radius, (chunk.bounds.center - bounds.center).length() + chunk.bounds.radius);
+	}
+	return bounds;
+}
+
+std::shared_ptr<const PagedChunk> OutOfCoreMesh::page(size_t chunk) const
+{
+	for (auto it = pagedChunks.begin(); it != pagedChunks.end(); ++it)
+	{
+		if (it->first == chunk)
+		{
+			pagedChunks.splice(pagedChunks.begin(), pagedChunks, it);
+			return it->second;
+		}
+	}
+	if (chunk >= chunks.size())
+	{
+		return nullptr;
+	}
+
+	TRACE_ZONE("Page in chunk");
+	const Chunk& info = chunks[chunk];
+	auto paged = std::make_shared<PagedChunk>();
+	paged->file.setFileName(scratch->fileName());
+	if (!paged->file.open(QIODevice::ReadOnly) || !(paged->mapped = paged->file.map(static_cast<qint64>(info.offset), static_cast<qint64>(info.bytes))))
+	{
+		qCritical() << "Cannot map chunk" << chunk << "of" << scratch->fileName();
+		return nullptr;
+	}
+	uint64_t offsets[7];
+	uint64_t bytes = 0;
+	layoutChunk(info.vertexCount, info.indexCount, offsets, bytes);
+	auto stream = [&paged, &offsets](int i) { return reinterpret_cast<const float*>(paged->mapped + offsets[i]); };
+	paged->vertices = { stream(0), stream(1), stream(2), info.vertexCount };
+	paged->normals = { stream(3), stream(4), stream(5), info.vertexCount };
+	paged->indices = { reinterpret_cast<const unsigned int*>(paged->mapped + offsets[6]), info.indexCount };
+
+	pagedChunks.emplace_front(chunk, paged);
+	pagedBytes += info.bytes;
+	while (pagedBytes > pagingBudget && pagedChunks.size() > 1)
+	{
+		pagedBytes -= chunks[pagedChunks.back().first].bytes;
+		pagedChunks.pop_back();
+	}
+	return paged;
+}
+
+size_t OutOfCoreMesh::getPagedBytes() const
+{
+	return pagedBytes;
+}
\ No newline at end of file
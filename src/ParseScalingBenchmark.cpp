@@ -0,0 +1,35 @@
+// Parses one mapped .obj file repeatedly at doubling thread counts
+
+#include "ParseScalingBenchmark.h"
+#include "ObjParser.h"
+#include <QDebug>
+#include <QFile>
+
+bool runParseScalingBenchmark(const QString& filePath, unsigned int maxThreads)
+{
+	QFile file(filePath);
+	if (!file.open(QIODevice::ReadOnly) || file.size() == 0)
+	{
+		qCritical() << "Cannot open" << filePath << "for the parse scaling report";
+		return false;
+	}
+	uchar* mapped = file.map(0, file.size());
+	if (!mapped)
+	{
+		qCritical() << "Cannot map" << filePath;
+		return false;
+	}
+
+	const char* text = reinterpret_cast<const char*>(mapped);
+	auto samples = ObjParser::measureScaling(text, text + file.size(), maxThreads);
+	file.unmap(mapped);
+
+	qInfo() << "Parse scaling for" << filePath << "-" << file.size() / (1024.0 * 1024.0) << "MB";
+	const double baseline = samples.empty() ? 0.0 : samples.front().megabytesPerSecond;
+	for (const auto& sample : samples)
+	{
+		qInfo().nospace() << sample.threadCount << " threads: " << sample.megabytesPerSecond << " MB/s ("
+			<< sample.seconds << " s, x" << (baseline > 0.0 ? sample.megabytesPerSecond / baseline : 0.0) << ")";
+	}
+	return true;
+}
\ No newline at end of file
@@ -0,0 +1,97 @@
+// Block-by-block parses of one file with and without a scratch shared by the blocks, counted with AllocationCounter
+
+#include "ParseScratchBenchmark.h"
+#include "AllocationCounter.h"
+#include "FileBlockReader.h"
+#include "ObjParser.h"
+#include "Parallel.h"
+#include <QDebug>
+#include <algorithm>
+#include <chrono>
+#include <optional>
+
+namespace
+{
+	constexpr int repeats = 3;
+
+	struct ParseRun
+	{
+		size_t allocations = 0;
+		size_t allocatedBytes = 0;
+		size_t peakBytes = 0;
+		double ms = 0.0;
+	};
+
+	bool parseFile(const QString& filePath, unsigned int threadCount, bool useScratch, ObjData& data, ParseRun& run)
+	{
+		data = ObjData();
+		AllocationCounter::Scope scope;
+		const auto start = std::chrono::steady_clock::now();
+		{
+			FileBlockReader reader(filePath, FileBlockReader::defaultBlockBytes, true);
+			std::optional<ObjParseScratch> scratch;
+			if (useScratch)
+			{
+				scratch.emplace();
+			}
+			std::span<const char> block;
+			while (reader.next(block))
+			{
+				ObjParser::parseParallel(block.data(), block.data() + block.size(), data, threadCount, scratch ? &*scratch : nullptr);
+			}
+			if (reader.failed())
+			{
+				return false;
+			}
+		}
+		run.ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		run.allocations = scope.allocations();
+		run.allocatedBytes = scope.allocatedBytes();
+		run.peakBytes = scope.peakBytes();
+		return true;
+	}
+
+	bool sameRecords(const ObjData& a, const ObjData& b)
+	{
+		auto sameStreams = [](const FloatStream& x, const FloatStream& y) { return std::equal(x.begin(), x.end(), y.begin(), y.end()); };
+		return sameStreams(a.vertices.x, b.vertices.x) && sameStreams(a.vertices.y, b.vertices.y) && sameStreams(a.vertices.z, b.vertices.z)
+			&& sameStreams(a.normals.x, b.normals.x) && sameStreams(a.texcoords.x, b.texcoords.x) && a.indices == b.indices
+			&& a.texcoordIndices == b.texcoordIndices && a.normalIndices == b.normalIndices;
+	}
+}
+
+bool runParseScratchBenchmark(const QString& filePath, unsigned int threadCount)
+{
+	threadCount = Parallel::resolveThreadCount(threadCount);
+	ObjData reference;
+	ObjData data;
+	ParseRun best[2];
+	for (int mode = 0; mode < 2; ++mode)
+	{
+		for (int repeat = 0; repeat < repeats; ++repeat)
+		{
+			ParseRun run;
+			if (!parseFile(filePath, threadCount, mode == 1, mode == 0 ? reference : data, run))
+			{
+				qCritical() << "Cannot read" << filePath << "for the parse scratch benchmark";
+				return false;
+			}
+			// Counts are the same every run, only the time varies
+			best[mode] = repeat == 0 || run.ms < best[mode].ms ? run : best[mode];
+		}
+	}
+
+	qInfo().nospace() << "Parse scratch benchmark: " << filePath << ", " << reference.indices.size() / 3 << " triangles, " << threadCount << " threads";
+	const char* names[2] = { "Chunk arrays per block", "One scratch per load" };
+	for (int mode = 0; mode < 2; ++mode)
+	{
+		qInfo().nospace() << names[mode] << ": " << best[mode].allocations << " allocations, " << best[mode].allocatedBytes / (1024.0 * 1024.0)
+			<< " MB allocated, peak " << best[mode].peakBytes / (1024.0 * 1024.0) << " MB, " << best[mode].ms << " ms";
+	}
+	if (!sameRecords(reference, data))
+	{
+		qCritical() << "Parsing with a scratch changed the records";
+		return false;
+	}
+	return true;
+}
\ No newline at end of file
@@ -0,0 +1,110 @@
+// Builds the picking BVH for a loaded model and fires random camera rays at it
+
+#include "PickBenchmark.h"
+#include "Model.h"
+#include "Parallel.h"
+#include "TriangleBvh.h"
+#include <QDebug>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <random>
+#include <vector>
+
+namespace
+{
+	template <typename Function>
+	double timeMs(const Function& function)
+	{
+		auto start = std::chrono::steady_clock::now();
+		function();
+		return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	// Rays from random points on a sphere around the model towards random points inside its bounds
+	std::vector<PickRay> makeRays(const MeshBounds& bounds, size_t count)
+	{
+		std::mt19937 random(12345);
+		std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+		const float radius = std::max(bounds.radius, 1e-3f) * 3.0f;
+		std::vector<PickRay> rays(count);
+		for (PickRay& ray : rays)
+		{
+			float direction[3] = { unit(random), unit(random), unit(random) };
+			const float length = std::max(std::sqrt(direction[0] * direction[0] + direction[1] * direction[1] + direction[2] * direction[2]), 1e-6f);
+			for (int axis = 0; axis < 3; ++axis)
+			{
+				const float target = bounds.center[axis] + unit(random) * 0.5f * (bounds.max[axis] - bounds.min[axis]);
+				ray.origin[axis] = bounds.center[axis] + direction[axis] / length * radius;
+				ray.direction[axis] = target - ray.origin[axis];
+			}
+		}
+		return rays;
+	}
+}
+
+bool runPickBenchmark(const QString& filePath, size_t rayCount)
+{
+	Model model;
+	if (!model.loadFromFile(filePath) || model.getIndices().empty())
+	{
+		qCritical() << "Cannot load" << filePath << "for the pick benchmark";
+		return false;
+	}
+	const Vec3Streams positions = model.getVertices();
+	const auto indices = model.getIndices();
+	qInfo() << "Pick benchmark:" << indices.size() / 3 << "triangles from" << filePath;
+
+	// Build at 1, 2, 4 ... hardware threads
+	TriangleBvh bvh;
+	const unsigned int maxThreads = Parallel::resolveThreadCount(0);
+	for (unsigned int threads = 1;; threads = std::min(threads * 2, maxThreads))
+	{
+		const double ms = timeMs([&]() { bvh.build(positions, indices, threads); });
+		qInfo().nospace() << "Build with " << threads << " threads: " << ms << " ms";
+		if (threads == maxThreads)
+		{
+			break;
+		}
+	}
+	qInfo().nospace() << bvh.getNodes().size() << " nodes, " << bvh.memoryBytes() / (1024.0 * 1024.0) << " MB";
+
+	const std::vector<PickRay> rays = makeRays(model.getBounds(), std::max<size_t>(rayCount, 1));
+	std::vector<double> queryUs;
+	std::vector<PickHit> hits;
+	queryUs.reserve(rays.size());
+	hits.reserve(rays.size());
+	for (const PickRay& ray : rays)
+	{
+		PickHit hit;
+		queryUs.push_back(timeMs([&]() { hit = bvh.intersect(ray, positions); }) * 1000.0);
+		hits.push_back(hit);
+	}
+	const size_t hitCount = std::count_if(hits.begin(), hits.end(), [](const PickHit& hit) { return hit.hit; });
+	std::vector<double> sorted = queryUs;
+	std::sort(sorted.begin(), sorted.end());
+	double total = 0.0;
+	for (double us : queryUs)
+	{
+		total += us;
+	}
+	qInfo().nospace() << rays.size() << " rays, " << hitCount << " hits: mean " << total / rays.size() << " us, p99 "
+		<< sorted[std::min(sorted.size() - 1, sorted.size() * 99 / 100)] << " us, max " << sorted.back() << " us";
+
+	// The brute-force loop is slow on big meshes, a handful of rays is enough to compare
+	const size_t checkCount = std::min<size_t>(rays.size(), 8);
+	size_t mismatches = 0;
+	double bruteMs = 0.0;
+	for (size_t i = 0; i < checkCount; ++i)
+	{
+		PickHit reference;
+		bruteMs += timeMs([&]() { reference = TriangleBvh::intersectAll(rays[i], positions, indices); });
+		if (reference.hit != hits[i].hit || (reference.hit && std::fabs(reference.distance - hits[i].distance) > 1e-5f * std::max(1.0f, reference.distance)))
+		{
+			++mismatches;
+		}
+	}
+	qInfo().nospace() << "Brute force: " << bruteMs / checkCount << " ms per ray (x" << (bruteMs / checkCount) / (total / rays.size() / 1000.0)
+		<< " slower), " << mismatches << " of " << checkCount << " hits differ";
+	return mismatches == 0;
+}
\ No newline at end of file
@@ -0,0 +1,788 @@
+// Header parsing and per-element record decoding, with plain float vertices and triangle lists on dedicated loops
+
+#include "PlyReader.h"
+#include <algorithm>
+#include <bit>
+#include <climits>
+#include <cstring>
+#include <QDebug>
+#include <QFileInfo>
+#include "NumberParser.h"
+#include "Parallel.h"
+
+namespace
+{
+	constexpr size_t maxHeaderBytes = 1 << 20;
+	constexpr size_t maxCarryBytes = 1 << 20; // A record split across blocks, longer only with a corrupt list count
+	constexpr size_t minParallelVertices = 1 << 16; // Per thread, shorter runs decode on the calling thread
+	constexpr uint64_t invalidIndex = UINT64_MAX;
+
+	inline bool isSpace(char c)
+	{
+		return c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '\v' || c == '\f';
+	}
+
+	// Whitespace-separated tokens of one line
+	struct TokenCursor
+	{
+		const char* pos;
+		const char* end;
+
+		bool next(const char*& tokenBegin, const char*& tokenEnd)
+		{
+			while (pos < end && isSpace(*pos)) ++pos;
+			if (pos == end)
+			{
+				return false;
+			}
+			tokenBegin = pos;
+			while (pos < end && !isSpace(*pos)) ++pos;
+			tokenEnd = pos;
+			return true;
+		}
+		bool nextNumber(double& value)
+		{
+			const char* first;
+			const char* last;
+			return next(first, last) && NumberParser::parseDouble(first, last, value) == last;
+		}
+	};
+
+	std::vector<std::string> splitWords(const char* begin, const char* end)
+	{
+		std::vector<std::string> words;
+		TokenCursor cursor = { begin, end };
+		const char* first;
+		const char* last;
+		while (cursor.next(first, last))
+		{
+			words.emplace_back(first, last);
+		}
+		return words;
+	}
+
+	uint64_t toIndex(double value)
+	{
+		return value >= 0.0 && value < static_cast<double>(invalidIndex) ? static_cast<uint64_t>(value) : invalidIndex;
+	}
+}
+
+PlyReader::PlyReader(unsigned int threadCount) : threadCount(threadCount) {}
+
+void PlyReader::streamVertices(size_t windowVertices, VertexWindowFunction flush)
+{
+	this->windowVertices = std::max<size_t>(windowVertices, 1);
+	flushWindow = std::move(flush);
+}
+
+bool PlyReader::isPlyFile(const QString& filePath)
+{
+	return QFileInfo(filePath).suffix().toLower() == "ply";
+}
+
+namespace
+{
+	size_t typeSize(unsigned char type)
+	{
+		static const size_t sizes[] = { 1, 1, 2, 2, 4, 4, 4, 8 };
+		return sizes[type];
+	}
+
+	// The spec's names and the sized aliases newer exporters write
+	bool parseTypeName(const std::string& name, unsigned char& type)
+	{
+		static const char* const names[][2] = { { "char", "int8" }, { "uchar", "uint8" }, { "short", "int16" }, { "ushort", "uint16" },
+			{ "int", "int32" }, { "uint", "uint32" }, { "float", "float32" }, { "double", "float64" } };
+		for (unsigned char i = 0; i < 8; ++i)
+		{
+			if (name == names[i][0] || name == names[i][1])
+			{
+				type = i;
+				return true;
+			}
+		}
+		return false;
+	}
+
+	template <typename T>
+	T load(const char* bytes, bool swap)
+	{
+		char copy[sizeof(T)];
+		std::memcpy(copy, bytes, sizeof(T));
+		if (swap)
+		{
+			std::reverse(copy, copy + sizeof(T));
+		}
+		T value;
+		std::memcpy(&value, copy, sizeof(T));
+		return value;
+	}
+
+	double readNumber(const char* bytes, unsigned char type, bool swap)
+	{
+		switch (type)
+		{
+		case 0: return load<int8_t>(bytes, false);
+		case 1: return load<uint8_t>(bytes, false);
+		case 2: return load<int16_t>(bytes, swap);
+		case 3: return load<uint16_t>(bytes, swap);
+		case 4: return load<int32_t>(bytes, swap);
+		case 5: return load<uint32_t>(bytes, swap);
+		case 6: return load<float>(bytes, swap);
+		case 7: return load<double>(bytes, swap);
+		}
+		return 0.0;
+	}
+
+	size_t listCount(const char* bytes, unsigned char type, bool swap)
+	{
+		const double count = readNumber(bytes, type, swap);
+		return count > 0.0 ? static_cast<size_t>(count) : 0;
+	}
+}
+
+bool PlyReader::fail(const char* message)
+{
+	qCritical() << "Invalid PLY file:" << message;
+	failed = true;
+	return false;
+}
+
+bool PlyReader::consume(const char* begin, const char* end)
+{
+	if (failed)
+	{
+		return false;
+	}
+	if (!headerDone)
+	{
+		// Collect the header, it ends with the line break after "end_header"
+		const size_t previous = carry.size();
+		const size_t take = std::min<size_t>(end - begin, maxHeaderBytes - previous);
+		carry.insert(carry.end(), begin, begin + take);
+		static const char marker[] = "\nend_header";
+		auto found = std::search(carry.begin(), carry.end(), marker, marker + sizeof(marker) - 1);
+		auto lineEnd = found == carry.end() ? carry.end() : std::find(found + sizeof(marker) - 1, carry.end(), '\n');
+		if (lineEnd == carry.end())
+		{
+			return carry.size() < maxHeaderBytes || fail("no end_header in the first MB");
+		}
+		const size_t headerBytes = lineEnd + 1 - carry.begin();
+		if (!parseHeader(carry.data(), carry.data() + headerBytes))
+		{
+			return false;
+		}
+		begin += headerBytes - previous;
+		carry.clear();
+		headerDone = true;
+	}
+
+	// Complete a record that was split by the previous block boundary, taking only the bytes it still needs
+	while (!carry.empty() && begin < end)
+	{
+		size_t take = end - begin;
+		if (format == Format::Ascii)
+		{
+			const char* newline = static_cast<const char*>(std::memchr(begin, '\n', end - begin));
+			take = newline ? newline + 1 - begin : take;
+		}
+		else
+		{
+			take = std::min(take, missingBytes(carry.data(), carry.data() + carry.size()));
+		}
+		if (carry.size() + take > maxCarryBytes)
+		{
+			return fail(format == Format::Ascii ? "a line is longer than 1 MB" : "a list count makes a record longer than 1 MB");
+		}
+		carry.insert(carry.end(), begin, begin + take);
+		begin += take;
+		const bool complete = format == Format::Ascii ? carry.back() == '\n' : missingBytes(carry.data(), carry.data() + carry.size()) == 0;
+		if (complete)
+		{
+			parseRecords(carry.data(), carry.data() + carry.size());
+			carry.clear();
+			if (failed)
+			{
+				return false;
+			}
+		}
+	}
+	if (!carry.empty())
+	{
+		return true;
+	}
+
+	while (begin < end)
+	{
+		const size_t used = parseRecords(begin, end);
+		if (failed)
+		{
+			return false;
+		}
+		if (used == 0)
+		{
+			break;
+		}
+		begin += used;
+	}
+	if (begin < end && element < elements.size())
+	{
+		carry.assign(begin, end); // At most one record
+	}
+	return true;
+}
+
+bool PlyReader::finish()
+{
+	if (failed)
+	{
+		return false;
+	}
+	if (!headerDone)
+	{
+		return fail("no end_header");
+	}
+	if (format == Format::Ascii && !carry.empty())
+	{
+		carry.push_back('\n'); // Last line without a line break
+		parseRecords(carry.data(), carry.data() + carry.size());
+		carry.clear();
+	}
+	while (element < elements.size() && record == elements[element].count)
+	{
+		++element;
+		record = 0;
+	}
+	if (element < elements.size())
+	{
+		qCritical().nospace() << "Invalid PLY file: it ends after " << record << " of " << elements[element].count << " "
+			<< elements[element].name.c_str() << " records";
+		failed = true;
+	}
+	return !failed;
+}
+
+PlyMesh& PlyReader::getMesh()
+{
+	return mesh;
+}
+
+bool PlyReader::verticesDone() const
+{
+	return headerDone && vertexRecord == vertexCount;
+}
+
+bool PlyReader::parseHeader(const char* begin, const char* end)
+{
+	bool hasFormat = false;
+	bool first = true;
+	for (const char* line = begin; line < end;)
+	{
+		const char* lineEnd = std::find(line, end, '\n');
+		const std::vector<std::string> words = splitWords(line, lineEnd);
+		line = lineEnd + 1;
+		if (first)
+		{
+			if (words.size() != 1 || words[0] != "ply")
+			{
+				return fail("missing the ply magic line");
+			}
+			first = false;
+		}
+		else if (words.empty() || words[0] == "comment" || words[0] == "obj_info" || words[0] == "end_header")
+		{
+			continue;
+		}
+		else if (words[0] == "format" && words.size() == 3)
+		{
+			if (words[1] == "ascii") format = Format::Ascii;
+			else if (words[1] == "binary_little_endian") format = Format::BinaryLittleEndian;
+			else if (words[1] == "binary_big_endian") format = Format::BinaryBigEndian;
+			else return fail("unknown format");
+			hasFormat = true;
+		}
+		else if (words[0] == "element" && words.size() == 3)
+		{
+			Element added;
+			added.name = words[1];
+			added.count = std::strtoull(words[2].c_str(), nullptr, 10);
+			added.kind = added.name == "vertex" ? Kind::Vertex : (added.name == "face" ? Kind::Face : Kind::Other);
+			elements.push_back(std::move(added));
+		}
+		else if (words[0] == "property" && !elements.empty())
+		{
+			Property property;
+			unsigned char type = 0;
+			unsigned char countType = 0;
+			if (words.size() == 5 && words[1] == "list" && parseTypeName(words[2], countType) && parseTypeName(words[3], type) && countType <= 5)
+			{
+				property.list = true;
+				property.countType = static_cast<Type>(countType);
+			}
+			else if (words.size() != 3 || !parseTypeName(words[1], type))
+			{
+				return fail("malformed property line");
+			}
+			property.type = static_cast<Type>(type);
+			property.name = words.back();
+			elements.back().properties.push_back(std::move(property));
+		}
+		else
+		{
+			return fail("unexpected header line");
+		}
+	}
+	if (!hasFormat)
+	{
+		return fail("no format line");
+	}
+	swapBytes = format == (std::endian::native == std::endian::little ? Format::BinaryBigEndian : Format::BinaryLittleEndian);
+
+	// Give the properties Model uses their roles, incomplete vectors are left unread
+	static const std::pair<const char*, Role> vertexRoles[] = { { "x", Role::X }, { "y", Role::Y }, { "z", Role::Z },
+		{ "nx", Role::NormalX }, { "ny", Role::NormalY }, { "nz", Role::NormalZ }, { "u", Role::U }, { "v", Role::V },
+		{ "s", Role::U }, { "t", Role::V }, { "texture_u", Role::U }, { "texture_v", Role::V }, { "texture_s", Role::U }, { "texture_t", Role::V } };
+	bool hasVertices = false;
+	uint64_t faceCount = 0;
+	for (Element& current : elements)
+	{
+		bool found[10] = {};
+		for (Property& property : current.properties)
+		{
+			if (current.kind == Kind::Vertex && !property.list)
+			{
+				for (const auto& [name, role] : vertexRoles)
+				{
+					if (property.name == name && !found[static_cast<int>(role)])
+					{
+						property.role = role;
+						found[static_cast<int>(role)] = true;
+						break;
+					}
+				}
+			}
+			else if (current.kind == Kind::Face && property.list && (property.name == "vertex_indices" || property.name == "vertex_index")
+				&& static_cast<unsigned char>(property.type) <= 5 && !found[static_cast<int>(Role::FaceIndices)])
+			{
+				property.role = Role::FaceIndices;
+				found[static_cast<int>(Role::FaceIndices)] = true;
+			}
+		}
+		const bool normals = windowVertices == 0 && found[static_cast<int>(Role::NormalX)] && found[static_cast<int>(Role::NormalY)] && found[static_cast<int>(Role::NormalZ)];
+		const bool texcoords = windowVertices == 0 && found[static_cast<int>(Role::U)] && found[static_cast<int>(Role::V)];
+		for (Property& property : current.properties)
+		{
+			const bool normal = property.role == Role::NormalX || property.role == Role::NormalY || property.role == Role::NormalZ;
+			const bool texcoord = property.role == Role::U || property.role == Role::V;
+			if ((normal && !normals) || (texcoord && !texcoords))
+			{
+				property.role = Role::None;
+			}
+		}
+
+		// Fixed-size binary records get property offsets, a list anywhere makes the size vary
+		current.recordBytes = 0;
+		if (format != Format::Ascii && std::none_of(current.properties.begin(), current.properties.end(), [](const Property& p) { return p.list; }))
+		{
+			for (Property& property : current.properties)
+			{
+				property.offset = current.recordBytes;
+				current.recordBytes += typeSize(static_cast<unsigned char>(property.type));
+			}
+		}
+
+		if (current.kind == Kind::Vertex && !hasVertices)
+		{
+			if (!found[static_cast<int>(Role::X)] || !found[static_cast<int>(Role::Y)] || !found[static_cast<int>(Role::Z)])
+			{
+				return fail("the vertex element has no x, y and z");
+			}
+			if (windowVertices == 0 && current.count >= UINT_MAX)
+			{
+				return fail("more vertices than 32-bit indices can address, only an out-of-core load can take them");
+			}
+			hasVertices = true;
+			vertexCount = current.count;
+			mesh.vertices.resize(windowVertices > 0 ? std::min<uint64_t>(vertexCount, windowVertices) : vertexCount);
+			if (normals)
+			{
+				mesh.normals.resize(vertexCount);
+			}
+			if (texcoords)
+			{
+				mesh.texcoords.resize(vertexCount);
+			}
+			fastVertices = current.recordBytes > 0 && !swapBytes && std::all_of(current.properties.begin(), current.properties.end(),
+				[](const Property& p) { return p.role == Role::None || p.type == Type::Float32; });
+		}
+		else if (current.kind == Kind::Vertex)
+		{
+			current.kind = Kind::Other; // A second vertex element is skipped
+		}
+		else if (current.kind == Kind::Face)
+		{
+			faceCount += current.count;
+			fastFaces = format != Format::Ascii && !swapBytes && current.properties.size() == 1 && current.properties[0].role == Role::FaceIndices
+				&& current.properties[0].countType == Type::UInt8 && (current.properties[0].type == Type::Int32 || current.properties[0].type == Type::UInt32);
+		}
+	}
+	if (!hasVertices)
+	{
+		return fail("no vertex element");
+	}
+	// Mostly triangles, capped so a bogus face count cannot reserve far more than any mesh of this many vertices needs
+	if (windowVertices == 0)
+	{
+		mesh.indices.reserve(std::min(faceCount, vertexCount * 4) * 3);
+	}
+	return true;
+}
+
+size_t PlyReader::missingBytes(const char* begin, const char* end) const
+{
+	const Element& current = elements[element];
+	const size_t available = end - begin;
+	if (current.recordBytes > 0)
+	{
+		return available >= current.recordBytes ? 0 : current.recordBytes - available;
+	}
+	size_t needed = 0;
+	for (const Property& property : current.properties)
+	{
+		if (property.list)
+		{
+			const size_t countBytes = typeSize(static_cast<unsigned char>(property.countType));
+			if (needed + countBytes > available)
+			{
+				return needed + countBytes - available;
+			}
+			needed += countBytes + listCount(begin + needed, static_cast<unsigned char>(property.countType), swapBytes) * typeSize(static_cast<unsigned char>(property.type));
+		}
+		else
+		{
+			needed += typeSize(static_cast<unsigned char>(property.type));
+		}
+	}
+	return needed > available ? needed - available : 0;
+}
+
+size_t PlyReader::parseRecords(const char* begin, const char* end)
+{
+	while (element < elements.size() && record == elements[element].count)
+	{
+		++element;
+		record = 0;
+	}
+	if (element >= elements.size())
+	{
+		return end - begin; // Anything after the last element is ignored
+	}
+
+	const Element& current = elements[element];
+	const char* pos = begin;
+	if (format == Format::Ascii)
+	{
+		while (record < current.count && pos < end)
+		{
+			const char* lineEnd = static_cast<const char*>(std::memchr(pos, '\n', end - pos));
+			if (!lineEnd)
+			{
+				break;
+			}
+			if (std::all_of(pos, lineEnd, isSpace))
+			{
+				pos = lineEnd + 1; // Blank lines are not records
+				continue;
+			}
+			if (!parseAsciiRecord(current, pos, lineEnd, vertexRecord - windowStart))
+			{
+				return 0;
+			}
+			pos = lineEnd + 1;
+			++record;
+			if (current.kind == Kind::Vertex)
+			{
+				advanceVertices(1);
+			}
+		}
+	}
+	else if (current.recordBytes > 0 && current.kind != Kind::Face)
+	{
+		size_t records = static_cast<size_t>(std::min<uint64_t>(current.count - record, static_cast<size_t>(end - pos) / current.recordBytes));
+		if (current.kind == Kind::Vertex)
+		{
+			records = std::min<size_t>(records, mesh.vertices.size() - static_cast<size_t>(vertexRecord - windowStart)); // The rest after a flush
+			parseVertexRun(pos, records);
+			advanceVertices(records);
+		}
+		pos += records * current.recordBytes;
+		record += records;
+	}
+	else if (current.kind == Kind::Face && fastFaces)
+	{
+		pos = begin + parseFacesFast(pos, end);
+	}
+	else
+	{
+		while (record < current.count && missingBytes(pos, end) == 0)
+		{
+			pos = parseBinaryRecord(current, pos, vertexRecord - windowStart);
+			if (!pos)
+			{
+				return 0;
+			}
+			++record;
+			if (current.kind == Kind::Vertex)
+			{
+				advanceVertices(1);
+			}
+		}
+	}
+	return pos - begin;
+}
+
+// Fixed-size vertex records split into ranges per thread, every record has its own output slot in the window
+size_t PlyReader::parseVertexRun(const char* begin, size_t records)
+{
+	const Element& current = elements[element];
+	const size_t stride = current.recordBytes;
+	const size_t firstVertex = static_cast<size_t>(vertexRecord - windowStart);
+
+	size_t offsets[10];
+	std::fill(offsets, offsets + 10, SIZE_MAX);
+	for (const Property& property : current.properties)
+	{
+		offsets[static_cast<int>(property.role)] = property.offset;
+	}
+	const bool normals = !mesh.normals.empty();
+	const bool texcoords = !mesh.texcoords.empty();
+	auto decode = [&](size_t first, size_t last)
+	{
+		if (!fastVertices)
+		{
+			for (size_t r = first; r < last; ++r)
+			{
+				parseBinaryRecord(current, begin + r * stride, firstVertex + r);
+			}
+			return;
+		}
+		// Every field read is a float in this machine's byte order, a plain copy per component
+		const char* source = begin + first * stride;
+		for (size_t r = first; r < last; ++r, source += stride)
+		{
+			const size_t v = firstVertex + r;
+			std::memcpy(&mesh.vertices.x[v], source + offsets[static_cast<int>(Role::X)], sizeof(float));
+			std::memcpy(&mesh.vertices.y[v], source + offsets[static_cast<int>(Role::Y)], sizeof(float));
+			std::memcpy(&mesh.vertices.z[v], source + offsets[static_cast<int>(Role::Z)], sizeof(float));
+			if (normals)
+			{
+				std::memcpy(&mesh.normals.x[v], source + offsets[static_cast<int>(Role::NormalX)], sizeof(float));
+				std::memcpy(&mesh.normals.y[v], source + offsets[static_cast<int>(Role::NormalY)], sizeof(float));
+				std::memcpy(&mesh.normals.z[v], source + offsets[static_cast<int>(Role::NormalZ)], sizeof(float));
+			}
+			if (texcoords)
+			{
+				std::memcpy(&mesh.texcoords.x[v], source + offsets[static_cast<int>(Role::U)], sizeof(float));
+				std::memcpy(&mesh.texcoords.y[v], source + offsets[static_cast<int>(Role::V)], sizeof(float));
+			}
+		}
+	};
+
+	const size_t threads = std::min<size_t>(Parallel::resolveThreadCount(threadCount), std::max<size_t>(records / minParallelVertices, 1));
+	Parallel::run(threads, [&](size_t t) { decode(records * t / threads, records * (t + 1) / threads); });
+	return records * stride;
+}
+
+void PlyReader::advanceVertices(uint64_t records)
+{
+	vertexRecord += records;
+	if (windowVertices == 0 || vertexRecord - windowStart < mesh.vertices.size())
+	{
+		return;
+	}
+	if (!flushWindow(mesh.vertices.view()))
+	{
+		fail("the vertex window could not be stored");
+		return;
+	}
+	windowStart = vertexRecord;
+	mesh.vertices.resize(static_cast<size_t>(std::min<uint64_t>(vertexCount - vertexRecord, windowVertices)));
+}
+
+// A face element holding only a uchar-counted list of 32-bit indices, as most exporters write it
+size_t PlyReader::parseFacesFast(const char* begin, const char* end)
+{
+	const Element& current = elements[element];
+	const uint64_t limit = vertexCount; // Negative int32 indices wrap far above any count 32-bit indices can address
+	const char* pos = begin;
+	while (record < current.count && pos < end)
+	{
+		const size_t corners = static_cast<unsigned char>(*pos);
+		const size_t bytes = 1 + corners * sizeof(unsigned int);
+		if (static_cast<size_t>(end - pos) < bytes)
+		{
+			break;
+		}
+		if (corners == 3)
+		{
+			unsigned int triangle[3];
+			std::memcpy(triangle, pos + 1, sizeof(triangle));
+			if (triangle[0] >= limit || triangle[1] >= limit || triangle[2] >= limit)
+			{
+				fail("a face refers to a vertex past the vertex element");
+				break;
+			}
+			addTriangle(triangle[0], triangle[1], triangle[2]);
+		}
+		else
+		{
+			polygon.resize(corners);
+			for (size_t i = 0; i < corners; ++i)
+			{
+				unsigned int index;
+				std::memcpy(&index, pos + 1 + i * sizeof(unsigned int), sizeof(index));
+				polygon[i] = index;
+			}
+			addFace();
+			if (failed)
+			{
+				break;
+			}
+		}
+		pos += bytes;
+		++record;
+	}
+	return pos - begin;
+}
+
+const char* PlyReader::parseBinaryRecord(const Element& current, const char* pos, size_t vertex)
+{
+	for (const Property& property : current.properties)
+	{
+		const unsigned char type = static_cast<unsigned char>(property.type);
+		if (property.list)
+		{
+			const size_t count = listCount(pos, static_cast<unsigned char>(property.countType), swapBytes);
+			pos += typeSize(static_cast<unsigned char>(property.countType));
+			if (property.role == Role::FaceIndices)
+			{
+				polygon.resize(count);
+				for (size_t i = 0; i < count; ++i)
+				{
+					polygon[i] = toIndex(readNumber(pos + i * typeSize(type), type, swapBytes));
+				}
+			}
+			pos += count * typeSize(type);
+			continue;
+		}
+
+		if (property.role != Role::None)
+		{
+			const float value = static_cast<float>(readNumber(pos, type, swapBytes));
+			switch (property.role)
+			{
+			case Role::X: mesh.vertices.x[vertex] = value; break;
+			case Role::Y: mesh.vertices.y[vertex] = value; break;
+			case Role::Z: mesh.vertices.z[vertex] = value; break;
+			case Role::NormalX: mesh.normals.x[vertex] = value; break;
+			case Role::NormalY: mesh.normals.y[vertex] = value; break;
+			case Role::NormalZ: mesh.normals.z[vertex] = value; break;
+			case Role::U: mesh.texcoords.x[vertex] = value; break;
+			case Role::V: mesh.texcoords.y[vertex] = value; break;
+			default: break;
+			}
+		}
+		pos += typeSize(type);
+	}
+	if (current.kind == Kind::Face)
+	{
+		addFace();
+	}
+	return failed ? nullptr : pos;
+}
+
+bool PlyReader::parseAsciiRecord(const Element& current, const char* line, const char* end, size_t vertex)
+{
+	TokenCursor cursor = { line, end };
+	double value = 0.0;
+	for (const Property& property : current.properties)
+	{
+		if (!cursor.nextNumber(value))
+		{
+			return fail("an ASCII record has fewer or malformed values");
+		}
+		if (property.list)
+		{
+			// Every value takes a character and a separator, a count past what the rest of the line holds is corrupt
+			if (value > static_cast<double>((cursor.end - cursor.pos + 1) / 2))
+			{
+				return fail("an ASCII list is shorter than its count");
+			}
+			const size_t count = value > 0.0 ? static_cast<size_t>(value) : 0;
+			const bool indices = property.role == Role::FaceIndices;
+			if (indices)
+			{
+				polygon.resize(count);
+			}
+			for (size_t i = 0; i < count; ++i)
+			{
+				if (!cursor.nextNumber(value))
+				{
+					return fail("an ASCII list is shorter than its count");
+				}
+				if (indices)
+				{
+					polygon[i] = toIndex(value);
+				}
+			}
+			continue;
+		}
+
+		const float component = static_cast<float>(value);
+		switch (property.role)
+		{
+		case Role::X: mesh.vertices.x[vertex] = component; break;
+		case Role::Y: mesh.vertices.y[vertex] = component; break;
+		case Role::Z: mesh.vertices.z[vertex] = component; break;
+		case Role::NormalX: mesh.normals.x[vertex] = component; break;
+		case Role::NormalY: mesh.normals.y[vertex] = component; break;
+		case Role::NormalZ: mesh.normals.z[vertex] = component; break;
+		case Role::U: mesh.texcoords.x[vertex] = component; break;
+		case Role::V: mesh.texcoords.y[vertex] = component; break;
+		default: break;
+		}
+	}
+	if (current.kind == Kind::Face)
+	{
+		addFace();
+	}
+	return !failed;
+}
+
+// Fan-triangulates polygon, faces with fewer than three corners add nothing
+void PlyReader::addFace()
+{
+	for (uint64_t index : polygon)
+	{
+		if (index >= vertexCount)
+		{
+			fail("a face refers to a vertex past the vertex element");
+			return;
+		}
+	}
+	for (size_t i = 1; i + 1 < polygon.size(); ++i)
+	{
+		addTriangle(polygon[0], polygon[i], polygon[i + 1]);
+	}
+}
+
+// Checked corners, below 32 bits unless streaming
+void PlyReader::addTriangle(uint64_t a, uint64_t b, uint64_t c)
+{
+	if (windowVertices > 0)
+	{
+		mesh.wideIndices.insert(mesh.wideIndices.end(), { a, b, c });
+		return;
+	}
+	mesh.indices.insert(mesh.indices.end(), { static_cast<unsigned int>(a), static_cast<unsigned int>(b), static_cast<unsigned int>(c) });
+}
\ No newline at end of file
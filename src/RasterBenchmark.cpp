@@ -0,0 +1,131 @@
+// Orbits the viewer camera around a loaded model and renders every pose on the CPU, no GPU needed
+
+#include "RasterBenchmark.h"
+#include "Camera.h"
+#include "MeshKernels.h"
+#include "Model.h"
+#include "Parallel.h"
+#include "SoftwareRasterizer.h"
+#include <QDebug>
+#include <QFileInfo>
+#include <QImage>
+#include <cmath>
+#include <vector>
+
+namespace
+{
+	// Eight yaw steps at the distance that fits the bounding sphere, half of it (clipped by the near plane and the
+	// viewport) and twice of it
+	std::vector<DirectX::XMFLOAT4X4> makePoses(const MeshBounds& bounds, float aspectRatio)
+	{
+		std::vector<DirectX::XMFLOAT4X4> poses;
+		Camera reference;
+		const float fitDistance = std::max(bounds.radius, 1e-3f) / std::sin(0.5f * reference.getVerticalFov()) * 1.1f;
+		for (float scale : { 1.0f, 0.5f, 2.0f })
+		{
+			Camera camera;
+			camera.setTarget({ bounds.center.x(), bounds.center.y(), bounds.center.z() });
+			camera.zoom((5.0f - fitDistance * scale) * 10.0f); // Camera starts 5 units out, one wheel unit is 0.1
+			for (int step = 0; step < 8; ++step)
+			{
+				poses.push_back(camera.getMVPMatrix(aspectRatio));
+				camera.orbit(90.0f, 0.0f); // 45 degrees of yaw
+			}
+		}
+		return poses;
+	}
+
+	uint64_t hashPixels(const std::vector<uint32_t>& pixels)
+	{
+		uint64_t hash = 14695981039346656037ull;
+		for (uint32_t pixel : pixels)
+		{
+			hash = (hash ^ pixel) * 1099511628211ull;
+		}
+		return hash;
+	}
+
+	bool saveImage(const SoftwareRasterizer& rasterizer, const QString& path)
+	{
+		const QImage image(reinterpret_cast<const uchar*>(rasterizer.getPixels().data()), rasterizer.getWidth(), rasterizer.getHeight(), QImage::Format_RGB32);
+		if (!image.save(path))
+		{
+			qCritical() << "Cannot write" << path;
+			return false;
+		}
+		qInfo() << "Wrote" << path;
+		return true;
+	}
+}
+
+bool runRasterBenchmark(const QString& filePath, int width, int height, const QString& imagePath)
+{
+	Model model;
+	model.setOptimizeOnLoad(true);
+	if (!model.loadFromFile(filePath) || model.getIndices().empty() || width <= 0 || height <= 0)
+	{
+		qCritical() << "Cannot load" << filePath << "for the raster benchmark";
+		return false;
+	}
+	const Vec3Streams positions = model.getVertices();
+	const Vec3Streams normals = model.getNormals();
+	const auto indices = model.getIndices();
+	const std::vector<DirectX::XMFLOAT4X4> poses = makePoses(model.getBounds(), float(width) / float(height));
+
+	// The viewer's default light, 45 degrees of yaw and pitch
+	const float lightAngle = 0.25f * 3.14159265f;
+	const float lightDirection[3] = { std::cos(lightAngle) * std::cos(lightAngle), std::sin(lightAngle), std::cos(lightAngle) * std::sin(lightAngle) };
+
+	SoftwareRasterizer rasterizer;
+	rasterizer.resize(width, height);
+	qInfo().nospace() << "Raster benchmark: " << indices.size() / 3 << " triangles at " << width << "x" << height << ", "
+		<< poses.size() << " poses, " << Parallel::resolveThreadCount(0) << " threads";
+
+	bool matches = true;
+	const MeshKernels::Isa previous = MeshKernels::activeIsa();
+	for (bool wireframe : { false, true })
+	{
+		rasterizer.setWireframe(wireframe);
+		std::vector<uint64_t> reference;
+		for (int isa = 0; isa <= static_cast<int>(MeshKernels::bestSupportedIsa()); ++isa)
+		{
+			MeshKernels::setActiveIsa(static_cast<MeshKernels::Isa>(isa));
+			RasterStats total;
+			size_t mismatches = 0;
+			for (size_t i = 0; i < poses.size(); ++i)
+			{
+				const RasterStats stats = rasterizer.render(positions, normals, indices, &poses[i].m[0][0], lightDirection);
+				total.primitives += stats.primitives;
+				total.pixels += stats.pixels;
+				total.transformMs += stats.transformMs;
+				total.binMs += stats.binMs;
+				total.rasterMs += stats.rasterMs;
+				total.shadeMs += stats.shadeMs;
+				total.frameMs += stats.frameMs;
+
+				const uint64_t hash = hashPixels(rasterizer.getPixels());
+				if (isa == 0)
+				{
+					reference.push_back(hash);
+				}
+				mismatches += hash == reference[i] ? 0 : 1;
+				if (i == 0 && isa == 0 && !imagePath.isEmpty())
+				{
+					const QFileInfo info(imagePath);
+					saveImage(rasterizer, wireframe ? info.path() + "/" + info.completeBaseName() + "-wireframe." + info.suffix() : imagePath);
+				}
+			}
+
+			const double frames = double(poses.size());
+			total.triangles = indices.size() / 3 * poses.size();
+			qInfo().nospace() << (wireframe ? "Wireframe " : "Solid ") << MeshKernels::isaName(MeshKernels::activeIsa()) << ": "
+				<< total.frameMs / frames << " ms per frame (transform " << total.transformMs / frames << ", bin " << total.binMs / frames
+				<< ", raster " << total.rasterMs / frames << ", shade " << total.shadeMs / frames << "), "
+				<< total.trianglesPerSecond() / 1.0e6 << " M triangles/s, " << total.primitives / frames << " primitives and "
+				<< total.pixels / frames << " pixels per frame, " << mismatches << " poses differ from scalar";
+			matches = matches && mismatches == 0;
+		}
+	}
+	MeshKernels::setActiveIsa(previous);
+	return matches;
+}
\ No newline at end of file
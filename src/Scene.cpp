@@ -0,0 +1,274 @@
+// Dirty flags are spread down in one forward pass, then each depth level is composed in batches with MeshKernels
+
+#include "Scene.h"
+#include <algorithm>
+#include <cstring>
+#include "MeshKernels.h"
+#include "Parallel.h"
+#include "Trace.h"
+
+namespace
+{
+	constexpr size_t batchSize = 256; // Nodes staged at once, 36 KB of stack for three sets of streams
+	constexpr size_t minNodesPerThread = 16 * 1024; // Smaller levels are not worth starting threads for
+
+	// Column-major 4x4 without the last row
+	void toAffine(const QMatrix4x4& matrix, float affine[12])
+	{
+		const float* m = matrix.constData();
+		for (int c = 0; c < 4; ++c)
+		{
+			for (int r = 0; r < 3; ++r)
+			{
+				affine[c * 3 + r] = m[c * 4 + r];
+			}
+		}
+	}
+}
+
+uint32_t Scene::addMesh(std::shared_ptr<const Model> mesh)
+{
+	meshes.push_back(std::move(mesh));
+	return static_cast<uint32_t>(meshes.size() - 1);
+}
+
+const Model* Scene::getMesh(uint32_t mesh) const
+{
+	return mesh < meshes.size() ? meshes[mesh].get() : nullptr;
+}
+
+size_t Scene::getMeshCount() const
+{
+	return meshes.size();
+}
+
+uint32_t Scene::addNode(uint32_t parent, const QMatrix4x4& matrix, uint32_t mesh)
+{
+	const uint32_t node = static_cast<uint32_t>(parents.size());
+	if (parent != none && parent >= node)
+	{
+		parent = none; // Would break the parent-first order, the node becomes a root instead
+	}
+	parents.push_back(parent);
+	depths.push_back(parent == none ? 0 : depths[parent] + 1);
+	maxDepth = std::max(maxDepth, depths.back());
+	nodeMeshes.push_back(mesh);
+	dirty.push_back(1);
+	firstDirty = std::min(firstDirty, node);
+	float affine[12];
+	toAffine(matrix, affine);
+	for (int k = 0; k < 12; ++k)
+	{
+		local[k].push_back(affine[k]);
+		world[k].push_back(affine[k]);
+	}
+	return node;
+}
+
+void Scene::clear()
+{
+	meshes.clear();
+	parents.clear();
+	depths.clear();
+	nodeMeshes.clear();
+	dirty.clear();
+	for (int k = 0; k < 12; ++k)
+	{
+		local[k].clear();
+		world[k].clear();
+	}
+	firstDirty = none;
+	maxDepth = 0;
+}
+
+size_t Scene::getNodeCount() const
+{
+	return parents.size();
+}
+
+uint32_t Scene::getParent(uint32_t node) const
+{
+	return parents[node];
+}
+
+uint32_t Scene::getNodeMesh(uint32_t node) const
+{
+	return nodeMeshes[node];
+}
+
+uint32_t Scene::getDepth(uint32_t node) const
+{
+	return depths[node];
+}
+
+void Scene::setLocalTransform(uint32_t node, const QMatrix4x4& matrix)
+{
+	float affine[12];
+	toAffine(matrix, affine);
+	for (int k = 0; k < 12; ++k)
+	{
+		local[k][node] = affine[k];
+	}
+	dirty[node] = 1;
+	firstDirty = std::min(firstDirty, node);
+}
+
+QMatrix4x4 Scene::getLocalTransform(uint32_t node) const
+{
+	QMatrix4x4 matrix;
+	float* m = matrix.data();
+	for (int c = 0; c < 4; ++c)
+	{
+		for (int r = 0; r < 3; ++r)
+		{
+			m[c * 4 + r] = local[c * 3 + r][node];
+		}
+	}
+	return matrix;
+}
+
+QMatrix4x4 Scene::getWorldTransform(uint32_t node) const
+{
+	QMatrix4x4 matrix;
+	getWorldTransform(node, matrix.data());
+	return matrix;
+}
+
+void Scene::getWorldTransform(uint32_t node, float matrix[16]) const
+{
+	for (int c = 0; c < 4; ++c)
+	{
+		for (int r = 0; r < 3; ++r)
+		{
+			matrix[c * 4 + r] = world[c * 3 + r][node];
+		}
+		matrix[c * 4 + 3] = c == 3 ? 1.0f : 0.0f;
+	}
+}
+
+bool Scene::needsUpdate() const
+{
+	return firstDirty != none;
+}
+
+size_t Scene::updateWorldTransforms(unsigned int threadCount)
+{
+	if (firstDirty == none)
+	{
+		return 0;
+	}
+	TRACE_ZONE("Scene::updateWorldTransforms");
+	// A parent always comes first, so one forward pass from the first changed node reaches every descendant. The
+	// changed nodes are bucketed by depth on the way: a level only reads the level above it.
+	const size_t nodeCount = parents.size();
+	levelStarts.assign(maxDepth + 2, 0);
+	for (size_t i = firstDirty; i < nodeCount; ++i)
+	{
+		const uint32_t parent = parents[i];
+		if (dirty[i] || (parent != none && dirty[parent]))
+		{
+			dirty[i] = 1;
+			++levelStarts[depths[i] + 1];
+		}
+	}
+	for (size_t level = 1; level < levelStarts.size(); ++level)
+	{
+		levelStarts[level] += levelStarts[level - 1];
+	}
+	const size_t updated = levelStarts.back();
+	updateOrder.resize(updated);
+	{
+		std::vector<size_t> next(levelStarts.begin(), levelStarts.end() - 1);
+		for (size_t i = firstDirty; i < nodeCount; ++i)
+		{
+			if (dirty[i])
+			{
+				updateOrder[next[depths[i]]++] = static_cast<uint32_t>(i); // Ascending within each level
+			}
+		}
+	}
+
+	const unsigned int threads = Parallel::resolveThreadCount(threadCount);
+	for (size_t level = 0; level + 1 < levelStarts.size(); ++level)
+	{
+		const uint32_t* nodes = updateOrder.data() + levelStarts[level];
+		const size_t count = levelStarts[level + 1] - levelStarts[level];
+		const size_t shares = std::clamp<size_t>(count / minNodesPerThread, 1, threads);
+		Parallel::run(shares, [&](size_t share)
+		{
+			const size_t begin = count * share / shares;
+			updateLevel(nodes + begin, count * (share + 1) / shares - begin, level == 0);
+		});
+	}
+	std::fill(dirty.begin() + firstDirty, dirty.end(), 0);
+	firstDirty = none;
+	return updated;
+}
+
+// nodes ascend, so a batch whose first and last node are count - 1 apart is a contiguous run that is composed in place
+void Scene::updateLevel(const uint32_t* nodes, size_t count, bool roots)
+{
+	alignas(64) float parentStage[12][batchSize];
+	alignas(64) float localStage[12][batchSize];
+	for (size_t first = 0; first < count; first += batchSize)
+	{
+		const size_t batch = std::min(batchSize, count - first);
+		const uint32_t* batchNodes = nodes + first;
+		const bool contiguous = batchNodes[batch - 1] - batchNodes[0] == batch - 1;
+		if (roots)
+		{
+			for (int k = 0; k < 12; ++k)
+			{
+				if (contiguous)
+				{
+					memcpy(world[k].data() + batchNodes[0], local[k].data() + batchNodes[0], batch * sizeof(float));
+					continue;
+				}
+				for (size_t j = 0; j < batch; ++j)
+				{
+					world[k][batchNodes[j]] = local[k][batchNodes[j]];
+				}
+			}
+			continue;
+		}
+
+		for (int k = 0; k < 12; ++k)
+		{
+			const float* parentWorld = world[k].data();
+			for (size_t j = 0; j < batch; ++j)
+			{
+				parentStage[k][j] = parentWorld[parents[batchNodes[j]]];
+			}
+		}
+		const float* parentStreams[12];
+		const float* localStreams[12];
+		float* outStreams[12];
+		for (int k = 0; k < 12; ++k)
+		{
+			parentStreams[k] = parentStage[k];
+			if (contiguous)
+			{
+				localStreams[k] = local[k].data() + batchNodes[0];
+				outStreams[k] = world[k].data() + batchNodes[0];
+				continue;
+			}
+			for (size_t j = 0; j < batch; ++j)
+			{
+				localStage[k][j] = local[k][batchNodes[j]];
+			}
+			localStreams[k] = localStage[k];
+			outStreams[k] = localStage[k];
+		}
+		MeshKernels::composeAffine(parentStreams, localStreams, outStreams, batch);
+		if (!contiguous)
+		{
+			for (int k = 0; k < 12; ++k)
+			{
+				for (size_t j = 0; j < batch; ++j)
+				{
+					world[k][batchNodes[j]] = localStage[k][j];
+				}
+			}
+		}
+	}
+}
\ No newline at end of file
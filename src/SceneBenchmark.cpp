@@ -0,0 +1,161 @@
+// Animates a generated root, subassembly, group and part hierarchy and updates its world matrices every frame
+
+#include "SceneBenchmark.h"
+#include "MeshKernels.h"
+#include "Model.h"
+#include "Parallel.h"
+#include "Scene.h"
+#include <QDebug>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <random>
+#include <vector>
+
+namespace
+{
+	constexpr int frames = 50; // Per mode, ISA and thread count
+	constexpr size_t subassemblies = 64;
+	constexpr size_t groupsPerSubassembly = 16;
+	constexpr size_t sharedMeshes = 16; // Bolts, brackets and the like, referenced by every part
+	constexpr double sparseFraction = 0.01;
+
+	QMatrix4x4 partTransform(std::mt19937& random, float angle)
+	{
+		std::uniform_real_distribution<float> offset(-10.0f, 10.0f);
+		QMatrix4x4 matrix;
+		matrix.translate(offset(random), offset(random), offset(random));
+		matrix.rotate(angle, 0.3f, 1.0f, 0.2f);
+		matrix.scale(0.5f + 0.25f * std::sin(angle));
+		return matrix;
+	}
+
+	// Depth-first like a file's node tree, so parts of one group are contiguous but every level is spread out
+	void buildAssembly(Scene& scene, size_t nodeCount, std::vector<uint32_t>& parts)
+	{
+		std::mt19937 random(42);
+		for (size_t m = 0; m < sharedMeshes; ++m)
+		{
+			scene.addMesh(std::make_shared<const Model>());
+		}
+		const uint32_t root = scene.addNode(Scene::none, QMatrix4x4());
+		const size_t groups = subassemblies * groupsPerSubassembly;
+		const size_t partCount = nodeCount > 1 + subassemblies + groups ? nodeCount - 1 - subassemblies - groups : 0;
+		size_t added = 0;
+		for (size_t s = 0; s < subassemblies; ++s)
+		{
+			const uint32_t subassembly = scene.addNode(root, partTransform(random, 10.0f * s));
+			for (size_t g = 0; g < groupsPerSubassembly; ++g)
+			{
+				const uint32_t group = scene.addNode(subassembly, partTransform(random, 5.0f * g));
+				const size_t groupIndex = s * groupsPerSubassembly + g;
+				const size_t groupParts = partCount * (groupIndex + 1) / groups - partCount * groupIndex / groups;
+				for (size_t p = 0; p < groupParts; ++p, ++added)
+				{
+					parts.push_back(scene.addNode(group, partTransform(random, float(added % 360)), static_cast<uint32_t>(added % sharedMeshes)));
+				}
+			}
+		}
+	}
+
+	// Largest element difference to world matrices composed one node at a time in node order
+	float maxReferenceError(const Scene& scene)
+	{
+		std::vector<QMatrix4x4> reference(scene.getNodeCount());
+		float error = 0.0f;
+		for (uint32_t node = 0; node < scene.getNodeCount(); ++node)
+		{
+			const uint32_t parent = scene.getParent(node);
+			reference[node] = parent == Scene::none ? scene.getLocalTransform(node) : reference[parent] * scene.getLocalTransform(node);
+			float world[16];
+			scene.getWorldTransform(node, world);
+			for (int k = 0; k < 16; ++k)
+			{
+				error = std::max(error, std::abs(world[k] - reference[node].constData()[k]));
+			}
+		}
+		return error;
+	}
+}
+
+bool runSceneBenchmark(size_t nodeCount)
+{
+	Scene scene;
+	std::vector<uint32_t> parts;
+	auto start = std::chrono::steady_clock::now();
+	buildAssembly(scene, nodeCount, parts);
+	size_t updated = scene.updateWorldTransforms();
+	const double buildMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	qInfo().nospace() << "Scene benchmark: " << scene.getNodeCount() << " nodes, " << parts.size() << " parts sharing "
+		<< scene.getMeshCount() << " meshes, built and updated in " << buildMs << " ms";
+
+	std::mt19937 random(7);
+	std::vector<uint32_t> sparse(parts);
+	std::shuffle(sparse.begin(), sparse.end(), random);
+	sparse.resize(static_cast<size_t>(sparse.size() * sparseFraction));
+	std::sort(sparse.begin(), sparse.end());
+	std::vector<QMatrix4x4> partMatrices;
+	for (uint32_t part : parts)
+	{
+		partMatrices.push_back(scene.getLocalTransform(part));
+	}
+
+	bool matches = true;
+	const unsigned int maxThreads = Parallel::resolveThreadCount(0);
+	const MeshKernels::Isa previous = MeshKernels::activeIsa();
+	for (int isa = 0; isa <= static_cast<int>(MeshKernels::bestSupportedIsa()); ++isa)
+	{
+		MeshKernels::setActiveIsa(static_cast<MeshKernels::Isa>(isa));
+		for (unsigned int threads = 1;; threads = std::min(threads * 2, maxThreads))
+		{
+			// Spinning the root moves everything, setting every part's matrix is what an animation player does
+			double rootMs = 0.0, partsMs = 0.0, sparseMs = 0.0, idleMs = 0.0;
+			size_t rootNodes = 0, partNodes = 0, sparseNodes = 0;
+			for (int frame = 0; frame < frames; ++frame)
+			{
+				QMatrix4x4 spin;
+				spin.rotate(float(frame), 0.0f, 1.0f, 0.0f);
+				start = std::chrono::steady_clock::now();
+				scene.setLocalTransform(0, spin);
+				rootNodes += scene.updateWorldTransforms(threads);
+				auto end = std::chrono::steady_clock::now();
+				rootMs += std::chrono::duration<double, std::milli>(end - start).count();
+
+				start = end;
+				for (size_t p = 0; p < parts.size(); ++p)
+				{
+					scene.setLocalTransform(parts[p], partMatrices[p]);
+				}
+				partNodes += scene.updateWorldTransforms(threads);
+				end = std::chrono::steady_clock::now();
+				partsMs += std::chrono::duration<double, std::milli>(end - start).count();
+
+				start = end;
+				for (uint32_t part : sparse)
+				{
+					scene.setLocalTransform(part, spin);
+				}
+				sparseNodes += scene.updateWorldTransforms(threads);
+				end = std::chrono::steady_clock::now();
+				sparseMs += std::chrono::duration<double, std::milli>(end - start).count();
+
+				start = end;
+				updated = scene.updateWorldTransforms(threads);
+				idleMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+				matches = matches && updated == 0;
+			}
+			const float error = maxReferenceError(scene);
+			matches = matches && error < 1.0e-3f;
+			qInfo().nospace() << MeshKernels::isaName(MeshKernels::activeIsa()) << ", " << threads << " threads: root "
+				<< rootMs / frames << " ms (" << rootNodes / frames << " nodes, " << rootMs * 1.0e6 / std::max<size_t>(rootNodes, 1) << " ns each), all parts "
+				<< partsMs / frames << " ms, " << sparse.size() << " parts " << sparseMs / frames << " ms (" << sparseNodes / frames
+				<< " nodes), unchanged " << idleMs / frames << " ms, max error " << error;
+			if (threads == maxThreads)
+			{
+				break;
+			}
+		}
+	}
+	MeshKernels::setActiveIsa(previous);
+	return matches;
+}
\ No newline at end of file
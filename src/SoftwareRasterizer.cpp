@@ -0,0 +1,893 @@
+// Clipping and tile binning, scalar/SSE2/AVX2 edge-function coverage into a visibility buffer, then one shading pass
+
+#include "SoftwareRasterizer.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include "MeshKernels.h"
+#include "Parallel.h"
+#include "SimdSupport.h"
+#include "Trace.h"
+
+namespace
+{
+	constexpr uint32_t noTriangle = std::numeric_limits<uint32_t>::max();
+	constexpr int tileSize = SoftwareRasterizer::tileSize;
+	constexpr size_t tilePixels = size_t(tileSize) * tileSize;
+	constexpr size_t blockTriangles = 1 << 14; // Binning work unit, fixed so every tile sees the same draw order at any thread count
+	constexpr size_t transformBlock = 1 << 16;
+	constexpr float subpixelSteps = 256.0f; // Vertices snap to 1/256 pixel, D3D's 8-bit subpixel grid
+	constexpr float guardBandPixels = 8192.0f; // Triangles are only clipped in x and y this far outside the viewport
+	constexpr uint32_t clearPixel = 0xff333333; // The viewer's 0.2 gray clear color
+
+	struct ClipVertex
+	{
+		float x, y, z, w;
+	};
+
+	// Inclusive pixel bounds
+	struct PixelRect
+	{
+		int x0, y0, x1, y1;
+	};
+
+	// Screen-space triangle, or a triangle edge in corners 0 and 1, with the pixel bounds it was binned by
+	struct Primitive
+	{
+		float x[3], y[3], z[3];
+		uint32_t triangle; // Index into the frame's triangles, what the visibility buffer stores
+		PixelRect bounds;
+	};
+
+	// Depth and visibility buffer of the tile being rasterized
+	struct TileTarget
+	{
+		float* depth; // Start of the tile, rows of tileSize
+		uint32_t* ids;
+		int originX;
+		int originY;
+	};
+
+	ClipVertex lerp(const ClipVertex& a, const ClipVertex& b, float t)
+	{
+		return { a.x + (b.x - a.x) * t, a.y + (b.y - a.y) * t, a.z + (b.z - a.z) * t, a.w + (b.w - a.w) * t };
+	}
+
+	float planeDistance(const float* plane, const ClipVertex& v)
+	{
+		return plane[0] * v.x + plane[1] * v.y + plane[2] * v.z + plane[3] * v.w;
+	}
+
+	// Sutherland-Hodgman against one clip-space plane, keeps the side with distance >= 0
+	int clipPolygon(const ClipVertex* in, int count, const float* plane, ClipVertex* out)
+	{
+		int outCount = 0;
+		for (int i = 0; i < count; ++i)
+		{
+			const ClipVertex& a = in[i];
+			const ClipVertex& b = in[(i + 1) % count];
+			const float da = planeDistance(plane, a);
+			const float db = planeDistance(plane, b);
+			if (da >= 0.0f)
+			{
+				out[outCount++] = a;
+			}
+			if ((da >= 0.0f) != (db >= 0.0f))
+			{
+				out[outCount++] = lerp(a, b, da / (da - db));
+			}
+		}
+		return outCount;
+	}
+
+	// Bits of the frustum planes a vertex is outside of: left, right, bottom, top, near, far
+	constexpr unsigned int frustumBits = 63;
+	constexpr unsigned int needsClipFlag = 64; // Behind the near plane or outside the guard band
+	unsigned int outcode(const ClipVertex& v)
+	{
+		return (v.x < -v.w ? 1u : 0u) | (v.x > v.w ? 2u : 0u) | (v.y < -v.w ? 4u : 0u) | (v.y > v.w ? 8u : 0u)
+			| (v.z < 0.0f ? 16u : 0u) | (v.z > v.w ? 32u : 0u);
+	}
+
+	float snap(float value)
+	{
+		return std::floor(value * subpixelSteps + 0.5f) / subpixelSteps;
+	}
+
+	// Edge functions E = (a * px + b * py) + c, positive inside a triangle with positive area. Each edge takes c from
+	// its lower endpoint, so the two triangles sharing an edge get exactly negated values and no pixel center on it is
+	// covered twice or missed. Ties go to top and left edges like D3D.
+	struct TriangleEdges
+	{
+		float a[3], b[3], c[3];
+		bool topLeft[3];
+		float originX, originY, z0, dzdx, dzdy; // Depth plane z = (z0 + dzdx * (px - originX)) + dzdy * (py - originY)
+	};
+
+	void setupEdges(const float* x, const float* y, const float* z, TriangleEdges& edges)
+	{
+		for (int e = 0; e < 3; ++e)
+		{
+			const int v = e;
+			const int w = (e + 1) % 3;
+			const float a = y[v] - y[w];
+			const float b = x[w] - x[v];
+			const int low = (y[v] < y[w] || (y[v] == y[w] && x[v] < x[w])) ? v : w;
+			edges.a[e] = a;
+			edges.b[e] = b;
+			edges.c[e] = -(a * x[low] + b * y[low]);
+			edges.topLeft[e] = a > 0.0f || (a == 0.0f && b > 0.0f);
+		}
+		const float area = (x[1] - x[0]) * (y[2] - y[0]) - (y[1] - y[0]) * (x[2] - x[0]);
+		edges.originX = x[0];
+		edges.originY = y[0];
+		edges.z0 = z[0];
+		edges.dzdx = ((z[1] - z[0]) * (y[2] - y[0]) - (z[2] - z[0]) * (y[1] - y[0])) / area;
+		edges.dzdy = ((z[2] - z[0]) * (x[1] - x[0]) - (z[1] - z[0]) * (x[2] - x[0])) / area;
+	}
+
+	bool depthPasses(float z, float stored)
+	{
+		return z < stored && z >= 0.0f && z <= 1.0f;
+	}
+
+	void coverScalar(const TriangleEdges& edges, const PixelRect& rect, uint32_t triangle, const TileTarget& tile)
+	{
+		for (int y = rect.y0; y <= rect.y1; ++y)
+		{
+			const float py = y + 0.5f;
+			float* depthRow = tile.depth + (y - tile.originY) * tileSize - tile.originX;
+			uint32_t* idRow = tile.ids + (y - tile.originY) * tileSize - tile.originX;
+			for (int x = rect.x0; x <= rect.x1; ++x)
+			{
+				const float px = x + 0.5f;
+				bool inside = true;
+				for (int e = 0; e < 3; ++e)
+				{
+					const float value = (edges.a[e] * px + edges.b[e] * py) + edges.c[e];
+					inside = inside && (value > 0.0f || (value == 0.0f && edges.topLeft[e]));
+				}
+				if (!inside)
+				{
+					continue;
+				}
+				const float z = (edges.z0 + edges.dzdx * (px - edges.originX)) + edges.dzdy * (py - edges.originY);
+				if (depthPasses(z, depthRow[x]))
+				{
+					depthRow[x] = z;
+					idRow[x] = triangle;
+				}
+			}
+		}
+	}
+
+#if MESH_KERNELS_X86
+	// Groups of four pixels aligned to the tile row, lanes outside rect are masked off
+	void coverSSE2(const TriangleEdges& edges, const PixelRect& rect, uint32_t triangle, const TileTarget& tile)
+	{
+		const __m128 laneCenters = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+		const __m128i laneIndex = _mm_setr_epi32(0, 1, 2, 3);
+		const __m128 zero = _mm_setzero_ps();
+		const __m128 one = _mm_set1_ps(1.0f);
+		const __m128i ids = _mm_set1_epi32(static_cast<int>(triangle));
+		__m128 a[3], c[3], topLeft[3];
+		for (int e = 0; e < 3; ++e)
+		{
+			a[e] = _mm_set1_ps(edges.a[e]);
+			c[e] = _mm_set1_ps(edges.c[e]);
+			topLeft[e] = _mm_castsi128_ps(_mm_set1_epi32(edges.topLeft[e] ? -1 : 0));
+		}
+		const __m128 z0 = _mm_set1_ps(edges.z0);
+		const __m128 dzdx = _mm_set1_ps(edges.dzdx);
+		const __m128 originX = _mm_set1_ps(edges.originX);
+		const int startX = tile.originX + ((rect.x0 - tile.originX) & ~3);
+
+		for (int y = rect.y0; y <= rect.y1; ++y)
+		{
+			const float py = y + 0.5f;
+			float* depthRow = tile.depth + (y - tile.originY) * tileSize - tile.originX;
+			uint32_t* idRow = tile.ids + (y - tile.originY) * tileSize - tile.originX;
+			__m128 bpy[3];
+			for (int e = 0; e < 3; ++e)
+			{
+				bpy[e] = _mm_set1_ps(edges.b[e] * py);
+			}
+			const __m128 zRow = _mm_set1_ps(edges.dzdy * (py - edges.originY));
+			for (int x = startX; x <= rect.x1; x += 4)
+			{
+				const __m128 px = _mm_add_ps(_mm_set1_ps(static_cast<float>(x)), laneCenters);
+				const __m128i lane = _mm_add_epi32(_mm_set1_epi32(x), laneIndex);
+				__m128 mask = _mm_castsi128_ps(_mm_and_si128(_mm_cmpgt_epi32(lane, _mm_set1_epi32(rect.x0 - 1)), _mm_cmplt_epi32(lane, _mm_set1_epi32(rect.x1 + 1))));
+				for (int e = 0; e < 3; ++e)
+				{
+					const __m128 value = _mm_add_ps(_mm_add_ps(_mm_mul_ps(a[e], px), bpy[e]), c[e]);
+					mask = _mm_and_ps(mask, _mm_or_ps(_mm_cmpgt_ps(value, zero), _mm_and_ps(_mm_cmpeq_ps(value, zero), topLeft[e])));
+				}
+				if (_mm_movemask_ps(mask) == 0)
+				{
+					continue;
+				}
+				const __m128 z = _mm_add_ps(_mm_add_ps(z0, _mm_mul_ps(dzdx, _mm_sub_ps(px, originX))), zRow);
+				const __m128 stored = _mm_load_ps(depthRow + x);
+				mask = _mm_and_ps(mask, _mm_and_ps(_mm_cmplt_ps(z, stored), _mm_and_ps(_mm_cmpge_ps(z, zero), _mm_cmple_ps(z, one))));
+				_mm_store_ps(depthRow + x, _mm_or_ps(_mm_and_ps(mask, z), _mm_andnot_ps(mask, stored)));
+				const __m128i maskBits = _mm_castps_si128(mask);
+				const __m128i storedIds = _mm_load_si128(reinterpret_cast<const __m128i*>(idRow + x));
+				_mm_store_si128(reinterpret_cast<__m128i*>(idRow + x), _mm_or_si128(_mm_and_si128(maskBits, ids), _mm_andnot_si128(maskBits, storedIds)));
+			}
+		}
+	}
+
+	MESH_KERNELS_AVX2_TARGET void coverAVX2(const TriangleEdges& edges, const PixelRect& rect, uint32_t triangle, const TileTarget& tile)
+	{
+		const __m256 laneCenters = _mm256_setr_ps(0.5f, 1.5f, 2.5f, 3.5f, 4.5f, 5.5f, 6.5f, 7.5f);
+		const __m256i laneIndex = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+		const __m256 zero = _mm256_setzero_ps();
+		const __m256 one = _mm256_set1_ps(1.0f);
+		const __m256 ids = _mm256_castsi256_ps(_mm256_set1_epi32(static_cast<int>(triangle)));
+		__m256 a[3], c[3], topLeft[3];
+		for (int e = 0; e < 3; ++e)
+		{
+			a[e] = _mm256_set1_ps(edges.a[e]);
+			c[e] = _mm256_set1_ps(edges.c[e]);
+			topLeft[e] = _mm256_castsi256_ps(_mm256_set1_epi32(edges.topLeft[e] ? -1 : 0));
+		}
+		const __m256 z0 = _mm256_set1_ps(edges.z0);
+		const __m256 dzdx = _mm256_set1_ps(edges.dzdx);
+		const __m256 originX = _mm256_set1_ps(edges.originX);
+		const int startX = tile.originX + ((rect.x0 - tile.originX) & ~7);
+
+		for (int y = rect.y0; y <= rect.y1; ++y)
+		{
+			const float py = y + 0.5f;
+			float* depthRow = tile.depth + (y - tile.originY) * tileSize - tile.originX;
+			float* idRow = reinterpret_cast<float*>(tile.ids + (y - tile.originY) * tileSize - tile.originX);
+			__m256 bpy[3];
+			for (int e = 0; e < 3; ++e)
+			{
+				bpy[e] = _mm256_set1_ps(edges.b[e] * py);
+			}
+			const __m256 zRow = _mm256_set1_ps(edges.dzdy * (py - edges.originY));
+			for (int x = startX; x <= rect.x1; x += 8)
+			{
+				const __m256 px = _mm256_add_ps(_mm256_set1_ps(static_cast<float>(x)), laneCenters);
+				const __m256i lane = _mm256_add_epi32(_mm256_set1_epi32(x), laneIndex);
+				__m256 mask = _mm256_castsi256_ps(_mm256_and_si256(_mm256_cmpgt_epi32(lane, _mm256_set1_epi32(rect.x0 - 1)), _mm256_cmpgt_epi32(_mm256_set1_epi32(rect.x1 + 1), lane)));
+				for (int e = 0; e < 3; ++e)
+				{
+					const __m256 value = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(a[e], px), bpy[e]), c[e]);
+					mask = _mm256_and_ps(mask, _mm256_or_ps(_mm256_cmp_ps(value, zero, _CMP_GT_OQ), _mm256_and_ps(_mm256_cmp_ps(value, zero, _CMP_EQ_OQ), topLeft[e])));
+				}
+				if (_mm256_movemask_ps(mask) == 0)
+				{
+					continue;
+				}
+				const __m256 z = _mm256_add_ps(_mm256_add_ps(z0, _mm256_mul_ps(dzdx, _mm256_sub_ps(px, originX))), zRow);
+				const __m256 stored = _mm256_load_ps(depthRow + x);
+				mask = _mm256_and_ps(mask, _mm256_and_ps(_mm256_cmp_ps(z, stored, _CMP_LT_OQ), _mm256_and_ps(_mm256_cmp_ps(z, zero, _CMP_GE_OQ), _mm256_cmp_ps(z, one, _CMP_LE_OQ))));
+				_mm256_store_ps(depthRow + x, _mm256_blendv_ps(stored, z, mask));
+				_mm256_store_ps(idRow + x, _mm256_blendv_ps(_mm256_load_ps(idRow + x), ids, mask));
+			}
+		}
+	}
+#endif
+
+	using CoverFunction = void (*)(const TriangleEdges&, const PixelRect&, uint32_t, const TileTarget&);
+
+	CoverFunction selectCover()
+	{
+#if MESH_KERNELS_X86
+		switch (MeshKernels::activeIsa())
+		{
+		case MeshKernels::Isa::AVX2:
+			return coverAVX2;
+		case MeshKernels::Isa::SSE2:
+			return coverSSE2;
+		default:
+			return coverScalar;
+		}
+#else
+		return coverScalar;
+#endif
+	}
+
+	void plot(int x, int y, float z, uint32_t triangle, const TileTarget& tile)
+	{
+		const size_t offset = size_t(y - tile.originY) * tileSize + (x - tile.originX);
+		if (depthPasses(z, tile.depth[offset]))
+		{
+			tile.depth[offset] = z;
+			tile.ids[offset] = triangle;
+		}
+	}
+
+	// One pixel per column or row along the major axis, the pixel whose center the line passes closest to
+	void drawLine(const float* x, const float* y, const float* z, const PixelRect& rect, uint32_t triangle, const TileTarget& tile)
+	{
+		const float dx = x[1] - x[0];
+		const float dy = y[1] - y[0];
+		const bool xMajor = std::fabs(dx) >= std::fabs(dy);
+		const float major0 = xMajor ? x[0] : y[0];
+		const float majorDelta = xMajor ? dx : dy;
+		const float minor0 = xMajor ? y[0] : x[0];
+		const float minorDelta = xMajor ? dy : dx;
+		if (majorDelta == 0.0f)
+		{
+			const int px = static_cast<int>(std::floor(x[0]));
+			const int py = static_cast<int>(std::floor(y[0]));
+			if (px >= rect.x0 && px <= rect.x1 && py >= rect.y0 && py <= rect.y1)
+			{
+				plot(px, py, z[0], triangle, tile);
+			}
+			return;
+		}
+		const int first = std::max(xMajor ? rect.x0 : rect.y0, static_cast<int>(std::ceil(std::min(major0, major0 + majorDelta) - 0.5f)));
+		const int last = std::min(xMajor ? rect.x1 : rect.y1, static_cast<int>(std::floor(std::max(major0, major0 + majorDelta) - 0.5f)));
+		for (int step = first; step <= last; ++step)
+		{
+			const float t = (step + 0.5f - major0) / majorDelta;
+			const int minor = static_cast<int>(std::floor(minor0 + t * minorDelta));
+			const float depth = z[0] + t * (z[1] - z[0]);
+			const int px = xMajor ? step : minor;
+			const int py = xMajor ? minor : step;
+			if (px >= rect.x0 && px <= rect.x1 && py >= rect.y0 && py <= rect.y1)
+			{
+				plot(px, py, depth, triangle, tile);
+			}
+		}
+	}
+
+	float smoothstep(float edge0, float edge1, float x)
+	{
+		const float t = std::clamp((x - edge0) / (edge1 - edge0), 0.0f, 1.0f);
+		return t * t * (3.0f - 2.0f * t);
+	}
+
+	uint32_t toPixel(float value)
+	{
+		const uint32_t channel = static_cast<uint32_t>(std::clamp(value, 0.0f, 1.0f) * 255.0f + 0.5f);
+		return 0xff000000u | (channel << 16) | (channel << 8) | channel;
+	}
+}
+
+struct SoftwareRasterizer::Block
+{
+	std::vector<Primitive> primitives;
+	std::vector<std::vector<uint32_t>> bins; // Per tile, indices into primitives in draw order
+};
+
+SoftwareRasterizer::SoftwareRasterizer(unsigned int threadCount) : threadCount(Parallel::resolveThreadCount(threadCount)) {}
+
+SoftwareRasterizer::~SoftwareRasterizer() {}
+
+void SoftwareRasterizer::resize(int newWidth, int newHeight)
+{
+	width = std::max(newWidth, 0);
+	height = std::max(newHeight, 0);
+	tilesX = (width + tileSize - 1) / tileSize;
+	tilesY = (height + tileSize - 1) / tileSize;
+	const size_t tileCount = size_t(tilesX) * tilesY;
+	depth.assign(tileCount * tilePixels, 1.0f);
+	triangleIds.assign(tileCount * tilePixels, noTriangle);
+	pixels.assign(size_t(width) * height, clearPixel);
+	for (Block& block : blocks)
+	{
+		block.bins.assign(tileCount, {});
+	}
+}
+int SoftwareRasterizer::getWidth() const
+{
+	return width;
+}
+int SoftwareRasterizer::getHeight() const
+{
+	return height;
+}
+
+void SoftwareRasterizer::toggleWireframe()
+{
+	wireframe = !wireframe;
+}
+void SoftwareRasterizer::setWireframe(bool enabled)
+{
+	wireframe = enabled;
+}
+bool SoftwareRasterizer::isWireframe() const
+{
+	return wireframe;
+}
+
+const std::vector<uint32_t>& SoftwareRasterizer::getPixels() const
+{
+	return pixels;
+}
+float SoftwareRasterizer::getDepth(int x, int y) const
+{
+	return (x >= 0 && y >= 0 && x < width && y < height) ? depth[tileOffset(x, y)] : 1.0f;
+}
+size_t SoftwareRasterizer::tileOffset(int x, int y) const
+{
+	return (size_t(y / tileSize) * tilesX + x / tileSize) * tilePixels + size_t(y % tileSize) * tileSize + x % tileSize;
+}
+
+RasterStats SoftwareRasterizer::render(Vec3Streams positions, Vec3Streams normals, std::span<const unsigned int> indices, const float* mvp, const float* lightDirection)
+{
+	TRACE_ZONE("SoftwareRasterizer::render");
+	using Clock = std::chrono::steady_clock;
+	auto milliseconds = [](Clock::time_point since) { return std::chrono::duration<double, std::milli>(Clock::now() - since).count(); };
+	RasterStats stats;
+	const auto frameStart = Clock::now();
+	if (width == 0 || height == 0)
+	{
+		return stats;
+	}
+
+	auto start = Clock::now();
+	transform(positions, mvp);
+	stats.transformMs = milliseconds(start);
+
+	// Bin and rasterize a batch at a time, the first pass over the tiles also clears them
+	const size_t triangleCount = indices.size() / 3;
+	stats.triangles = triangleCount;
+	for (size_t first = 0; first == 0 || first < triangleCount; first += batchTriangles)
+	{
+		const size_t count = std::min(batchTriangles, triangleCount - first);
+		const size_t blockCount = (count + blockTriangles - 1) / blockTriangles;
+		start = Clock::now();
+		bin(indices, first, count, blockCount);
+		stats.binMs += milliseconds(start);
+		for (size_t b = 0; b < blockCount; ++b)
+		{
+			stats.primitives += blocks[b].primitives.size();
+		}
+
+		start = Clock::now();
+		rasterize(blockCount, first == 0);
+		stats.rasterMs += milliseconds(start);
+	}
+
+	start = Clock::now();
+	stats.pixels = shade(positions, normals, indices, lightDirection);
+	stats.shadeMs = milliseconds(start);
+	stats.frameMs = milliseconds(frameStart);
+	return stats;
+}
+
+// clip = (x, y, z, 1) * mvp for every vertex, plus the snapped screen position and frustum bits that triangles
+// which need no clipping take as they are
+void SoftwareRasterizer::transform(Vec3Streams positions, const float* m)
+{
+	TRACE_ZONE("Raster transform");
+	const size_t count = positions.size();
+	clipXYZ.resize(count);
+	clipW.resize(count);
+	screen.resize(count);
+	vertexFlags.resize(count);
+	const float halfWidth = 0.5f * width;
+	const float halfHeight = 0.5f * height;
+	const float guardX = 1.0f + guardBandPixels / halfWidth;
+	const float guardY = 1.0f + guardBandPixels / halfHeight;
+	const size_t blockCount = (count + transformBlock - 1) / transformBlock;
+	std::atomic<size_t> nextBlock{ 0 };
+	Parallel::run(std::min<size_t>(threadCount, blockCount), [&](size_t)
+	{
+		for (size_t block = nextBlock++; block < blockCount; block = nextBlock++)
+		{
+			const size_t end = std::min(count, (block + 1) * transformBlock);
+			for (size_t i = block * transformBlock; i < end; ++i)
+			{
+				const float x = positions.x[i];
+				const float y = positions.y[i];
+				const float z = positions.z[i];
+				const ClipVertex clip = { x * m[0] + y * m[4] + z * m[8] + m[12], x * m[1] + y * m[5] + z * m[9] + m[13],
+					x * m[2] + y * m[6] + z * m[10] + m[14], x * m[3] + y * m[7] + z * m[11] + m[15] };
+				clipXYZ.x[i] = clip.x;
+				clipXYZ.y[i] = clip.y;
+				clipXYZ.z[i] = clip.z;
+				clipW[i] = clip.w;
+
+				const bool needsClip = !(clip.z >= 0.0f && clip.w > 0.0f && std::fabs(clip.x) <= guardX * clip.w && std::fabs(clip.y) <= guardY * clip.w);
+				vertexFlags[i] = static_cast<uint8_t>(outcode(clip) | (needsClip ? needsClipFlag : 0u));
+				if (!needsClip)
+				{
+					const float inverseW = 1.0f / clip.w;
+					screen.x[i] = snap((clip.x * inverseW + 1.0f) * halfWidth);
+					screen.y[i] = snap((1.0f - clip.y * inverseW) * halfHeight);
+					screen.z[i] = clip.z * inverseW;
+				}
+			}
+		}
+	});
+}
+
+// Cull, clip and project each triangle of the batch, then append it to the bin of every tile its bounds touch
+void SoftwareRasterizer::bin(std::span<const unsigned int> indices, size_t firstTriangle, size_t triangleCount, size_t blockCount)
+{
+	TRACE_ZONE("Raster bin");
+	const size_t tileCount = size_t(tilesX) * tilesY;
+	if (blocks.size() < blockCount)
+	{
+		blocks.resize(blockCount);
+	}
+	for (size_t b = 0; b < blockCount; ++b)
+	{
+		if (blocks[b].bins.size() != tileCount)
+		{
+			blocks[b].bins.assign(tileCount, {});
+		}
+	}
+
+	const size_t vertexCount = vertexFlags.size();
+	const float halfWidth = 0.5f * width;
+	const float halfHeight = 0.5f * height;
+	const float guardX = 1.0f + guardBandPixels / halfWidth;
+	const float guardY = 1.0f + guardBandPixels / halfHeight;
+	const float clipPlanes[5][4] = { { 0.0f, 0.0f, 1.0f, 0.0f }, { 1.0f, 0.0f, 0.0f, guardX }, { -1.0f, 0.0f, 0.0f, guardX },
+		{ 0.0f, 1.0f, 0.0f, guardY }, { 0.0f, -1.0f, 0.0f, guardY } };
+	const bool drawEdges = wireframe;
+
+	std::atomic<size_t> nextBlock{ 0 };
+	Parallel::run(std::min<size_t>(threadCount, blockCount), [&](size_t)
+	{
+		for (size_t blockIndex = nextBlock++; blockIndex < blockCount; blockIndex = nextBlock++)
+		{
+			Block& block = blocks[blockIndex];
+			block.primitives.clear();
+			for (auto& tileBin : block.bins)
+			{
+				tileBin.clear();
+			}
+
+			auto project = [&](const ClipVertex& v, float& x, float& y, float& z)
+			{
+				const float inverseW = 1.0f / v.w;
+				x = snap((v.x * inverseW + 1.0f) * halfWidth);
+				y = snap((1.0f - v.y * inverseW) * halfHeight);
+				z = v.z * inverseW;
+			};
+			auto addPrimitive = [&](Primitive& primitive, float minX, float minY, float maxX, float maxY)
+			{
+				// Pixel centers inside the bounds, clamped to the viewport
+				primitive.bounds.x0 = std::max(0, static_cast<int>(std::ceil(std::max(minX, -1.0f) - 0.5f)));
+				primitive.bounds.y0 = std::max(0, static_cast<int>(std::ceil(std::max(minY, -1.0f) - 0.5f)));
+				primitive.bounds.x1 = std::min(width - 1, static_cast<int>(std::floor(std::min(maxX, width + 1.0f) - 0.5f)));
+				primitive.bounds.y1 = std::min(height - 1, static_cast<int>(std::floor(std::min(maxY, height + 1.0f) - 0.5f)));
+				if (primitive.bounds.x0 > primitive.bounds.x1 || primitive.bounds.y0 > primitive.bounds.y1)
+				{
+					return;
+				}
+				const uint32_t index = static_cast<uint32_t>(block.primitives.size());
+				block.primitives.push_back(primitive);
+				for (int ty = primitive.bounds.y0 / tileSize; ty <= primitive.bounds.y1 / tileSize; ++ty)
+				{
+					for (int tx = primitive.bounds.x0 / tileSize; tx <= primitive.bounds.x1 / tileSize; ++tx)
+					{
+						block.bins[size_t(ty) * tilesX + tx].push_back(index);
+					}
+				}
+			};
+			auto addTriangle = [&](Primitive& primitive)
+			{
+				// Clockwise on screen is front facing (FrontCounterClockwise = FALSE), back faces and slivers go
+				const float area = (primitive.x[1] - primitive.x[0]) * (primitive.y[2] - primitive.y[0]) - (primitive.y[1] - primitive.y[0]) * (primitive.x[2] - primitive.x[0]);
+				if (area > 0.0f)
+				{
+					addPrimitive(primitive, std::min({ primitive.x[0], primitive.x[1], primitive.x[2] }), std::min({ primitive.y[0], primitive.y[1], primitive.y[2] }),
+						std::max({ primitive.x[0], primitive.x[1], primitive.x[2] }), std::max({ primitive.y[0], primitive.y[1], primitive.y[2] }));
+				}
+			};
+
+			const size_t begin = firstTriangle + blockIndex * blockTriangles;
+			const size_t end = std::min(firstTriangle + triangleCount, begin + blockTriangles);
+			for (size_t triangle = begin; triangle < end; ++triangle)
+			{
+				unsigned int vertex[3];
+				unsigned int allOutside = frustumBits;
+				unsigned int anyFlags = 0;
+				bool valid = true;
+				for (int k = 0; k < 3; ++k)
+				{
+					vertex[k] = indices[triangle * 3 + k];
+					valid = valid && vertex[k] < vertexCount;
+					if (!valid)
+					{
+						break;
+					}
+					allOutside &= vertexFlags[vertex[k]];
+					anyFlags |= vertexFlags[vertex[k]];
+				}
+				if (!valid || (allOutside & frustumBits) != 0)
+				{
+					continue;
+				}
+				const bool needsClip = (anyFlags & needsClipFlag) != 0;
+				ClipVertex corners[3];
+				if (needsClip)
+				{
+					for (int k = 0; k < 3; ++k)
+					{
+						corners[k] = { clipXYZ.x[vertex[k]], clipXYZ.y[vertex[k]], clipXYZ.z[vertex[k]], clipW[vertex[k]] };
+					}
+				}
+
+				Primitive primitive;
+				primitive.triangle = static_cast<uint32_t>(triangle);
+				if (drawEdges)
+				{
+					// Each edge clipped on its own, the clipping planes add no edges of their own
+					for (int e = 0; e < 3; ++e)
+					{
+						const unsigned int v0 = vertex[e];
+						const unsigned int v1 = vertex[(e + 1) % 3];
+						if ((vertexFlags[v0] & vertexFlags[v1] & frustumBits) != 0)
+						{
+							continue;
+						}
+						if (((vertexFlags[v0] | vertexFlags[v1]) & needsClipFlag) == 0)
+						{
+							primitive.x[0] = screen.x[v0];
+							primitive.y[0] = screen.y[v0];
+							primitive.z[0] = screen.z[v0];
+							primitive.x[1] = screen.x[v1];
+							primitive.y[1] = screen.y[v1];
+							primitive.z[1] = screen.z[v1];
+						}
+						else
+						{
+							ClipVertex segment[2] = { corners[e], corners[(e + 1) % 3] };
+							bool visible = true;
+							for (const float* plane : clipPlanes)
+							{
+								const float d0 = planeDistance(plane, segment[0]);
+								const float d1 = planeDistance(plane, segment[1]);
+								if (d0 < 0.0f && d1 < 0.0f)
+								{
+									visible = false;
+									break;
+								}
+								if (d0 < 0.0f || d1 < 0.0f)
+								{
+									segment[d0 < 0.0f ? 0 : 1] = lerp(segment[0], segment[1], d0 / (d0 - d1));
+								}
+							}
+							if (!visible)
+							{
+								continue;
+							}
+							project(segment[0], primitive.x[0], primitive.y[0], primitive.z[0]);
+							project(segment[1], primitive.x[1], primitive.y[1], primitive.z[1]);
+						}
+						addPrimitive(primitive, std::min(primitive.x[0], primitive.x[1]) - 0.5f, std::min(primitive.y[0], primitive.y[1]) - 0.5f,
+							std::max(primitive.x[0], primitive.x[1]) + 0.5f, std::max(primitive.y[0], primitive.y[1]) + 0.5f);
+					}
+					continue;
+				}
+
+				if (!needsClip)
+				{
+					for (int k = 0; k < 3; ++k)
+					{
+						primitive.x[k] = screen.x[vertex[k]];
+						primitive.y[k] = screen.y[vertex[k]];
+						primitive.z[k] = screen.z[vertex[k]];
+					}
+					addTriangle(primitive);
+					continue;
+				}
+
+				// Triangles crossing the near plane or the guard band become a fan of up to six
+				ClipVertex polygon[2][9];
+				int polygonCount = 3;
+				int current = 0;
+				std::copy(corners, corners + 3, polygon[0]);
+				for (const float* plane : clipPlanes)
+				{
+					polygonCount = clipPolygon(polygon[current], polygonCount, plane, polygon[1 - current]);
+					current = 1 - current;
+					if (polygonCount < 3)
+					{
+						break;
+					}
+				}
+				float px[9], py[9], pz[9];
+				for (int k = 0; k < polygonCount; ++k)
+				{
+					project(polygon[current][k], px[k], py[k], pz[k]);
+				}
+				for (int k = 1; k + 1 < polygonCount; ++k)
+				{
+					const int fan[3] = { 0, k, k + 1 };
+					for (int c = 0; c < 3; ++c)
+					{
+						primitive.x[c] = px[fan[c]];
+						primitive.y[c] = py[fan[c]];
+						primitive.z[c] = pz[fan[c]];
+					}
+					addTriangle(primitive);
+				}
+			}
+		}
+	});
+}
+
+// Every tile walks the bins of the blocks in order, so draw order and depth ties match a single thread
+void SoftwareRasterizer::rasterize(size_t blockCount, bool clear)
+{
+	TRACE_ZONE("Raster tiles");
+	const size_t tileCount = size_t(tilesX) * tilesY;
+	const CoverFunction cover = selectCover();
+	const bool drawEdges = wireframe;
+	std::atomic<size_t> nextTile{ 0 };
+	Parallel::run(std::min<size_t>(threadCount, tileCount), [&](size_t)
+	{
+		for (size_t tileIndex = nextTile++; tileIndex < tileCount; tileIndex = nextTile++)
+		{
+			TileTarget tile;
+			tile.depth = depth.data() + tileIndex * tilePixels;
+			tile.ids = triangleIds.data() + tileIndex * tilePixels;
+			tile.originX = static_cast<int>(tileIndex % tilesX) * tileSize;
+			tile.originY = static_cast<int>(tileIndex / tilesX) * tileSize;
+			if (clear)
+			{
+				std::fill(tile.depth, tile.depth + tilePixels, 1.0f);
+				std::fill(tile.ids, tile.ids + tilePixels, noTriangle);
+			}
+			const PixelRect tileRect = { tile.originX, tile.originY, std::min(width, tile.originX + tileSize) - 1, std::min(height, tile.originY + tileSize) - 1 };
+
+			for (size_t b = 0; b < blockCount; ++b)
+			{
+				const Block& block = blocks[b];
+				for (uint32_t index : block.bins[tileIndex])
+				{
+					const Primitive& primitive = block.primitives[index];
+					const PixelRect rect = { std::max(tileRect.x0, primitive.bounds.x0), std::max(tileRect.y0, primitive.bounds.y0),
+						std::min(tileRect.x1, primitive.bounds.x1), std::min(tileRect.y1, primitive.bounds.y1) };
+					if (drawEdges)
+					{
+						drawLine(primitive.x, primitive.y, primitive.z, rect, primitive.triangle, tile);
+					}
+					else
+					{
+						TriangleEdges edges;
+						setupEdges(primitive.x, primitive.y, primitive.z, edges);
+						cover(edges, rect, primitive.triangle, tile);
+					}
+				}
+			}
+		}
+	});
+}
+
+// Deferred shading of the visibility buffer, each pixel once. Barycentrics come from the triangle's clip-space
+// corners, which makes them perspective correct without needing the clipped polygon.
+size_t SoftwareRasterizer::shade(Vec3Streams positions, Vec3Streams normals, std::span<const unsigned int> indices, const float* lightDirection)
+{
+	TRACE_ZONE("Raster shade");
+	const float lightLength = std::sqrt(lightDirection[0] * lightDirection[0] + lightDirection[1] * lightDirection[1] + lightDirection[2] * lightDirection[2]);
+	const float light[3] = { lightDirection[0] / lightLength, lightDirection[1] / lightLength, lightDirection[2] / lightLength };
+	const float fillLength = std::sqrt(0.75f);
+	const float fill[3] = { -0.5f / fillLength, 0.5f / fillLength, -0.5f / fillLength };
+
+	const size_t tileCount = size_t(tilesX) * tilesY;
+	std::atomic<size_t> nextTile{ 0 };
+	std::atomic<size_t> shaded{ 0 };
+	Parallel::run(std::min<size_t>(threadCount, tileCount), [&](size_t)
+	{
+		// Per-triangle terms, reused while neighbouring pixels hit the same triangle
+		uint32_t cached = noTriangle;
+		float rows[3][3];
+		float cornerNormals[3][3];
+		float cornerPositions[3][3];
+		size_t tileShaded = 0;
+
+		for (size_t tileIndex = nextTile++; tileIndex < tileCount; tileIndex = nextTile++)
+		{
+			const uint32_t* ids = triangleIds.data() + tileIndex * tilePixels;
+			const int originX = static_cast<int>(tileIndex % tilesX) * tileSize;
+			const int originY = static_cast<int>(tileIndex / tilesX) * tileSize;
+			const int endX = std::min(width, originX + tileSize);
+			const int endY = std::min(height, originY + tileSize);
+			for (int y = originY; y < endY; ++y)
+			{
+				uint32_t* out = pixels.data() + size_t(y) * width;
+				const float ndcY = 1.0f - (y + 0.5f) / (0.5f * height);
+				for (int x = originX; x < endX; ++x)
+				{
+					const uint32_t triangle = ids[(y - originY) * tileSize + (x - originX)];
+					if (triangle == noTriangle)
+					{
+						out[x] = clearPixel;
+						continue;
+					}
+					if (triangle != cached)
+					{
+						cached = triangle;
+						float corners[3][3];
+						for (int k = 0; k < 3; ++k)
+						{
+							const unsigned int v = indices[size_t(triangle) * 3 + k];
+							corners[k][0] = clipXYZ.x[v];
+							corners[k][1] = clipXYZ.y[v];
+							corners[k][2] = clipW[v];
+							float n[3] = { 0.0f, 1.0f, 0.0f };
+							if (v < normals.size())
+							{
+								n[0] = normals.x[v];
+								n[1] = normals.y[v];
+								n[2] = normals.z[v];
+							}
+							// The vertex shader outputs unit normals
+							const float length = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+							const float scale = length > 0.0f ? 1.0f / length : 0.0f;
+							for (int c = 0; c < 3; ++c)
+							{
+								cornerNormals[k][c] = n[c] * scale;
+							}
+							cornerPositions[k][0] = positions.x[v];
+							cornerPositions[k][1] = positions.y[v];
+							cornerPositions[k][2] = positions.z[v];
+						}
+						// Rows of the adjugate of [c0 c1 c2] with ci = (x, y, w)
+						for (int k = 0; k < 3; ++k)
+						{
+							const float* p = corners[(k + 1) % 3];
+							const float* q = corners[(k + 2) % 3];
+							rows[k][0] = p[1] * q[2] - p[2] * q[1];
+							rows[k][1] = p[2] * q[0] - p[0] * q[2];
+							rows[k][2] = p[0] * q[1] - p[1] * q[0];
+						}
+					}
+
+					const float ndcX = (x + 0.5f) / (0.5f * width) - 1.0f;
+					float weights[3];
+					float sum = 0.0f;
+					for (int k = 0; k < 3; ++k)
+					{
+						weights[k] = rows[k][0] * ndcX + rows[k][1] * ndcY + rows[k][2];
+						sum += weights[k];
+					}
+					const float inverseSum = sum != 0.0f ? 1.0f / sum : 0.0f;
+					float normal[3] = { 0.0f, 0.0f, 0.0f };
+					float world[3] = { 0.0f, 0.0f, 0.0f };
+					for (int k = 0; k < 3; ++k)
+					{
+						const float weight = weights[k] * inverseSum;
+						for (int c = 0; c < 3; ++c)
+						{
+							normal[c] += weight * cornerNormals[k][c];
+							world[c] += weight * cornerPositions[k][c];
+						}
+					}
+
+					// pixel.hlsl: main light, fill light, rim term for a camera assumed at the origin, then ambient
+					const float normalLength = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+					if (normalLength < 0.001f)
+					{
+						normal[0] = 0.0f;
+						normal[1] = 1.0f;
+						normal[2] = 0.0f;
+					}
+					else
+					{
+						for (float& c : normal)
+						{
+							c /= normalLength;
+						}
+					}
+					const float mainDiffuse = smoothstep(-0.2f, 0.2f, normal[0] * light[0] + normal[1] * light[1] + normal[2] * light[2]) * 0.7f;
+					const float fillDiffuse = smoothstep(-0.3f, 0.3f, normal[0] * fill[0] + normal[1] * fill[1] + normal[2] * fill[2]) * 0.3f;
+					const float worldLength = std::sqrt(world[0] * world[0] + world[1] * world[1] + world[2] * world[2]);
+					const float facing = worldLength > 0.0f ? -(normal[0] * world[0] + normal[1] * world[1] + normal[2] * world[2]) / worldLength : 0.0f;
+					const float rim = 1.0f - std::max(facing, 0.0f);
+					const float lighting = std::clamp(0.15f + mainDiffuse + fillDiffuse + rim * rim * 0.2f, 0.0f, 1.0f);
+					out[x] = toPixel(0.8f * lighting);
+					++tileShaded;
+				}
+			}
+		}
+		shaded += tileShaded;
+	});
+	return shaded;
+}
\ No newline at end of file
@@ -0,0 +1,349 @@
+// Binary records decode in parallel slices, ASCII facets in one tokenizing pass, welding is VertexWelder's
+
+#include "StlLoader.h"
+#include <algorithm>
+#include <bit>
+#include <climits>
+#include <cmath>
+#include <cstring>
+#include <functional>
+#include <numeric>
+#include <string_view>
+#include <QDebug>
+#include <QFile>
+#include <QFileInfo>
+#include "MeshKernels.h"
+#include "NumberParser.h"
+#include "OutOfCoreMesh.h"
+#include "Parallel.h"
+#include "Trace.h"
+
+namespace
+{
+	constexpr size_t headerBytes = 84; // 80 free bytes and the triangle count
+	constexpr size_t recordBytes = 50; // Facet normal, three corners, attribute byte count
+	constexpr size_t minTrianglesPerThread = 1 << 15;
+	constexpr size_t chunkedBatchTriangles = 1 << 20; // Decoded at a time when streaming into an OutOfCoreMesh
+
+	template <typename Job>
+	void runSlices(size_t count, unsigned int threadCount, const Job& job)
+	{
+		const size_t threads = std::min<size_t>(Parallel::resolveThreadCount(threadCount), std::max<size_t>(count / minTrianglesPerThread, 1));
+		Parallel::run(threads, [&](size_t t) { job(count * t / threads, count * (t + 1) / threads); });
+	}
+
+	float readFloat(const unsigned char* bytes) // Binary STL is little-endian
+	{
+		unsigned char copy[sizeof(float)];
+		std::memcpy(copy, bytes, sizeof(copy));
+		if constexpr (std::endian::native == std::endian::big)
+		{
+			std::reverse(copy, copy + sizeof(copy));
+		}
+		float value;
+		std::memcpy(&value, copy, sizeof(value));
+		return value;
+	}
+
+	void decodeBinary(const unsigned char* records, size_t triangleCount, Vec3Array& corners, Vec3Array* facetNormals, unsigned int threadCount)
+	{
+		corners.resize(triangleCount * 3);
+		if (facetNormals)
+		{
+			facetNormals->resize(triangleCount);
+		}
+		runSlices(triangleCount, threadCount, [&](size_t first, size_t last)
+		{
+			for (size_t t = first; t < last; ++t)
+			{
+				const unsigned char* record = records + t * recordBytes;
+				if (facetNormals)
+				{
+					facetNormals->x[t] = readFloat(record);
+					facetNormals->y[t] = readFloat(record + 4);
+					facetNormals->z[t] = readFloat(record + 8);
+				}
+				for (size_t corner = 0; corner < 3; ++corner)
+				{
+					const unsigned char* position = record + 12 + corner * 12;
+					corners.x[t * 3 + corner] = readFloat(position);
+					corners.y[t * 3 + corner] = readFloat(position + 4);
+					corners.z[t * 3 + corner] = readFloat(position + 8);
+				}
+			}
+		});
+	}
+
+	// The whole file mapped, with its format decided. Binary files may start with "solid" too, a size that matches
+	// the triangle count decides.
+	struct MappedStl
+	{
+		QFile file;
+		const unsigned char* data = nullptr;
+		size_t size = 0;
+		bool binary = false;
+		size_t binaryCount = 0;
+
+		~MappedStl()
+		{
+			if (data)
+			{
+				file.unmap(const_cast<uchar*>(data));
+			}
+		}
+
+		bool open(const QString& filePath)
+		{
+			file.setFileName(filePath);
+			if (!file.open(QIODevice::ReadOnly) || file.size() == 0)
+			{
+				qCritical() << "Cannot open" << filePath;
+				return false;
+			}
+			size = static_cast<size_t>(file.size());
+			data = file.map(0, file.size());
+			if (!data)
+			{
+				qCritical() << "Cannot map" << filePath;
+				return false;
+			}
+			binaryCount = size >= headerBytes ? (data[80] | data[81] << 8 | data[82] << 16 | static_cast<size_t>(data[83]) << 24) : 0;
+			const bool sizeMatches = size >= headerBytes && headerBytes + binaryCount * recordBytes == size;
+			const char* text = reinterpret_cast<const char*>(data);
+			const char* textStart = std::find_if(text, text + size, [](char c) { return c != ' ' && c != '\t' && c != '\r' && c != '\n'; });
+			binary = sizeMatches || size - (textStart - text) < 5 || std::strncmp(textStart, "solid", 5) != 0;
+			if (binary && (size < headerBytes || headerBytes + binaryCount * recordBytes > size))
+			{
+				qCritical() << filePath << "is not a complete binary STL file";
+				return false;
+			}
+			return true;
+		}
+	};
+
+	// solid / facet normal n n n / outer loop / vertex v v v (x3) / endloop / endfacet ... endsolid
+	// With flush, it is called after the facet that brings corners to batchCorners and false from it stops the parse.
+	bool parseAscii(const char* pos, const char* end, Vec3Array& corners, Vec3Array* facetNormals, size_t batchCorners = 0,
+		const std::function<bool(const char* pos)>& flush = {})
+	{
+		auto isSpace = [](char c) { return c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '\v' || c == '\f'; };
+		auto nextToken = [&](const char*& first, const char*& last)
+		{
+			while (pos < end && isSpace(*pos)) ++pos;
+			first = pos;
+			while (pos < end && !isSpace(*pos)) ++pos;
+			last = pos;
+			return first < last;
+		};
+		auto readVector = [&](float out[3])
+		{
+			const char* first;
+			const char* last;
+			for (int i = 0; i < 3; ++i)
+			{
+				if (!nextToken(first, last) || NumberParser::parseFloat(first, last, out[i]) != last)
+				{
+					return false;
+				}
+			}
+			return true;
+		};
+		auto fail = [](const char* message)
+		{
+			qCritical() << "Invalid ASCII STL:" << message;
+			return false;
+		};
+
+		const char* first;
+		const char* last;
+		int facetCorners = -1; // -1 outside a facet
+		float vector[3];
+		while (nextToken(first, last))
+		{
+			const std::string_view token(first, last - first);
+			if (token == "solid" || token == "endsolid")
+			{
+				pos = std::find(pos, end, '\n'); // The name runs to the end of the line
+			}
+			else if (token == "facet")
+			{
+				if (facetCorners >= 0 || !nextToken(first, last) || std::string_view(first, last - first) != "normal" || !readVector(vector))
+				{
+					return fail("malformed facet normal");
+				}
+				if (facetNormals)
+				{
+					facetNormals->x.push_back(vector[0]);
+					facetNormals->y.push_back(vector[1]);
+					facetNormals->z.push_back(vector[2]);
+				}
+				facetCorners = 0;
+			}
+			else if (token == "vertex")
+			{
+				if (facetCorners < 0 || facetCorners == 3 || !readVector(vector))
+				{
+					return fail("malformed or extra vertex");
+				}
+				corners.x.push_back(vector[0]);
+				corners.y.push_back(vector[1]);
+				corners.z.push_back(vector[2]);
+				++facetCorners;
+			}
+			else if (token == "endfacet")
+			{
+				if (facetCorners != 3)
+				{
+					return fail("a facet without three vertices");
+				}
+				facetCorners = -1;
+				if (flush && corners.size() >= batchCorners && !flush(pos))
+				{
+					return false;
+				}
+			}
+		}
+		return facetCorners < 0 || fail("the file ends inside a facet");
+	}
+
+	// Every corner its own vertex with its facet's normal, the cross product where the file left the normal zero
+	void buildFlat(Vec3Array& corners, const Vec3Array& facetNormals, StlMeshData& out, unsigned int threadCount)
+	{
+		const size_t triangleCount = corners.size() / 3;
+		out.vertices = std::move(corners);
+		out.normals.resize(triangleCount * 3);
+		runSlices(triangleCount, threadCount, [&](size_t first, size_t last)
+		{
+			for (size_t t = first; t < last; ++t)
+			{
+				QVector3D normal(facetNormals.x[t], facetNormals.y[t], facetNormals.z[t]);
+				const float lengthSquared = normal.lengthSquared();
+				if (!(lengthSquared > 1e-12f) || !std::isfinite(lengthSquared))
+				{
+					const QVector3D a(out.vertices.x[t * 3], out.vertices.y[t * 3], out.vertices.z[t * 3]);
+					const QVector3D b(out.vertices.x[t * 3 + 1], out.vertices.y[t * 3 + 1], out.vertices.z[t * 3 + 1]);
+					const QVector3D c(out.vertices.x[t * 3 + 2], out.vertices.y[t * 3 + 2], out.vertices.z[t * 3 + 2]);
+					normal = QVector3D::crossProduct(b - a, c - a);
+				}
+				for (size_t corner = t * 3; corner < t * 3 + 3; ++corner)
+				{
+					out.normals.x[corner] = normal.x();
+					out.normals.y[corner] = normal.y();
+					out.normals.z[corner] = normal.z();
+				}
+			}
+		});
+		MeshKernels::normalize(out.normals.x.data(), out.normals.y.data(), out.normals.z.data(), out.normals.size());
+		out.indices.resize(triangleCount * 3);
+		std::iota(out.indices.begin(), out.indices.end(), 0u);
+	}
+
+	void buildWelded(const Vec3Array& corners, float weldEpsilon, StlMeshData& out, unsigned int threadCount)
+	{
+		std::vector<unsigned int> firstCorners;
+		{
+			TRACE_ZONE("Weld vertices");
+			out.weldStats = VertexWelder::weldPositions(corners.view(), weldEpsilon, threadCount, out.indices, firstCorners);
+		}
+		out.vertices.resize(firstCorners.size());
+		runSlices(firstCorners.size(), threadCount, [&](size_t first, size_t last)
+		{
+			for (size_t v = first; v < last; ++v)
+			{
+				out.vertices.x[v] = corners.x[firstCorners[v]];
+				out.vertices.y[v] = corners.y[firstCorners[v]];
+				out.vertices.z[v] = corners.z[firstCorners[v]];
+			}
+		});
+
+		// Triangles whose corners welded together have no area left
+		size_t kept = 0;
+		for (size_t i = 0; i + 2 < out.indices.size(); i += 3)
+		{
+			const unsigned int a = out.indices[i], b = out.indices[i + 1], c = out.indices[i + 2];
+			if (a != b && b != c && a != c)
+			{
+				out.indices[kept++] = a;
+				out.indices[kept++] = b;
+				out.indices[kept++] = c;
+			}
+		}
+		out.indices.resize(kept);
+	}
+}
+
+bool StlLoader::isStlFile(const QString& filePath)
+{
+	return QFileInfo(filePath).suffix().toLower() == "stl";
+}
+
+bool StlLoader::load(const QString& filePath, StlMeshData& out, bool weld, float weldEpsilon, unsigned int threadCount)
+{
+	Vec3Array corners;
+	Vec3Array facetNormals;
+	{
+		MappedStl stl;
+		if (!stl.open(filePath))
+		{
+			return false;
+		}
+		out.binary = stl.binary;
+		TRACE_ZONE("Parse STL");
+		if (stl.binary)
+		{
+			decodeBinary(stl.data + headerBytes, stl.binaryCount, corners, weld ? nullptr : &facetNormals, threadCount);
+		}
+		else if (!parseAscii(reinterpret_cast<const char*>(stl.data), reinterpret_cast<const char*>(stl.data) + stl.size, corners, weld ? nullptr : &facetNormals))
+		{
+			return false;
+		}
+	}
+
+	out.triangleCount = corners.size() / 3;
+	if (out.triangleCount == 0 || out.triangleCount > (UINT_MAX - 1) / 3)
+	{
+		qCritical() << filePath << "has no triangles or more than 32-bit indices can address";
+		return false;
+	}
+	if (weld)
+	{
+		buildWelded(corners, weldEpsilon, out, threadCount);
+	}
+	else
+	{
+		buildFlat(corners, facetNormals, out, threadCount);
+	}
+	return true;
+}
+
+bool StlLoader::loadChunked(const QString& filePath, OutOfCoreMesh& out, unsigned int threadCount, const std::function<bool(double fraction)>& progress)
+{
+	MappedStl stl;
+	if (!stl.open(filePath))
+	{
+		return false;
+	}
+	TRACE_ZONE("Parse STL");
+	Vec3Array corners;
+	if (stl.binary)
+	{
+		for (size_t first = 0; first < stl.binaryCount; first += chunkedBatchTriangles)
+		{
+			const size_t count = std::min(chunkedBatchTriangles, stl.binaryCount - first);
+			decodeBinary(stl.data + headerBytes + first * recordBytes, count, corners, nullptr, threadCount);
+			if (!out.addTriangles(corners.view()) || !progress(static_cast<double>(first + count) / stl.binaryCount))
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+	const char* text = reinterpret_cast<const char*>(stl.data);
+	auto flush = [&](const char* pos)
+	{
+		const bool added = out.addTriangles(corners.view());
+		corners.clear();
+		return added && progress(static_cast<double>(pos - text) / stl.size);
+	};
+	return parseAscii(text, text + stl.size, corners, nullptr, chunkedBatchTriangles * 3, flush) && flush(text + stl.size);
+}
\ No newline at end of file
@@ -0,0 +1,181 @@
+// Lock-free per-thread zone buffers and their Chrome trace JSON export
+
+#include "Trace.h"
+
+#if SIMPLE3DVIEWER_TRACING
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <QDebug>
+#include <QFile>
+
+namespace
+{
+	constexpr size_t chunkEvents = 4096;
+
+	struct Event
+	{
+		const char* name;
+		int64_t start;
+		int64_t end;
+	};
+
+	// Filled by the owning thread only. count and next are published with release stores, so the exporter
+	// reads every event below count without locking the writer out.
+	struct Chunk
+	{
+		Event events[chunkEvents];
+		std::atomic<size_t> count{ 0 };
+		std::atomic<Chunk*> next{ nullptr };
+	};
+
+	struct ThreadBuffer
+	{
+		unsigned int id = 0;
+		std::atomic<const char*> name{ nullptr };
+		Chunk head;
+		Chunk* tail = &head; // Owner thread only
+
+		~ThreadBuffer()
+		{
+			Chunk* chunk = head.next.load(std::memory_order_relaxed);
+			while (chunk)
+			{
+				Chunk* next = chunk->next.load(std::memory_order_relaxed);
+				delete chunk;
+				chunk = next;
+			}
+		}
+	};
+
+	// Buffers outlive their threads so zones of finished loads still get exported
+	struct Registry
+	{
+		std::mutex mutex;
+		std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+		const std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+	};
+
+	Registry& registry()
+	{
+		static Registry instance;
+		return instance;
+	}
+
+	ThreadBuffer& threadBuffer()
+	{
+		thread_local ThreadBuffer* buffer = []()
+		{
+			Registry& shared = registry();
+			std::lock_guard<std::mutex> lock(shared.mutex);
+			shared.buffers.push_back(std::make_unique<ThreadBuffer>());
+			shared.buffers.back()->id = static_cast<unsigned int>(shared.buffers.size());
+			return shared.buffers.back().get();
+		}();
+		return *buffer;
+	}
+
+	void appendString(std::string& out, const char* text)
+	{
+		out += '"';
+		for (; *text; ++text)
+		{
+			if (*text == '"' || *text == '\\')
+			{
+				out += '\\';
+			}
+			out += *text;
+		}
+		out += '"';
+	}
+
+	// Microseconds with nanosecond decimals, the unit the trace format expects
+	void appendMicroseconds(std::string& out, int64_t ns)
+	{
+		out += std::to_string(ns / 1000);
+		out += '.';
+		const std::string fraction = std::to_string(ns % 1000);
+		out.append(3 - fraction.size(), '0');
+		out += fraction;
+	}
+}
+
+int64_t Trace::now()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - registry().epoch).count();
+}
+
+void Trace::record(const char* name, int64_t startNs, int64_t endNs)
+{
+	ThreadBuffer& buffer = threadBuffer();
+	Chunk* chunk = buffer.tail;
+	size_t count = chunk->count.load(std::memory_order_relaxed);
+	if (count == chunkEvents)
+	{
+		Chunk* next = new Chunk;
+		chunk->next.store(next, std::memory_order_release);
+		buffer.tail = next;
+		chunk = next;
+		count = 0;
+	}
+	chunk->events[count] = { name, startNs, endNs };
+	chunk->count.store(count + 1, std::memory_order_release);
+}
+
+void Trace::setThreadName(const char* name)
+{
+	threadBuffer().name.store(name, std::memory_order_release);
+}
+
+bool Trace::writeJson(const QString& filePath)
+{
+	std::string out = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+	size_t eventCount = 0;
+	{
+		Registry& shared = registry();
+		std::lock_guard<std::mutex> lock(shared.mutex);
+		for (const auto& buffer : shared.buffers)
+		{
+			if (const char* name = buffer->name.load(std::memory_order_acquire))
+			{
+				out += "{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":" + std::to_string(buffer->id) + ",\"args\":{\"name\":";
+				appendString(out, name);
+				out += "}},";
+			}
+			for (const Chunk* chunk = &buffer->head; chunk; chunk = chunk->next.load(std::memory_order_acquire))
+			{
+				const size_t count = chunk->count.load(std::memory_order_acquire);
+				for (size_t i = 0; i < count; ++i)
+				{
+					const Event& event = chunk->events[i];
+					out += "{\"ph\":\"X\",\"name\":";
+					appendString(out, event.name);
+					out += ",\"pid\":1,\"tid\":" + std::to_string(buffer->id) + ",\"ts\":";
+					appendMicroseconds(out, event.start);
+					out += ",\"dur\":";
+					appendMicroseconds(out, event.end - event.start);
+					out += "},";
+				}
+				eventCount += count;
+			}
+		}
+	}
+	if (out.back() == ',')
+	{
+		out.pop_back();
+	}
+	out += "]}\n";
+
+	QFile file(filePath);
+	if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate) || file.write(out.data(), static_cast<qint64>(out.size())) != static_cast<qint64>(out.size()))
+	{
+		qCritical() << "Cannot write the trace to" << filePath;
+		return false;
+	}
+	qInfo() << "Wrote" << eventCount << "trace zones to" << filePath;
+	return true;
+}
+#endif
\ No newline at end of file
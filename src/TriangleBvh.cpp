@@ -0,0 +1,418 @@
+// Binned SAH build with parallel subtrees, stack-based nearest-hit traversal
+
+#include "TriangleBvh.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <thread>
+#include "Parallel.h"
+
+namespace
+{
+	constexpr int binCount = 16;
+	constexpr uint32_t maxLeafTriangles = 8;
+	constexpr int maxDepth = 48; // Deeper nodes become leaves so the traversal stack below always suffices
+	constexpr int stackSize = 64;
+	constexpr size_t parallelMinTriangles = 1 << 16; // Smaller subtrees are not worth a thread
+
+	struct Box
+	{
+		float low[3] = { std::numeric_limits<float>::max(), std::numeric_limits<float>::max(), std::numeric_limits<float>::max() };
+		float high[3] = { -std::numeric_limits<float>::max(), -std::numeric_limits<float>::max(), -std::numeric_limits<float>::max() };
+
+		void grow(const float* point)
+		{
+			for (int axis = 0; axis < 3; ++axis)
+			{
+				low[axis] = std::min(low[axis], point[axis]);
+				high[axis] = std::max(high[axis], point[axis]);
+			}
+		}
+		void grow(const Box& other)
+		{
+			for (int axis = 0; axis < 3; ++axis)
+			{
+				low[axis] = std::min(low[axis], other.low[axis]);
+				high[axis] = std::max(high[axis], other.high[axis]);
+			}
+		}
+		float halfArea() const
+		{
+			const float dx = high[0] - low[0], dy = high[1] - low[1], dz = high[2] - low[2];
+			return dx < 0.0f ? 0.0f : dx * dy + dy * dz + dz * dx;
+		}
+	};
+
+	// Per-triangle data the build reads over and over
+	struct BuildTriangle
+	{
+		Box bounds;
+		float centroid[3];
+	};
+
+	struct BuildContext
+	{
+		std::vector<BuildTriangle> triangles;
+		std::vector<uint32_t> ids; // Partitioned in place, ends up in leaf order
+		int parallelDepth = 0; // Split off a thread for right subtrees above this depth
+	};
+
+	void makeLeaf(BvhNode& node, uint32_t first, uint32_t count)
+	{
+		node.leftOrFirst = first;
+		node.count = count;
+	}
+
+	// Build the subtree of nodes[nodeIndex] over ids[first, first + count). Children are appended depth first,
+	// left subtree before right, so the layout is identical whether or not the right side ran on a thread.
+	void buildNode(BuildContext& context, std::vector<BvhNode>& nodes, size_t nodeIndex, uint32_t first, uint32_t count, int depth)
+	{
+		Box bounds, centroidBounds;
+		for (uint32_t i = first; i < first + count; ++i)
+		{
+			const BuildTriangle& triangle = context.triangles[context.ids[i]];
+			bounds.grow(triangle.bounds);
+			centroidBounds.grow(triangle.centroid);
+		}
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			nodes[nodeIndex].boundsMin[axis] = bounds.low[axis];
+			nodes[nodeIndex].boundsMax[axis] = bounds.high[axis];
+		}
+
+		if (count <= 2 || depth >= maxDepth)
+		{
+			makeLeaf(nodes[nodeIndex], first, count);
+			return;
+		}
+
+		// Bin centroids along every axis and sweep for the cheapest split
+		float bestCost = std::numeric_limits<float>::max();
+		int bestAxis = -1;
+		int bestSplit = 0;
+		float binScale[3];
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			const float extent = centroidBounds.high[axis] - centroidBounds.low[axis];
+			binScale[axis] = extent > 0.0f ? binCount / extent : 0.0f;
+			if (extent <= 0.0f)
+			{
+				continue;
+			}
+
+			Box binBounds[binCount];
+			uint32_t binTriangles[binCount] = {};
+			for (uint32_t i = first; i < first + count; ++i)
+			{
+				const BuildTriangle& triangle = context.triangles[context.ids[i]];
+				const int bin = std::min(binCount - 1, int((triangle.centroid[axis] - centroidBounds.low[axis]) * binScale[axis]));
+				++binTriangles[bin];
+				binBounds[bin].grow(triangle.bounds);
+			}
+
+			float leftArea[binCount - 1];
+			uint32_t leftCount[binCount - 1];
+			Box sweep;
+			uint32_t sweepCount = 0;
+			for (int split = 0; split < binCount - 1; ++split)
+			{
+				sweep.grow(binBounds[split]);
+				sweepCount += binTriangles[split];
+				leftArea[split] = sweep.halfArea();
+				leftCount[split] = sweepCount;
+			}
+			sweep = Box();
+			sweepCount = 0;
+			for (int split = binCount - 1; split > 0; --split)
+			{
+				sweep.grow(binBounds[split]);
+				sweepCount += binTriangles[split];
+				if (leftCount[split - 1] == 0 || sweepCount == 0)
+				{
+					continue;
+				}
+				const float cost = leftArea[split - 1] * leftCount[split - 1] + sweep.halfArea() * sweepCount;
+				if (cost < bestCost)
+				{
+					bestCost = cost;
+					bestAxis = axis;
+					bestSplit = split;
+				}
+			}
+		}
+
+		// SAH with unit traversal and intersection costs, relative to this node's area
+		const float nodeArea = bounds.halfArea();
+		const float splitCost = nodeArea > 0.0f ? 1.0f + bestCost / nodeArea : float(count);
+		uint32_t middle;
+		if (bestAxis < 0)
+		{
+			// All centroids coincide, halve the range so leaves stay small
+			if (count <= maxLeafTriangles)
+			{
+				makeLeaf(nodes[nodeIndex], first, count);
+				return;
+			}
+			middle = first + count / 2;
+		}
+		else
+		{
+			if (splitCost >= float(count) && count <= maxLeafTriangles)
+			{
+				makeLeaf(nodes[nodeIndex], first, count);
+				return;
+			}
+			const float low = centroidBounds.low[bestAxis];
+			const float scale = binScale[bestAxis];
+			auto* split = std::partition(context.ids.data() + first, context.ids.data() + first + count, [&](uint32_t id)
+			{
+				const int bin = std::min(binCount - 1, int((context.triangles[id].centroid[bestAxis] - low) * scale));
+				return bin < bestSplit;
+			});
+			middle = uint32_t(split - context.ids.data());
+		}
+
+		const size_t left = nodes.size();
+		nodes[nodeIndex].leftOrFirst = uint32_t(left);
+		nodes[nodeIndex].count = 0;
+		nodes.resize(left + 2);
+
+		const uint32_t leftCount = middle - first;
+		const uint32_t rightCount = count - leftCount;
+		if (depth < context.parallelDepth && rightCount >= parallelMinTriangles)
+		{
+			// The right subtree grows its own node array on a second thread and is spliced in afterwards
+			std::vector<BvhNode> rightNodes(1);
+			std::thread worker([&]() { buildNode(context, rightNodes, 0, middle, rightCount, depth + 1); });
+			buildNode(context, nodes, left, first, leftCount, depth + 1);
+			worker.join();
+
+			const uint32_t base = uint32_t(nodes.size()) - 1; // Local node i > 0 lands at base + i
+			auto rebase = [base](BvhNode node)
+			{
+				if (node.count == 0)
+				{
+					node.leftOrFirst += base;
+				}
+				return node;
+			};
+			nodes[left + 1] = rebase(rightNodes[0]);
+			nodes.reserve(nodes.size() + rightNodes.size() - 1);
+			for (size_t i = 1; i < rightNodes.size(); ++i)
+			{
+				nodes.push_back(rebase(rightNodes[i]));
+			}
+		}
+		else
+		{
+			buildNode(context, nodes, left, first, leftCount, depth + 1);
+			buildNode(context, nodes, left + 1, middle, rightCount, depth + 1);
+		}
+	}
+
+	// Möller-Trumbore, two-sided so picking also finds triangles seen from behind
+	bool intersectTriangle(const PickRay& ray, Vec3Streams p, unsigned int a, unsigned int b, unsigned int c, float maxDistance, float& distance, float& u, float& v)
+	{
+		const float e1x = p.x[b] - p.x[a], e1y = p.y[b] - p.y[a], e1z = p.z[b] - p.z[a];
+		const float e2x = p.x[c] - p.x[a], e2y = p.y[c] - p.y[a], e2z = p.z[c] - p.z[a];
+		const float* d = ray.direction;
+		const float px = d[1] * e2z - d[2] * e2y, py = d[2] * e2x - d[0] * e2z, pz = d[0] * e2y - d[1] * e2x;
+		const float determinant = e1x * px + e1y * py + e1z * pz;
+		if (std::fabs(determinant) < 1e-12f)
+		{
+			return false;
+		}
+		const float inverse = 1.0f / determinant;
+		const float tx = ray.origin[0] - p.x[a], ty = ray.origin[1] - p.y[a], tz = ray.origin[2] - p.z[a];
+		const float hitU = (tx * px + ty * py + tz * pz) * inverse;
+		if (hitU < 0.0f || hitU > 1.0f)
+		{
+			return false;
+		}
+		const float qx = ty * e1z - tz * e1y, qy = tz * e1x - tx * e1z, qz = tx * e1y - ty * e1x;
+		const float hitV = (d[0] * qx + d[1] * qy + d[2] * qz) * inverse;
+		if (hitV < 0.0f || hitU + hitV > 1.0f)
+		{
+			return false;
+		}
+		const float hitDistance = (e2x * qx + e2y * qy + e2z * qz) * inverse;
+		if (hitDistance < 0.0f || hitDistance >= maxDistance)
+		{
+			return false;
+		}
+		distance = hitDistance;
+		u = hitU;
+		v = hitV;
+		return true;
+	}
+
+	// Entry distance of the ray into the node's box, infinity on a miss or beyond maxDistance
+	float intersectBox(const BvhNode& node, const float* origin, const float* inverseDirection, float maxDistance)
+	{
+		float entry = 0.0f;
+		float exit = maxDistance;
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			const float t0 = (node.boundsMin[axis] - origin[axis]) * inverseDirection[axis];
+			const float t1 = (node.boundsMax[axis] - origin[axis]) * inverseDirection[axis];
+			entry = std::max(entry, std::min(t0, t1));
+			exit = std::min(exit, std::max(t0, t1));
+		}
+		return entry <= exit ? entry : std::numeric_limits<float>::infinity();
+	}
+}
+
+void TriangleBvh::build(Vec3Streams positions, std::span<const unsigned int> indices, unsigned int threadCount)
+{
+	clear();
+	const size_t triangleCount = indices.size() / 3;
+	if (triangleCount == 0 || positions.empty())
+	{
+		return;
+	}
+
+	BuildContext context;
+	context.triangles.resize(triangleCount);
+	context.ids.reserve(triangleCount);
+	for (size_t t = 0; t < triangleCount; ++t)
+	{
+		const unsigned int corners[3] = { indices[t * 3], indices[t * 3 + 1], indices[t * 3 + 2] };
+		if (corners[0] >= positions.count || corners[1] >= positions.count || corners[2] >= positions.count)
+		{
+			continue; // Broken triangles can never be hit
+		}
+		BuildTriangle& triangle = context.triangles[t];
+		for (unsigned int corner : corners)
+		{
+			const float point[3] = { positions.x[corner], positions.y[corner], positions.z[corner] };
+			triangle.bounds.grow(point);
+		}
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			triangle.centroid[axis] = (triangle.bounds.low[axis] + triangle.bounds.high[axis]) * 0.5f;
+		}
+		context.ids.push_back(uint32_t(t));
+	}
+	if (context.ids.empty())
+	{
+		return;
+	}
+
+	const unsigned int threads = Parallel::resolveThreadCount(threadCount);
+	while ((1u << context.parallelDepth) < threads)
+	{
+		++context.parallelDepth;
+	}
+
+	nodes.reserve(context.ids.size() / 2);
+	nodes.resize(1);
+	buildNode(context, nodes, 0, 0, uint32_t(context.ids.size()), 0);
+	nodes.shrink_to_fit();
+
+	triangleIds = std::move(context.ids);
+	triangles.resize(triangleIds.size() * 3);
+	for (size_t i = 0; i < triangleIds.size(); ++i)
+	{
+		for (int k = 0; k < 3; ++k)
+		{
+			triangles[i * 3 + k] = indices[size_t(triangleIds[i]) * 3 + k];
+		}
+	}
+}
+
+void TriangleBvh::clear()
+{
+	nodes.clear();
+	triangleIds.clear();
+	triangles.clear();
+}
+
+PickHit TriangleBvh::intersect(const PickRay& ray, Vec3Streams positions) const
+{
+	PickHit result;
+	if (nodes.empty())
+	{
+		return result;
+	}
+
+	float inverseDirection[3];
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		inverseDirection[axis] = 1.0f / ray.direction[axis]; // Zero components become infinities, which the slab test handles
+	}
+
+	float nearest = std::numeric_limits<float>::infinity();
+	uint32_t stack[stackSize];
+	int stackCount = 0;
+	if (intersectBox(nodes[0], ray.origin, inverseDirection, nearest) < nearest)
+	{
+		stack[stackCount++] = 0;
+	}
+	while (stackCount > 0)
+	{
+		const BvhNode& node = nodes[stack[--stackCount]];
+		if (node.count > 0)
+		{
+			for (uint32_t i = node.leftOrFirst; i < node.leftOrFirst + node.count; ++i)
+			{
+				float distance, u, v;
+				if (intersectTriangle(ray, positions, triangles[i * 3], triangles[i * 3 + 1], triangles[i * 3 + 2], nearest, distance, u, v))
+				{
+					nearest = distance;
+					result.hit = true;
+					result.triangle = triangleIds[i];
+					result.distance = distance;
+					result.u = u;
+					result.v = v;
+				}
+			}
+			continue;
+		}
+
+		// Visit the nearer child first so the far one is often skipped by the shrinking nearest distance
+		uint32_t nearChild = node.leftOrFirst;
+		uint32_t farChild = node.leftOrFirst + 1;
+		float nearEntry = intersectBox(nodes[nearChild], ray.origin, inverseDirection, nearest);
+		float farEntry = intersectBox(nodes[farChild], ray.origin, inverseDirection, nearest);
+		if (farEntry < nearEntry)
+		{
+			std::swap(nearChild, farChild);
+			std::swap(nearEntry, farEntry);
+		}
+		if (farEntry < nearest)
+		{
+			stack[stackCount++] = farChild;
+		}
+		if (nearEntry < nearest)
+		{
+			stack[stackCount++] = nearChild;
+		}
+	}
+	return result;
+}
+
+PickHit TriangleBvh::intersectAll(const PickRay& ray, Vec3Streams positions, std::span<const unsigned int> indices)
+{
+	PickHit result;
+	float nearest = std::numeric_limits<float>::infinity();
+	for (size_t t = 0; t + 2 < indices.size(); t += 3)
+	{
+		float distance, u, v;
+		if (indices[t] < positions.count && indices[t + 1] < positions.count && indices[t + 2] < positions.count
+			&& intersectTriangle(ray, positions, indices[t], indices[t + 1], indices[t + 2], nearest, distance, u, v))
+		{
+			nearest = distance;
+			result.hit = true;
+			result.triangle = uint32_t(t / 3);
+			result.distance = distance;
+			result.u = u;
+			result.v = v;
+		}
+	}
+	return result;
+}
+
+size_t TriangleBvh::memoryBytes() const
+{
+	return nodes.size() * sizeof(BvhNode) + triangleIds.size() * sizeof(uint32_t) + triangles.size() * sizeof(unsigned int);
+}
\ No newline at end of file
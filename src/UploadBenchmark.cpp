@@ -0,0 +1,117 @@
+// Counts heap bytes with AllocationCounter, a plain buffer stands in for the upload heap
+
+#include "UploadBenchmark.h"
+#include "AllocationCounter.h"
+#include "MeshPacker.h"
+#include "Model.h"
+#include <QDebug>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace
+{
+	double megabytes(size_t bytes)
+	{
+		return bytes / (1024.0 * 1024.0);
+	}
+
+	double elapsedMs(std::chrono::steady_clock::time_point start)
+	{
+		return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	// What the viewport's allocator hands the loader, with destination vectors in place of the mapped upload heaps
+	class StandInBuffers : public MeshBuffers
+	{
+	public:
+		StandInBuffers(std::vector<uint8_t>& vertices, std::vector<uint8_t>& indices) : vertices(vertices), indices(indices) {}
+		void* vertexData() override { return vertices.data(); }
+		void* indexData() override { return indices.data(); }
+
+	private:
+		std::vector<uint8_t>& vertices;
+		std::vector<uint8_t>& indices;
+	};
+}
+
+bool runUploadBenchmark(const QString& filePath)
+{
+	Model model;
+	if (!model.loadFromFile(filePath) || model.getIndices().empty())
+	{
+		qCritical() << "Cannot load" << filePath << "for the upload benchmark";
+		return false;
+	}
+	const size_t modelBytes = (model.getVertices().size() + model.getNormals().size()) * 3 * sizeof(float) + model.getIndices().size_bytes();
+	qInfo().nospace() << "Upload benchmark: " << model.getVertices().size() << " vertices, " << model.getIndices().size() / 3
+		<< " triangles, " << megabytes(modelBytes) << " MB of positions, normals and indices in the model";
+
+	bool identical = true;
+	for (bool compact : { false, true })
+	{
+		// Stand-ins for the mapped upload heaps, driver memory that is not part of the process heap in the viewer
+		PackedMesh sizes;
+		if (!MeshPacker::layout(model, compact, sizes))
+		{
+			return false;
+		}
+		std::vector<uint8_t> stagedVertices(sizes.vertexBytes), stagedIndices(sizes.indexBytes);
+		std::vector<uint8_t> directVertices(sizes.vertexBytes), directIndices(sizes.indexBytes);
+		std::vector<uint8_t> allocatedVertices(sizes.vertexBytes), allocatedIndices(sizes.indexBytes);
+		sizes.clear();
+
+		size_t stagedPeak = 0;
+		auto start = std::chrono::steady_clock::now();
+		{
+			// What a load did before: pack into owned vectors, then copy those into the buffers
+			AllocationCounter::Scope scope;
+			PackedMesh mesh;
+			MeshPacker::pack(model, compact, mesh);
+			memcpy(stagedVertices.data(), mesh.vertexData.data(), mesh.vertexBytes);
+			memcpy(stagedIndices.data(), mesh.indexData.data(), mesh.indexBytes);
+			stagedPeak = scope.peakBytes();
+		}
+		const double stagedMs = elapsedMs(start);
+
+		size_t directPeak = 0;
+		start = std::chrono::steady_clock::now();
+		{
+			AllocationCounter::Scope scope;
+			PackedMesh mesh;
+			MeshPacker::layout(model, compact, mesh);
+			MeshPacker::writeVertices(model, mesh, directVertices.data());
+			MeshPacker::writeIndices(model, mesh, directIndices.data());
+			directPeak = scope.peakBytes();
+		}
+		const double directMs = elapsedMs(start);
+
+		size_t allocatedPeak = 0;
+		start = std::chrono::steady_clock::now();
+		{
+			// What ModelLoader does: pack() on the loader thread straight into the buffers the viewport binds
+			AllocationCounter::Scope scope;
+			PackedMesh mesh;
+			MeshPacker::pack(model, compact, mesh, [&allocatedVertices, &allocatedIndices](size_t, size_t)
+			{
+				return std::make_unique<StandInBuffers>(allocatedVertices, allocatedIndices);
+			});
+			allocatedPeak = scope.peakBytes();
+		}
+		const double allocatedMs = elapsedMs(start);
+
+		const bool same = stagedVertices == directVertices && stagedIndices == directIndices
+			&& stagedVertices == allocatedVertices && stagedIndices == allocatedIndices;
+		identical = identical && same;
+		qInfo().nospace() << (compact ? "Compact" : "Full") << " vertices, " << megabytes(stagedVertices.size() + stagedIndices.size())
+			<< " MB of buffers: pack + copy peaks at " << megabytes(stagedPeak) << " MB in " << stagedMs << " ms, layout + write in place at "
+			<< megabytes(directPeak) << " MB in " << directMs << " ms, pack into allocated buffers at " << megabytes(allocatedPeak)
+			<< " MB in " << allocatedMs << " ms" << (same ? "" : ", BYTES DIFFER");
+	}
+	if (!identical)
+	{
+		qCritical() << "Writing in place does not produce the packed bytes";
+	}
+	return identical;
+}
\ No newline at end of file
@@ -0,0 +1,411 @@
+// Scalar, SSE2 and AVX2 encoders and decoders for CompactVertex
+
+#include "VertexQuantizer.h"
+#include <algorithm>
+#include <cmath>
+#include "SimdSupport.h"
+
+namespace
+{
+	constexpr float unormMax = 65535.0f;
+	constexpr float snormMax = 32767.0f;
+
+	// ---- Scalar reference versions, also used for the tails of the SIMD loops ----
+	// The SIMD versions perform the same operations in the same order, so all paths produce identical bits.
+
+	uint16_t quantizeUnorm(float value, float offset, float inverseScale)
+	{
+		const float unit = std::min(std::max((value - offset) * inverseScale, 0.0f), 1.0f);
+		return static_cast<uint16_t>(std::nearbyint(unit * unormMax));
+	}
+
+	// Project onto the octahedron |x| + |y| + |z| = 1 and fold the lower half over the diagonals
+	void encodeOctahedral(float x, float y, float z, int16_t* out)
+	{
+		const float sum = std::fabs(x) + std::fabs(y) + std::fabs(z);
+		const float inverse = sum > 0.0f ? 1.0f / sum : 0.0f;
+		float u = x * inverse;
+		float v = y * inverse;
+		if (z < 0.0f)
+		{
+			const float foldedU = (1.0f - std::fabs(v)) * (u >= 0.0f ? 1.0f : -1.0f);
+			const float foldedV = (1.0f - std::fabs(u)) * (v >= 0.0f ? 1.0f : -1.0f);
+			u = foldedU;
+			v = foldedV;
+		}
+		out[0] = static_cast<int16_t>(std::nearbyint(std::min(std::max(u, -1.0f), 1.0f) * snormMax));
+		out[1] = static_cast<int16_t>(std::nearbyint(std::min(std::max(v, -1.0f), 1.0f) * snormMax));
+	}
+
+	void encodeScalar(Vec3Streams p, Vec3Streams n, const float* offset, const float* inverseScale, CompactVertex* out, size_t begin, size_t end)
+	{
+		for (size_t i = begin; i < end; ++i)
+		{
+			CompactVertex& vertex = out[i];
+			vertex.position[0] = quantizeUnorm(p.x[i], offset[0], inverseScale[0]);
+			vertex.position[1] = quantizeUnorm(p.y[i], offset[1], inverseScale[1]);
+			vertex.position[2] = quantizeUnorm(p.z[i], offset[2], inverseScale[2]);
+			vertex.position[3] = 0;
+			if (i < n.count)
+			{
+				encodeOctahedral(n.x[i], n.y[i], n.z[i], vertex.normal);
+			}
+			else
+			{
+				encodeOctahedral(0.0f, 1.0f, 0.0f, vertex.normal);
+			}
+		}
+	}
+
+	void decodePositionsScalar(const CompactVertex* vertices, const PositionQuantization& q, float* x, float* y, float* z, size_t begin, size_t end)
+	{
+		for (size_t i = begin; i < end; ++i)
+		{
+			x[i] = float(vertices[i].position[0]) / unormMax * q.scale[0] + q.offset[0];
+			y[i] = float(vertices[i].position[1]) / unormMax * q.scale[1] + q.offset[1];
+			z[i] = float(vertices[i].position[2]) / unormMax * q.scale[2] + q.offset[2];
+		}
+	}
+
+	// Inverse of encodeOctahedral, identical to decodeNormal() in vertex.hlsl
+	void decodeNormalsScalar(const CompactVertex* vertices, float* x, float* y, float* z, size_t begin, size_t end)
+	{
+		for (size_t i = begin; i < end; ++i)
+		{
+			float u = std::max(float(vertices[i].normal[0]) / snormMax, -1.0f);
+			float v = std::max(float(vertices[i].normal[1]) / snormMax, -1.0f);
+			const float w = 1.0f - std::fabs(u) - std::fabs(v);
+			const float t = std::max(-w, 0.0f);
+			u += u >= 0.0f ? -t : t;
+			v += v >= 0.0f ? -t : t;
+			const float length = std::sqrt(u * u + v * v + w * w);
+			x[i] = u / length;
+			y[i] = v / length;
+			z[i] = w / length;
+		}
+	}
+
+#if MESH_KERNELS_X86
+	// ---- SSE2, four vertices per iteration. The 12-byte records are written from lane arrays. ----
+
+	__m128 clampSSE2(__m128 value, __m128 low, __m128 high)
+	{
+		return _mm_min_ps(_mm_max_ps(value, low), high);
+	}
+
+	// -1 where value < 0, +1 elsewhere (also for -0.0, matching the scalar comparison)
+	__m128 signNotNegativeSSE2(__m128 value)
+	{
+		const __m128 negative = _mm_cmplt_ps(value, _mm_setzero_ps());
+		return _mm_or_ps(_mm_and_ps(negative, _mm_set1_ps(-1.0f)), _mm_andnot_ps(negative, _mm_set1_ps(1.0f)));
+	}
+
+	__m128 selectSSE2(__m128 mask, __m128 whenTrue, __m128 whenFalse)
+	{
+		return _mm_or_ps(_mm_and_ps(mask, whenTrue), _mm_andnot_ps(mask, whenFalse));
+	}
+
+	void encodeSSE2(Vec3Streams p, Vec3Streams n, const float* offset, const float* inverseScale, CompactVertex* out, size_t count)
+	{
+		const size_t blockEnd = std::min(count, n.count) & ~size_t(3);
+		const __m128 zero = _mm_setzero_ps(), one = _mm_set1_ps(1.0f), minusOne = _mm_set1_ps(-1.0f);
+		const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+		const __m128 unorm = _mm_set1_ps(unormMax), snorm = _mm_set1_ps(snormMax);
+		const __m128 ox = _mm_set1_ps(offset[0]), oy = _mm_set1_ps(offset[1]), oz = _mm_set1_ps(offset[2]);
+		const __m128 sx = _mm_set1_ps(inverseScale[0]), sy = _mm_set1_ps(inverseScale[1]), sz = _mm_set1_ps(inverseScale[2]);
+		alignas(16) int32_t qx[4], qy[4], qz[4], qu[4], qv[4];
+		for (size_t i = 0; i < blockEnd; i += 4)
+		{
+			_mm_store_si128(reinterpret_cast<__m128i*>(qx), _mm_cvtps_epi32(_mm_mul_ps(clampSSE2(_mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(p.x + i), ox), sx), zero, one), unorm)));
+			_mm_store_si128(reinterpret_cast<__m128i*>(qy), _mm_cvtps_epi32(_mm_mul_ps(clampSSE2(_mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(p.y + i), oy), sy), zero, one), unorm)));
+			_mm_store_si128(reinterpret_cast<__m128i*>(qz), _mm_cvtps_epi32(_mm_mul_ps(clampSSE2(_mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(p.z + i), oz), sz), zero, one), unorm)));
+
+			const __m128 nx = _mm_loadu_ps(n.x + i), ny = _mm_loadu_ps(n.y + i), nz = _mm_loadu_ps(n.z + i);
+			const __m128 sum = _mm_add_ps(_mm_add_ps(_mm_and_ps(nx, absMask), _mm_and_ps(ny, absMask)), _mm_and_ps(nz, absMask));
+			const __m128 inverse = _mm_and_ps(_mm_div_ps(one, sum), _mm_cmpgt_ps(sum, zero));
+			__m128 u = _mm_mul_ps(nx, inverse);
+			__m128 v = _mm_mul_ps(ny, inverse);
+			const __m128 foldedU = _mm_mul_ps(_mm_sub_ps(one, _mm_and_ps(v, absMask)), signNotNegativeSSE2(u));
+			const __m128 foldedV = _mm_mul_ps(_mm_sub_ps(one, _mm_and_ps(u, absMask)), signNotNegativeSSE2(v));
+			const __m128 lower = _mm_cmplt_ps(nz, zero);
+			u = selectSSE2(lower, foldedU, u);
+			v = selectSSE2(lower, foldedV, v);
+			_mm_store_si128(reinterpret_cast<__m128i*>(qu), _mm_cvtps_epi32(_mm_mul_ps(clampSSE2(u, minusOne, one), snorm)));
+			_mm_store_si128(reinterpret_cast<__m128i*>(qv), _mm_cvtps_epi32(_mm_mul_ps(clampSSE2(v, minusOne, one), snorm)));
+
+			for (int lane = 0; lane < 4; ++lane)
+			{
+				CompactVertex& vertex = out[i + lane];
+				vertex.position[0] = static_cast<uint16_t>(qx[lane]);
+				vertex.position[1] = static_cast<uint16_t>(qy[lane]);
+				vertex.position[2] = static_cast<uint16_t>(qz[lane]);
+				vertex.position[3] = 0;
+				vertex.normal[0] = static_cast<int16_t>(qu[lane]);
+				vertex.normal[1] = static_cast<int16_t>(qv[lane]);
+			}
+		}
+		encodeScalar(p, n, offset, inverseScale, out, blockEnd, count);
+	}
+
+	void decodePositionsSSE2(const CompactVertex* vertices, size_t count, const PositionQuantization& q, float* x, float* y, float* z)
+	{
+		const size_t blockEnd = count & ~size_t(3);
+		const __m128 unorm = _mm_set1_ps(unormMax);
+		const __m128 ox = _mm_set1_ps(q.offset[0]), oy = _mm_set1_ps(q.offset[1]), oz = _mm_set1_ps(q.offset[2]);
+		const __m128 sx = _mm_set1_ps(q.scale[0]), sy = _mm_set1_ps(q.scale[1]), sz = _mm_set1_ps(q.scale[2]);
+		for (size_t i = 0; i < blockEnd; i += 4)
+		{
+			const CompactVertex* v = vertices + i;
+			const __m128i ix = _mm_setr_epi32(v[0].position[0], v[1].position[0], v[2].position[0], v[3].position[0]);
+			const __m128i iy = _mm_setr_epi32(v[0].position[1], v[1].position[1], v[2].position[1], v[3].position[1]);
+			const __m128i iz = _mm_setr_epi32(v[0].position[2], v[1].position[2], v[2].position[2], v[3].position[2]);
+			_mm_storeu_ps(x + i, _mm_add_ps(_mm_mul_ps(_mm_div_ps(_mm_cvtepi32_ps(ix), unorm), sx), ox));
+			_mm_storeu_ps(y + i, _mm_add_ps(_mm_mul_ps(_mm_div_ps(_mm_cvtepi32_ps(iy), unorm), sy), oy));
+			_mm_storeu_ps(z + i, _mm_add_ps(_mm_mul_ps(_mm_div_ps(_mm_cvtepi32_ps(iz), unorm), sz), oz));
+		}
+		decodePositionsScalar(vertices, q, x, y, z, blockEnd, count);
+	}
+
+	void decodeNormalsSSE2(const CompactVertex* vertices, size_t count, float* x, float* y, float* z)
+	{
+		const size_t blockEnd = count & ~size_t(3);
+		const __m128 zero = _mm_setzero_ps(), one = _mm_set1_ps(1.0f), minusOne = _mm_set1_ps(-1.0f);
+		const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+		const __m128 snorm = _mm_set1_ps(snormMax);
+		for (size_t i = 0; i < blockEnd; i += 4)
+		{
+			const CompactVertex* e = vertices + i;
+			__m128 u = _mm_max_ps(_mm_div_ps(_mm_cvtepi32_ps(_mm_setr_epi32(e[0].normal[0], e[1].normal[0], e[2].normal[0], e[3].normal[0])), snorm), minusOne);
+			__m128 v = _mm_max_ps(_mm_div_ps(_mm_cvtepi32_ps(_mm_setr_epi32(e[0].normal[1], e[1].normal[1], e[2].normal[1], e[3].normal[1])), snorm), minusOne);
+			const __m128 w = _mm_sub_ps(_mm_sub_ps(one, _mm_and_ps(u, absMask)), _mm_and_ps(v, absMask));
+			const __m128 t = _mm_max_ps(_mm_sub_ps(zero, w), zero);
+			u = _mm_add_ps(u, selectSSE2(_mm_cmpge_ps(u, zero), _mm_sub_ps(zero, t), t));
+			v = _mm_add_ps(v, selectSSE2(_mm_cmpge_ps(v, zero), _mm_sub_ps(zero, t), t));
+			const __m128 length = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(u, u), _mm_mul_ps(v, v)), _mm_mul_ps(w, w)));
+			_mm_storeu_ps(x + i, _mm_div_ps(u, length));
+			_mm_storeu_ps(y + i, _mm_div_ps(v, length));
+			_mm_storeu_ps(z + i, _mm_div_ps(w, length));
+		}
+		decodeNormalsScalar(vertices, x, y, z, blockEnd, count);
+	}
+
+	// ---- AVX2, eight vertices per iteration ----
+
+	MESH_KERNELS_AVX2_TARGET
+	__m256 clampAVX2(__m256 value, __m256 low, __m256 high)
+	{
+		return _mm256_min_ps(_mm256_max_ps(value, low), high);
+	}
+
+	MESH_KERNELS_AVX2_TARGET
+	void encodeAVX2(Vec3Streams p, Vec3Streams n, const float* offset, const float* inverseScale, CompactVertex* out, size_t count)
+	{
+		const size_t blockEnd = std::min(count, n.count) & ~size_t(7);
+		const __m256 zero = _mm256_setzero_ps(), one = _mm256_set1_ps(1.0f), minusOne = _mm256_set1_ps(-1.0f);
+		const __m256 absMask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7FFFFFFF));
+		const __m256 unorm = _mm256_set1_ps(unormMax), snorm = _mm256_set1_ps(snormMax);
+		const __m256 ox = _mm256_set1_ps(offset[0]), oy = _mm256_set1_ps(offset[1]), oz = _mm256_set1_ps(offset[2]);
+		const __m256 sx = _mm256_set1_ps(inverseScale[0]), sy = _mm256_set1_ps(inverseScale[1]), sz = _mm256_set1_ps(inverseScale[2]);
+		alignas(32) int32_t qx[8], qy[8], qz[8], qu[8], qv[8];
+		for (size_t i = 0; i < blockEnd; i += 8)
+		{
+			_mm256_store_si256(reinterpret_cast<__m256i*>(qx), _mm256_cvtps_epi32(_mm256_mul_ps(clampAVX2(_mm256_mul_ps(_mm256_sub_ps(_mm256_loadu_ps(p.x + i), ox), sx), zero, one), unorm)));
+			_mm256_store_si256(reinterpret_cast<__m256i*>(qy), _mm256_cvtps_epi32(_mm256_mul_ps(clampAVX2(_mm256_mul_ps(_mm256_sub_ps(_mm256_loadu_ps(p.y + i), oy), sy), zero, one), unorm)));
+			_mm256_store_si256(reinterpret_cast<__m256i*>(qz), _mm256_cvtps_epi32(_mm256_mul_ps(clampAVX2(_mm256_mul_ps(_mm256_sub_ps(_mm256_loadu_ps(p.z + i), oz), sz), zero, one), unorm)));
+
+			const __m256 nx = _mm256_loadu_ps(n.x + i), ny = _mm256_loadu_ps(n.y + i), nz = _mm256_loadu_ps(n.z + i);
+			const __m256 sum = _mm256_add_ps(_mm256_add_ps(_mm256_and_ps(nx, absMask), _mm256_and_ps(ny, absMask)), _mm256_and_ps(nz, absMask));
+			const __m256 inverse = _mm256_and_ps(_mm256_div_ps(one, sum), _mm256_cmp_ps(sum, zero, _CMP_GT_OQ));
+			__m256 u = _mm256_mul_ps(nx, inverse);
+			__m256 v = _mm256_mul_ps(ny, inverse);
+			const __m256 signU = _mm256_blendv_ps(one, minusOne, _mm256_cmp_ps(u, zero, _CMP_LT_OQ));
+			const __m256 signV = _mm256_blendv_ps(one, minusOne, _mm256_cmp_ps(v, zero, _CMP_LT_OQ));
+			const __m256 foldedU = _mm256_mul_ps(_mm256_sub_ps(one, _mm256_and_ps(v, absMask)), signU);
+			const __m256 foldedV = _mm256_mul_ps(_mm256_sub_ps(one, _mm256_and_ps(u, absMask)), signV);
+			const __m256 lower = _mm256_cmp_ps(nz, zero, _CMP_LT_OQ);
+			u = _mm256_blendv_ps(u, foldedU, lower);
+			v = _mm256_blendv_ps(v, foldedV, lower);
+			_mm256_store_si256(reinterpret_cast<__m256i*>(qu), _mm256_cvtps_epi32(_mm256_mul_ps(clampAVX2(u, minusOne, one), snorm)));
+			_mm256_store_si256(reinterpret_cast<__m256i*>(qv), _mm256_cvtps_epi32(_mm256_mul_ps(clampAVX2(v, minusOne, one), snorm)));
+
+			for (int lane = 0; lane < 8; ++lane)
+			{
+				CompactVertex& vertex = out[i + lane];
+				vertex.position[0] = static_cast<uint16_t>(qx[lane]);
+				vertex.position[1] = static_cast<uint16_t>(qy[lane]);
+				vertex.position[2] = static_cast<uint16_t>(qz[lane]);
+				vertex.position[3] = 0;
+				vertex.normal[0] = static_cast<int16_t>(qu[lane]);
+				vertex.normal[1] = static_cast<int16_t>(qv[lane]);
+			}
+		}
+		encodeScalar(p, n, offset, inverseScale, out, blockEnd, count);
+	}
+
+	MESH_KERNELS_AVX2_TARGET
+	void decodePositionsAVX2(const CompactVertex* vertices, size_t count, const PositionQuantization& q, float* x, float* y, float* z)
+	{
+		const size_t blockEnd = count & ~size_t(7);
+		const __m256 unorm = _mm256_set1_ps(unormMax);
+		const __m256 ox = _mm256_set1_ps(q.offset[0]), oy = _mm256_set1_ps(q.offset[1]), oz = _mm256_set1_ps(q.offset[2]);
+		const __m256 sx = _mm256_set1_ps(q.scale[0]), sy = _mm256_set1_ps(q.scale[1]), sz = _mm256_set1_ps(q.scale[2]);
+		// Each record is three 32-bit words, gather word 0 (x, y) and word 1 (z, w) and split the halves
+		const __m256i wordOffsets = _mm256_setr_epi32(0, 3, 6, 9, 12, 15, 18, 21);
+		const __m256i lowHalf = _mm256_set1_epi32(0xFFFF);
+		for (size_t i = 0; i < blockEnd; i += 8)
+		{
+			const int* words = reinterpret_cast<const int*>(vertices + i);
+			const __m256i xy = _mm256_i32gather_epi32(words, wordOffsets, 4);
+			const __m256i zw = _mm256_i32gather_epi32(words + 1, wordOffsets, 4);
+			const __m256 fx = _mm256_cvtepi32_ps(_mm256_and_si256(xy, lowHalf));
+			const __m256 fy = _mm256_cvtepi32_ps(_mm256_srli_epi32(xy, 16));
+			const __m256 fz = _mm256_cvtepi32_ps(_mm256_and_si256(zw, lowHalf));
+			_mm256_storeu_ps(x + i, _mm256_add_ps(_mm256_mul_ps(_mm256_div_ps(fx, unorm), sx), ox));
+			_mm256_storeu_ps(y + i, _mm256_add_ps(_mm256_mul_ps(_mm256_div_ps(fy, unorm), sy), oy));
+			_mm256_storeu_ps(z + i, _mm256_add_ps(_mm256_mul_ps(_mm256_div_ps(fz, unorm), sz), oz));
+		}
+		decodePositionsScalar(vertices, q, x, y, z, blockEnd, count);
+	}
+
+	MESH_KERNELS_AVX2_TARGET
+	void decodeNormalsAVX2(const CompactVertex* vertices, size_t count, float* x, float* y, float* z)
+	{
+		const size_t blockEnd = count & ~size_t(7);
+		const __m256 zero = _mm256_setzero_ps(), one = _mm256_set1_ps(1.0f), minusOne = _mm256_set1_ps(-1.0f);
+		const __m256 absMask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7FFFFFFF));
+		const __m256 snorm = _mm256_set1_ps(snormMax);
+		const __m256i wordOffsets = _mm256_setr_epi32(0, 3, 6, 9, 12, 15, 18, 21);
+		for (size_t i = 0; i < blockEnd; i += 8)
+		{
+			// Word 2 of each record holds the two signed normal components
+			const __m256i packed = _mm256_i32gather_epi32(reinterpret_cast<const int*>(vertices + i) + 2, wordOffsets, 4);
+			const __m256i iu = _mm256_srai_epi32(_mm256_slli_epi32(packed, 16), 16);
+			const __m256i iv = _mm256_srai_epi32(packed, 16);
+			__m256 u = _mm256_max_ps(_mm256_div_ps(_mm256_cvtepi32_ps(iu), snorm), minusOne);
+			__m256 v = _mm256_max_ps(_mm256_div_ps(_mm256_cvtepi32_ps(iv), snorm), minusOne);
+			const __m256 w = _mm256_sub_ps(_mm256_sub_ps(one, _mm256_and_ps(u, absMask)), _mm256_and_ps(v, absMask));
+			const __m256 t = _mm256_max_ps(_mm256_sub_ps(zero, w), zero);
+			const __m256 minusT = _mm256_sub_ps(zero, t);
+			u = _mm256_add_ps(u, _mm256_blendv_ps(t, minusT, _mm256_cmp_ps(u, zero, _CMP_GE_OQ)));
+			v = _mm256_add_ps(v, _mm256_blendv_ps(t, minusT, _mm256_cmp_ps(v, zero, _CMP_GE_OQ)));
+			const __m256 length = _mm256_sqrt_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(u, u), _mm256_mul_ps(v, v)), _mm256_mul_ps(w, w)));
+			_mm256_storeu_ps(x + i, _mm256_div_ps(u, length));
+			_mm256_storeu_ps(y + i, _mm256_div_ps(v, length));
+			_mm256_storeu_ps(z + i, _mm256_div_ps(w, length));
+		}
+		decodeNormalsScalar(vertices, x, y, z, blockEnd, count);
+	}
+#endif
+}
+
+PositionQuantization VertexQuantizer::positionQuantization(const MeshBounds& bounds)
+{
+	PositionQuantization quantization;
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		quantization.offset[axis] = bounds.min[axis];
+		quantization.scale[axis] = std::max(bounds.max[axis] - bounds.min[axis], 0.0f);
+	}
+	return quantization;
+}
+
+void VertexQuantizer::encode(Vec3Streams positions, Vec3Streams normals, const PositionQuantization& quantization, CompactVertex* out)
+{
+	float inverseScale[3];
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		// A flat axis encodes as 0 and decodes back to the offset
+		inverseScale[axis] = quantization.scale[axis] > 0.0f ? 1.0f / quantization.scale[axis] : 0.0f;
+	}
+
+#if MESH_KERNELS_X86
+	switch (MeshKernels::activeIsa())
+	{
+	case MeshKernels::Isa::AVX2:
+		encodeAVX2(positions, normals, quantization.offset, inverseScale, out, positions.count);
+		return;
+	case MeshKernels::Isa::SSE2:
+		encodeSSE2(positions, normals, quantization.offset, inverseScale, out, positions.count);
+		return;
+	default:
+		break;
+	}
+#endif
+	encodeScalar(positions, normals, quantization.offset, inverseScale, out, 0, positions.count);
+}
+
+void VertexQuantizer::decodePositions(const CompactVertex* vertices, size_t count, const PositionQuantization& quantization, float* x, float* y, float* z)
+{
+#if MESH_KERNELS_X86
+	switch (MeshKernels::activeIsa())
+	{
+	case MeshKernels::Isa::AVX2:
+		if (count <= size_t(INT32_MAX) / 3) // Gathers take signed 32-bit word offsets
+		{
+			decodePositionsAVX2(vertices, count, quantization, x, y, z);
+			return;
+		}
+		[[fallthrough]];
+	case MeshKernels::Isa::SSE2:
+		decodePositionsSSE2(vertices, count, quantization, x, y, z);
+		return;
+	default:
+		break;
+	}
+#endif
+	decodePositionsScalar(vertices, quantization, x, y, z, 0, count);
+}
+
+void VertexQuantizer::decodeNormals(const CompactVertex* vertices, size_t count, float* x, float* y, float* z)
+{
+#if MESH_KERNELS_X86
+	switch (MeshKernels::activeIsa())
+	{
+	case MeshKernels::Isa::AVX2:
+		if (count <= size_t(INT32_MAX) / 3)
+		{
+			decodeNormalsAVX2(vertices, count, x, y, z);
+			return;
+		}
+		[[fallthrough]];
+	case MeshKernels::Isa::SSE2:
+		decodeNormalsSSE2(vertices, count, x, y, z);
+		return;
+	default:
+		break;
+	}
+#endif
+	decodeNormalsScalar(vertices, x, y, z, 0, count);
+}
+
+QuantizationError VertexQuantizer::measureError(Vec3Streams positions, Vec3Streams normals, const CompactVertex* vertices, const PositionQuantization& quantization)
+{
+	QuantizationError error;
+	const size_t count = positions.count;
+	Vec3Array decoded;
+	decoded.resize(count);
+
+	decodePositions(vertices, count, quantization, decoded.x.data(), decoded.y.data(), decoded.z.data());
+	float maxDistanceSquared = 0.0f;
+	for (size_t i = 0; i < count; ++i)
+	{
+		const float dx = decoded.x[i] - positions.x[i], dy = decoded.y[i] - positions.y[i], dz = decoded.z[i] - positions.z[i];
+		maxDistanceSquared = std::max(maxDistanceSquared, dx * dx + dy * dy + dz * dz);
+	}
+	error.maxPositionError = std::sqrt(maxDistanceSquared);
+
+	// Compare directions only, zero-length source normals have none to lose
+	decodeNormals(vertices, count, decoded.x.data(), decoded.y.data(), decoded.z.data());
+	float minCosine = 1.0f;
+	for (size_t i = 0; i < count && i < normals.count; ++i)
+	{
+		const float length = std::sqrt(normals.x[i] * normals.x[i] + normals.y[i] * normals.y[i] + normals.z[i] * normals.z[i]);
+		if (length > 0.0f)
+		{
+			const float cosine = (normals.x[i] * decoded.x[i] + normals.y[i] * decoded.y[i] + normals.z[i] * decoded.z[i]) / length;
+			minCosine = std::min(minCosine, cosine);
+		}
+	}
+	error.maxNormalErrorDegrees = float(std::acos(std::min(std::max(double(minCosine), -1.0), 1.0)) * 180.0 / 3.14159265358979323846);
+	return error;
+}
\ No newline at end of file
@@ -0,0 +1,645 @@
+// Open-addressing (linear probing) hashes over index tuples and position keys, 16-byte slots so four share a cache line
+
+#include "VertexWelder.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include "Parallel.h"
+
+namespace
+{
+	constexpr unsigned int emptySlot = 0xFFFFFFFF;
+
+	struct Slot
+	{
+		VertexTuple key;
+		unsigned int vertex; // emptySlot while unused
+	};
+	static_assert(sizeof(Slot) == 16, "Slots should pack four to a cache line");
+
+	inline size_t hashTuple(const VertexTuple& tuple)
+	{
+		unsigned int h = tuple.position * 0x9E3779B1u;
+		h ^= tuple.texcoord * 0x85EBCA77u;
+		h ^= tuple.normal * 0xC2B2AE3Du;
+		h ^= h >> 15;
+		h *= 0x2C1B3C6Du;
+		h ^= h >> 12;
+		return h;
+	}
+
+	inline bool sameTuple(const VertexTuple& a, const VertexTuple& b)
+	{
+		return a.position == b.position && a.texcoord == b.texcoord && a.normal == b.normal;
+	}
+
+	class TupleTable
+	{
+	public:
+		explicit TupleTable(size_t expected)
+		{
+			allocate(std::max<size_t>(16, expected * 2)); // Start at or below half full
+		}
+
+		// Welded vertex of tuple, the next free vertex id when it has not been seen yet
+		unsigned int findOrInsert(const VertexTuple& tuple, unsigned int nextVertex, bool& inserted)
+		{
+			if ((used + 1) * 10 > slots.size() * 7)
+			{
+				allocate(slots.size() * 2);
+			}
+			size_t index = hashTuple(tuple) & mask;
+			while (true)
+			{
+				Slot& slot = slots[index];
+				if (slot.vertex == emptySlot)
+				{
+					slot.key = tuple;
+					slot.vertex = nextVertex;
+					++used;
+					inserted = true;
+					return nextVertex;
+				}
+				if (sameTuple(slot.key, tuple))
+				{
+					inserted = false;
+					return slot.vertex;
+				}
+				index = (index + 1) & mask;
+			}
+		}
+
+	private:
+		// Resize to the next power of two >= capacity and re-insert what is already there
+		void allocate(size_t capacity)
+		{
+			size_t size = 16;
+			while (size < capacity) size *= 2;
+
+			std::vector<Slot> old(size, Slot{ {}, emptySlot });
+			old.swap(slots);
+			mask = size - 1;
+			for (const Slot& slot : old)
+			{
+				if (slot.vertex != emptySlot)
+				{
+					size_t index = hashTuple(slot.key) & mask;
+					while (slots[index].vertex != emptySlot) index = (index + 1) & mask;
+					slots[index] = slot;
+				}
+			}
+		}
+
+		std::vector<Slot> slots;
+		size_t mask = 0;
+		size_t used = 0;
+	};
+
+	constexpr size_t minCornersPerThread = 1 << 16;
+
+	// Float bits of a position, equal exactly when two positions weld without an epsilon
+	struct PositionKey
+	{
+		unsigned int x;
+		unsigned int y;
+		unsigned int z;
+
+		bool operator==(const PositionKey& other) const { return x == other.x && y == other.y && z == other.z; }
+	};
+
+	struct PositionSlot
+	{
+		PositionKey key;
+		unsigned int corner; // emptySlot while unused
+	};
+	static_assert(sizeof(PositionSlot) == 16, "Slots should pack four to a cache line");
+
+	class PositionKeys
+	{
+	public:
+		explicit PositionKeys(Vec3Streams corners) : corners(corners) {}
+
+		PositionKey operator()(size_t corner) const
+		{
+			return { component(corners.x[corner]), component(corners.y[corner]), component(corners.z[corner]) };
+		}
+		// Top bits pick the partition, low bits the slot in the partition's table
+		static uint64_t hash(const PositionKey& key)
+		{
+			uint64_t h = (static_cast<uint64_t>(key.x) << 32 | key.y) * 0x9E3779B97F4A7C15ull;
+			h ^= (h >> 29) + key.z * 0xC2B2AE3D27D4EB4Full;
+			h *= 0x94D049BB133111EBull;
+			return h ^ (h >> 31);
+		}
+
+	private:
+		static unsigned int component(float value)
+		{
+			unsigned int bits;
+			value = value == 0.0f ? 0.0f : value; // -0 to +0
+			std::memcpy(&bits, &value, sizeof(bits));
+			return bits;
+		}
+
+		Vec3Streams corners;
+	};
+
+	// Corner c of the range [0, cornerCount) thread t of threads walks
+	size_t rangeBegin(size_t cornerCount, size_t threads, size_t thread)
+	{
+		return cornerCount * thread / threads;
+	}
+
+	// Count and scatter corners by partition, each thread's range lands in order so a partition lists its corners
+	// ascending. Partition p's corners end up in order[partitionStarts[p], partitionStarts[p + 1]).
+	template <typename PartitionOf>
+	void scatterByPartition(size_t cornerCount, size_t threads, size_t partitions, const PartitionOf& partitionOf,
+		std::vector<unsigned int>& order, std::vector<size_t>& partitionStarts)
+	{
+		std::vector<size_t> offsets(threads * partitions, 0);
+		Parallel::run(threads, [&](size_t t)
+		{
+			size_t* counts = &offsets[t * partitions];
+			for (size_t c = rangeBegin(cornerCount, threads, t); c < rangeBegin(cornerCount, threads, t + 1); ++c)
+			{
+				++counts[partitionOf(c)];
+			}
+		});
+		partitionStarts.assign(partitions + 1, 0);
+		size_t total = 0;
+		for (size_t p = 0; p < partitions; ++p)
+		{
+			partitionStarts[p] = total;
+			for (size_t t = 0; t < threads; ++t)
+			{
+				const size_t count = offsets[t * partitions + p];
+				offsets[t * partitions + p] = total;
+				total += count;
+			}
+		}
+		partitionStarts[partitions] = total;
+		order.resize(cornerCount);
+		Parallel::run(threads, [&](size_t t)
+		{
+			size_t* next = &offsets[t * partitions];
+			for (size_t c = rangeBegin(cornerCount, threads, t); c < rangeBegin(cornerCount, threads, t + 1); ++c)
+			{
+				order[next[partitionOf(c)]++] = static_cast<unsigned int>(c);
+			}
+		});
+	}
+
+	// Enough partitions to balance uneven ones, none on one thread
+	unsigned int partitionBitsFor(size_t threads)
+	{
+		unsigned int bits = 0;
+		while (threads > 1 && (size_t(1) << bits) < threads * 8) ++bits;
+		return bits;
+	}
+
+	// Cell edge over epsilon. A corner more than epsilon from every side of its cell is searched for in that cell alone,
+	// larger cells make that likelier but hold more corners to test.
+	constexpr double cellEpsilons = 4.0;
+
+	// Every corner filed under its cell of a grid with cellEpsilons * epsilon spacing, the cells spread over hash partitions with
+	// a table each. Read-only once built, any number of threads can search it.
+	class CornerGrid
+	{
+	public:
+		CornerGrid(Vec3Streams corners, float epsilon, size_t threads)
+			: corners(corners), inverse(1.0 / (cellEpsilons * epsilon)), epsilonSquared(double(epsilon) * epsilon), partitionBits(partitionBitsFor(threads))
+		{
+			const size_t partitions = size_t(1) << partitionBits;
+			std::vector<size_t> partitionStarts;
+			scatterByPartition(corners.size(), threads, partitions, [this](size_t c) { return partitionOf(hashOf(cellOf(c))); }, cellCorners, partitionStarts);
+
+			// Per partition, count the corners of each cell, turn the counts into where each cell's corners go and put
+			// them there, still ascending
+			tables.resize(partitions);
+			std::atomic<size_t> nextPartition{ 0 };
+			Parallel::run(threads, [&](size_t)
+			{
+				std::vector<unsigned int> partitionCorners;
+				for (size_t p = nextPartition++; p < partitions; p = nextPartition++)
+				{
+					const size_t first = partitionStarts[p];
+					const size_t last = partitionStarts[p + 1];
+					Table& table = tables[p];
+					resize(table, 16);
+					size_t cells = 0;
+					for (size_t i = first; i < last; ++i)
+					{
+						if ((cells + 1) * 2 > table.slots.size())
+						{
+							resize(table, table.slots.size() * 2);
+						}
+						const Cell cell = cellOf(cellCorners[i]);
+						CellRange& range = table.slots[slotOf(table, cell, hashOf(cell))];
+						if (range.begin == emptySlot)
+						{
+							range = { cell, 0, 0 };
+							++cells;
+						}
+						++range.end;
+					}
+					unsigned int offset = static_cast<unsigned int>(first);
+					for (CellRange& range : table.slots)
+					{
+						if (range.begin != emptySlot)
+						{
+							range.begin = offset;
+							offset += range.end;
+							range.end = range.begin;
+						}
+					}
+					partitionCorners.assign(cellCorners.begin() + first, cellCorners.begin() + last);
+					for (unsigned int corner : partitionCorners)
+					{
+						const Cell cell = cellOf(corner);
+						cellCorners[table.slots[slotOf(table, cell, hashOf(cell))].end++] = corner;
+					}
+				}
+			});
+		}
+
+		// Call visit(other) for the corners before corner within epsilon of it until visit returns false, ascending
+		// within each cell. Along each axis such a corner is in corner's cell, or in the neighbour on a side corner is
+		// within epsilon of, so one to eight cells are searched.
+		template <typename Visit>
+		void forEachEarlier(size_t corner, const Visit& visit) const
+		{
+			const Cell center = cellOf(corner);
+			const int sideX = side(corners.x[corner], center.x);
+			const int sideY = side(corners.y[corner], center.y);
+			const int sideZ = side(corners.z[corner], center.z);
+			for (int n = 0; n < 8; ++n)
+			{
+				if ((n & 1 && sideX == 0) || (n & 2 && sideY == 0) || (n & 4 && sideZ == 0))
+				{
+					continue;
+				}
+				const Cell cell = { center.x + (n & 1 ? sideX : 0), center.y + (n & 2 ? sideY : 0), center.z + (n & 4 ? sideZ : 0) };
+				const uint64_t hash = hashOf(cell);
+				const Table& table = tables[partitionOf(hash)];
+				const CellRange& range = table.slots[slotOf(table, cell, hash)];
+				if (range.begin == emptySlot)
+				{
+					continue;
+				}
+				for (unsigned int i = range.begin; i < range.end && cellCorners[i] < corner; ++i)
+				{
+					if (withinEpsilon(corner, cellCorners[i]) && !visit(cellCorners[i]))
+					{
+						return;
+					}
+				}
+			}
+		}
+
+	private:
+		struct Cell
+		{
+			int x;
+			int y;
+			int z;
+
+			bool operator==(const Cell& other) const { return x == other.x && y == other.y && z == other.z; }
+		};
+
+		struct CellRange
+		{
+			Cell cell;
+			unsigned int begin; // Into cellCorners, emptySlot while unused
+			unsigned int end;
+		};
+
+		struct Table
+		{
+			std::vector<CellRange> slots; // Power-of-two size, at most half full
+			size_t mask = 0;
+		};
+
+		// Power-of-two size, the cells already there are filed again
+		static void resize(Table& table, size_t size)
+		{
+			std::vector<CellRange> old(size, CellRange{ {}, emptySlot, 0 });
+			old.swap(table.slots);
+			table.mask = size - 1;
+			for (const CellRange& range : old)
+			{
+				if (range.begin != emptySlot)
+				{
+					table.slots[slotOf(table, range.cell, hashOf(range.cell))] = range;
+				}
+			}
+		}
+
+		static int component(double scaled)
+		{
+			// NaN lands in cell 0, its distance test never passes
+			return static_cast<int>(std::clamp(scaled == scaled ? std::floor(scaled) : 0.0, -2147483647.0, 2147483646.0));
+		}
+
+		static uint64_t hashOf(const Cell& cell)
+		{
+			return PositionKeys::hash({ static_cast<unsigned int>(cell.x), static_cast<unsigned int>(cell.y), static_cast<unsigned int>(cell.z) });
+		}
+
+		// Top bits pick the partition, low bits the slot in its table
+		size_t partitionOf(uint64_t hash) const
+		{
+			return partitionBits > 0 ? static_cast<size_t>(hash >> (64 - partitionBits)) : 0;
+		}
+
+		// Slot of cell, the empty slot it would go in when it has no corner
+		static size_t slotOf(const Table& table, const Cell& cell, uint64_t hash)
+		{
+			size_t index = hash & table.mask;
+			while (table.slots[index].begin != emptySlot && !(table.slots[index].cell == cell)) index = (index + 1) & table.mask;
+			return index;
+		}
+
+		// -1 near the lower side of the cell, 1 near the upper one, 0 in between. Near takes in a little more than
+		// epsilon, so rounding never leaves out a neighbour.
+		int side(float value, int cell) const
+		{
+			const double offset = value * inverse - cell;
+			return offset < reach ? -1 : offset > 1.0 - reach ? 1 : 0;
+		}
+
+		Cell cellOf(size_t corner) const
+		{
+			return { component(corners.x[corner] * inverse), component(corners.y[corner] * inverse), component(corners.z[corner] * inverse) };
+		}
+
+		bool withinEpsilon(size_t a, size_t b) const
+		{
+			const double dx = double(corners.x[a]) - corners.x[b];
+			const double dy = double(corners.y[a]) - corners.y[b];
+			const double dz = double(corners.z[a]) - corners.z[b];
+			return dx * dx + dy * dy + dz * dz <= epsilonSquared;
+		}
+
+		Vec3Streams corners;
+		double inverse; // Cells per unit
+		static constexpr double reach = 1.0 / cellEpsilons + 1.0e-3; // Epsilon in cells
+		double epsilonSquared;
+		unsigned int partitionBits;
+		std::vector<Table> tables; // Per partition
+		std::vector<unsigned int> cellCorners; // Grouped by partition, then by cell, ascending within a cell
+	};
+
+	enum CornerState : unsigned char
+	{
+		Undecided,
+		StartsVertex,
+		JoinsVertex
+	};
+	constexpr int maxParallelRounds = 16;
+
+	// The greedy weld in corner order, where each corner joins the lowest earlier vertex within epsilon or starts a new
+	// one, without going through the corners in order. A corner starts a vertex exactly when no earlier corner within
+	// epsilon does, and joins the lowest that does, so corners are settled in rounds over the undecided ones in
+	// parallel: a corner with no earlier corner within epsilon left undecided starts a vertex or joins the lowest one
+	// that starts one, and so does a corner whose undecided ones all come after a corner that starts a vertex. States
+	// only ever leave Undecided for their final value, a state read before another thread's store merely defers a corner
+	// to the next round, so the result is that of the sequential greedy weld on any thread count. firstOfCorner receives
+	// the corner that starts each corner's vertex.
+	void weldWithinEpsilon(Vec3Streams corners, float epsilon, size_t threads, std::vector<unsigned int>& firstOfCorner)
+	{
+		const size_t cornerCount = corners.size();
+		const CornerGrid grid(corners, epsilon, threads);
+		std::vector<std::atomic<unsigned char>> states(cornerCount); // Undecided
+		firstOfCorner.resize(cornerCount);
+		// True once corner is settled
+		auto settle = [&grid, &states, &firstOfCorner](unsigned int corner)
+		{
+			unsigned int first = emptySlot; // Lowest earlier corner within epsilon that starts a vertex
+			unsigned int undecided = emptySlot; // Lowest that is not settled yet
+			grid.forEachEarlier(corner, [&states, &first, &undecided](unsigned int other)
+			{
+				const unsigned char state = states[other].load(std::memory_order_relaxed);
+				if (state == StartsVertex)
+				{
+					first = std::min(first, other);
+				}
+				else if (state == Undecided)
+				{
+					undecided = std::min(undecided, other);
+				}
+				return true;
+			});
+			if (undecided < first)
+			{
+				return false;
+			}
+			firstOfCorner[corner] = first == emptySlot ? corner : first;
+			states[corner].store(first == emptySlot ? StartsVertex : JoinsVertex, std::memory_order_relaxed);
+			return true;
+		};
+
+		// A round settles at least the lowest undecided corner, and on one thread all of them
+		std::vector<unsigned int> undecided(cornerCount);
+		for (size_t c = 0; c < cornerCount; ++c)
+		{
+			undecided[c] = static_cast<unsigned int>(c);
+		}
+		std::vector<std::vector<unsigned int>> deferred(threads);
+		for (int round = 0; round < maxParallelRounds && !undecided.empty(); ++round)
+		{
+			Parallel::run(threads, [&](size_t t)
+			{
+				deferred[t].clear();
+				for (size_t i = rangeBegin(undecided.size(), threads, t); i < rangeBegin(undecided.size(), threads, t + 1); ++i)
+				{
+					if (!settle(undecided[i]))
+					{
+						deferred[t].push_back(undecided[i]);
+					}
+				}
+			});
+			undecided.clear();
+			for (const std::vector<unsigned int>& kept : deferred)
+			{
+				undecided.insert(undecided.end(), kept.begin(), kept.end());
+			}
+		}
+		// Long runs of corners each within epsilon of the next settle a few links per round, the rest goes in corner
+		// order, where every earlier corner is settled by the time a corner is reached
+		for (unsigned int corner : undecided)
+		{
+			settle(corner);
+		}
+	}
+
+	// Bit-identical positions (-0 equals 0) welded over hash partitions, each with its own table. firstOfCorner receives
+	// the lowest corner at each corner's position, order is scratch.
+	void weldExact(Vec3Streams corners, size_t threads, std::vector<unsigned int>& order, std::vector<unsigned int>& firstOfCorner)
+	{
+		const size_t cornerCount = corners.size();
+		const PositionKeys keys(corners);
+		const unsigned int partitionBits = partitionBitsFor(threads);
+		const size_t partitions = size_t(1) << partitionBits;
+		auto partitionOf = [partitionBits](uint64_t hash) { return partitionBits > 0 ? static_cast<size_t>(hash >> (64 - partitionBits)) : 0; };
+		std::vector<size_t> partitionStarts;
+		scatterByPartition(cornerCount, threads, partitions, [&](size_t c) { return partitionOf(PositionKeys::hash(keys(c))); }, order, partitionStarts);
+
+		// Weld each partition with its own table. The first corner seen for a key is the lowest, it becomes the vertex.
+		firstOfCorner.resize(cornerCount);
+		std::atomic<size_t> nextPartition{ 0 };
+		Parallel::run(threads, [&](size_t)
+		{
+			std::vector<PositionSlot> slots;
+			for (size_t p = nextPartition++; p < partitions; p = nextPartition++)
+			{
+				const size_t count = partitionStarts[p + 1] - partitionStarts[p];
+				size_t size = 16;
+				while (size < count * 2) size *= 2; // At most half full
+				slots.assign(size, PositionSlot{ {}, emptySlot });
+				const size_t mask = size - 1;
+				for (size_t i = partitionStarts[p]; i < partitionStarts[p + 1]; ++i)
+				{
+					const unsigned int corner = order[i];
+					const PositionKey key = keys(corner);
+					size_t index = PositionKeys::hash(key) & mask;
+					while (slots[index].corner != emptySlot && !(slots[index].key == key)) index = (index + 1) & mask;
+					if (slots[index].corner == emptySlot)
+					{
+						slots[index] = { key, corner };
+					}
+					firstOfCorner[corner] = slots[index].corner;
+				}
+			}
+		});
+	}
+
+	// Number the corners that are their own first corner, in corner order, and point every corner at its first's number.
+	// vertexOfFirst is scratch.
+	void numberVertices(const std::vector<unsigned int>& firstOfCorner, size_t threads, std::vector<unsigned int>& vertexOfFirst,
+		std::vector<unsigned int>& indices, std::vector<unsigned int>& firstCorners)
+	{
+		const size_t cornerCount = firstOfCorner.size();
+		std::vector<size_t> vertexStarts(threads + 1, 0);
+		Parallel::run(threads, [&](size_t t)
+		{
+			size_t count = 0;
+			for (size_t c = rangeBegin(cornerCount, threads, t); c < rangeBegin(cornerCount, threads, t + 1); ++c)
+			{
+				count += firstOfCorner[c] == c ? 1 : 0;
+			}
+			vertexStarts[t + 1] = count;
+		});
+		for (size_t t = 0; t < threads; ++t)
+		{
+			vertexStarts[t + 1] += vertexStarts[t];
+		}
+		firstCorners.resize(vertexStarts[threads]);
+		vertexOfFirst.resize(cornerCount);
+		Parallel::run(threads, [&](size_t t)
+		{
+			size_t vertex = vertexStarts[t];
+			for (size_t c = rangeBegin(cornerCount, threads, t); c < rangeBegin(cornerCount, threads, t + 1); ++c)
+			{
+				if (firstOfCorner[c] == c)
+				{
+					vertexOfFirst[c] = static_cast<unsigned int>(vertex);
+					firstCorners[vertex++] = static_cast<unsigned int>(c);
+				}
+			}
+		});
+		indices.resize(cornerCount);
+		Parallel::run(threads, [&](size_t t)
+		{
+			for (size_t c = rangeBegin(cornerCount, threads, t); c < rangeBegin(cornerCount, threads, t + 1); ++c)
+			{
+				indices[c] = vertexOfFirst[firstOfCorner[c]];
+			}
+		});
+	}
+}
+
+size_t VertexWelder::estimateVertexCount(size_t positionCount, size_t texcoordCount, size_t normalCount, size_t cornerCount)
+{
+	// Typical meshes need about one vertex per record of the largest attribute plus seams
+	const size_t largest = std::max({ positionCount, texcoordCount, normalCount });
+	return std::min(cornerCount, largest + largest / 4);
+}
+
+WeldStats VertexWelder::weld(const unsigned int* positionIndices, const unsigned int* texcoordIndices, const unsigned int* normalIndices,
+	size_t cornerCount, size_t expectedVertexCount, std::vector<unsigned int>& indices, std::vector<VertexTuple>& tuples)
+{
+	auto start = std::chrono::steady_clock::now();
+
+	indices.resize(cornerCount);
+	tuples.clear();
+	tuples.reserve(expectedVertexCount);
+	TupleTable table(expectedVertexCount);
+	for (size_t i = 0; i < cornerCount; ++i)
+	{
+		const VertexTuple tuple = { positionIndices[i], texcoordIndices[i], normalIndices[i] };
+		bool inserted = false;
+		indices[i] = table.findOrInsert(tuple, static_cast<unsigned int>(tuples.size()), inserted);
+		if (inserted)
+		{
+			tuples.push_back(tuple);
+		}
+	}
+
+	WeldStats stats;
+	stats.cornerCount = cornerCount;
+	stats.vertexCount = tuples.size();
+	stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	return stats;
+}
+
+WeldStats VertexWelder::weldPositions(Vec3Streams corners, float epsilon, unsigned int threadCount, std::vector<unsigned int>& indices,
+	std::vector<unsigned int>& firstCorners)
+{
+	auto start = std::chrono::steady_clock::now();
+
+	const size_t cornerCount = corners.size();
+	const size_t threads = std::min<size_t>(Parallel::resolveThreadCount(threadCount), std::max<size_t>(cornerCount / minCornersPerThread, 1));
+	std::vector<unsigned int> firstOfCorner;
+	std::vector<unsigned int> order;
+	weldExact(corners, threads, order, firstOfCorner);
+	if (epsilon > 0.0f)
+	{
+		// Corners at one position all take the vertex of the first of them in the greedy weld, so only the distinct
+		// positions, in the order of their first corners, go through it. Positions that are not finite are never within
+		// epsilon of anything, every corner at one stays its own vertex as before.
+		std::vector<unsigned int> distinctOfCorner;
+		std::vector<unsigned int> distinctFirsts;
+		numberVertices(firstOfCorner, threads, order, distinctOfCorner, distinctFirsts);
+		Vec3Array distinct;
+		distinct.resize(distinctFirsts.size());
+		Parallel::run(threads, [&](size_t t)
+		{
+			for (size_t d = rangeBegin(distinctFirsts.size(), threads, t); d < rangeBegin(distinctFirsts.size(), threads, t + 1); ++d)
+			{
+				distinct.x[d] = corners.x[distinctFirsts[d]];
+				distinct.y[d] = corners.y[distinctFirsts[d]];
+				distinct.z[d] = corners.z[distinctFirsts[d]];
+			}
+		});
+		std::vector<unsigned int> firstOfDistinct;
+		weldWithinEpsilon(distinct.view(), epsilon, threads, firstOfDistinct);
+		Parallel::run(threads, [&](size_t t)
+		{
+			for (size_t c = rangeBegin(cornerCount, threads, t); c < rangeBegin(cornerCount, threads, t + 1); ++c)
+			{
+				const bool finite = std::isfinite(corners.x[c]) && std::isfinite(corners.y[c]) && std::isfinite(corners.z[c]);
+				firstOfCorner[c] = finite ? distinctFirsts[firstOfDistinct[distinctOfCorner[c]]] : static_cast<unsigned int>(c);
+			}
+		});
+	}
+	numberVertices(firstOfCorner, threads, order, indices, firstCorners);
+
+	WeldStats stats;
+	stats.cornerCount = cornerCount;
+	stats.vertexCount = firstCorners.size();
+	stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	return stats;
+}
\ No newline at end of file
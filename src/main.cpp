@@ -2,11 +2,17 @@
 
 #include <QApplication>
 #include "MainWindow.h"
+#include "Trace.h"
 
 int main(int argc, char* argv[])
 {
 	QApplication app(argc, argv);
+	TRACE_THREAD_NAME("GUI");
 	MainWindow window;
 	window.show();
-	return app.exec();
+	const int result = app.exec();
+#if SIMPLE3DVIEWER_TRACING
+	Trace::writeJson(qEnvironmentVariable("SIMPLE3DVIEWER_TRACE", "simple3dviewer-trace.json"));
+#endif
+	return result;
 }
\ No newline at end of file